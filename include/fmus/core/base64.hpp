@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace fmus::core {
+
+// Standard base64 (RFC 4648) with padding. Vectorized with SSSE3 when the CPU has it.
+std::string base64Encode(const uint8_t* data, size_t size);
+
+inline std::string base64Encode(std::string_view data) {
+    return base64Encode(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+inline std::string base64Encode(const std::vector<uint8_t>& data) {
+    return base64Encode(data.data(), data.size());
+}
+
+// Returns false on characters outside the alphabet or a malformed tail.
+// Missing trailing padding is accepted.
+bool base64Decode(std::string_view input, std::vector<uint8_t>& output);
+
+} // namespace fmus::core
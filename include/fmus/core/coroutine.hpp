@@ -0,0 +1,423 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace fmus::core {
+
+class EventLoop;
+
+template<typename T>
+class Oneshot;
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            // Symmetric transfer back to the awaiting coroutine, so deep chains
+            // of co_await do not grow the stack
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+    T take() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void take() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+// Fire-and-forget frame used by EventLoop::spawn; destroys itself when done
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+};
+
+} // namespace detail
+
+// Lazily started coroutine. Nothing runs until the task is awaited (or handed
+// to EventLoop::spawn); the result or exception is delivered to the awaiter.
+template<typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool isValid() const { return static_cast<bool>(handle_); }
+
+    struct Awaiter {
+        Handle handle;
+
+        bool await_ready() const noexcept { return !handle || handle.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume() { return handle.promise().take(); }
+    };
+
+    Awaiter operator co_await() const& noexcept { return Awaiter{handle_}; }
+    Awaiter operator co_await() const&& noexcept { return Awaiter{handle_}; }
+
+private:
+    Handle handle_;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+// Coroutine scheduler on a small pool of threads sharing one epoll instance.
+//
+// Suspended flows cost only their coroutine frame: a sleeping flow is an
+// entry in the timer heap, a flow waiting on a socket is an epoll
+// registration, and a flow waiting on a Oneshot is a handle stored in it.
+// Threads only run flows that are ready, so none of them ever blocks on
+// behalf of a single flow.
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerCallback = std::function<void()>;
+
+    struct Config {
+        size_t threads = 1;
+        size_t batch_size = 64; // Ready flows run between two epoll polls
+    };
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    void setConfig(const Config& config); // Takes effect on the next start()
+    bool start();
+    void stop(); // Runs flows that are already ready; suspended flows stay suspended
+    bool isRunning() const { return running_; }
+
+    // Starts a flow on a loop thread; the loop owns it until it completes.
+    // A flow's result, if any, is discarded.
+    bool spawn(Task<void> task);
+
+    template<typename T>
+    bool spawn(Task<T> task) {
+        return spawn(discard(std::move(task)));
+    }
+
+    // Resumes a suspended coroutine on a loop thread
+    bool post(std::coroutine_handle<> handle);
+
+    // Timer callbacks run on a loop thread; cancelTimer returns false once
+    // the callback has been taken to run
+    uint64_t addTimer(Clock::time_point deadline, TimerCallback callback);
+    bool cancelTimer(uint64_t id);
+
+    // Resumes with true once fd is readable, false on timeout or error.
+    // A zero timeout waits indefinitely.
+    Task<bool> readable(int fd, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    void forget(int fd); // Call before closing a watched fd
+
+    // Awaitable that moves the calling coroutine onto a loop thread
+    struct ScheduleAwaiter {
+        EventLoop& loop;
+
+        bool await_ready() const noexcept { return EventLoop::current() == &loop; }
+        bool await_suspend(std::coroutine_handle<> handle) { return loop.post(handle); }
+        void await_resume() const noexcept {}
+    };
+
+    ScheduleAwaiter schedule() { return ScheduleAwaiter{*this}; }
+
+    // The loop whose thread is running the caller, if any
+    static EventLoop* current();
+
+    // Statistics
+    struct Stats {
+        uint64_t flows_spawned = 0;
+        uint64_t flows_failed = 0; // Ended with an exception
+        size_t flows_active = 0;
+        uint64_t resumed = 0;
+        uint64_t timers_fired = 0;
+        size_t timers_pending = 0;
+        size_t fds_watched = 0;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    static detail::Detached runFlow(EventLoop* loop, Task<void> task);
+
+    template<typename T>
+    static Task<void> discard(Task<T> task) {
+        co_await task;
+    }
+
+    bool watch(int fd, std::shared_ptr<Oneshot<bool>> ready);
+    void unwatch(int fd, const std::shared_ptr<Oneshot<bool>>& ready);
+    void threadLoop();
+    void runTimers();
+    void armTimer(Clock::time_point deadline);
+    void wake();
+
+    Config config_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_;
+    int epoll_fd_;
+    int wake_fd_;  // eventfd, readable while ready flows are queued
+    int timer_fd_; // timerfd armed for the earliest deadline
+
+    std::deque<std::coroutine_handle<>> ready_;
+    std::mutex ready_mutex_;
+
+    // Min-heap of (deadline, id); cancelled ids are dropped from the callback
+    // map and skipped when they reach the top
+    using TimerEntry = std::pair<Clock::time_point, uint64_t>;
+    std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timer_heap_;
+    std::unordered_map<uint64_t, TimerCallback> timers_;
+    uint64_t next_timer_id_;
+    Clock::time_point armed_deadline_;
+    mutable std::mutex timer_mutex_;
+
+    std::unordered_map<int, std::shared_ptr<Oneshot<bool>>> watchers_;
+    mutable std::mutex watch_mutex_;
+
+    std::mutex mutex_;
+
+    std::atomic<uint64_t> flows_spawned_{0};
+    std::atomic<uint64_t> flows_failed_{0};
+    std::atomic<size_t> flows_active_{0};
+    std::atomic<uint64_t> resumed_{0};
+    std::atomic<uint64_t> timers_fired_{0};
+};
+
+// Single-assignment result that a coroutine can await, e.g. a transaction's
+// final response. The value is kept once set, so awaiting after set() does
+// not suspend. One waiter at a time.
+template<typename T>
+class Oneshot : public std::enable_shared_from_this<Oneshot<T>> {
+public:
+    // Returns false if a value was already set
+    bool set(T value) {
+        std::coroutine_handle<> waiter;
+        EventLoop* loop;
+        uint64_t timer;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (value_) {
+                return false;
+            }
+            value_.emplace(std::move(value));
+            waiter = std::exchange(waiter_, {});
+            loop = loop_;
+            timer = std::exchange(timer_, 0);
+        }
+
+        if (waiter) {
+            if (timer != 0) {
+                loop->cancelTimer(timer);
+            }
+            resume(loop, waiter);
+        }
+        return true;
+    }
+
+    bool isSet() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return value_.has_value();
+    }
+
+    // Resumes with the value, or with nullopt once timeout passes. The
+    // timeout needs the awaiter to run on an event loop; zero waits forever.
+    struct Awaiter {
+        std::shared_ptr<Oneshot> state;
+        std::chrono::milliseconds timeout;
+
+        bool await_ready() const { return state->isSet(); }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            // The frame holding this awaiter may be resumed and destroyed by
+            // another thread as soon as the lock is released
+            std::shared_ptr<Oneshot> state = this->state;
+            std::lock_guard<std::mutex> lock(state->mutex_);
+            if (state->value_) {
+                return false;
+            }
+
+            state->waiter_ = handle;
+            state->loop_ = EventLoop::current();
+            uint64_t wait_id = ++state->wait_id_;
+            if (timeout.count() > 0 && state->loop_) {
+                std::weak_ptr<Oneshot> weak = state;
+                state->timer_ = state->loop_->addTimer(EventLoop::Clock::now() + timeout, [weak, wait_id] {
+                    if (auto self = weak.lock()) {
+                        self->expire(wait_id);
+                    }
+                });
+            }
+            return true;
+        }
+
+        std::optional<T> await_resume() const {
+            std::lock_guard<std::mutex> lock(state->mutex_);
+            return state->value_;
+        }
+    };
+
+    Awaiter wait(std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+        return Awaiter{this->shared_from_this(), timeout};
+    }
+
+private:
+    void expire(uint64_t wait_id) {
+        std::coroutine_handle<> waiter;
+        EventLoop* loop;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!waiter_ || wait_id != wait_id_) {
+                return; // Already resumed by set()
+            }
+            waiter = std::exchange(waiter_, {});
+            loop = loop_;
+            timer_ = 0;
+        }
+        resume(loop, waiter);
+    }
+
+    static void resume(EventLoop* loop, std::coroutine_handle<> waiter) {
+        // Back onto the waiter's loop; inline when it has none or has stopped
+        if (!loop || !loop->post(waiter)) {
+            waiter.resume();
+        }
+    }
+
+    std::optional<T> value_;
+    std::coroutine_handle<> waiter_;
+    EventLoop* loop_ = nullptr;
+    uint64_t timer_ = 0;
+    uint64_t wait_id_ = 0;
+    mutable std::mutex mutex_;
+};
+
+// Suspends the calling flow for duration on its event loop. Outside a loop
+// there is nothing else to run, so the thread sleeps instead.
+struct SleepAwaiter {
+    EventLoop::Clock::duration duration;
+
+    bool await_ready() const {
+        if (duration.count() <= 0) {
+            return true;
+        }
+        if (!EventLoop::current()) {
+            std::this_thread::sleep_for(duration);
+            return true;
+        }
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) const {
+        EventLoop::current()->addTimer(EventLoop::Clock::now() + duration, [handle] { handle.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+};
+
+inline SleepAwaiter sleepFor(EventLoop::Clock::duration duration) {
+    return SleepAwaiter{duration};
+}
+
+} // namespace fmus::core
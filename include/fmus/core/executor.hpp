@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+namespace fmus::core {
+
+// Task priorities, highest first
+enum class TaskPriority : uint8_t {
+    MEDIA = 0,
+    SIGNALING = 1,
+    MANAGEMENT = 2
+};
+
+// Shared task executor, one worker per core.
+//
+// Each worker owns a deque per priority. Idle workers steal from the back of
+// other workers' deques, highest priority first. Tasks posted with an
+// affinity key go to the worker owning that key and are never stolen, so
+// work for one call (keyed by its Call-ID) runs in order on one thread.
+class Executor {
+public:
+    using Task = std::function<void()>;
+
+    struct Config {
+        size_t threads = 0;       // 0 uses one per hardware thread
+        bool pin_threads = false; // Bind worker i to CPU i
+    };
+
+    Executor();
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    void setConfig(const Config& config); // Takes effect on the next start()
+    bool start();
+    void stop(); // Runs what is already queued, then joins the workers
+    bool isRunning() const { return running_; }
+
+    // Returns false and leaves the task untouched when the executor is not
+    // running, so the caller can run it inline
+    bool post(Task&& task, TaskPriority priority = TaskPriority::SIGNALING);
+    bool post(Task&& task, TaskPriority priority, uint64_t affinity);
+
+    size_t getThreadCount() const { return workers_.size(); }
+
+    // Stable key for affinity, e.g. from a Call-ID
+    static uint64_t affinityKey(std::string_view key);
+
+    // The executor whose worker is running the calling thread, if any
+    static Executor* current();
+
+    // Statistics
+    struct WorkerStats {
+        size_t queue_depth = 0;
+        uint64_t executed = 0;
+        uint64_t stolen = 0;         // Tasks this worker took from others
+        uint64_t steal_attempts = 0;
+    };
+
+    struct Stats {
+        uint64_t posted = 0;
+        uint64_t executed = 0;
+        uint64_t stolen = 0;
+        uint64_t steal_attempts = 0;
+        uint64_t rejected = 0;
+        uint64_t failed = 0; // Tasks that threw
+        size_t queue_depth = 0;
+        size_t queue_depth_by_priority[3] = {0, 0, 0};
+        std::vector<WorkerStats> workers;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    static constexpr size_t PRIORITY_COUNT = 3;
+
+    struct Worker {
+        std::thread thread;
+        std::deque<Task> pinned[PRIORITY_COUNT];    // Affinity tasks, owner only
+        std::deque<Task> stealable[PRIORITY_COUNT];
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+        bool sleeping = false;
+
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> stolen{0};
+        std::atomic<uint64_t> steal_attempts{0};
+    };
+
+    bool enqueue(Task&& task, TaskPriority priority, size_t index, bool pinned);
+    void workerLoop(size_t index);
+    bool popLocal(Worker& worker, Task& task);
+    bool steal(size_t thief, Task& task);
+    void run(Task& task);
+    void wakeIdleWorker(size_t except);
+
+    Config config_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> next_worker_{0};
+    std::atomic<size_t> stealable_count_{0};
+    std::atomic<size_t> sleeping_count_{0};
+    std::mutex mutex_;
+
+    std::atomic<uint64_t> posted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> failed_{0};
+};
+
+} // namespace fmus::core
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <ostream>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+namespace fmus::core {
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+// FNV-1a; pass a previous result as hash to continue it over more data
+constexpr uint64_t fnv1a(std::string_view data, uint64_t hash = FNV_OFFSET_BASIS) {
+    for (char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Identifier string stored inline up to Capacity bytes, with its hash kept
+// up to date as it is built. Equality compares the cached hashes before the
+// bytes, and std::hash returns the cached value, so map probes never rehash
+// or walk the characters of a non-matching key. Longer values spill to the
+// heap and keep working, without the inline benefit.
+template<size_t Capacity>
+class InlineString {
+public:
+    InlineString() = default;
+    InlineString(std::string_view value) { append(value); }
+    InlineString(const std::string& value) : InlineString(std::string_view(value)) {}
+    InlineString(const char* value) : InlineString(std::string_view(value)) {}
+
+    InlineString(const InlineString& other) { copyFrom(other); }
+    InlineString(InlineString&& other) noexcept { moveFrom(other); }
+
+    InlineString& operator=(const InlineString& other) {
+        if (this != &other) {
+            clear();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    InlineString& operator=(InlineString&& other) noexcept {
+        if (this != &other) {
+            heap_.reset();
+            heap_capacity_ = 0;
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    void append(std::string_view value) {
+        hash_ = fnv1a(value, hash_);
+
+        size_t new_size = size_ + value.size();
+        if (new_size > capacity()) {
+            // value may point into the old buffer, so copy before releasing it
+            size_t new_capacity = std::max(new_size, 2 * capacity());
+            auto heap = std::make_unique<char[]>(new_capacity);
+            std::memcpy(heap.get(), data(), size_);
+            std::memcpy(heap.get() + size_, value.data(), value.size());
+            heap_ = std::move(heap);
+            heap_capacity_ = static_cast<uint32_t>(new_capacity);
+        } else if (!value.empty()) {
+            std::memcpy(buffer() + size_, value.data(), value.size());
+        }
+        size_ = static_cast<uint32_t>(new_size);
+    }
+
+    void clear() {
+        size_ = 0;
+        hash_ = FNV_OFFSET_BASIS;
+    }
+
+    const char* data() const { return heap_ ? heap_.get() : inline_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool isInline() const { return !heap_; }
+    uint64_t hash() const { return hash_; }
+
+    std::string_view view() const { return std::string_view(data(), size_); }
+    std::string str() const { return std::string(data(), size_); }
+    operator std::string_view() const { return view(); }
+
+    friend bool operator==(const InlineString& a, const InlineString& b) {
+        return a.hash_ == b.hash_ && a.size_ == b.size_ &&
+               std::memcmp(a.data(), b.data(), a.size_) == 0;
+    }
+
+    friend bool operator==(const InlineString& a, std::string_view b) {
+        return a.view() == b;
+    }
+
+    friend bool operator==(const InlineString& a, const std::string& b) {
+        return a.view() == b;
+    }
+
+    friend bool operator==(const InlineString& a, const char* b) {
+        return a.view() == b;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const InlineString& value) {
+        return os << value.view();
+    }
+
+private:
+    char* buffer() { return heap_ ? heap_.get() : inline_; }
+    size_t capacity() const { return heap_ ? heap_capacity_ : Capacity; }
+
+    void copyFrom(const InlineString& other) {
+        if (other.size_ > capacity()) {
+            heap_ = std::make_unique<char[]>(other.size_);
+            heap_capacity_ = other.size_;
+        }
+        std::memcpy(buffer(), other.data(), other.size_);
+        size_ = other.size_;
+        hash_ = other.hash_;
+    }
+
+    void moveFrom(InlineString& other) {
+        if (other.heap_) {
+            heap_ = std::move(other.heap_);
+            heap_capacity_ = other.heap_capacity_;
+        } else {
+            std::memcpy(inline_, other.inline_, other.size_);
+        }
+        size_ = other.size_;
+        hash_ = other.hash_;
+        other.heap_capacity_ = 0;
+        other.clear();
+    }
+
+    char inline_[Capacity];
+    uint32_t size_ = 0;
+    uint32_t heap_capacity_ = 0;
+    uint64_t hash_ = FNV_OFFSET_BASIS;
+    std::unique_ptr<char[]> heap_;
+};
+
+} // namespace fmus::core
+
+template<size_t Capacity>
+struct std::hash<fmus::core::InlineString<Capacity>> {
+    size_t operator()(const fmus::core::InlineString<Capacity>& value) const noexcept {
+        return static_cast<size_t>(value.hash());
+    }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <sstream>
 #include <mutex>
@@ -22,22 +23,22 @@ public:
     static LogLevel getLevel();
     
     template<typename... Args>
-    static void debug(const std::string& format, Args&&... args) {
+    static void debug(std::string_view format, Args&&... args) {
         log(LogLevel::DEBUG, format, std::forward<Args>(args)...);
     }
     
     template<typename... Args>
-    static void info(const std::string& format, Args&&... args) {
+    static void info(std::string_view format, Args&&... args) {
         log(LogLevel::INFO, format, std::forward<Args>(args)...);
     }
     
     template<typename... Args>
-    static void warn(const std::string& format, Args&&... args) {
+    static void warn(std::string_view format, Args&&... args) {
         log(LogLevel::WARN, format, std::forward<Args>(args)...);
     }
     
     template<typename... Args>
-    static void error(const std::string& format, Args&&... args) {
+    static void error(std::string_view format, Args&&... args) {
         log(LogLevel::ERROR, format, std::forward<Args>(args)...);
     }
 
@@ -46,7 +47,8 @@ private:
     static std::mutex mutex_;
     
     template<typename... Args>
-    static void log(LogLevel level, const std::string& format, Args&&... args) {
+    static void log(LogLevel level, std::string_view format, Args&&... args) {
+        // Filtered messages cost no allocation
         if (level < current_level_) return;
         
         std::lock_guard<std::mutex> lock(mutex_);
@@ -72,7 +74,7 @@ private:
         }
         
         // Simple format string replacement (basic implementation)
-        std::string message = formatString(format, std::forward<Args>(args)...);
+        std::string message = formatString(std::string(format), std::forward<Args>(args)...);
         
         std::cout << "[" << oss.str() << "] [" << level_str << "] " << message << std::endl;
     }
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace fmus::core {
+
+// Size-class allocator for per-call objects (messages, transactions, dialogs
+// and their buffers).
+//
+// Blocks of each size class are carved from 64 KB slabs and recycled through
+// per-thread free lists, so steady-state allocation and release touch no
+// lock. A thread whose list grows past the cache limit returns a batch to
+// the shared list; an empty list refills a batch from it. Slabs are kept for
+// reuse and never returned upstream. Requests larger than the biggest class
+// or with unusual alignment go straight to the upstream resource.
+class SlabPool : public std::pmr::memory_resource {
+public:
+    static constexpr size_t MAX_BLOCK_SIZE = 4096;
+    static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+    // Process-wide pool; lives until exit so thread caches can always drain
+    static SlabPool& instance();
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // Statistics; only the slow paths are counted, to keep the fast path
+    // free of shared writes
+    struct Stats {
+        uint64_t upstream_allocations = 0; // Oversized requests
+        uint64_t slabs = 0;
+        uint64_t refills = 0;              // Batches moved from the shared lists
+        uint64_t spills = 0;               // Batches returned to the shared lists
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    friend struct ThreadCache;
+
+    static constexpr size_t CLASS_COUNT = 9; // 16, 32, ... 4096 bytes
+    static constexpr size_t BATCH_SIZE = 32;
+    static constexpr size_t CACHE_LIMIT = 4 * BATCH_SIZE;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SharedList {
+        FreeBlock* head = nullptr;
+        size_t count = 0;
+        std::mutex mutex;
+    };
+
+    SlabPool();
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    static size_t sizeClass(size_t bytes);
+    static size_t classSize(size_t size_class) { return size_t(16) << size_class; }
+
+    // Moves up to BATCH_SIZE blocks into the caller's list; carves a slab if needed
+    size_t refill(size_t size_class, FreeBlock*& head);
+    void spill(size_t size_class, FreeBlock* head, FreeBlock* tail, size_t count);
+
+    SharedList shared_[CLASS_COUNT];
+    std::vector<void*> slabs_;
+    std::mutex slab_mutex_;
+    std::pmr::memory_resource* upstream_;
+
+    std::atomic<uint64_t> upstream_allocations_{0};
+    std::atomic<uint64_t> slab_count_{0};
+    std::atomic<uint64_t> refills_{0};
+    std::atomic<uint64_t> spills_{0};
+};
+
+// Stateless allocator over SlabPool::instance(). Containers using it copy
+// and move like std::allocator ones, unlike pmr containers whose copies fall
+// back to the default resource.
+template<typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    PoolAllocator() noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(SlabPool::instance().allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        SlabPool::instance().deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+};
+
+// shared_ptr whose object and control block share one pooled block
+template<typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args&&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+} // namespace fmus::core
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace fmus::core {
+
+// Cryptographically secure random numbers for nonces, SIP branches, tags,
+// Call-IDs and keys. Each thread runs its own ChaCha20 (RFC 8439)
+// keystream, seeded from getrandom(2) and handed out from a buffer, so a
+// call costs no system call and no locking. The key is replaced from the
+// keystream on every refill, so later state cannot recover earlier output;
+// the kernel is asked for a fresh seed every megabyte and after fork().
+class SecureRandom {
+public:
+    static void fill(void* data, size_t size);
+    static std::vector<uint8_t> bytes(size_t size);
+    static uint32_t next32();
+    static uint64_t next64();
+
+    // Tokens safe in any SIP or URI context. Hex carries 4 bits per
+    // character, base32 (a-z, 2-7) carries 5.
+    static std::string hexToken(size_t length);
+    static std::string base32Token(size_t length);
+    static void appendHex(std::string& out, size_t length);
+    static void appendBase32(std::string& out, size_t length);
+};
+
+} // namespace fmus::core
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace fmus::core {
+
+// SHA-1 (FIPS 180-4). Uses the x86 SHA extensions when the CPU has them.
+// Still required by the WebSocket handshake and SDP fingerprints; not for new security uses.
+class Sha1 {
+public:
+    static constexpr size_t DIGEST_SIZE = 20;
+    using Digest = std::array<uint8_t, DIGEST_SIZE>;
+
+    Sha1();
+
+    void update(const uint8_t* data, size_t size);
+    void update(std::string_view data) {
+        update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+    Digest finalize();
+    void reset();
+
+    // One-shot helpers
+    static Digest digest(const uint8_t* data, size_t size);
+    static Digest digest(std::string_view data) {
+        return digest(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
+    static bool isHardwareAccelerated();
+
+private:
+    void processBlocks(const uint8_t* data, size_t block_count);
+
+    uint32_t state_[5];
+    uint8_t buffer_[64];
+    size_t buffer_size_;
+    uint64_t total_size_;
+};
+
+} // namespace fmus::core
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "../sip/dialog.hpp"
+#include "../network/transport.hpp"
+#include "../media/codec.hpp"
+#include "../core/coroutine.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include <cstdint>
+
+namespace fmus::enterprise {
+
+// Per-call state of the B2BUA, one slot of the engine's call table. Slots
+// are reused, so flows hold the generation they were started for and give
+// up once it changes. Media relays copy what they need when they start and
+// never read the table.
+struct B2buaCall {
+    enum class State : uint8_t {
+        FREE,
+        INVITING,    // Outbound INVITE sent
+        EARLY,       // Provisional response relayed to the inbound leg
+        ANSWERED,
+        CANCELLING,  // Inbound leg cancelled before the answer
+        TERMINATING  // BYE sent to one leg
+    };
+
+    struct Leg {
+        sip::SipIdentifier call_id;
+        network::SocketAddress signaling; // Where this leg's requests and responses go
+        network::SocketAddress media;     // Peer RTP address from its SDP
+        network::RtpPortPair ports;       // Local RTP port and socket from the pool
+        uint8_t payload_type = 0;
+        std::shared_ptr<sip::Dialog> dialog;           // Set once the leg is answered
+        std::shared_ptr<sip::Transaction> transaction; // INVITE or BYE in progress
+    };
+
+    static constexpr size_t INBOUND = 0;
+    static constexpr size_t OUTBOUND = 1;
+
+    uint32_t generation = 0;
+    State state = State::FREE;
+    Leg legs[2];
+    std::shared_ptr<std::atomic<bool>> media_active; // Cleared to stop the relays
+    std::chrono::steady_clock::time_point created;
+    std::vector<uint8_t> offered_formats; // Inbound offer
+    sip::SipMessage invite;               // Inbound INVITE, answered once the outbound leg is
+};
+
+// Back-to-back user agent: answers each inbound INVITE by placing an
+// outbound call to the next hop, then bridges the two dialogs. RTP for both
+// legs is received on local ports from a pre-bound port pool and relayed
+// between them, transcoded when the legs settled on different G.711
+// variants.
+// Signaling runs on the SIP transport thread; outbound legs, teardown and
+// media run as flows on the engine's event loop.
+class B2buaEngine {
+public:
+    struct Config {
+        network::SocketAddress sip_address{"127.0.0.1", 5070};
+        network::SocketAddress next_hop{"127.0.0.1", 5080}; // Receives the outbound legs
+        std::string media_ip = "127.0.0.1";
+        uint16_t rtp_port_min = 20000;
+        uint16_t rtp_port_max = 39999;
+        bool pre_bind_ports = true; // Bind the RTP range at start() instead of per call
+        bool batched_relay = true;  // Connected sockets, GRO/GSO batches for untranscoded media
+        size_t max_calls = 10000;
+        size_t media_threads = 1;
+        std::vector<uint8_t> outbound_codecs; // Offered to the next hop; empty = the inbound offer
+        std::chrono::milliseconds answer_timeout{60000};
+    };
+
+    B2buaEngine();
+    ~B2buaEngine();
+
+    B2buaEngine(const B2buaEngine&) = delete;
+    B2buaEngine& operator=(const B2buaEngine&) = delete;
+
+    void setConfig(const Config& config); // Takes effect on the next start()
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    // Statistics
+    struct Stats {
+        uint64_t calls_received = 0;
+        uint64_t calls_answered = 0;
+        uint64_t calls_rejected = 0;  // No slot, port or usable offer
+        uint64_t calls_failed = 0;    // Outbound leg refused, timed out or cancelled
+        uint64_t calls_completed = 0; // Hung up after the answer
+        uint64_t active_calls = 0;
+        uint64_t retransmissions = 0;
+        uint64_t rtp_relayed = 0;
+        uint64_t rtp_transcoded = 0;
+        uint64_t rtp_dropped = 0;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    using Leg = B2buaCall::Leg;
+
+    void onMessage(const sip::SipMessage& message, const network::SocketAddress& from);
+    void onInvite(const sip::SipMessage& invite, const network::SocketAddress& from);
+    void onAck(const sip::SipMessage& ack);
+    void onBye(const sip::SipMessage& bye, const network::SocketAddress& from);
+    void onCancel(const sip::SipMessage& cancel, const network::SocketAddress& from);
+    void onResponse(const sip::SipMessage& response);
+
+    core::Task<void> runCall(uint32_t slot, uint32_t generation);
+    core::Task<void> hangup(uint32_t slot, uint32_t generation, size_t leg);
+    core::Task<std::optional<sip::SipMessage>> sendInvite(uint32_t slot, uint32_t generation, sip::SipMessage invite);
+    core::Task<std::optional<sip::SipMessage>> sendRequest(uint32_t slot, uint32_t generation, size_t leg,
+                                                           sip::SipMessage request);
+    core::Task<void> relayMedia(std::shared_ptr<network::UdpSocket> from, std::shared_ptr<network::UdpSocket> to,
+                                network::SocketAddress destination, std::shared_ptr<media::CodecManager> transcoder,
+                                uint8_t payload_type, std::shared_ptr<std::atomic<bool>> active);
+
+    // Call table; callers hold mutex_
+    B2buaCall* findCall(uint32_t slot, uint32_t generation);
+    std::optional<uint32_t> findSlot(std::string_view call_id) const;
+    bool openMedia(Leg& leg);
+    void closeMedia(Leg& leg);
+    void startMedia(B2buaCall& call);
+    void releaseCall(uint32_t slot);
+
+    sip::SipMessage createOutboundInvite(const B2buaCall& call) const;
+    void respond(const sip::SipMessage& request, sip::SipResponseCode code, const network::SocketAddress& to);
+    void send(const sip::SipMessage& message, const network::SocketAddress& to);
+
+    Config config_;
+    std::string contact_;
+
+    network::SipTransport transport_;
+    network::RtpPortPool ports_;
+    core::EventLoop loop_;
+
+    std::vector<B2buaCall> calls_;
+    std::vector<uint32_t> free_slots_;
+    std::unordered_map<sip::SipIdentifier, uint32_t> slots_by_call_id_; // Both legs' Call-IDs
+    uint64_t next_call_number_ = 0;
+
+    std::atomic<bool> running_;
+    mutable std::mutex mutex_;
+
+    // Statistics
+    std::atomic<uint64_t> calls_received_{0};
+    std::atomic<uint64_t> calls_answered_{0};
+    std::atomic<uint64_t> calls_rejected_{0};
+    std::atomic<uint64_t> calls_failed_{0};
+    std::atomic<uint64_t> calls_completed_{0};
+    std::atomic<uint64_t> active_calls_{0};
+    std::atomic<uint64_t> retransmissions_{0};
+    std::atomic<uint64_t> rtp_relayed_{0};
+    std::atomic<uint64_t> rtp_transcoded_{0};
+    std::atomic<uint64_t> rtp_dropped_{0};
+};
+
+// SIP load generator for B2BUA benchmarks. Places calls at a fixed rate
+// from a UAC address towards the target, answers the resulting outbound
+// legs on a UAS address, holds each call with RTP flowing both ways and
+// hangs up from the UAC side. It does not retransmit, so on a lossy path
+// lost messages show up as failed calls.
+class CallGenerator {
+public:
+    struct Config {
+        network::SocketAddress target{"127.0.0.1", 5070};      // The B2BUA
+        network::SocketAddress uac_address{"127.0.0.1", 5090}; // Places calls
+        network::SocketAddress uas_address{"127.0.0.1", 5080}; // Answers outbound legs
+        std::string media_ip = "127.0.0.1";
+        double calls_per_second = 100;
+        size_t total_calls = 0;    // 0 = until stopped
+        size_t max_concurrent = 0; // 0 = unlimited
+        std::chrono::milliseconds hold_time{1000};
+        std::chrono::milliseconds rtp_interval{20}; // 0 = signaling only
+        std::vector<uint8_t> codecs{0};             // Offered by the UAC; the UAS takes the first offered
+        size_t threads = 1;
+    };
+
+    CallGenerator();
+    ~CallGenerator();
+
+    CallGenerator(const CallGenerator&) = delete;
+    CallGenerator& operator=(const CallGenerator&) = delete;
+
+    void setConfig(const Config& config);
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+    bool isFinished() const; // All of total_calls placed and ended
+
+    // Statistics
+    struct Stats {
+        uint64_t calls_attempted = 0;
+        uint64_t calls_answered = 0;
+        uint64_t calls_failed = 0;
+        uint64_t calls_completed = 0; // BYE answered with 200
+        uint64_t active_calls = 0;
+        uint64_t rtp_sent = 0;
+        uint64_t rtp_received = 0;
+        uint64_t setup_time_us = 0; // Sum of INVITE-to-200 times over answered calls
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    void onUacMessage(const sip::SipMessage& message, const network::SocketAddress& from);
+    void onUasMessage(const sip::SipMessage& message, const network::SocketAddress& from);
+
+    core::Task<void> pace();
+    core::Task<void> placeCall(uint64_t number);
+    core::Task<std::optional<sip::SipMessage>> request(const std::string& call_id, const sip::SipMessage& message);
+    core::Task<void> sendMedia(std::shared_ptr<network::UdpSocket> socket, network::SocketAddress destination,
+                               uint8_t payload_type, std::shared_ptr<std::atomic<bool>> active);
+    core::Task<void> receiveMedia(std::shared_ptr<network::UdpSocket> socket);
+
+    Config config_;
+
+    network::SipTransport uac_transport_;
+    network::SipTransport uas_transport_;
+    std::shared_ptr<network::UdpSocket> uac_media_;
+    std::shared_ptr<network::UdpSocket> uas_media_;
+    core::EventLoop loop_;
+
+    // UAC requests awaiting a final response, and UAS calls sending media
+    std::unordered_map<std::string, std::shared_ptr<core::Oneshot<sip::SipMessage>>> pending_;
+    std::unordered_map<std::string, std::shared_ptr<std::atomic<bool>>> answered_;
+
+    std::atomic<bool> running_;
+    std::atomic<bool> pacing_{false};
+    mutable std::mutex mutex_;
+
+    // Statistics
+    std::atomic<uint64_t> calls_attempted_{0};
+    std::atomic<uint64_t> calls_answered_{0};
+    std::atomic<uint64_t> calls_failed_{0};
+    std::atomic<uint64_t> calls_completed_{0};
+    std::atomic<uint64_t> active_calls_{0};
+    std::atomic<uint64_t> rtp_sent_{0};
+    std::atomic<uint64_t> rtp_received_{0};
+    std::atomic<uint64_t> setup_time_us_{0};
+};
+
+} // namespace fmus::enterprise
@@ -2,6 +2,11 @@
 
 #include "../sip/message.hpp"
 #include "../network/socket.hpp"
+#include "../network/transport.hpp"
+#include "../sip/registrar.hpp"
+#include "offline_queue.hpp"
+#include "recording.hpp"
+#include "speaker.hpp"
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -10,6 +15,11 @@
 #include <chrono>
 #include <atomic>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_set>
+#include <deque>
+#include <optional>
 
 namespace fmus::enterprise {
 
@@ -111,6 +121,7 @@ struct ConferenceRoom {
     std::chrono::system_clock::time_point created_time;
     bool recording_enabled = false;
     std::string recording_path;
+    std::shared_ptr<DominantSpeakerDetector> speakers; // Shared by copies of the room
     
     ConferenceRoom() : type(ConferenceType::AUDIO_ONLY), created_time(std::chrono::system_clock::now()) {}
     
@@ -120,15 +131,71 @@ struct ConferenceRoom {
     void removeParticipant(const std::string& user_id);
 };
 
+// Interned user identifier. Presence indexes hold these instead of strings.
+using UserId = uint32_t;
+
+// Maps user names to dense IDs and back. Not synchronized; owners lock around it.
+class UserIdTable {
+public:
+    UserId intern(const std::string& user);
+    std::optional<UserId> find(const std::string& user) const;
+    const std::string& name(UserId id) const { return names_[id]; }
+    size_t size() const { return names_.size(); }
+
+private:
+    std::unordered_map<std::string, UserId> ids_;
+    std::deque<std::string> names_; // Indexed by ID, references stay valid
+};
+
+// Sorted-vector set of user IDs: contiguous, binary-searched, cheap to snapshot
+class UserIdSet {
+public:
+    bool insert(UserId id);
+    bool erase(UserId id);
+    bool contains(UserId id) const;
+
+    size_t size() const { return ids_.size(); }
+    bool empty() const { return ids_.empty(); }
+    const std::vector<UserId>& ids() const { return ids_; }
+
+private:
+    std::vector<UserId> ids_;
+};
+
 // Presence Manager
+//
+// State changes are coalesced per presentity: the first change opens a
+// window, later changes inside it only overwrite the stored state, and when
+// the window closes the dispatcher thread fans the latest state out. Updates
+// due in the same pass are grouped per subscriber, so a subscriber watching
+// many presentities that change together gets one batch instead of one
+// notification per presentity. Every entry also sits on an expiry min-heap;
+// the dispatcher wakes for the earliest deadline, so expiry costs are
+// proportional to the entries actually expiring, and expired presentities
+// are reported to their subscribers as offline.
 class PresenceManager {
 public:
     using PresenceUpdateCallback = std::function<void(const PresenceInfo&)>;
     using SubscriptionCallback = std::function<void(const std::string&, const std::string&)>; // subscriber, presentity
+    using NotificationCallback = std::function<void(const std::string&, const std::vector<PresenceInfo>&)>; // subscriber, updates
+
+    struct Config {
+        std::chrono::milliseconds coalescing_window{200};
+        size_t max_batch_size = 64; // Presentities per notification
+        std::chrono::seconds presence_timeout{300};
+    };
 
     PresenceManager();
     ~PresenceManager();
     
+    // Dispatcher; without it updates are delivered synchronously
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    void setConfig(const Config& config);
+    Config getConfig() const;
+
     // Presence operations
     bool updatePresence(const std::string& user_id, PresenceState state, const std::string& status = "");
     PresenceInfo getPresence(const std::string& user_id) const;
@@ -143,49 +210,169 @@ public:
     // Callbacks
     void setPresenceUpdateCallback(PresenceUpdateCallback callback) { presence_callback_ = callback; }
     void setSubscriptionCallback(SubscriptionCallback callback) { subscription_callback_ = callback; }
+    void setNotificationCallback(NotificationCallback callback) { notification_callback_ = callback; }
+
+    // The dialog a subscriber's SUBSCRIBE established (RFC 6665). Every
+    // NOTIFY to the subscriber goes out inside it with the next CSeq.
+    struct SubscriptionDialog {
+        std::string call_id;
+        std::string local_uri;     // Resource the subscriber subscribed to
+        std::string local_tag;     // Our To tag in the 2xx to the SUBSCRIBE
+        std::string remote_uri;    // Subscriber's From URI
+        std::string remote_tag;    // Subscriber's From tag
+        std::string remote_target; // Subscriber's Contact; remote_uri when empty
+        network::SocketAddress address; // Where NOTIFYs are sent; unset for callback-only delivery
+        bool event_list = true;    // Resource list subscription (RFC 4662): batches carry RLMI
+        uint32_t cseq = 0;         // Last CSeq sent
+        uint32_t version = 0;      // Next RLMI version
+    };
     
-    // Maintenance
+    void setSubscriptionDialog(const std::string& subscriber, const SubscriptionDialog& dialog);
+    std::optional<SubscriptionDialog> getSubscriptionDialog(const std::string& subscriber) const;
+    
+    // Sends each notification as a NOTIFY to subscribers whose dialog has an
+    // address; local_address goes into Via and Contact
+    void setTransport(network::SipTransport* transport, const network::SocketAddress& local_address);
+
+    // Next NOTIFY (Event: presence) in the subscriber's dialog, created on
+    // first use when none was set. List subscriptions get a
+    // multipart/related body with an RLMI root and one PIDF part per
+    // presentity, full state in the first one; others get a single PIDF.
+    sip::SipMessage createNotifyMessage(const std::string& subscriber, const std::vector<PresenceInfo>& updates);
+    
+    // Expires due entries now; only needed when the dispatcher is not running
     void cleanupExpiredPresence();
     
     // Statistics
     size_t getPresenceCount() const;
     size_t getSubscriptionCount() const;
 
+    struct Stats {
+        uint64_t updates_received = 0;
+        uint64_t updates_coalesced = 0;  // Absorbed by an open window
+        uint64_t presentities_flushed = 0;
+        uint64_t notifications_sent = 0; // Batches delivered to the callback or the transport
+        uint64_t deliveries = 0;         // Presentity updates inside those batches
+        uint64_t expirations = 0;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
 private:
-    void notifySubscribers(const PresenceInfo& presence);
+    struct PendingFlush {
+        UserId presentity;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    struct ExpiryEntry {
+        std::chrono::steady_clock::time_point deadline;
+        UserId presentity;
+
+        bool operator>(const ExpiryEntry& other) const { return deadline > other.deadline; }
+    };
+
+    void dispatcherLoop();
+    void flush(const std::vector<UserId>& presentities);
+    void scheduleExpiry(UserId presentity, std::chrono::steady_clock::time_point deadline);
+    std::vector<UserId> collectExpired(std::chrono::steady_clock::time_point now);
+    void removeExpired(const std::vector<UserId>& presentities);
+    
+    UserIdTable user_ids_;
+    std::unordered_map<UserId, PresenceInfo> presence_info_;
+    std::unordered_map<UserId, UserIdSet> subscribers_;   // presentity -> subscribers
+    std::unordered_map<UserId, UserIdSet> subscriptions_; // subscriber -> presentities
+    std::unordered_map<UserId, SubscriptionDialog> dialogs_; // By subscriber
     
-    std::unordered_map<std::string, PresenceInfo> presence_info_;
-    std::unordered_map<std::string, std::vector<std::string>> subscriptions_; // presentity -> subscribers
+    network::SipTransport* transport_ = nullptr;
+    network::SocketAddress local_address_;
     
+    // Presentities with an open coalescing window, in deadline order
+    std::deque<PendingFlush> pending_;
+    std::unordered_set<UserId> pending_set_;
+
+    // Min-heap of expiry deadlines. Entries superseded by a later update stay
+    // in the heap and are skipped when they surface (lazy deletion).
+    std::vector<ExpiryEntry> expiry_heap_;
+    std::unordered_map<UserId, std::chrono::steady_clock::time_point> expiry_deadlines_; // Current deadline
+
+    Config config_;
+    std::atomic<bool> running_;
+    std::thread dispatcher_thread_;
+    std::condition_variable dispatcher_cv_;
+
     PresenceUpdateCallback presence_callback_;
     SubscriptionCallback subscription_callback_;
+    NotificationCallback notification_callback_;
     
+    std::atomic<uint64_t> updates_received_{0};
+    std::atomic<uint64_t> updates_coalesced_{0};
+    std::atomic<uint64_t> presentities_flushed_{0};
+    std::atomic<uint64_t> notifications_sent_{0};
+    std::atomic<uint64_t> deliveries_{0};
+    std::atomic<uint64_t> expirations_{0};
+
     mutable std::mutex mutex_;
 };
 
-// Instant Messaging Manager
+class MessageStore;
+
+// Instant Messaging Manager (messages live in a MessageStore, in memory until
+// getStore().open() is given a directory)
+//
+// Once a registrar is attached, messages for recipients without a current
+// registration are queued instead of delivered. A registration hands the
+// recipient's whole queue to the batch delivery callback on the delivery
+// thread, away from the registrar's lock. The registrar's own registration
+// callback keeps running ahead of ours until detachRegistrar() restores it.
 class InstantMessagingManager {
 public:
     using MessageCallback = std::function<void(const InstantMessage&)>;
     using DeliveryCallback = std::function<void(const std::string&, bool)>; // message_id, delivered
+    using BatchDeliveryCallback = std::function<void(const std::string&, const std::vector<InstantMessage>&)>; // recipient, messages
 
     InstantMessagingManager();
     ~InstantMessagingManager();
     
+    // Delivery thread; without it queued messages are delivered synchronously
+    bool start();
+    void stop();
+    
+    // Online tracking
+    void attachRegistrar(sip::SipRegistrar& registrar);
+    void detachRegistrar();
+    void setUserOnline(const std::string& user_id, bool online);
+    bool isUserOnline(const std::string& user_id) const;
+    
     // Message operations
     std::string sendMessage(const std::string& from, const std::string& to, 
                            const std::string& content, MessageType type = MessageType::TEXT);
     bool markDelivered(const std::string& message_id);
     bool markRead(const std::string& message_id);
     
-    // Message retrieval
+    // Message retrieval, newest `limit` messages in chronological order
     std::vector<InstantMessage> getMessages(const std::string& user_id, size_t limit = 50) const;
     std::vector<InstantMessage> getConversation(const std::string& user1, const std::string& user2, size_t limit = 50) const;
     InstantMessage getMessage(const std::string& message_id) const;
     
+    // Time-range paging: messages with from <= timestamp < until
+    std::vector<InstantMessage> getMessages(const std::string& user_id,
+                                            std::chrono::system_clock::time_point from,
+                                            std::chrono::system_clock::time_point until,
+                                            size_t limit = 50) const;
+    std::vector<InstantMessage> getConversation(const std::string& user1, const std::string& user2,
+                                                std::chrono::system_clock::time_point from,
+                                                std::chrono::system_clock::time_point until,
+                                                size_t limit = 50) const;
+    
+    MessageStore& getStore() { return *store_; }
+    
     // Callbacks
     void setMessageCallback(MessageCallback callback) { message_callback_ = callback; }
     void setDeliveryCallback(DeliveryCallback callback) { delivery_callback_ = callback; }
+    void setBatchDeliveryCallback(BatchDeliveryCallback callback) { batch_delivery_callback_ = callback; }
+    
+    OfflineMessageQueue& getOfflineQueue() { return offline_queue_; }
     
     // Statistics
     size_t getMessageCount() const;
@@ -193,12 +380,26 @@ public:
 
 private:
     std::string generateMessageId() const;
+    void deliveryLoop();
+    void deliverQueued(const std::string& user_id);
+    
+    std::unique_ptr<MessageStore> store_;
+    OfflineMessageQueue offline_queue_;
     
-    std::unordered_map<std::string, InstantMessage> messages_;
-    std::unordered_map<std::string, std::vector<std::string>> user_messages_; // user_id -> message_ids
+    sip::SipRegistrar* registrar_;
+    sip::SipRegistrar::RegistrationCallback previous_registration_callback_;
+    
+    std::atomic<bool> tracking_online_;
+    std::unordered_set<std::string> online_users_;
+    std::deque<std::string> ready_users_; // Registered with messages waiting
+    
+    std::atomic<bool> running_;
+    std::thread delivery_thread_;
+    std::condition_variable delivery_cv_;
     
     MessageCallback message_callback_;
     DeliveryCallback delivery_callback_;
+    BatchDeliveryCallback batch_delivery_callback_;
     
     mutable std::mutex mutex_;
 };
@@ -238,11 +439,14 @@ private:
     mutable std::mutex mutex_;
 };
 
+class CallRecordingManager;
+
 // Conference Manager
 class ConferenceManager {
 public:
     using ConferenceCallback = std::function<void(const std::string&, const std::string&)>; // room_id, event
     using ParticipantCallback = std::function<void(const std::string&, const ConferenceParticipant&, bool)>; // room_id, participant, joined
+    using SpeakerCallback = std::function<void(const std::string&, const std::string&)>; // room_id, user_id (empty for none)
 
     ConferenceManager();
     ~ConferenceManager();
@@ -264,9 +468,22 @@ public:
     bool stopRecording(const std::string& room_id);
     bool isRecording(const std::string& room_id) const;
     
+    // Room recordings go through the recording manager, keyed by room ID
+    void setRecordingManager(CallRecordingManager* recording_manager) { recording_manager_ = recording_manager; }
+    
+    // Speaker detection. audio_level_id is the participant's negotiated
+    // RFC 6464 extmap ID. Media threads should hold the detector and slot
+    // from getSpeakerDetector(); onAudioPacket() looks both up per packet.
+    bool setAudioLevelId(const std::string& room_id, const std::string& user_id, uint8_t audio_level_id);
+    std::shared_ptr<DominantSpeakerDetector> getSpeakerDetector(const std::string& room_id) const;
+    bool onAudioPacket(const std::string& room_id, const std::string& user_id, const uint8_t* packet, size_t size);
+    std::string getDominantSpeaker(const std::string& room_id) const;
+    std::vector<std::string> getActiveSpeakers(const std::string& room_id, size_t count) const;
+    
     // Callbacks
     void setConferenceCallback(ConferenceCallback callback) { conference_callback_ = callback; }
     void setParticipantCallback(ParticipantCallback callback) { participant_callback_ = callback; }
+    void setSpeakerCallback(SpeakerCallback callback) { speaker_callback_ = callback; } // Runs on a media thread
     
     // Statistics
     size_t getConferenceCount() const;
@@ -278,9 +495,11 @@ private:
     void notifyParticipantEvent(const std::string& room_id, const ConferenceParticipant& participant, bool joined);
     
     std::unordered_map<std::string, ConferenceRoom> conferences_;
+    CallRecordingManager* recording_manager_;
     
     ConferenceCallback conference_callback_;
     ParticipantCallback participant_callback_;
+    SpeakerCallback speaker_callback_;
     
     mutable std::mutex mutex_;
 };
@@ -303,6 +522,17 @@ public:
     bool isRecording(const std::string& call_id) const;
     std::string getRecordingPath(const std::string& call_id) const;
     std::vector<std::string> getActiveRecordings() const;
+
+    // Media taps. Media threads should hold the stream from getStream() and
+    // write to it directly; these look the call up on every packet.
+    std::shared_ptr<RecordingStream> getStream(const std::string& call_id) const;
+    bool recordRtp(const std::string& call_id, const uint8_t* packet, size_t size);
+    bool recordAudio(const std::string& call_id, const int16_t* samples, size_t count);
+
+    // Writer lifecycle; without a running writer pages are written inline
+    bool start() { return writer_.start(); }
+    void stop() { writer_.stop(); }
+    RecordingWriter& getWriter() { return writer_; }
     
     // Callbacks
     void setRecordingCallback(RecordingCallback callback) { recording_callback_ = callback; }
@@ -318,8 +548,10 @@ private:
         bool active = false;
         bool paused = false;
         std::chrono::system_clock::time_point start_time;
+        std::shared_ptr<RecordingStream> stream;
     };
     
+    RecordingWriter writer_;
     std::unordered_map<std::string, RecordingSession> recordings_;
     
     RecordingCallback recording_callback_;
@@ -344,6 +576,13 @@ public:
     bool initialize();
     void shutdown();
     
+    // Registrations drive offline message delivery until shutdown()
+    void attachRegistrar(sip::SipRegistrar& registrar);
+    
+    // Where offline message queues spill past their in-memory depth; without
+    // one, messages beyond it are not queued (see OfflineMessageQueue)
+    bool setOfflineQueueDirectory(const std::string& directory);
+    
     // Maintenance
     void performMaintenance();
     
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "features.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <optional>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+
+namespace fmus::enterprise {
+
+// Append-only message log.
+//
+// Messages and status changes are appended as records to fixed-size segments,
+// either files in a directory or memory buffers when no directory is set.
+// Per-user and per-conversation indexes are arrays of record locations sorted
+// by timestamp, so time-range queries binary-search instead of scanning.
+// Decoded messages are kept in an LRU cache. Retention drops whole segments;
+// index entries pointing into dropped segments are trimmed lazily.
+class MessageStore {
+public:
+    struct Config {
+        std::string directory;                 // Empty keeps segments in memory
+        size_t segment_size = 16 * 1024 * 1024;
+        size_t cache_capacity = 10000;         // Decoded messages
+        std::chrono::hours retention{24 * 30}; // 0 keeps everything
+        size_t max_segments = 0;               // 0 is unlimited
+    };
+
+    using TimePoint = std::chrono::system_clock::time_point;
+
+    MessageStore();
+    ~MessageStore();
+
+    MessageStore(const MessageStore&) = delete;
+    MessageStore& operator=(const MessageStore&) = delete;
+
+    // Opens the store, replaying existing segments to rebuild the indexes
+    bool open(const Config& config);
+    void close();
+    bool isOpen() const;
+
+    bool append(const InstantMessage& message);
+    bool markDelivered(const std::string& message_id);
+    bool markRead(const std::string& message_id);
+
+    std::optional<InstantMessage> get(const std::string& message_id) const;
+
+    // Newest `limit` messages with from <= timestamp < until, oldest first.
+    // Page backwards by passing the oldest returned timestamp as `until`.
+    std::vector<InstantMessage> getUserMessages(const std::string& user_id, TimePoint from, TimePoint until,
+                                                size_t limit) const;
+    std::vector<InstantMessage> getConversation(const std::string& user1, const std::string& user2,
+                                                TimePoint from, TimePoint until, size_t limit) const;
+
+    // Drops segments past retention or beyond max_segments; returns messages removed
+    size_t applyRetention();
+
+    size_t getMessageCount() const;
+    size_t getUndeliveredCount() const;
+
+    // Statistics
+    struct Stats {
+        uint64_t messages_appended = 0;
+        uint64_t bytes_appended = 0;
+        uint64_t cache_hits = 0;
+        uint64_t cache_misses = 0;
+        uint64_t segments_created = 0;
+        uint64_t segments_dropped = 0;
+        size_t segment_count = 0;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    enum RecordType : uint8_t {
+        RECORD_MESSAGE = 1,
+        RECORD_STATUS = 2
+    };
+
+    enum StatusFlags : uint8_t {
+        STATUS_DELIVERED = 0x01,
+        STATUS_READ = 0x02
+    };
+
+    struct Segment {
+        uint32_t id = 0;
+        int fd = -1;                  // File-backed segments
+        std::vector<uint8_t> memory;  // Memory-backed segments
+        size_t size = 0;
+        int64_t last_timestamp = 0;   // Milliseconds since epoch
+        std::vector<std::string> message_ids;
+    };
+
+    struct Location {
+        uint32_t segment;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct IndexEntry {
+        int64_t timestamp;
+        Location location;
+    };
+
+    struct Index {
+        std::vector<IndexEntry> entries; // Sorted by timestamp
+        uint64_t trimmed_generation = 0;
+    };
+
+    struct MessageRef {
+        Location location;
+        uint8_t flags = 0;
+    };
+
+    bool openSegment(uint32_t id);
+    bool replaySegment(Segment& segment);
+    bool writeRecord(RecordType type, const std::vector<uint8_t>& payload, Location& location);
+    bool readRecord(const Location& location, std::vector<uint8_t>& payload) const;
+    bool setStatus(const std::string& message_id, uint8_t flags);
+
+    void indexMessage(const InstantMessage& message, const Location& location, int64_t timestamp);
+    void applyStatus(const std::string& message_id, uint8_t flags);
+    std::vector<InstantMessage> query(Index* index, TimePoint from, TimePoint until, size_t limit) const;
+    void trimIndex(Index& index) const;
+    std::optional<InstantMessage> loadMessage(const Location& location) const;
+    void dropOldestSegment();
+
+    std::string segmentPath(uint32_t id) const;
+    static std::string conversationKey(const std::string& user1, const std::string& user2);
+    static uint64_t cacheKey(const Location& location) {
+        return (static_cast<uint64_t>(location.segment) << 32) | location.offset;
+    }
+
+    Config config_;
+    bool open_;
+
+    std::deque<Segment> segments_; // Oldest first, the last one is active
+    uint32_t next_segment_id_;
+    uint64_t retention_generation_;
+
+    std::unordered_map<std::string, MessageRef> messages_;
+    mutable std::unordered_map<std::string, Index> user_index_;
+    mutable std::unordered_map<std::string, Index> conversation_index_;
+    size_t undelivered_count_;
+
+    // LRU cache of decoded messages keyed by record location
+    mutable std::list<std::pair<uint64_t, InstantMessage>> cache_;
+    mutable std::unordered_map<uint64_t, std::list<std::pair<uint64_t, InstantMessage>>::iterator> cache_index_;
+
+    mutable Stats stats_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace fmus::enterprise
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+namespace fmus::enterprise {
+
+// Per-recipient queues of message IDs waiting for the recipient to register.
+// Each queue keeps up to max_memory_depth IDs in memory; the overflow is
+// appended to a spill file per user and read back when the queue drains.
+// Beyond max_queue_depth, or past max_memory_depth when no spill directory
+// is set, new IDs are dropped from the queue and counted in Stats::dropped:
+// the messages stay in the message store as undelivered but are not part of
+// the recipient's batch on registration.
+class OfflineMessageQueue {
+public:
+    struct Config {
+        size_t max_memory_depth = 256;  // Per user
+        size_t max_queue_depth = 10000; // Per user, memory plus spill
+        std::string spill_directory;    // Empty disables spilling
+    };
+
+    OfflineMessageQueue();
+    ~OfflineMessageQueue();
+
+    // Picks up spill files left by a previous run
+    bool setConfig(const Config& config);
+    Config getConfig() const;
+
+    bool enqueue(const std::string& user_id, const std::string& message_id);
+
+    // Removes and returns everything queued for the user, oldest first
+    std::vector<std::string> drain(const std::string& user_id);
+
+    size_t getDepth(const std::string& user_id) const;
+    size_t getTotalDepth() const;
+
+    // Statistics
+    struct Stats {
+        uint64_t enqueued = 0;
+        uint64_t drained = 0;
+        uint64_t spilled = 0;
+        uint64_t dropped = 0;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    struct UserQueue {
+        std::deque<std::string> memory;
+        size_t spilled = 0; // IDs in the spill file, all newer than the in-memory ones
+    };
+
+    std::string spillPath(const std::string& user_id) const;
+    bool appendToSpill(const std::string& user_id, const std::string& message_id);
+    void readSpill(const std::string& user_id, std::vector<std::string>& message_ids);
+
+    Config config_;
+    std::unordered_map<std::string, UserQueue> queues_;
+    size_t total_depth_;
+
+    std::atomic<uint64_t> enqueued_{0};
+    std::atomic<uint64_t> drained_{0};
+    std::atomic<uint64_t> spilled_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    mutable std::mutex mutex_;
+};
+
+} // namespace fmus::enterprise
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+namespace fmus::enterprise {
+
+class RecordingWriter;
+
+// Recording file formats
+enum class RecordingFormat {
+    WAV,     // 16-bit mono PCM
+    RTPDUMP  // rtptools rtpdump, raw RTP packets with arrival offsets
+};
+
+// Sidecar time index entry, stored in <recording>.idx. CHUNK entries point at
+// record boundaries so a time range can be served from the middle of a file.
+struct RecordingIndexEntry {
+    enum Type : uint32_t {
+        CHUNK = 1,
+        PAUSE = 2,
+        RESUME = 3,
+        END = 4
+    };
+
+    uint32_t type = CHUNK;
+    uint64_t media_ms = 0; // Recording time, pauses excluded
+    uint64_t wall_ms = 0;  // Time since the recording started
+    uint64_t offset = 0;   // File offset of the next record
+};
+
+// Reads a recording's sidecar index to map recording time to byte ranges
+class RecordingIndex {
+public:
+    struct Pause {
+        uint64_t media_ms;
+        uint64_t wall_start_ms;
+        uint64_t wall_end_ms; // Equal to wall_start_ms while still paused
+    };
+
+    bool load(const std::string& recording_path);
+
+    const std::vector<RecordingIndexEntry>& getEntries() const { return entries_; }
+    uint64_t getFileSize() const { return file_size_; }
+    uint64_t getDurationMs() const;
+    std::vector<Pause> getPauses() const;
+
+    // Byte range [begin, end) covering recording time [from_ms, until_ms),
+    // widened to the enclosing index chunks
+    bool findRange(uint64_t from_ms, uint64_t until_ms, uint64_t& begin, uint64_t& end) const;
+
+private:
+    std::vector<RecordingIndexEntry> entries_;
+    uint64_t file_size_ = 0;
+};
+
+// One recording file. Media threads append into the current page; a full
+// page is handed to the writer's I/O thread and appends continue in the
+// second page. If both pages are busy the record is dropped and counted,
+// so the media path never waits on the disk.
+class RecordingStream : public std::enable_shared_from_this<RecordingStream> {
+public:
+    ~RecordingStream();
+
+    RecordingStream(const RecordingStream&) = delete;
+    RecordingStream& operator=(const RecordingStream&) = delete;
+
+    // Media-thread side
+    bool writeAudio(const int16_t* samples, size_t count);
+    bool writeRtp(const uint8_t* packet, size_t size);
+
+    // Writes are refused while paused; the gap is marked in the index
+    void pause();
+    void resume();
+    bool isPaused() const { return paused_; }
+
+    const std::string& getPath() const { return path_; }
+    RecordingFormat getFormat() const { return format_; }
+    bool isDirectIo() const { return direct_io_; }
+    bool isClosed() const { return closed_; }
+
+    uint64_t getBytesRecorded() const { return bytes_recorded_; }
+    uint64_t getBytesDropped() const { return bytes_dropped_; }
+
+private:
+    friend class RecordingWriter;
+
+    RecordingStream(RecordingWriter& writer, const std::string& path, RecordingFormat format,
+                    int fd, int index_fd, bool direct_io, size_t page_size, size_t worker,
+                    uint32_t sample_rate, std::chrono::milliseconds index_interval);
+
+    // Copies prefix and data as one record, or drops both
+    bool append(const uint8_t* prefix, size_t prefix_size, const uint8_t* data, size_t size);
+    void writeFileHeader();
+    void addIndexEntry(uint32_t type, std::chrono::steady_clock::time_point now);
+    uint64_t mediaTimeMs(std::chrono::steady_clock::time_point now) const;
+
+    RecordingWriter& writer_;
+    std::string path_;
+    RecordingFormat format_;
+    int fd_;
+    int index_fd_;
+    std::atomic<bool> direct_io_;
+    size_t page_size_;
+    size_t worker_;
+    uint32_t sample_rate_;
+
+    // Double-buffered pages; in_flight_ is set while the I/O thread owns a page
+    uint8_t* pages_[2];
+    int buffer_index_[2]; // Registered io_uring buffer slots, -1 when not registered
+    size_t used_[2];
+    int active_;
+    std::atomic<bool> in_flight_[2];
+
+    uint64_t file_offset_; // I/O thread side
+
+    // Index entries not yet handed to the I/O thread
+    std::vector<RecordingIndexEntry> pending_index_;
+    std::chrono::milliseconds index_interval_;
+    uint64_t next_index_ms_;
+    bool header_written_;
+
+    std::chrono::steady_clock::time_point start_time_;
+    std::chrono::steady_clock::time_point pause_start_;
+    std::chrono::steady_clock::duration paused_total_;
+    std::atomic<bool> paused_;
+    std::atomic<bool> closed_;
+    std::atomic<uint64_t> bytes_recorded_{0};
+    std::atomic<uint64_t> bytes_dropped_{0};
+
+    std::mutex mutex_; // Guards the active page; held only for the copy
+};
+
+// Writes recording pages from dedicated I/O threads. Files are opened with
+// O_DIRECT where the filesystem supports it and written in whole aligned
+// pages; each stream sticks to one I/O thread so its pages stay in order.
+// With the io_uring socket backend selected, each thread submits the pages
+// it has queued through the shared ring in one call, from registered pages.
+class RecordingWriter {
+public:
+    struct Config {
+        size_t page_size = 32 * 1024; // Rounded up to a multiple of 4096
+        size_t io_threads = 1;
+        bool direct_io = true;
+        uint32_t sample_rate = 8000;  // WAV
+        std::chrono::milliseconds index_interval{500};
+    };
+
+    RecordingWriter();
+    ~RecordingWriter();
+
+    RecordingWriter(const RecordingWriter&) = delete;
+    RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+    // Applies to streams opened afterwards; io_threads is fixed by the first start()
+    void setConfig(const Config& config);
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    std::shared_ptr<RecordingStream> open(const std::string& path, RecordingFormat format);
+    void close(const std::shared_ptr<RecordingStream>& stream);
+
+    // Statistics
+    struct Stats {
+        uint64_t streams_opened = 0;
+        uint64_t streams_closed = 0;
+        uint64_t direct_io_streams = 0;
+        uint64_t pages_written = 0;
+        uint64_t bytes_written = 0;
+        uint64_t write_errors = 0;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    friend class RecordingStream;
+
+    struct WriteRequest {
+        std::shared_ptr<RecordingStream> stream;
+        int page;
+        size_t size;
+        bool finish; // Last page; the file is completed and closed after it
+        std::vector<RecordingIndexEntry> index;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::deque<WriteRequest> queue;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    void submit(WriteRequest request, size_t worker);
+    void workerLoop(Worker& worker);
+    void process(const WriteRequest& request);
+    void processOnRing(const std::deque<WriteRequest>& batch);
+    void writePage(RecordingStream& stream, int page, size_t size);
+    void writeIndex(RecordingStream& stream, const std::vector<RecordingIndexEntry>& entries);
+    void finishStream(RecordingStream& stream);
+
+    Config config_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_{0};
+    std::atomic<bool> running_;
+    bool use_ring_ = false; // Fixed by start()
+    std::mutex mutex_;
+
+    std::atomic<uint64_t> streams_opened_{0};
+    std::atomic<uint64_t> streams_closed_{0};
+    std::atomic<uint64_t> direct_io_streams_{0};
+    std::atomic<uint64_t> pages_written_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> write_errors_{0};
+};
+
+// Utility functions
+RecordingFormat recordingFormatForPath(const std::string& path);
+std::string recordingIndexPath(const std::string& recording_path);
+
+// File header for serving data_size bytes cut from the middle of a recording
+bool readRecordingHeader(const std::string& recording_path, uint64_t data_size, std::string& header,
+                         uint64_t& header_size);
+
+} // namespace fmus::enterprise
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <optional>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+namespace fmus::enterprise {
+
+// Picks the dominant speaker of a conference from the RFC 6464 audio levels
+// senders put in their RTP header extensions, so no stream is decoded.
+//
+// Levels are read in place from received packets and folded into 20 ms
+// frames. Each participant is scored over three windows: short (frames
+// active within a block), medium (active blocks) and long (active medium
+// windows), each as the log-likelihood that speech explains the activity
+// seen. A challenger replaces the dominant speaker only when it beats it in
+// all three, so coughs and short interjections do not switch the view.
+//
+// onPacket() is lock-free and safe from any media thread; the scoring runs
+// on whichever thread crosses a frame boundary.
+class DominantSpeakerDetector {
+public:
+    struct Config {
+        size_t max_participants = 64;
+        std::chrono::milliseconds frame{20};
+        std::chrono::milliseconds decision_interval{300};
+        uint8_t activity_threshold = 60; // Frames at or above -60 dBov count as active
+    };
+
+    using Clock = std::chrono::steady_clock;
+    using SpeakerCallback = std::function<void(const std::string&)>; // New dominant speaker, empty for none
+
+    DominantSpeakerDetector();
+    explicit DominantSpeakerDetector(const Config& config);
+    ~DominantSpeakerDetector();
+
+    DominantSpeakerDetector(const DominantSpeakerDetector&) = delete;
+    DominantSpeakerDetector& operator=(const DominantSpeakerDetector&) = delete;
+
+    // Returns the participant's slot for onPacket(), or -1 when full.
+    // audio_level_id is the negotiated extmap ID, 0 when not yet known.
+    int addParticipant(const std::string& user_id, uint8_t audio_level_id = 0);
+    void removeParticipant(const std::string& user_id);
+    int findParticipant(const std::string& user_id) const;
+    void setAudioLevelId(int slot, uint8_t audio_level_id);
+    void setMuted(int slot, bool muted); // Muted participants never become dominant
+
+    // Reads the audio level from a received RTP packet without copying it;
+    // false when the packet carries none
+    bool onPacket(int slot, const uint8_t* packet, size_t size, Clock::time_point now = Clock::now());
+
+    // Advances time without packets, e.g. when every participant is silent
+    void update(Clock::time_point now = Clock::now());
+
+    std::string getDominantSpeaker() const;
+
+    // Up to count participants with recent speech, most active first; mixing
+    // and forwarding can skip everyone else
+    std::vector<std::string> getActiveSpeakers(size_t count) const;
+
+    void setSpeakerCallback(SpeakerCallback callback);
+
+    // Statistics
+    struct Stats {
+        uint64_t packets = 0;
+        uint64_t packets_without_level = 0;
+        uint64_t decisions = 0;
+        uint64_t speaker_changes = 0;
+    };
+
+    Stats getStats() const;
+
+private:
+    struct Participant;
+
+    // Caller holds mutex_
+    void advance(Clock::time_point now);
+    void rollFrame();
+    std::optional<std::string> decide(Clock::time_point now); // The new dominant speaker, if it changed
+
+    Config config_;
+    std::unique_ptr<Participant[]> participants_;
+    std::atomic<int64_t> frame_end_{0}; // Clock ticks; packets before this land in the current frame
+    Clock::time_point next_decision_;
+    int dominant_ = -1;
+
+    SpeakerCallback speaker_callback_;
+    mutable std::mutex mutex_;
+
+    std::atomic<uint64_t> packets_{0};
+    std::atomic<uint64_t> packets_without_level_{0};
+    uint64_t decisions_ = 0;
+    uint64_t speaker_changes_ = 0;
+};
+
+} // namespace fmus::enterprise
@@ -4,6 +4,7 @@
 #include "../enterprise/features.hpp"
 #include "../sip/registrar.hpp"
 #include "../webrtc/signaling.hpp"
+#include "../core/executor.hpp"
 #include <string>
 #include <unordered_map>
 #include <memory>
@@ -29,12 +30,14 @@ enum class HttpStatus {
     OK = 200,
     CREATED = 201,
     NO_CONTENT = 204,
+    PARTIAL_CONTENT = 206,
     BAD_REQUEST = 400,
     UNAUTHORIZED = 401,
     FORBIDDEN = 403,
     NOT_FOUND = 404,
     METHOD_NOT_ALLOWED = 405,
     CONFLICT = 409,
+    RANGE_NOT_SATISFIABLE = 416,
     INTERNAL_SERVER_ERROR = 500,
     NOT_IMPLEMENTED = 501,
     SERVICE_UNAVAILABLE = 503
@@ -69,6 +72,11 @@ struct HttpResponse {
     std::unordered_map<std::string, std::string> headers;
     std::string body;
     
+    // Optional file range sent after the body with sendfile
+    std::string file_path;
+    uint64_t file_offset = 0;
+    uint64_t file_length = 0;
+    
     HttpResponse(HttpStatus s = HttpStatus::OK) : status(s) {
         headers["Content-Type"] = "application/json";
         headers["Server"] = "FMUS-3G/1.0";
@@ -78,8 +86,9 @@ struct HttpResponse {
     void setHtml(const std::string& html);
     void setPlainText(const std::string& text);
     void setCors();
+    void setFile(const std::string& path, uint64_t offset, uint64_t length, const std::string& content_type);
     
-    std::string toString() const;
+    std::string toString() const; // Head and body; a file range follows separately
 };
 
 // REST API Endpoint Handler
@@ -127,6 +136,9 @@ public:
     
     // CORS support
     void enableCors(const std::string& origins = "*");
+    
+    // Handle requests on the executor at management priority; inline when unset
+    void setExecutor(core::Executor* executor) { executor_ = executor; }
 
 private:
     struct Route {
@@ -154,6 +166,9 @@ private:
     bool cors_enabled_ = false;
     std::string cors_origins_;
     
+    std::atomic<core::Executor*> executor_{nullptr};
+    std::atomic<size_t> pending_tasks_{0};
+    
     mutable std::mutex mutex_;
 };
 
@@ -213,8 +228,6 @@ public:
     
     // Recording endpoints
     HttpResponse getRecordings(const HttpRequest& request);
-    HttpResponse startRecording(const HttpRequest& request);
-    HttpResponse stopRecording(const HttpRequest& request);
     HttpResponse downloadRecording(const HttpRequest& request);
     
     // WebRTC signaling endpoints
@@ -280,8 +293,10 @@ public:
     bool validateToken(const std::string& token) const;
     
 private:
+    static bool constantTimeEquals(const std::string& a, const std::string& b);
+
     std::string secret_key_;
-    std::unordered_map<std::string, std::chrono::system_clock::time_point> active_tokens_;
+    mutable std::unordered_map<std::string, std::chrono::system_clock::time_point> active_tokens_; // Token -> expiry
     mutable std::mutex mutex_;
 };
 
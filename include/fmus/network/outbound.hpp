@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+namespace fmus::network {
+
+class Socket;
+
+// Immutable, reference-counted outbound payload. One encoded buffer can be
+// queued on any number of connections without copying.
+using SharedBuffer = std::shared_ptr<const std::vector<uint8_t>>;
+
+SharedBuffer makeSharedBuffer(std::vector<uint8_t> data);
+SharedBuffer makeSharedBuffer(const uint8_t* data, size_t size);
+
+// Lock-free multi-producer single-consumer queue of outbound buffers
+class OutboundQueue {
+public:
+    OutboundQueue();
+    ~OutboundQueue();
+
+    OutboundQueue(const OutboundQueue&) = delete;
+    OutboundQueue& operator=(const OutboundQueue&) = delete;
+
+    // Producer side, safe from any thread
+    void push(SharedBuffer buffer);
+
+    // Consumer side, one thread at a time
+    const SharedBuffer* front() const;
+    size_t peek(const SharedBuffer** buffers, size_t max_count) const;
+    void pop();
+    bool empty() const { return front() == nullptr; }
+    void clear();
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        SharedBuffer buffer;
+    };
+
+    std::atomic<Node*> head_; // Most recently pushed node
+    Node* tail_;              // Consumed sentinel; tail_->next is the front
+};
+
+// Epoll-driven writer that drains socket outbound queues without blocking.
+// Producers only enqueue and arm EPOLLOUT; the writer threads gather queued
+// buffers into one sendmsg() per wakeup, so a connection that stops reading
+// never stalls the caller or other peers. Sockets that stay above their high
+// watermark longer than the eviction timeout are shut down.
+class SocketWriter {
+public:
+    explicit SocketWriter(size_t thread_count = 1);
+    ~SocketWriter();
+
+    SocketWriter(const SocketWriter&) = delete;
+    SocketWriter& operator=(const SocketWriter&) = delete;
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    // Route a socket's queued sends through this writer (socket must be shared-owned)
+    bool attach(Socket& socket);
+    void detach(Socket& socket);
+
+    // Statistics
+    struct Stats {
+        uint64_t sockets_attached = 0;
+        uint64_t buffers_written = 0;
+        uint64_t bytes_written = 0;
+        uint64_t would_block = 0;
+        uint64_t write_errors = 0;
+        uint64_t evictions = 0;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    friend class Socket;
+
+    void schedule(Socket& socket);
+    void markCongested(Socket& socket);
+    void writerLoop();
+    void evictSlowConsumers();
+    bool flush(Socket& socket, std::string& error, bool& drained);
+
+    size_t thread_count_;
+    int epoll_fd_;
+    std::atomic<bool> running_;
+    std::vector<std::thread> threads_;
+
+    std::unordered_map<Socket*, std::weak_ptr<Socket>> sockets_;
+    std::unordered_map<Socket*, std::chrono::steady_clock::time_point> congested_; // Above high watermark since
+    std::atomic<int64_t> last_eviction_check_{0};
+    mutable std::mutex mutex_;
+
+    std::atomic<uint64_t> sockets_attached_{0};
+    std::atomic<uint64_t> buffers_written_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> would_block_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+} // namespace fmus::network
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace fmus::network {
+
+// Admission control for SIP signaling under overload.
+//
+// The controller watches how long messages wait between arrival and
+// processing and how many are still queued. When the smallest wait over an
+// interval stays above the target, or the backlog passes its limit, a
+// standing queue has formed and the share of new INVITEs and REGISTERs to
+// reject grows; once the queue drains the share shrinks again. Rejected
+// requests get a stateless 503 with Retry-After before they are queued, so
+// shedding costs far less than serving. In-dialog requests, ACK, BYE and
+// responses are never shed: finishing existing work is what frees capacity.
+//
+// admit() and onProcessed() are safe from any thread and take no lock on
+// their fast path.
+class OverloadController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State : uint8_t {
+        NORMAL,     // Everything admitted
+        THROTTLING, // A share of new requests rejected
+        OVERLOADED  // Every new request rejected
+    };
+
+    struct Config {
+        bool enabled = true;
+        std::chrono::milliseconds target_delay{20}; // Standing queueing delay that counts as overload
+        size_t max_backlog = 2000;                  // Queued messages that count as overload
+        size_t hard_backlog = 10000;                // Reject every new request at once above this
+        std::chrono::milliseconds interval{100};    // How often the rejection share is adjusted
+        uint32_t increase_percent = 10;             // Added to the rejection share per overloaded interval
+        uint32_t decrease_percent = 5;              // Taken off per interval without a standing queue, idle ones included
+        std::chrono::seconds retry_after{5};        // Retry-After in 503 replies...
+        std::chrono::seconds retry_after_spread{5}; // ...plus up to this much, so clients do not return together
+    };
+
+    struct Stats {
+        uint64_t offered = 0;   // New INVITEs and REGISTERs seen
+        uint64_t admitted = 0;
+        uint64_t rejected = 0;
+        uint64_t overload_episodes = 0; // Transitions out of NORMAL
+        State state = State::NORMAL;
+        uint32_t reject_percent = 0;
+        uint64_t queue_delay_min_us = 0; // Over the last complete interval
+        uint64_t queue_delay_max_us = 0;
+        size_t backlog = 0;              // Last reported
+    };
+
+    OverloadController();
+    explicit OverloadController(const Config& config);
+
+    void setConfig(const Config& config);
+    Config getConfig() const;
+
+    // Whether a new INVITE or REGISTER arriving now should be processed,
+    // given the number of messages already queued
+    bool admit(size_t backlog, Clock::time_point now = Clock::now());
+
+    // Reports a message that waited queue_delay before processing started
+    void onProcessed(Clock::duration queue_delay, size_t backlog, Clock::time_point now = Clock::now());
+
+    // Retry-After value in seconds for the next 503
+    uint32_t retryAfter() const;
+
+    State getState() const { return state_.load(std::memory_order_relaxed); }
+    uint32_t getRejectPercent() const { return reject_percent_.load(std::memory_order_relaxed); }
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    void maybeAdjust(Clock::time_point now);
+    void adjust(Clock::time_point now);
+    void setState(State state);
+
+    mutable std::mutex mutex_; // Config and interval roll-over
+    Config config_;
+
+    std::atomic<State> state_{State::NORMAL};
+    std::atomic<uint32_t> reject_percent_{0};
+    std::atomic<int64_t> next_adjust_ns_{0};
+    std::atomic<size_t> hard_backlog_{SIZE_MAX}; // Read without the lock
+
+    // Current interval
+    std::atomic<uint64_t> min_delay_ns_{UINT64_MAX};
+    std::atomic<uint64_t> max_delay_ns_{0};
+    std::atomic<size_t> backlog_{0};
+
+    // Last complete interval, for metrics
+    std::atomic<uint64_t> last_min_delay_ns_{0};
+    std::atomic<uint64_t> last_max_delay_ns_{0};
+
+    std::atomic<uint64_t> offered_{0};
+    std::atomic<uint64_t> admitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> episodes_{0};
+};
+
+const char* overloadStateToString(OverloadController::State state);
+
+} // namespace fmus::network
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "socket.hpp"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+namespace fmus::network {
+
+// Forwards datagrams unchanged from one UDP socket to a fixed peer through
+// another, moving batches per system call instead of single packets.
+//
+// The output socket is connected to the peer for the relay's lifetime.
+// Input is read with recvmmsg(), or with UDP_GRO where the kernel supports
+// it, so one read can return a run of coalesced same-size datagrams. Output
+// goes out with sendmmsg(), each run of same-size datagrams as one
+// UDP_SEGMENT (GSO) message the kernel splits again. Either feature turns
+// itself off when the kernel refuses it, leaving plain batching.
+//
+// A relay is driven from outside: call pump() once the input is readable.
+// Not thread-safe; one relay per direction. Buffers are per thread, so a
+// relay holds no packet memory between pumps.
+class UdpRelay {
+public:
+    struct Config {
+        size_t batch_size = 32;          // Datagrams per recvmmsg() without GRO
+        size_t max_datagram_size = 2048; // Larger datagrams are dropped
+        bool use_gro = true;
+        bool use_gso = true;
+    };
+
+    UdpRelay(std::shared_ptr<UdpSocket> input, std::shared_ptr<UdpSocket> output,
+             const SocketAddress& destination);
+    UdpRelay(std::shared_ptr<UdpSocket> input, std::shared_ptr<UdpSocket> output,
+             const SocketAddress& destination, const Config& config);
+    ~UdpRelay(); // Disconnects the output and turns GRO off on the input
+
+    UdpRelay(const UdpRelay&) = delete;
+    UdpRelay& operator=(const UdpRelay&) = delete;
+
+    // Forwards what is queued on the input without blocking, up to budget
+    // datagrams; returns how many were forwarded
+    size_t pump(size_t budget = 256);
+
+    bool usesGro() const { return gro_; }
+    bool usesGso() const { return gso_; }
+
+    // Statistics
+    struct Stats {
+        uint64_t datagrams = 0;
+        uint64_t bytes = 0;
+        uint64_t dropped = 0;       // Oversized or refused by the kernel
+        uint64_t receive_calls = 0;
+        uint64_t send_calls = 0;
+        uint64_t segmented = 0;     // Datagrams sent inside UDP_SEGMENT messages
+    };
+
+    const Stats& getStats() const { return stats_; }
+
+private:
+    void sendRuns();
+    size_t sendFrom(size_t first_run); // Returns the first run still to send
+
+    std::shared_ptr<UdpSocket> input_;
+    std::shared_ptr<UdpSocket> output_;
+    SocketAddress destination_;
+    Config config_;
+    bool connected_ = false;
+    bool gro_ = false;
+    bool gso_ = false;
+
+    Stats stats_;
+};
+
+} // namespace fmus::network
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "outbound.hpp"
+#include "../core/coroutine.hpp"
 #include <string>
 #include <vector>
 #include <memory>
@@ -8,6 +10,9 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+#include <optional>
+#include <ctime>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -19,6 +24,13 @@ enum class SocketType {
     TCP
 };
 
+// How sockets receive: a blocking thread per socket, or one shared io_uring
+// ring (see uring.hpp). Chosen at startup, before sockets start receiving.
+enum class IoBackend {
+    THREADS,
+    IO_URING
+};
+
 enum class SocketState {
     CLOSED,
     BINDING,
@@ -44,12 +56,34 @@ struct SocketAddress {
     static SocketAddress fromSockAddr(const sockaddr_in& addr);
 };
 
-class Socket {
+// When a datagram arrived, as nanoseconds on CLOCK_REALTIME. Taken by the
+// NIC or the kernel when receive timestamps are enabled, otherwise read as
+// the datagram is dequeued, after any scheduling delay.
+using ReceiveTime = std::chrono::nanoseconds;
+
+// Kernel receive timestamp carried in a recvmsg() control buffer (raw
+// hardware preferred over software), or zero when there is none
+ReceiveTime receiveTimestamp(const msghdr& header);
+
+// Control buffer space for the largest timestamp message
+constexpr size_t RECEIVE_TIMESTAMP_CONTROL_SIZE = CMSG_SPACE(3 * sizeof(timespec));
+
+class Socket : public std::enable_shared_from_this<Socket> {
 public:
     using DataCallback = std::function<void(const std::vector<uint8_t>&, const SocketAddress&)>;
+    using TimedDataCallback = std::function<void(const std::vector<uint8_t>&, const SocketAddress&, ReceiveTime)>;
     using ErrorCallback = std::function<void(const std::string&)>;
     using StateCallback = std::function<void(SocketState)>;
     using ConnectionCallback = std::function<void(std::shared_ptr<Socket>)>;
+    using WatermarkCallback = std::function<void(size_t)>; // Queued bytes at the crossing
+    
+    // Bounds for the outbound queue used by queued sends
+    struct WriteQueueLimits {
+        size_t high_watermark = 1024 * 1024;
+        size_t low_watermark = 256 * 1024;
+        size_t max_queued_bytes = 8 * 1024 * 1024;
+        std::chrono::milliseconds eviction_timeout{5000}; // Time above high watermark, 0 = never evict
+    };
 
     Socket(SocketType type);
     virtual ~Socket();
@@ -68,10 +102,41 @@ public:
     bool send(const std::vector<uint8_t>& data, const SocketAddress& to = {});
     bool send(const uint8_t* data, size_t size, const SocketAddress& to = {});
     
-    // Async operations
+    // Queue a buffer on the attached SocketWriter (falls back to send() when detached)
+    bool queueSend(SharedBuffer buffer);
+    bool hasWriter() const { return writer_ != nullptr; }
+    
+    // Send a file range on a TCP stream with sendfile(2); copies through the
+    // outbound queue instead when a writer is attached, to keep ordering
+    bool sendFile(int file_fd, uint64_t offset, uint64_t length);
+    
+    void setWriteQueueLimits(const WriteQueueLimits& limits) { write_limits_ = limits; }
+    const WriteQueueLimits& getWriteQueueLimits() const { return write_limits_; }
+    size_t getQueuedBytes() const { return queued_bytes_; }
+    bool isEvicted() const { return evicted_; }
+    
+    // Async operations. A receive thread keeps a shared-owned socket alive
+    // until its loop ends, so callbacks may close and drop the socket.
     void startReceiving();
     void stopReceiving();
     
+    // Selects the backend for sockets that start receiving afterwards.
+    // IO_URING covers UDP receives and detached UDP queued sends; TCP keeps
+    // its threads. Returns false, staying on THREADS, where io_uring is missing.
+    static bool setIoBackend(IoBackend backend);
+    static IoBackend getIoBackend();
+    
+    // Coroutine receive for sockets not using startReceiving(): suspends the
+    // calling flow on its event loop until data arrives. Resumes with nullopt
+    // on timeout, error or TCP close; a zero timeout waits indefinitely.
+    struct Datagram {
+        std::vector<uint8_t> data;
+        SocketAddress from;
+        ReceiveTime received{0};
+    };
+    
+    core::Task<std::optional<Datagram>> recv(std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    
     // Getters
     SocketType getType() const { return type_; }
     SocketState getState() const { return state_; }
@@ -81,14 +146,22 @@ public:
     
     // Callbacks
     void setDataCallback(DataCallback callback) { data_callback_ = callback; }
+    // Takes the place of the data callback, adding each datagram's receive time
+    void setTimedDataCallback(TimedDataCallback callback) { timed_data_callback_ = callback; }
     void setErrorCallback(ErrorCallback callback) { error_callback_ = callback; }
     void setStateCallback(StateCallback callback) { state_callback_ = callback; }
     void setConnectionCallback(ConnectionCallback callback) { connection_callback_ = callback; }
+    void setHighWatermarkCallback(WatermarkCallback callback) { high_watermark_callback_ = callback; }
+    void setLowWatermarkCallback(WatermarkCallback callback) { low_watermark_callback_ = callback; }
 
 protected:
+    friend class SocketWriter;
+    
     void setState(SocketState state);
     void notifyError(const std::string& error);
     void receiveLoop();
+    void wakeReceiver();
+    void deliver(const uint8_t* data, size_t size, const sockaddr_in& from, ReceiveTime received);
     
     SocketType type_;
     std::atomic<SocketState> state_;
@@ -98,13 +171,30 @@ protected:
     
     // Threading
     std::atomic<bool> receiving_;
+    std::atomic<bool> closing_{false}; // Ends recv() flows once close() starts
     std::thread receive_thread_;
+    std::atomic<uint64_t> ring_receiver_{0}; // Receiving through the io_uring ring
+    std::atomic<bool> timestamps_{false};     // Kernel receive timestamps enabled
     
     // Callbacks
     DataCallback data_callback_;
+    TimedDataCallback timed_data_callback_;
     ErrorCallback error_callback_;
     StateCallback state_callback_;
     ConnectionCallback connection_callback_;
+    WatermarkCallback high_watermark_callback_;
+    WatermarkCallback low_watermark_callback_;
+    
+    // Outbound queue, drained by writer_ when attached
+    std::atomic<SocketWriter*> writer_{nullptr};
+    OutboundQueue send_queue_;
+    size_t send_offset_ = 0;
+    std::atomic<bool> write_scheduled_{false};
+    std::mutex write_mutex_;
+    WriteQueueLimits write_limits_;
+    std::atomic<size_t> queued_bytes_{0};
+    std::atomic<bool> above_high_watermark_{false};
+    std::atomic<bool> evicted_{false};
     
     // Synchronization
     mutable std::mutex mutex_;
@@ -118,6 +208,21 @@ public:
     bool enableBroadcast(bool enable = true);
     bool enableMulticast(const std::string& group);
     bool setReceiveBufferSize(int size);
+    
+    // Stamps datagrams as the NIC or kernel receives them, for jitter and
+    // delay measured without our own queueing. Uses SO_TIMESTAMPING, taking
+    // hardware stamps where the interface already produces them, or
+    // SO_TIMESTAMPNS on older kernels.
+    bool enableReceiveTimestamps(bool enable = true);
+    bool hasReceiveTimestamps() const { return timestamps_; }
+    
+    // Drops queued datagrams without blocking; returns how many carried data
+    size_t discardPending();
+    
+    // Connects to one peer: plain sends need no address and the kernel
+    // drops datagrams from anyone else. clearPeer() undoes it.
+    bool setPeer(const SocketAddress& peer);
+    bool clearPeer();
     bool setSendBufferSize(int size);
 };
 
@@ -1,10 +1,18 @@
 #pragma once
 
 #include "socket.hpp"
+#include "websocket.hpp"
+#include "overload.hpp"
 #include "fmus/sip/message.hpp"
+#include "fmus/sip/response_template.hpp"
 #include "fmus/rtp/packet.hpp"
+#include "fmus/core/executor.hpp"
 #include <unordered_map>
 #include <queue>
+#include <deque>
+#include <optional>
+#include <chrono>
+#include <array>
 
 namespace fmus::network {
 
@@ -19,19 +27,33 @@ public:
     // Transport management
     bool startUdp(const SocketAddress& bind_address);
     bool startTcp(const SocketAddress& bind_address);
+    bool startWebSocket(const SocketAddress& bind_address); // SIP over WebSocket (RFC 7118)
     void stop();
     
     // Message sending
     bool sendMessage(const fmus::sip::SipMessage& message, const SocketAddress& destination);
     bool sendMessage(const std::string& raw_message, const SocketAddress& destination);
+    bool sendRaw(std::string_view raw_message, const SocketAddress& destination);
+    
+    // Renders a stateless reply to request from its template and sends it
+    bool sendResponse(const fmus::sip::ResponseTemplate& response, const fmus::sip::SipMessage& request,
+                      const SocketAddress& destination, const fmus::sip::ResponseTemplate::Values& values = {});
     
     // Callbacks
     void setMessageCallback(MessageCallback callback) { message_callback_ = callback; }
     void setErrorCallback(ErrorCallback callback) { error_callback_ = callback; }
     
+    // Parse and deliver messages on the executor, keyed by Call-ID; inline when unset
+    void setExecutor(core::Executor* executor) { executor_ = executor; }
+    
+    // Turns new INVITEs and REGISTERs away with 503 when executor work queues up
+    OverloadController& getOverloadController() { return overload_; }
+    const OverloadController& getOverloadController() const { return overload_; }
+    
     // Connection management
     std::shared_ptr<TcpSocket> getTcpConnection(const SocketAddress& address);
     void closeTcpConnection(const SocketAddress& address);
+    size_t getWebSocketConnectionCount() const;
     
     // Statistics
     struct Stats {
@@ -49,21 +71,124 @@ private:
     void onUdpData(const std::vector<uint8_t>& data, const SocketAddress& from);
     void onTcpData(const std::vector<uint8_t>& data, const SocketAddress& from);
     void onTcpConnection(std::shared_ptr<Socket> connection);
+    void onWebSocketConnection(std::shared_ptr<Socket> connection);
     void onError(const std::string& error);
     
+    void dispatchMessage(std::string message, const SocketAddress& from);
     void processMessage(const std::string& message, const SocketAddress& from);
+    void rejectOverloaded(const std::string& message, const SocketAddress& from);
+    
+    void attachTcpConnection(const std::shared_ptr<TcpSocket>& connection);
+    
+    // Drains TCP connection outbound queues; declared first so it outlives the connections
+    SocketWriter tcp_writer_;
     
     std::shared_ptr<UdpSocket> udp_socket_;
     std::shared_ptr<TcpSocket> tcp_server_;
     std::unordered_map<std::string, std::shared_ptr<TcpSocket>> tcp_connections_;
+    std::shared_ptr<TcpSocket> ws_server_;
+    std::unordered_map<std::string, std::shared_ptr<WebSocketConnection>> ws_connections_;
     
     MessageCallback message_callback_;
     ErrorCallback error_callback_;
     
+    std::atomic<core::Executor*> executor_{nullptr};
+    std::atomic<size_t> pending_tasks_{0};
+    
+    OverloadController overload_;
+    const fmus::sip::ResponseTemplate overload_reply_ = fmus::sip::ResponseTemplate::serviceUnavailable();
+    
     mutable std::mutex mutex_;
     Stats stats_;
 };
 
+// RTP port and the RTCP port above it, with their sockets when the pool
+// pre-binds them
+struct RtpPortPair {
+    uint16_t rtp_port = 0; // Even; RTCP uses rtp_port + 1
+    std::shared_ptr<UdpSocket> rtp_socket;
+    std::shared_ptr<UdpSocket> rtcp_socket;
+    
+    uint16_t rtcpPort() const { return static_cast<uint16_t>(rtp_port + 1); }
+    bool isBound() const { return rtp_socket != nullptr; }
+};
+
+// Even/odd RTP/RTCP port pairs from a fixed range (RFC 3550 Section 11).
+//
+// With pre_bind set, start() creates and binds both sockets of every pair
+// once, so allocate() is a pop from a free list and call setup makes no
+// socket syscalls. Pre-binding stops short of the process fd limit; pairs
+// past that are left out of the pool. Released pairs sit in quarantine for
+// a while before reuse, and any packets that reached them in the meantime
+// (late media for the previous call) are discarded on the way out. Without
+// pre_bind the pool hands out port numbers only.
+class RtpPortPool {
+public:
+    struct Config {
+        std::string ip = "0.0.0.0";
+        uint16_t min_port = 20000;
+        uint16_t max_port = 39999;
+        bool pre_bind = true;
+        std::chrono::milliseconds quarantine{2000};
+        int receive_buffer_size = 0; // SO_RCVBUF for pre-bound sockets, 0 = system default
+    };
+    
+    RtpPortPool();
+    explicit RtpPortPool(const Config& config);
+    ~RtpPortPool();
+    
+    RtpPortPool(const RtpPortPool&) = delete;
+    RtpPortPool& operator=(const RtpPortPool&) = delete;
+    
+    void setConfig(const Config& config); // Takes effect on the next start()
+    bool start();
+    void stop(); // Closes pre-bound sockets, including those still allocated
+    bool isRunning() const { return running_; }
+    
+    std::optional<RtpPortPair> allocate();
+    void release(const RtpPortPair& pair);
+    
+    size_t available() const;   // Free now, excluding quarantine
+    size_t quarantined() const;
+    size_t capacity() const;
+    
+    // Statistics
+    struct Stats {
+        uint64_t allocations = 0;
+        uint64_t releases = 0;
+        uint64_t exhausted = 0;       // allocate() with no free pair
+        uint64_t bind_failures = 0;   // Pairs left out at start()
+        uint64_t stray_packets = 0;   // Discarded on leaving quarantine
+    };
+    
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    struct Entry {
+        RtpPortPair pair;
+        bool allocated = false;
+    };
+    
+    bool bindPair(RtpPortPair& pair);
+    void reclaim(std::chrono::steady_clock::time_point now); // Caller holds mutex_
+    
+    Config config_;
+    std::vector<Entry> entries_;                // Indexed by (port - first_port_) / 2
+    std::vector<uint32_t> free_;                // Stack of entry indices
+    std::deque<std::pair<std::chrono::steady_clock::time_point, uint32_t>> quarantine_; // Oldest first
+    uint16_t first_port_ = 0;
+    size_t capacity_ = 0;
+    bool running_ = false;
+    mutable std::mutex mutex_;
+    
+    std::atomic<uint64_t> allocations_{0};
+    std::atomic<uint64_t> releases_{0};
+    std::atomic<uint64_t> exhausted_{0};
+    std::atomic<uint64_t> bind_failures_{0};
+    std::atomic<uint64_t> stray_packets_{0};
+};
+
 class RtpTransport {
 public:
     using PacketCallback = std::function<void(const fmus::rtp::RtpPacket&, const SocketAddress&)>;
@@ -75,6 +200,10 @@ public:
     
     // Transport management
     bool start(const SocketAddress& rtp_address, const SocketAddress& rtcp_address = {});
+    
+    // Runs on a pre-bound pair from an RtpPortPool. stop() leaves its sockets
+    // open for the caller to release back to the pool.
+    bool start(const RtpPortPair& ports);
     void stop();
     
     // Packet sending
@@ -86,6 +215,33 @@ public:
     void setRtcpCallback(RtcpCallback callback) { rtcp_callback_ = callback; }
     void setErrorCallback(ErrorCallback callback) { error_callback_ = callback; }
     
+    // Deliver packets on the executor at media priority; inline when unset.
+    // All of one transport's packets go to the same worker, so its callbacks
+    // run one at a time and each stream stays in order, as with a receive
+    // thread. Pinned tasks are never stolen: the load spreads across workers
+    // per transport (per call), not per packet.
+    void setExecutor(core::Executor* executor) { executor_ = executor; }
+    
+    // Measure jitter and delay from kernel receive timestamps instead of the
+    // time packets are dequeued; applies from the next start()
+    void setReceiveTimestamps(bool enable) { receive_timestamps_ = enable; }
+    
+    // RTP clock for a payload type, used to compare RTP and arrival times.
+    // Static types default to RFC 3551; dynamic ones to 8000 Hz.
+    void setClockRate(uint8_t payload_type, uint32_t clock_rate);
+    
+    // Per-source receive statistics. Delay is one-way transit relative to
+    // the fastest packet seen, as sender and receiver clocks are not synced.
+    struct SourceStats {
+        uint32_t ssrc = 0;
+        uint64_t packets = 0;
+        double jitter_ms = 0;             // RFC 3550 interarrival jitter
+        double relative_delay_ms = 0;     // Latest packet
+        double max_relative_delay_ms = 0;
+    };
+    
+    std::vector<SourceStats> getSourceStats() const;
+    
     // Statistics
     struct Stats {
         uint64_t rtp_packets_sent = 0;
@@ -97,23 +253,62 @@ public:
         uint64_t errors = 0;
     };
     
-    Stats getStats() const { return stats_; }
-    void resetStats() { stats_ = {}; }
+    Stats getStats() const;
+    void resetStats();
 
 private:
-    void onRtpData(const std::vector<uint8_t>& data, const SocketAddress& from);
+    void onRtpData(const std::vector<uint8_t>& data, const SocketAddress& from, ReceiveTime received);
     void onRtcpData(const std::vector<uint8_t>& data, const SocketAddress& from);
     void onError(const std::string& error);
     
+    void dispatchPacket(const std::vector<uint8_t>& data, const SocketAddress& from, bool rtcp,
+                        ReceiveTime received = ReceiveTime(0));
+    void processRtp(const std::vector<uint8_t>& data, const SocketAddress& from, ReceiveTime received);
+    void processRtcp(const std::vector<uint8_t>& data, const SocketAddress& from);
+    void updateSource(const fmus::rtp::RtpPacket& packet, ReceiveTime received);
+    
+    void attachSockets(); // Caller holds mutex_
+    
     std::shared_ptr<UdpSocket> rtp_socket_;
     std::shared_ptr<UdpSocket> rtcp_socket_;
+    bool owns_sockets_ = true;
     
     PacketCallback rtp_callback_;
     RtcpCallback rtcp_callback_;
     ErrorCallback error_callback_;
     
+    std::atomic<core::Executor*> executor_{nullptr};
+    std::atomic<size_t> pending_tasks_{0};
+    const uint64_t affinity_; // Executor worker key for this transport
+    
+    // RFC 3550 A.8 state per SSRC, in seconds
+    struct SourceState {
+        SourceStats stats;
+        uint32_t last_timestamp = 0;
+        ReceiveTime last_arrival{0};
+        uint32_t clock_rate = 0;
+        double jitter = 0;
+        double transit = 0;     // Relative to the first packet
+        double min_transit = 0;
+    };
+    
+    static constexpr size_t MAX_SOURCES = 64; // Bounds state created by stray SSRCs
+    
+    bool receive_timestamps_ = false;
+    std::array<std::atomic<uint32_t>, 128> clock_rates_;
+    mutable std::mutex sources_mutex_;
+    std::unordered_map<uint32_t, SourceState> sources_;
+    
     mutable std::mutex mutex_;
-    Stats stats_;
+    
+    // Updated by senders and the receive worker without mutex_
+    std::atomic<uint64_t> rtp_packets_sent_{0};
+    std::atomic<uint64_t> rtp_packets_received_{0};
+    std::atomic<uint64_t> rtcp_packets_sent_{0};
+    std::atomic<uint64_t> rtcp_packets_received_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> errors_{0};
 };
 
 // Transport Manager - coordinates all network transports
@@ -130,15 +325,18 @@ public:
     
     // Global operations
     void shutdown();
+    void setExecutor(core::Executor* executor);
     
     // Configuration
     struct Config {
         SocketAddress sip_udp_address{"0.0.0.0", 5060};
         SocketAddress sip_tcp_address{"0.0.0.0", 5060};
+        SocketAddress sip_ws_address{"0.0.0.0", 8088};
         SocketAddress rtp_address{"0.0.0.0", 0}; // 0 = auto-assign
         SocketAddress rtcp_address{"0.0.0.0", 0}; // 0 = auto-assign
         bool enable_sip_udp = true;
         bool enable_sip_tcp = true;
+        bool enable_sip_ws = false;
         bool enable_rtp = true;
     };
     
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "outbound.hpp"
+#include "socket.hpp"
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include <netinet/in.h>
+
+struct io_uring_sqe;
+
+namespace fmus::network {
+
+// One io_uring instance with a completion thread, shared by every socket
+// and file writer once the IO_URING backend is selected. Uses the raw
+// system calls, so it needs no liburing.
+//
+// UDP receivers are multishot RECVMSG requests on registered file slots:
+// one submission keeps delivering datagrams into a ring of provided buffers
+// until cancelled, and is re-armed when the buffers run dry. Sends are a
+// SENDMSG linked to a LINK_TIMEOUT so a stuck send is cancelled instead of
+// holding its buffer. File writes are submitted in batches with one system
+// call, as WRITE_FIXED when the memory is a registered buffer.
+//
+// Receive handlers run on the completion thread and must not block.
+class IoUring {
+public:
+    struct Config {
+        unsigned entries = 1024;            // Submission queue size
+        unsigned buffer_count = 2048;       // Provided receive buffers, rounded up to a power of two
+        size_t buffer_size = 4096;          // Larger datagrams are dropped
+        unsigned fixed_files = 4096;        // Registered file slots
+        unsigned fixed_buffers = 1024;      // Registered buffer slots
+        std::chrono::milliseconds send_timeout{200};
+    };
+
+    using ReceiveHandler = std::function<void(const uint8_t*, size_t, const sockaddr_in&, ReceiveTime)>;
+    using Completion = std::function<void(int)>; // Bytes transferred or -errno
+
+    struct FileWrite {
+        int fd;
+        const void* data;
+        size_t size;
+        uint64_t offset;
+        int buffer_index = -1; // From registerBuffer(), -1 for plain memory
+        Completion done;       // Runs on the completion thread as this write ends
+    };
+
+    IoUring();
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Probes the kernel for everything the ring relies on
+    static bool isSupported();
+
+    // The ring behind the IO_URING backend
+    static IoUring& shared();
+
+    void setConfig(const Config& config);
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    // Delivers datagrams from a UDP socket until removed, with the kernel
+    // receive timestamp when the socket has them on; returns 0 on failure.
+    // removeReceiver() waits for the handler to finish unless called from it.
+    uint64_t addReceiver(int fd, ReceiveHandler handler);
+    void removeReceiver(uint64_t id);
+
+    // Sends asynchronously, keeping buffer alive until done; an unset
+    // destination sends on a connected socket
+    bool send(int fd, SharedBuffer buffer, const SocketAddress& to = {}, Completion done = {});
+
+    // Submits the writes together and blocks until all have completed;
+    // results[i] is what write i returned. A write's own completion runs as
+    // soon as it ends, e.g. to free its memory before the batch is done.
+    bool writeFiles(const FileWrite* writes, size_t count, int* results);
+
+    // Pins memory for WRITE_FIXED; returns the slot or -1 when none is free
+    int registerBuffer(void* data, size_t size);
+    void unregisterBuffer(int index);
+
+    // Statistics
+    struct Stats {
+        uint64_t datagrams_received = 0;
+        uint64_t bytes_received = 0;
+        uint64_t receive_rearms = 0;     // Multishot requests restarted
+        uint64_t truncated = 0;
+        uint64_t sends = 0;
+        uint64_t send_errors = 0;
+        uint64_t send_timeouts = 0;
+        uint64_t file_writes = 0;
+        uint64_t fixed_writes = 0;
+        uint64_t submit_calls = 0;
+        uint64_t wait_calls = 0;
+    };
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    struct Operation;
+    struct Receiver;
+    struct SendOperation;
+    struct WriteOperation;
+    struct WriteBatch;
+    struct SubmissionQueue;
+    struct CompletionQueue;
+
+    bool setupRing();
+    bool setupBufferRing();
+    void teardown();
+
+    // Callers hold submit_mutex_
+    io_uring_sqe* nextSqe(); // nullptr when the ring stays full
+    bool submit();
+    bool armReceiver(Receiver& receiver);
+    void armWake();
+
+    void wake();
+    void armQueued();
+    void completionLoop();
+    void handleReceive(Receiver& receiver, int result, uint32_t flags);
+    void recycleBuffer(uint16_t buffer_id);
+
+    int allocateFileSlot(int fd);
+    void releaseFileSlot(int slot);
+
+    Config config_;
+    std::atomic<bool> running_;
+    std::mutex state_mutex_;
+    int ring_fd_ = -1;
+    int wake_fd_ = -1;
+    uint64_t wake_value_ = 0;
+    std::unique_ptr<Operation> wake_op_;
+    std::atomic<size_t> in_flight_{0};
+
+    // Mapped rings
+    std::unique_ptr<SubmissionQueue> sq_;
+    std::unique_ptr<CompletionQueue> cq_;
+    void* sq_map_ = nullptr;
+    size_t sq_map_size_ = 0;
+    void* cq_map_ = nullptr;
+    size_t cq_map_size_ = 0;
+    void* sqe_map_ = nullptr;
+    size_t sqe_map_size_ = 0;
+    std::mutex submit_mutex_;
+
+    // Provided receive buffers
+    void* buffer_ring_ = nullptr;
+    size_t buffer_ring_size_ = 0;
+    std::vector<uint8_t> buffers_;
+    uint16_t buffer_tail_ = 0;
+
+    // Registered resources
+    std::mutex resource_mutex_;
+    std::vector<int> free_file_slots_;
+    std::vector<int> free_buffer_slots_;
+
+    std::mutex receiver_mutex_;
+    std::condition_variable receiver_cv_;
+    std::unordered_map<uint64_t, std::unique_ptr<Receiver>> receivers_;
+    std::vector<Receiver*> arm_queue_; // Added, waiting for the completion thread
+    uint64_t next_receiver_id_ = 1;
+
+    std::thread completion_thread_;
+    std::thread::id completion_thread_id_;
+
+    // Statistics
+    std::atomic<uint64_t> datagrams_received_{0};
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> receive_rearms_{0};
+    std::atomic<uint64_t> truncated_{0};
+    std::atomic<uint64_t> sends_{0};
+    std::atomic<uint64_t> send_errors_{0};
+    std::atomic<uint64_t> send_timeouts_{0};
+    std::atomic<uint64_t> file_writes_{0};
+    std::atomic<uint64_t> fixed_writes_{0};
+    std::atomic<uint64_t> submit_calls_{0};
+    std::atomic<uint64_t> wait_calls_{0};
+};
+
+} // namespace fmus::network
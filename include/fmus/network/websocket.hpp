@@ -0,0 +1,180 @@
+#pragma once
+
+#include "socket.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+
+namespace fmus::network {
+
+// WebSocket Frame Types
+enum class WebSocketOpcode : uint8_t {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xA
+};
+
+// WebSocket Frame
+struct WebSocketFrame {
+    bool fin = true;
+    WebSocketOpcode opcode = WebSocketOpcode::TEXT;
+    bool masked = false;
+    uint32_t mask = 0;
+    std::vector<uint8_t> payload;
+    
+    std::vector<uint8_t> serialize() const;
+    static WebSocketFrame deserialize(const uint8_t* data, size_t size);
+    static bool isWebSocketFrame(const uint8_t* data, size_t size);
+};
+
+// Incremental WebSocket frame decoder
+// Bytes are consumed as they arrive: header bytes are staged in a fixed buffer and
+// payload bytes are unmasked straight into the message being assembled, so a frame
+// is never re-parsed or shifted. Fragmented messages are reassembled and delivered
+// once; control frames may be interleaved and are delivered immediately.
+class WebSocketFrameDecoder {
+public:
+    using FrameCallback = std::function<void(const WebSocketFrame&)>;
+
+    explicit WebSocketFrameDecoder(size_t max_message_size = 16 * 1024 * 1024);
+
+    // Feed received bytes, returns false on protocol error
+    bool feed(const uint8_t* data, size_t size);
+    void reset();
+
+    void setFrameCallback(FrameCallback callback) { frame_callback_ = callback; }
+
+    // Server side: clients must mask every frame (RFC 6455 section 5.1)
+    void setRequireMasked(bool require) { require_masked_ = require; }
+
+    bool hasError() const { return !error_.empty(); }
+    const std::string& getError() const { return error_; }
+
+    // Statistics
+    struct Stats {
+        uint64_t frames_decoded = 0;
+        uint64_t messages_decoded = 0;
+        uint64_t control_frames = 0;
+        uint64_t continuation_frames = 0;
+        uint64_t bytes_consumed = 0;
+        uint64_t protocol_errors = 0;
+    };
+
+    Stats getStats() const { return stats_; }
+    void resetStats() { stats_ = {}; }
+
+private:
+    enum class State {
+        HEADER,
+        PAYLOAD
+    };
+
+    size_t consumeHeader(const uint8_t* data, size_t size);
+    size_t consumePayload(const uint8_t* data, size_t size);
+    bool beginFrame();
+    void finishFrame();
+    bool fail(const std::string& error);
+
+    size_t max_message_size_;
+    bool require_masked_ = false;
+    State state_ = State::HEADER;
+
+    // Current frame header
+    uint8_t header_[14];
+    size_t header_size_ = 0;
+    size_t header_needed_ = 2;
+    bool frame_fin_ = false;
+    WebSocketOpcode frame_opcode_ = WebSocketOpcode::TEXT;
+    bool frame_masked_ = false;
+    uint32_t frame_mask_ = 0;
+    uint64_t frame_length_ = 0;
+    uint64_t frame_received_ = 0;
+
+    // Data message being reassembled and the current control frame
+    WebSocketFrame message_;
+    WebSocketFrame control_;
+    bool in_message_ = false;
+
+    FrameCallback frame_callback_;
+    std::string error_;
+    Stats stats_;
+};
+
+// WebSocket Connection
+// Must be owned by a shared_ptr; owners may drop their reference from the
+// close callback.
+class WebSocketConnection : public std::enable_shared_from_this<WebSocketConnection> {
+public:
+    using MessageCallback = std::function<void(const std::string&)>;
+    using CloseCallback = std::function<void()>;
+    using ErrorCallback = std::function<void(const std::string&)>;
+
+    WebSocketConnection(std::shared_ptr<TcpSocket> socket);
+    ~WebSocketConnection();
+    
+    // Starts reading the upgrade request and frames. Call once the
+    // subprotocol and callbacks are set; they are not changed afterwards.
+    void start();
+    
+    // Subprotocol the client must offer (Sec-WebSocket-Protocol), e.g. "sip" for RFC 7118
+    void setSubprotocol(const std::string& subprotocol) { subprotocol_ = subprotocol; }
+    const std::string& getSubprotocol() const { return subprotocol_; }
+    
+    // Connection management
+    bool performHandshake(const std::string& request);
+    void close();
+    bool isConnected() const { return connected_; }
+    
+    // Message handling
+    bool sendMessage(const std::string& message);
+    bool sendFrame(const SharedBuffer& frame); // Pre-encoded frame, shared across connections
+    bool sendPing();
+    bool sendPong();
+    
+    static SharedBuffer encodeMessage(const std::string& message);
+    
+    // Callbacks
+    void setMessageCallback(MessageCallback callback) { message_callback_ = callback; }
+    void setCloseCallback(CloseCallback callback) { close_callback_ = callback; }
+    void setErrorCallback(ErrorCallback callback) { error_callback_ = callback; }
+    
+    // Properties
+    const std::string& getId() const { return connection_id_; }
+    SocketAddress getRemoteAddress() const;
+
+private:
+    void onSocketData(const std::vector<uint8_t>& data, const SocketAddress& from);
+    void onSocketError(const std::string& error);
+    void processWebSocketFrame(const WebSocketFrame& frame);
+    
+    std::string generateWebSocketAccept(const std::string& key) const;
+    
+    std::shared_ptr<TcpSocket> socket_;
+    std::string connection_id_;
+    std::atomic<bool> connected_;
+    std::atomic<bool> handshake_complete_;
+    std::string subprotocol_;
+    std::string handshake_buffer_;
+    
+    // Frame assembly
+    WebSocketFrameDecoder decoder_;
+    
+    MessageCallback message_callback_;
+    CloseCallback close_callback_;
+    ErrorCallback error_callback_;
+    
+    mutable std::mutex mutex_;
+};
+
+// Utility functions
+// XOR a WebSocket masking key over data in place; `offset` is the position of data[0]
+// within the frame payload so that chunked unmasking stays aligned with the key.
+void applyWebSocketMask(uint8_t* data, size_t size, uint32_t mask, uint64_t offset = 0);
+
+} // namespace fmus::network
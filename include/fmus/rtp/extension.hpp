@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace fmus::rtp {
+
+// Header extensions this library can read, by their SDP extmap URI
+enum class RtpExtensionType : uint8_t {
+    UNKNOWN,
+    AUDIO_LEVEL,               // RFC 6464 client-to-mixer audio level
+    ABS_SEND_TIME,             // Sender clock, 6.18 fixed point seconds
+    TRANSPORT_SEQUENCE_NUMBER, // Transport-wide congestion control
+    MID                        // RFC 8843 media identification
+};
+
+const char* extensionTypeToUri(RtpExtensionType type);
+RtpExtensionType uriToExtensionType(std::string_view uri);
+
+// One element of a header extension block; data points into the packet
+struct RtpExtensionElement {
+    uint8_t id = 0;
+    const uint8_t* data = nullptr;
+    uint8_t size = 0;
+};
+
+// Zero-copy view over an RFC 8285 one-byte (0xBEDE) or two-byte (0x100x)
+// header extension block. Only valid while the bytes it views are.
+// Malformed trailing elements end the iteration rather than failing it.
+class RtpExtensionView {
+public:
+    static constexpr uint16_t ONE_BYTE_PROFILE = 0xBEDE;
+    static constexpr uint16_t TWO_BYTE_PROFILE = 0x1000; // Low four bits are application bits
+
+    RtpExtensionView() = default;
+    RtpExtensionView(uint16_t profile, const uint8_t* data, size_t size)
+        : profile_(profile), data_(data), size_(size) {}
+
+    // Finds the block in a serialized RTP packet without copying it; empty
+    // when the packet has no extension or is too short for the one it claims
+    static RtpExtensionView fromPacket(const uint8_t* packet, size_t size);
+
+    uint16_t getProfile() const { return profile_; }
+    bool isOneByte() const { return profile_ == ONE_BYTE_PROFILE; }
+    bool isTwoByte() const { return (profile_ & 0xFFF0) == TWO_BYTE_PROFILE; }
+    bool empty() const { return size_ == 0 || (!isOneByte() && !isTwoByte()); }
+
+    std::optional<RtpExtensionElement> find(uint8_t id) const;
+
+    class Iterator {
+    public:
+        Iterator(const RtpExtensionView* view, size_t offset) : view_(view), next_(offset) { advance(); }
+
+        const RtpExtensionElement& operator*() const { return element_; }
+        const RtpExtensionElement* operator->() const { return &element_; }
+        Iterator& operator++() { advance(); return *this; }
+        bool operator==(const Iterator& other) const { return offset_ == other.offset_; }
+        bool operator!=(const Iterator& other) const { return offset_ != other.offset_; }
+
+    private:
+        void advance();
+
+        const RtpExtensionView* view_;
+        size_t offset_ = END; // Start of the current element
+        size_t next_;
+        RtpExtensionElement element_;
+    };
+
+    Iterator begin() const { return Iterator(this, empty() ? END : 0); }
+    Iterator end() const { return Iterator(this, END); }
+
+private:
+    static constexpr size_t END = static_cast<size_t>(-1);
+
+    uint16_t profile_ = 0;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Extension IDs agreed for a session through SDP a=extmap lines, with
+// typed readers for the extensions they map
+class RtpExtensionMap {
+public:
+    // Maps an ID to the extension behind uri; false when the ID is out of
+    // range or the URI is not one this library reads
+    bool add(uint8_t id, std::string_view uri);
+    bool add(uint8_t id, RtpExtensionType type);
+    void remove(uint8_t id);
+    void clear();
+
+    // 0 when the extension was not negotiated
+    uint8_t getId(RtpExtensionType type) const { return ids_[static_cast<size_t>(type)]; }
+    RtpExtensionType getType(uint8_t id) const { return types_[id]; }
+    static bool isKnown(std::string_view uri) { return uriToExtensionType(uri) != RtpExtensionType::UNKNOWN; }
+
+    struct AudioLevel {
+        bool voice_activity = false;
+        uint8_t level = 127; // -dBov, 0 loudest and 127 silence
+    };
+
+    std::optional<AudioLevel> getAudioLevel(const RtpExtensionView& view) const;
+    std::optional<uint32_t> getAbsSendTime(const RtpExtensionView& view) const; // 24 bits
+    std::optional<uint16_t> getTransportSequenceNumber(const RtpExtensionView& view) const;
+    std::optional<std::string_view> getMid(const RtpExtensionView& view) const;
+
+private:
+    std::optional<RtpExtensionElement> find(const RtpExtensionView& view, RtpExtensionType type) const;
+
+    std::array<RtpExtensionType, 256> types_{};
+    std::array<uint8_t, 5> ids_{};
+};
+
+} // namespace fmus::rtp
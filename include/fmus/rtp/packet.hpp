@@ -1,5 +1,6 @@
 #pragma once
 
+#include "extension.hpp"
 #include <cstdint>
 #include <vector>
 #include <memory>
@@ -18,6 +19,16 @@ struct RtpHeader {
     uint32_t ssrc = 0;
     std::vector<uint32_t> csrc_list;
     
+    // Header extension block after the CSRCs when extension is set; the
+    // data is padded to whole 32-bit words on serialization
+    uint16_t extension_profile = RtpExtensionView::ONE_BYTE_PROFILE;
+    std::vector<uint8_t> extension_data;
+    
+    RtpExtensionView getExtensions() const {
+        return extension ? RtpExtensionView(extension_profile, extension_data.data(), extension_data.size())
+                         : RtpExtensionView();
+    }
+    
     // Serialize to bytes
     std::vector<uint8_t> serialize() const;
     
@@ -48,7 +59,8 @@ public:
     // Serialize entire packet to bytes
     std::vector<uint8_t> serialize() const;
     
-    // Deserialize packet from bytes
+    // Deserialize packet from bytes; the payload excludes the header
+    // extension and any padding
     static std::unique_ptr<RtpPacket> deserialize(const uint8_t* data, size_t size);
     
     // Get total packet size
@@ -2,15 +2,21 @@
 
 #include "message.hpp"
 #include "transaction.hpp"
+#include "../core/inline_string.hpp"
 #include <string>
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include <functional>
 #include <atomic>
 #include <mutex>
 
 namespace fmus::sip {
 
+// Dialog identifiers; Call-ID and tags are hashed once when extracted
+using DialogId = core::InlineString<128>;
+using SipIdentifier = core::InlineString<64>;
+
 // Dialog States
 enum class DialogState {
     EARLY,      // Dialog created, not confirmed yet
@@ -24,17 +30,17 @@ public:
     using StateCallback = std::function<void(DialogState, DialogState)>;
     using MessageCallback = std::function<void(const SipMessage&)>;
 
-    Dialog(const std::string& dialog_id, const SipMessage& initial_request);
+    Dialog(const DialogId& dialog_id, const SipMessage& initial_request);
     ~Dialog();
     
     // Basic properties
-    const std::string& getId() const { return dialog_id_; }
+    const DialogId& getId() const { return dialog_id_; }
     DialogState getState() const { return state_; }
     
     // Dialog identification (RFC 3261 Section 12.1.1)
-    const std::string& getCallId() const { return call_id_; }
-    const std::string& getLocalTag() const { return local_tag_; }
-    const std::string& getRemoteTag() const { return remote_tag_; }
+    const SipIdentifier& getCallId() const { return call_id_; }
+    const SipIdentifier& getLocalTag() const { return local_tag_; }
+    const SipIdentifier& getRemoteTag() const { return remote_tag_; }
     
     // Route set management
     const std::vector<std::string>& getRouteSet() const { return route_set_; }
@@ -77,8 +83,8 @@ public:
     
     // Transaction management
     void addTransaction(std::shared_ptr<Transaction> transaction);
-    void removeTransaction(const std::string& transaction_id);
-    std::shared_ptr<Transaction> findTransaction(const std::string& transaction_id) const;
+    void removeTransaction(const TransactionId& transaction_id);
+    std::shared_ptr<Transaction> findTransaction(const TransactionId& transaction_id) const;
     
     // Callbacks
     void setStateCallback(StateCallback callback) { state_callback_ = callback; }
@@ -86,7 +92,7 @@ public:
     
     // Validation
     bool validateMessage(const SipMessage& message) const;
-    static std::string generateDialogId(const SipMessage& message);
+    static DialogId generateDialogId(const SipMessage& message);
 
 private:
     void notifyStateChange(DialogState old_state);
@@ -94,13 +100,13 @@ private:
     void extractDialogInfo(const SipMessage& message);
     uint32_t extractCSeq(const std::string& cseq_header) const;
     
-    std::string dialog_id_;
+    DialogId dialog_id_;
     std::atomic<DialogState> state_;
     
     // Dialog identification
-    std::string call_id_;
-    std::string local_tag_;
-    std::string remote_tag_;
+    SipIdentifier call_id_;
+    SipIdentifier local_tag_;
+    SipIdentifier remote_tag_;
     
     // URIs and routing
     std::string local_uri_;
@@ -134,10 +140,10 @@ public:
     
     // Dialog management
     std::shared_ptr<Dialog> createDialog(const SipMessage& initial_request);
-    std::shared_ptr<Dialog> findDialog(const std::string& dialog_id) const;
+    std::shared_ptr<Dialog> findDialog(const DialogId& dialog_id) const;
     std::shared_ptr<Dialog> findDialogByMessage(const SipMessage& message) const;
     
-    void removeDialog(const std::string& dialog_id);
+    void removeDialog(const DialogId& dialog_id);
     void removeDialog(std::shared_ptr<Dialog> dialog);
     
     // Message routing
@@ -158,7 +164,7 @@ public:
 private:
     void onDialogStateChanged(std::shared_ptr<Dialog> dialog, DialogState old_state, DialogState new_state);
     
-    std::vector<std::shared_ptr<Dialog>> dialogs_;
+    std::unordered_map<DialogId, std::shared_ptr<Dialog>> dialogs_;
     
     // Callbacks
     DialogCallback dialog_created_callback_;
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "../core/pool.hpp"
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
+#include <cstdint>
 
 namespace fmus::sip {
 
@@ -43,7 +46,12 @@ enum class SipResponseCode {
     Forbidden = 403,
     NotFound = 404,
     MethodNotAllowed = 405,
+    ProxyAuthenticationRequired = 407,
     RequestTimeout = 408,
+    CallDoesNotExist = 481,
+    BusyHere = 486,
+    RequestTerminated = 487,
+    NotAcceptableHere = 488,
     
     // 5xx Server Error
     ServerInternalError = 500,
@@ -72,10 +80,17 @@ public:
 
 class SipHeaders {
 public:
-    void set(const std::string& name, const std::string& value);
-    std::string get(const std::string& name) const;
-    bool has(const std::string& name) const;
-    void remove(const std::string& name);
+    SipHeaders() = default;
+    SipHeaders(const SipHeaders& other);
+    SipHeaders(SipHeaders&& other) noexcept = default;
+    SipHeaders& operator=(const SipHeaders& other);
+    SipHeaders& operator=(SipHeaders&& other) noexcept = default;
+    
+    void set(std::string_view name, std::string_view value);
+    std::string get(std::string_view name) const;
+    std::string_view view(std::string_view name) const; // Valid until the headers change
+    bool has(std::string_view name) const;
+    void remove(std::string_view name);
     
     // Convenience methods for common headers
     void setFrom(const std::string& from) { set("From", from); }
@@ -96,10 +111,35 @@ public:
     std::string getContentType() const { return get("Content-Type"); }
     size_t getContentLength() const;
     
-    const std::unordered_map<std::string, std::string>& getAll() const { return headers_; }
+    size_t size() const { return entries_.size(); }
+    
+    // Calls visitor(name, value) for each header in insertion order
+    template<typename Visitor>
+    void forEach(Visitor&& visitor) const {
+        for (const auto& entry : entries_) {
+            visitor(text(entry.name_offset, entry.name_length), text(entry.value_offset, entry.value_length));
+        }
+    }
 
 private:
-    std::unordered_map<std::string, std::string> headers_;
+    // Names and values live in one per-message arena that only grows; a
+    // value replaced by a longer one stays behind until the message dies.
+    // Copies are compacted.
+    struct Entry {
+        uint32_t name_offset;
+        uint32_t name_length;
+        uint32_t value_offset;
+        uint32_t value_length;
+    };
+    
+    std::string_view text(uint32_t offset, uint32_t length) const {
+        return std::string_view(arena_.data() + offset, length);
+    }
+    uint32_t store(std::string_view value);
+    const Entry* find(std::string_view name) const;
+    
+    std::vector<Entry, core::PoolAllocator<Entry>> entries_;
+    std::vector<char, core::PoolAllocator<char>> arena_;
 };
 
 class SipMessage {
@@ -112,6 +152,10 @@ public:
     // Response constructor  
     SipMessage(SipResponseCode code, const std::string& reason_phrase = "");
     
+    // Response carrying the request's Via, From, To, Call-ID and CSeq
+    static SipMessage createResponse(const SipMessage& request, SipResponseCode code,
+                                     const std::string& reason_phrase = "");
+    
     bool isRequest() const { return is_request_; }
     bool isResponse() const { return !is_request_; }
     
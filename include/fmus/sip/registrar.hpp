@@ -2,7 +2,9 @@
 
 #include "message.hpp"
 #include "dialog.hpp"
+#include "transaction.hpp"
 #include "../network/socket.hpp"
+#include "../core/coroutine.hpp"
 #include <string>
 #include <unordered_map>
 #include <memory>
@@ -99,6 +101,7 @@ public:
     // Callbacks
     void setAuthenticationCallback(AuthenticationCallback callback) { auth_callback_ = callback; }
     void setRegistrationCallback(RegistrationCallback callback) { registration_callback_ = callback; }
+    const RegistrationCallback& getRegistrationCallback() const { return registration_callback_; }
     
     // User management
     bool addUser(const std::string& username, const std::string& password, 
@@ -150,6 +153,7 @@ class SipRegistrationClient {
 public:
     using StateCallback = std::function<void(RegistrationState, RegistrationState)>;
     using ErrorCallback = std::function<void(const std::string&)>;
+    using SendCallback = std::function<bool(const SipMessage&)>;
 
     SipRegistrationClient();
     ~SipRegistrationClient();
@@ -167,6 +171,11 @@ public:
     // Callbacks
     void setStateCallback(StateCallback callback) { state_callback_ = callback; }
     void setErrorCallback(ErrorCallback callback) { error_callback_ = callback; }
+    void setSendCallback(SendCallback callback) { send_callback_ = callback; }
+    
+    // Registration flows run on this loop; without one (or without a send
+    // callback) registerUser() only builds and logs the request
+    void setEventLoop(core::EventLoop* loop) { loop_ = loop; }
     
     // Registration operations
     bool registerUser();
@@ -179,8 +188,17 @@ public:
     
     // Message handling
     bool processResponse(const SipMessage& response);
+    
+    // REGISTER, answer one digest challenge, then wait for the final answer.
+    // Resolves true on 2xx; expires 0 unregisters. One flow at a time, and
+    // the client must outlive it.
+    core::Task<bool> registerFlow(uint32_t expires);
 
 private:
+    // Sends request in a new client transaction, retransmitting on Timer E
+    // until a response arrives; nullopt after Timer F
+    core::Task<std::optional<SipMessage>> sendRequest(SipMessage request);
+    
     void setState(RegistrationState new_state);
     void notifyError(const std::string& error);
     
@@ -206,6 +224,10 @@ private:
     
     StateCallback state_callback_;
     ErrorCallback error_callback_;
+    SendCallback send_callback_;
+    
+    core::EventLoop* loop_ = nullptr;
+    std::shared_ptr<ClientNonInviteTransaction> transaction_; // Awaiting a response
     
     mutable std::mutex mutex_;
 };
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "message.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace fmus::sip {
+
+// Pre-serialized response for replies sent without a transaction: 100
+// Trying, 200 to OPTIONS, 401/407 challenges, 503 overload and the like.
+//
+// The status line and fixed headers are laid out once as bytes with slots
+// between them. render() copies the request's Via, From, To, Call-ID and
+// CSeq in from its parsed header views, plus a To tag and per-reply values
+// such as the nonce, without building a SipMessage. The output matches what
+// SipMessage::createResponse() plus the same headers would serialize to.
+//
+// Templates are immutable once built and may be shared between threads.
+class ResponseTemplate {
+public:
+    // Per-reply values for slots in added headers
+    enum class Slot : uint8_t {
+        NONCE,
+        VALUE
+    };
+
+    struct Values {
+        std::string_view to_tag; // Generated when empty and the template adds a tag
+        std::string_view nonce;
+        std::string_view value;
+    };
+
+    explicit ResponseTemplate(SipResponseCode code, const std::string& reason_phrase = "");
+
+    // Adds ";tag=" to a To header that has none, as every final response
+    // outside a dialog needs
+    ResponseTemplate& addToTag(bool enable = true);
+
+    // Headers after the copied ones, in order; Content-Length: 0 comes last
+    ResponseTemplate& addHeader(std::string_view name, std::string_view value);
+    ResponseTemplate& addHeader(std::string_view name, std::string_view prefix, Slot slot,
+                                std::string_view suffix = {});
+
+    SipResponseCode getCode() const { return code_; }
+
+    // Writes the reply to request into out; returns its size, or 0 when it
+    // does not fit in capacity
+    size_t render(const SipMessage& request, const Values& values, char* out, size_t capacity) const;
+
+    // Same, into a per-thread buffer reused across calls; the view is valid
+    // until the next render() on this thread
+    std::string_view render(const SipMessage& request, const Values& values = {}) const;
+
+    // Common replies
+    static ResponseTemplate trying();
+    static ResponseTemplate optionsOk(std::string_view allow);
+    static ResponseTemplate challenge(std::string_view realm, bool proxy = false); // Nonce slot
+    static ResponseTemplate serviceUnavailable();                               // Retry-After value slot
+
+private:
+    // Literal bytes from text_, or a slot when length is 0
+    enum class Source : uint8_t {
+        LITERAL,
+        VIA,
+        FROM,
+        TO,
+        CALL_ID,
+        CSEQ,
+        NONCE,
+        VALUE
+    };
+
+    struct Segment {
+        Source source;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    void addLiteral(std::string_view text);
+    void addSource(Source source);
+
+    SipResponseCode code_;
+    bool to_tag_ = false;
+    std::string text_;
+    std::vector<Segment> segments_;
+    size_t literal_size_ = 0;
+};
+
+} // namespace fmus::sip
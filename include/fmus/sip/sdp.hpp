@@ -65,6 +65,35 @@ struct Attribute {
     bool isProperty() const { return value.empty(); }
 };
 
+// SDP certificate fingerprint (RFC 4572), e.g. a=fingerprint:sha-1 4A:AD:B9:...
+// Only sha-1 digests can be computed locally.
+struct Fingerprint {
+    std::string hash_function = "sha-1";
+    std::vector<uint8_t> digest;
+    
+    std::string toString() const;
+    Attribute toAttribute() const { return Attribute("fingerprint", toString()); }
+    static std::optional<Fingerprint> fromString(const std::string& value);
+    
+    static Fingerprint fromCertificate(const std::vector<uint8_t>& der);
+    static std::optional<Fingerprint> fromPem(const std::string& pem);
+    
+    bool matches(const std::vector<uint8_t>& der) const;
+};
+
+// SDP RTP header extension mapping (RFC 8285), e.g.
+// a=extmap:1/sendonly urn:ietf:params:rtp-hdrext:ssrc-audio-level
+struct ExtensionMap {
+    uint8_t id = 0;
+    std::string direction; // Empty for the media direction
+    std::string uri;
+    std::string attributes;
+    
+    std::string toString() const;
+    Attribute toAttribute() const { return Attribute("extmap", toString()); }
+    static std::optional<ExtensionMap> fromString(const std::string& value);
+};
+
 // SDP Media Description
 class MediaDescription {
 public:
@@ -104,6 +133,9 @@ public:
     
     const std::vector<Attribute>& getAllAttributes() const { return attributes_; }
     
+    // Well-formed a=extmap lines, in order
+    std::vector<ExtensionMap> getExtensionMaps() const;
+    
     // Serialization
     std::string toString() const;
     static MediaDescription fromString(const std::string& media_section);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "message.hpp"
+#include "../core/coroutine.hpp"
+#include "../core/inline_string.hpp"
 #include <string>
 #include <memory>
 #include <functional>
@@ -10,6 +12,14 @@
 
 namespace fmus::sip {
 
+// RFC 3261 timer values
+constexpr std::chrono::milliseconds TIMER_T1{500};  // RTT estimate
+constexpr std::chrono::milliseconds TIMER_T2{4000}; // Maximum retransmit interval
+constexpr std::chrono::milliseconds TIMER_B{64 * TIMER_T1.count()}; // Also Timer F
+
+// Transaction identifier; hashed once when generated
+using TransactionId = core::InlineString<32>;
+
 // Transaction States
 enum class TransactionState {
     // Client Transaction States
@@ -47,11 +57,11 @@ public:
     using TimeoutCallback = std::function<void()>;
     using MessageCallback = std::function<void(const SipMessage&)>;
 
-    Transaction(TransactionType type, const std::string& transaction_id);
+    Transaction(TransactionType type, const TransactionId& transaction_id);
     virtual ~Transaction();
     
     // Basic properties
-    const std::string& getId() const { return transaction_id_; }
+    const TransactionId& getId() const { return transaction_id_; }
     TransactionType getType() const { return type_; }
     TransactionState getState() const { return state_; }
     
@@ -67,6 +77,13 @@ public:
     void setTimeoutCallback(TimeoutCallback callback) { timeout_callback_ = callback; }
     void setMessageCallback(MessageCallback callback) { message_callback_ = callback; }
     
+    // Coroutine API: resumes with the final response, or with nullopt once
+    // timeout passes. A later await still sees a response that arrives after
+    // a timeout. Client transactions only; one waiter at a time.
+    core::Oneshot<SipMessage>::Awaiter finalResponse(std::chrono::milliseconds timeout = TIMER_B) {
+        return final_response_->wait(timeout);
+    }
+    
     // Timing
     void startTimer(const std::string& timer_name, std::chrono::milliseconds duration);
     void stopTimer(const std::string& timer_name);
@@ -84,9 +101,10 @@ protected:
     void notifyStateChange(TransactionState old_state);
     void notifyTimeout();
     void notifyMessage(const SipMessage& message);
+    void completeFinalResponse(const SipMessage& response);
     
     TransactionType type_;
-    std::string transaction_id_;
+    TransactionId transaction_id_;
     std::atomic<TransactionState> state_;
     
     // Callbacks
@@ -94,6 +112,9 @@ protected:
     TimeoutCallback timeout_callback_;
     MessageCallback message_callback_;
     
+    // First final response, for coroutines awaiting finalResponse()
+    std::shared_ptr<core::Oneshot<SipMessage>> final_response_;
+    
     // Dialog reference (weak to avoid circular dependencies)
     std::weak_ptr<Dialog> dialog_;
     
@@ -115,7 +136,7 @@ protected:
 // Client INVITE Transaction
 class ClientInviteTransaction : public Transaction {
 public:
-    ClientInviteTransaction(const std::string& transaction_id, const SipMessage& invite);
+    ClientInviteTransaction(const TransactionId& transaction_id, const SipMessage& invite);
     
     bool processMessage(const SipMessage& message) override;
     bool sendMessage(const SipMessage& message) override;
@@ -144,7 +165,7 @@ private:
 // Client Non-INVITE Transaction  
 class ClientNonInviteTransaction : public Transaction {
 public:
-    ClientNonInviteTransaction(const std::string& transaction_id, const SipMessage& request);
+    ClientNonInviteTransaction(const TransactionId& transaction_id, const SipMessage& request);
     
     bool processMessage(const SipMessage& message) override;
     bool sendMessage(const SipMessage& message) override;
@@ -166,7 +187,7 @@ private:
 // Server INVITE Transaction
 class ServerInviteTransaction : public Transaction {
 public:
-    ServerInviteTransaction(const std::string& transaction_id, const SipMessage& invite);
+    ServerInviteTransaction(const TransactionId& transaction_id, const SipMessage& invite);
     
     bool processMessage(const SipMessage& message) override;
     bool sendMessage(const SipMessage& message) override;
@@ -195,7 +216,7 @@ private:
 // Server Non-INVITE Transaction
 class ServerNonInviteTransaction : public Transaction {
 public:
-    ServerNonInviteTransaction(const std::string& transaction_id, const SipMessage& request);
+    ServerNonInviteTransaction(const TransactionId& transaction_id, const SipMessage& request);
     
     bool processMessage(const SipMessage& message) override;
     bool sendMessage(const SipMessage& message) override;
@@ -220,14 +241,14 @@ private:
 class TransactionIdGenerator {
 public:
     // Generate transaction ID from SIP message (RFC 3261 Section 17.1.3)
-    static std::string generateClientId(const SipMessage& request);
-    static std::string generateServerId(const SipMessage& request);
+    static TransactionId generateClientId(const SipMessage& request);
+    static TransactionId generateServerId(const SipMessage& request);
     
     // Generate branch parameter for Via header
     static std::string generateBranch();
 
 private:
-    static std::string hashMessage(const SipMessage& message);
+    static TransactionId hashMessage(const SipMessage& message, bool include_request_uri);
 };
 
 } // namespace fmus::sip
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../network/socket.hpp"
+#include "../network/websocket.hpp"
 #include "../sip/sdp.hpp"
 #include <string>
 #include <unordered_map>
@@ -13,6 +14,13 @@
 
 namespace fmus::webrtc {
 
+// WebSocket framing lives in the network layer so SIP transports can share it
+using network::WebSocketOpcode;
+using network::WebSocketFrame;
+using network::WebSocketFrameDecoder;
+using network::WebSocketConnection;
+using network::applyWebSocketMask;
+
 // WebRTC Signaling Message Types
 enum class SignalingMessageType {
     OFFER,
@@ -43,82 +51,6 @@ struct SignalingMessage {
     bool isValid() const { return !session_id.empty() && !from.empty(); }
 };
 
-// WebSocket Frame Types (simplified)
-enum class WebSocketOpcode : uint8_t {
-    CONTINUATION = 0x0,
-    TEXT = 0x1,
-    BINARY = 0x2,
-    CLOSE = 0x8,
-    PING = 0x9,
-    PONG = 0xA
-};
-
-// WebSocket Frame
-struct WebSocketFrame {
-    bool fin = true;
-    WebSocketOpcode opcode = WebSocketOpcode::TEXT;
-    bool masked = false;
-    uint32_t mask = 0;
-    std::vector<uint8_t> payload;
-    
-    std::vector<uint8_t> serialize() const;
-    static WebSocketFrame deserialize(const uint8_t* data, size_t size);
-    static bool isWebSocketFrame(const uint8_t* data, size_t size);
-};
-
-// WebSocket Connection
-class WebSocketConnection {
-public:
-    using MessageCallback = std::function<void(const std::string&)>;
-    using CloseCallback = std::function<void()>;
-    using ErrorCallback = std::function<void(const std::string&)>;
-
-    WebSocketConnection(std::shared_ptr<network::TcpSocket> socket);
-    ~WebSocketConnection();
-    
-    // Connection management
-    bool performHandshake(const std::string& request);
-    void close();
-    bool isConnected() const { return connected_; }
-    
-    // Message handling
-    bool sendMessage(const std::string& message);
-    bool sendPing();
-    bool sendPong();
-    
-    // Callbacks
-    void setMessageCallback(MessageCallback callback) { message_callback_ = callback; }
-    void setCloseCallback(CloseCallback callback) { close_callback_ = callback; }
-    void setErrorCallback(ErrorCallback callback) { error_callback_ = callback; }
-    
-    // Properties
-    const std::string& getId() const { return connection_id_; }
-    const network::SocketAddress& getRemoteAddress() const;
-
-private:
-    void onSocketData(const std::vector<uint8_t>& data, const network::SocketAddress& from);
-    void onSocketError(const std::string& error);
-    void processWebSocketFrame(const WebSocketFrame& frame);
-    
-    std::string generateWebSocketAccept(const std::string& key) const;
-    std::string calculateSHA1(const std::string& data) const;
-    std::string base64Encode(const std::vector<uint8_t>& data) const;
-    
-    std::shared_ptr<network::TcpSocket> socket_;
-    std::string connection_id_;
-    std::atomic<bool> connected_;
-    std::atomic<bool> handshake_complete_;
-    
-    // Frame assembly
-    std::vector<uint8_t> frame_buffer_;
-    
-    MessageCallback message_callback_;
-    CloseCallback close_callback_;
-    ErrorCallback error_callback_;
-    
-    mutable std::mutex mutex_;
-};
-
 // WebRTC Signaling Server
 class SignalingServer {
 public:
@@ -184,9 +116,15 @@ private:
     void handleIceCandidate(const SignalingMessage& message, const std::string& connection_id);
     void handleBye(const SignalingMessage& message, const std::string& connection_id);
     
+    // Queue one encoded frame on every recipient without holding mutex_
+    bool fanOut(const network::SharedBuffer& frame, const std::vector<std::shared_ptr<WebSocketConnection>>& recipients);
+    
     std::shared_ptr<network::TcpSocket> server_socket_;
     std::atomic<bool> running_;
     
+    // Drains connection outbound queues; declared before connections_ so it outlives them
+    network::SocketWriter writer_;
+    
     // Connection management
     std::unordered_map<std::string, std::shared_ptr<WebSocketConnection>> connections_;
     
@@ -0,0 +1,227 @@
+#include "fmus/core/base64.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace fmus::core {
+
+namespace {
+
+const char ENCODE_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 0xFF marks bytes outside the alphabet
+struct DecodeTable {
+    uint8_t values[256];
+
+    DecodeTable() {
+        for (auto& value : values) {
+            value = 0xFF;
+        }
+        for (uint8_t i = 0; i < 64; ++i) {
+            values[static_cast<uint8_t>(ENCODE_TABLE[i])] = i;
+        }
+    }
+};
+
+const DecodeTable DECODE_TABLE;
+
+void encodeScalar(const uint8_t* in, size_t size, char* out) {
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        uint32_t triple = (static_cast<uint32_t>(in[i]) << 16) |
+                          (static_cast<uint32_t>(in[i + 1]) << 8) |
+                          static_cast<uint32_t>(in[i + 2]);
+        *out++ = ENCODE_TABLE[(triple >> 18) & 0x3F];
+        *out++ = ENCODE_TABLE[(triple >> 12) & 0x3F];
+        *out++ = ENCODE_TABLE[(triple >> 6) & 0x3F];
+        *out++ = ENCODE_TABLE[triple & 0x3F];
+    }
+
+    size_t remaining = size - i;
+    if (remaining > 0) {
+        uint32_t triple = static_cast<uint32_t>(in[i]) << 16;
+        if (remaining == 2) {
+            triple |= static_cast<uint32_t>(in[i + 1]) << 8;
+        }
+        *out++ = ENCODE_TABLE[(triple >> 18) & 0x3F];
+        *out++ = ENCODE_TABLE[(triple >> 12) & 0x3F];
+        *out++ = remaining == 2 ? ENCODE_TABLE[(triple >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+}
+
+// Decodes whole quartets plus an optional padded or unpadded tail; returns bytes written or -1
+ptrdiff_t decodeScalar(const char* in, size_t size, uint8_t* out) {
+    // Strip up to two padding characters, only valid on a complete final quartet
+    if (size % 4 == 0 && size > 0 && in[size - 1] == '=') {
+        size--;
+        if (in[size - 1] == '=') {
+            size--;
+        }
+    }
+    if (size % 4 == 1) {
+        return -1;
+    }
+
+    uint8_t* start = out;
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        uint32_t a = DECODE_TABLE.values[static_cast<uint8_t>(in[i])];
+        uint32_t b = DECODE_TABLE.values[static_cast<uint8_t>(in[i + 1])];
+        uint32_t c = DECODE_TABLE.values[static_cast<uint8_t>(in[i + 2])];
+        uint32_t d = DECODE_TABLE.values[static_cast<uint8_t>(in[i + 3])];
+        if ((a | b | c | d) & 0x80) {
+            return -1;
+        }
+        uint32_t triple = (a << 18) | (b << 12) | (c << 6) | d;
+        *out++ = static_cast<uint8_t>(triple >> 16);
+        *out++ = static_cast<uint8_t>(triple >> 8);
+        *out++ = static_cast<uint8_t>(triple);
+    }
+
+    size_t remaining = size - i;
+    if (remaining > 0) {
+        uint32_t a = DECODE_TABLE.values[static_cast<uint8_t>(in[i])];
+        uint32_t b = DECODE_TABLE.values[static_cast<uint8_t>(in[i + 1])];
+        uint32_t c = remaining == 3 ? DECODE_TABLE.values[static_cast<uint8_t>(in[i + 2])] : 0;
+        if ((a | b | c) & 0x80) {
+            return -1;
+        }
+        uint32_t triple = (a << 18) | (b << 12) | (c << 6);
+        *out++ = static_cast<uint8_t>(triple >> 16);
+        if (remaining == 3) {
+            *out++ = static_cast<uint8_t>(triple >> 8);
+        }
+    }
+
+    return out - start;
+}
+
+#if defined(__x86_64__)
+bool cpuHasSsse3() {
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+    return has_ssse3;
+}
+
+// 12 input bytes to 16 characters per iteration: split into 6-bit indices with
+// multiplies, then map indices to ASCII through a pshufb offset table
+__attribute__((target("ssse3")))
+size_t encodeSsse3(const uint8_t* in, size_t size, char* out) {
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+
+    size_t consumed = 0;
+    while (size - consumed >= 16) {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + consumed));
+        input = _mm_shuffle_epi8(input, shuffle);
+
+        __m128i hi = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)),
+                                     _mm_set1_epi32(0x04000040));
+        __m128i lo = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003f03f0)),
+                                     _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(hi, lo);
+
+        __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+        __m128i ascii = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), ascii);
+        out += 16;
+        consumed += 12;
+    }
+    return consumed;
+}
+
+// 16 characters to 12 bytes per iteration. Characters are classified by nibble
+// lookups; a block with anything outside the alphabet (including '=') is left
+// for the scalar path, which reports the error or handles the padded tail.
+__attribute__((target("ssse3")))
+size_t decodeSsse3(const char* in, size_t size, uint8_t* out) {
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2F);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t consumed = 0;
+    // Keep 8 characters back: the 16-byte store needs headroom and the final
+    // quartet may carry padding
+    while (size - consumed >= 24) {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + consumed));
+
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(input, 4), mask_2f);
+        __m128i lo_nibbles = _mm_and_si128(input, mask_2f);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        __m128i invalid = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+        if (_mm_movemask_epi8(invalid) != 0xFFFF) {
+            break;
+        }
+
+        __m128i eq_2f = _mm_cmpeq_epi8(input, mask_2f);
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        __m128i values = _mm_add_epi8(input, roll);
+
+        __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        merged = _mm_shuffle_epi8(merged, pack);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), merged);
+        out += 12;
+        consumed += 16;
+    }
+    return consumed;
+}
+#endif
+
+} // namespace
+
+std::string base64Encode(const uint8_t* data, size_t size) {
+    std::string result(((size + 2) / 3) * 4, '\0');
+    char* out = result.data();
+    size_t consumed = 0;
+
+#if defined(__x86_64__)
+    if (cpuHasSsse3()) {
+        consumed = encodeSsse3(data, size, out);
+        out += (consumed / 3) * 4;
+    }
+#endif
+
+    encodeScalar(data + consumed, size - consumed, out);
+    return result;
+}
+
+bool base64Decode(std::string_view input, std::vector<uint8_t>& output) {
+    output.resize((input.size() / 4) * 3 + 3);
+    uint8_t* out = output.data();
+    size_t consumed = 0;
+
+#if defined(__x86_64__)
+    if (cpuHasSsse3()) {
+        consumed = decodeSsse3(input.data(), input.size(), out);
+        out += (consumed / 4) * 3;
+    }
+#endif
+
+    ptrdiff_t written = decodeScalar(input.data() + consumed, input.size() - consumed, out);
+    if (written < 0) {
+        output.clear();
+        return false;
+    }
+
+    output.resize(static_cast<size_t>(out - output.data()) + static_cast<size_t>(written));
+    return true;
+}
+
+} // namespace fmus::core
@@ -0,0 +1,374 @@
+#include "fmus/core/coroutine.hpp"
+#include "fmus/core/logger.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace fmus::core {
+
+namespace {
+
+constexpr int MAX_EVENTS = 64;
+
+thread_local EventLoop* current_loop = nullptr;
+
+} // namespace
+
+EventLoop::EventLoop()
+    : running_(false), epoll_fd_(-1), wake_fd_(-1), timer_fd_(-1), next_timer_id_(1),
+      armed_deadline_(Clock::time_point::max()) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0 || timer_fd_ < 0) {
+        Logger::error("Failed to create event loop descriptors: {}", strerror(errno));
+        return;
+    }
+
+    for (int fd : {wake_fd_, timer_fd_}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            Logger::error("Failed to register event loop descriptor: {}", strerror(errno));
+        }
+    }
+}
+
+EventLoop::~EventLoop() {
+    stop();
+
+    for (int fd : {timer_fd_, wake_fd_, epoll_fd_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+void EventLoop::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+bool EventLoop::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (running_) {
+        return true;
+    }
+
+    if (epoll_fd_ < 0 || wake_fd_ < 0 || timer_fd_ < 0) {
+        Logger::error("Event loop cannot start without its descriptors");
+        return false;
+    }
+
+    running_ = true;
+    for (size_t i = 0; i < std::max<size_t>(1, config_.threads); ++i) {
+        threads_.emplace_back(&EventLoop::threadLoop, this);
+    }
+
+    Logger::info("Event loop started with {} threads", threads_.size());
+    return true;
+}
+
+void EventLoop::stop() {
+    if (current_loop == this) {
+        Logger::error("Event loop cannot be stopped from one of its own flows");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> ready_lock(ready_mutex_);
+        running_ = false;
+    }
+    wake();
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+
+    Logger::info("Event loop stopped");
+}
+
+bool EventLoop::spawn(Task<void> task) {
+    if (!running_ || !task.isValid()) {
+        return false;
+    }
+
+    flows_spawned_++;
+    flows_active_++;
+    runFlow(this, std::move(task));
+    return true;
+}
+
+detail::Detached EventLoop::runFlow(EventLoop* loop, Task<void> task) {
+    co_await loop->schedule();
+
+    try {
+        co_await task;
+    } catch (const std::exception& e) {
+        loop->flows_failed_++;
+        Logger::error("Event loop flow failed: {}", e.what());
+    } catch (...) {
+        loop->flows_failed_++;
+        Logger::error("Event loop flow failed with an unknown exception");
+    }
+
+    loop->flows_active_--;
+}
+
+bool EventLoop::post(std::coroutine_handle<> handle) {
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        if (!running_) {
+            return false;
+        }
+        was_empty = ready_.empty();
+        ready_.push_back(handle);
+    }
+
+    // A non-empty queue is still owed a pass by the thread that will empty it
+    if (was_empty) {
+        wake();
+    }
+    return true;
+}
+
+uint64_t EventLoop::addTimer(Clock::time_point deadline, TimerCallback callback) {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+
+    uint64_t id = next_timer_id_++;
+    timers_.emplace(id, std::move(callback));
+    timer_heap_.emplace(deadline, id);
+
+    if (deadline < armed_deadline_) {
+        armTimer(deadline);
+    }
+    return id;
+}
+
+bool EventLoop::cancelTimer(uint64_t id) {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    return timers_.erase(id) > 0;
+}
+
+Task<bool> EventLoop::readable(int fd, std::chrono::milliseconds timeout) {
+    auto ready = std::make_shared<Oneshot<bool>>();
+    if (!watch(fd, ready)) {
+        co_return false;
+    }
+
+    std::optional<bool> result = co_await ready->wait(timeout);
+    if (!result) {
+        unwatch(fd, ready);
+    }
+    co_return result.value_or(false);
+}
+
+void EventLoop::forget(int fd) {
+    std::lock_guard<std::mutex> lock(watch_mutex_);
+    watchers_.erase(fd);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+EventLoop* EventLoop::current() {
+    return current_loop;
+}
+
+EventLoop::Stats EventLoop::getStats() const {
+    Stats stats;
+    stats.flows_spawned = flows_spawned_;
+    stats.flows_failed = flows_failed_;
+    stats.flows_active = flows_active_;
+    stats.resumed = resumed_;
+    stats.timers_fired = timers_fired_;
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        stats.timers_pending = timers_.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        stats.fds_watched = watchers_.size();
+    }
+    return stats;
+}
+
+void EventLoop::resetStats() {
+    flows_spawned_ = 0;
+    flows_failed_ = 0;
+    resumed_ = 0;
+    timers_fired_ = 0;
+}
+
+bool EventLoop::watch(int fd, std::shared_ptr<Oneshot<bool>> ready) {
+    std::lock_guard<std::mutex> lock(watch_mutex_);
+
+    // One-shot so each readiness wakes exactly one waiter on one thread
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) != 0) {
+        if (errno != ENOENT || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            Logger::error("Failed to watch fd {}: {}", fd, strerror(errno));
+            return false;
+        }
+    }
+
+    watchers_[fd] = std::move(ready);
+    return true;
+}
+
+void EventLoop::unwatch(int fd, const std::shared_ptr<Oneshot<bool>>& ready) {
+    // A late readiness for this fd then finds no watcher and is ignored
+    std::lock_guard<std::mutex> lock(watch_mutex_);
+    auto it = watchers_.find(fd);
+    if (it != watchers_.end() && it->second == ready) {
+        watchers_.erase(it);
+    }
+}
+
+void EventLoop::threadLoop() {
+    current_loop = this;
+
+    epoll_event events[MAX_EVENTS];
+
+    while (true) {
+        // Run a batch of ready flows, then poll so I/O and timers are not starved
+        bool idle = false;
+        bool exiting = false;
+        for (size_t ran = 0; ran < std::max<size_t>(1, config_.batch_size); ++ran) {
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lock(ready_mutex_);
+                if (ready_.empty()) {
+                    idle = true;
+                    exiting = !running_;
+                    break;
+                }
+                handle = ready_.front();
+                ready_.pop_front();
+            }
+            handle.resume();
+            resumed_++;
+        }
+
+        if (exiting) {
+            break;
+        }
+
+        int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, idle ? -1 : 0);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::error("Event loop wait failed: {}", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == wake_fd_) {
+                // Left readable once stopping, so every thread sees it
+                if (running_) {
+                    uint64_t value;
+                    [[maybe_unused]] ssize_t n = ::read(wake_fd_, &value, sizeof(value));
+                }
+            } else if (fd == timer_fd_) {
+                uint64_t expirations;
+                [[maybe_unused]] ssize_t n = ::read(timer_fd_, &expirations, sizeof(expirations));
+                runTimers();
+            } else {
+                std::shared_ptr<Oneshot<bool>> ready;
+                {
+                    std::lock_guard<std::mutex> lock(watch_mutex_);
+                    auto it = watchers_.find(fd);
+                    if (it != watchers_.end()) {
+                        ready = std::move(it->second);
+                        watchers_.erase(it);
+                    }
+                }
+                if (ready) {
+                    ready->set(true);
+                }
+            }
+        }
+    }
+
+    // Pass the stop on in case this thread consumed the wakeup
+    wake();
+    current_loop = nullptr;
+}
+
+void EventLoop::runTimers() {
+    std::vector<TimerCallback> due;
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        auto now = Clock::now();
+
+        while (!timer_heap_.empty()) {
+            const TimerEntry& top = timer_heap_.top();
+            auto it = timers_.find(top.second);
+            if (it == timers_.end()) {
+                timer_heap_.pop(); // Cancelled
+                continue;
+            }
+            if (top.first > now) {
+                break;
+            }
+            due.push_back(std::move(it->second));
+            timers_.erase(it);
+            timer_heap_.pop();
+        }
+
+        armed_deadline_ = Clock::time_point::max();
+        if (!timer_heap_.empty()) {
+            armTimer(timer_heap_.top().first);
+        }
+    }
+
+    for (auto& callback : due) {
+        timers_fired_++;
+        try {
+            callback();
+        } catch (const std::exception& e) {
+            Logger::error("Event loop timer failed: {}", e.what());
+        }
+    }
+}
+
+void EventLoop::armTimer(Clock::time_point deadline) {
+    // steady_clock is CLOCK_MONOTONIC; a zero value would disarm the timer
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    ns = std::max<int64_t>(ns, 1);
+
+    itimerspec spec{};
+    spec.it_value.tv_sec = ns / 1000000000;
+    spec.it_value.tv_nsec = ns % 1000000000;
+    if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        Logger::error("Failed to arm event loop timer: {}", strerror(errno));
+        return;
+    }
+    armed_deadline_ = deadline;
+}
+
+void EventLoop::wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+}
+
+} // namespace fmus::core
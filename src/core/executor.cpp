@@ -0,0 +1,310 @@
+#include "fmus/core/executor.hpp"
+#include "fmus/core/logger.hpp"
+#include "fmus/core/inline_string.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <exception>
+
+namespace fmus::core {
+
+namespace {
+
+thread_local Executor* current_executor = nullptr;
+thread_local size_t current_worker = 0;
+
+} // namespace
+
+Executor::Executor() : running_(false) {
+}
+
+Executor::~Executor() {
+    stop();
+}
+
+void Executor::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+bool Executor::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (running_) {
+        return true;
+    }
+
+    // Workers are kept across restarts so posting never races with their creation
+    if (workers_.empty()) {
+        size_t count = config_.threads > 0 ? config_.threads : std::thread::hardware_concurrency();
+        for (size_t i = 0; i < std::max<size_t>(1, count); ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+    }
+
+    running_ = true;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::thread(&Executor::workerLoop, this, i);
+
+        if (config_.pin_threads) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+            if (pthread_setaffinity_np(workers_[i]->thread.native_handle(), sizeof(cpus), &cpus) != 0) {
+                Logger::warn("Failed to pin executor worker {}", i);
+            }
+        }
+    }
+
+    Logger::info("Executor started with {} workers", workers_.size());
+    return true;
+}
+
+void Executor::stop() {
+    if (current_executor == this) {
+        Logger::error("Executor cannot be stopped from one of its own tasks");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!running_) {
+        return;
+    }
+
+    running_ = false;
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard<std::mutex> worker_lock(worker->mutex);
+        }
+        worker->cv.notify_all();
+    }
+
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    Logger::info("Executor stopped");
+}
+
+bool Executor::post(Task&& task, TaskPriority priority) {
+    if (!running_) {
+        rejected_++;
+        return false;
+    }
+
+    // Work spawned by a task stays on its worker unless someone steals it
+    size_t index = (current_executor == this) ? current_worker : next_worker_++ % workers_.size();
+    return enqueue(std::move(task), priority, index, false);
+}
+
+bool Executor::post(Task&& task, TaskPriority priority, uint64_t affinity) {
+    if (!running_) {
+        rejected_++;
+        return false;
+    }
+
+    return enqueue(std::move(task), priority, affinity % workers_.size(), true);
+}
+
+uint64_t Executor::affinityKey(std::string_view key) {
+    return fnv1a(key);
+}
+
+Executor* Executor::current() {
+    return current_executor;
+}
+
+Executor::Stats Executor::getStats() const {
+    Stats stats;
+    stats.posted = posted_;
+    stats.rejected = rejected_;
+    stats.failed = failed_;
+
+    for (const auto& worker : workers_) {
+        WorkerStats worker_stats;
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            for (size_t p = 0; p < PRIORITY_COUNT; ++p) {
+                size_t depth = worker->pinned[p].size() + worker->stealable[p].size();
+                stats.queue_depth_by_priority[p] += depth;
+                worker_stats.queue_depth += depth;
+            }
+        }
+        worker_stats.executed = worker->executed;
+        worker_stats.stolen = worker->stolen;
+        worker_stats.steal_attempts = worker->steal_attempts;
+
+        stats.executed += worker_stats.executed;
+        stats.stolen += worker_stats.stolen;
+        stats.steal_attempts += worker_stats.steal_attempts;
+        stats.queue_depth += worker_stats.queue_depth;
+        stats.workers.push_back(worker_stats);
+    }
+
+    return stats;
+}
+
+void Executor::resetStats() {
+    posted_ = 0;
+    rejected_ = 0;
+    failed_ = 0;
+    for (auto& worker : workers_) {
+        worker->executed = 0;
+        worker->stolen = 0;
+        worker->steal_attempts = 0;
+    }
+}
+
+bool Executor::enqueue(Task&& task, TaskPriority priority, size_t index, bool pinned) {
+    Worker& worker = *workers_[index];
+    size_t p = static_cast<size_t>(priority);
+    bool wake_owner;
+
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!running_) {
+            rejected_++;
+            return false;
+        }
+
+        if (pinned) {
+            worker.pinned[p].push_back(std::move(task));
+        } else {
+            worker.stealable[p].push_back(std::move(task));
+            stealable_count_++;
+        }
+        wake_owner = worker.sleeping;
+    }
+
+    posted_++;
+
+    // A busy owner leaves stealable work to whoever is idle
+    if (wake_owner) {
+        worker.cv.notify_one();
+    } else if (!pinned && sleeping_count_ > 0) {
+        wakeIdleWorker(index);
+    }
+    return true;
+}
+
+void Executor::wakeIdleWorker(size_t except) {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        if (i == except) {
+            continue;
+        }
+
+        Worker& worker = *workers_[i];
+        bool sleeping;
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            sleeping = worker.sleeping;
+        }
+        if (sleeping) {
+            worker.cv.notify_one();
+            return;
+        }
+    }
+}
+
+void Executor::workerLoop(size_t index) {
+    current_executor = this;
+    current_worker = index;
+
+    Worker& self = *workers_[index];
+
+    auto has_local = [&self] {
+        for (size_t p = 0; p < PRIORITY_COUNT; ++p) {
+            if (!self.pinned[p].empty() || !self.stealable[p].empty()) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    while (true) {
+        Task task;
+        if (popLocal(self, task) || steal(index, task)) {
+            run(task);
+            self.executed++;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(self.mutex);
+        if (!running_ && !has_local()) {
+            break;
+        }
+
+        // Announce the sleep before checking for stealable work, so a poster
+        // either sees this worker asleep or this worker sees its task
+        self.sleeping = true;
+        sleeping_count_++;
+        self.cv.wait(lock, [&] { return has_local() || stealable_count_ > 0 || !running_; });
+        self.sleeping = false;
+        sleeping_count_--;
+    }
+
+    current_executor = nullptr;
+}
+
+bool Executor::popLocal(Worker& worker, Task& task) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    for (size_t p = 0; p < PRIORITY_COUNT; ++p) {
+        if (!worker.pinned[p].empty()) {
+            task = std::move(worker.pinned[p].front());
+            worker.pinned[p].pop_front();
+            return true;
+        }
+        if (!worker.stealable[p].empty()) {
+            task = std::move(worker.stealable[p].front());
+            worker.stealable[p].pop_front();
+            stealable_count_--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Executor::steal(size_t thief, Task& task) {
+    if (stealable_count_ == 0 || workers_.size() < 2) {
+        return false;
+    }
+
+    Worker& self = *workers_[thief];
+    self.steal_attempts++;
+
+    // Highest priority anywhere first; take from the back, away from the owner
+    for (size_t p = 0; p < PRIORITY_COUNT; ++p) {
+        for (size_t i = 1; i < workers_.size(); ++i) {
+            Worker& victim = *workers_[(thief + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.stealable[p].empty()) {
+                task = std::move(victim.stealable[p].back());
+                victim.stealable[p].pop_back();
+                stealable_count_--;
+                self.stolen++;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void Executor::run(Task& task) {
+    try {
+        task();
+    } catch (const std::exception& e) {
+        failed_++;
+        Logger::error("Executor task failed: {}", e.what());
+    } catch (...) {
+        failed_++;
+        Logger::error("Executor task failed with an unknown exception");
+    }
+}
+
+} // namespace fmus::core
@@ -0,0 +1,196 @@
+#include "fmus/core/pool.hpp"
+#include <algorithm>
+
+namespace fmus::core {
+
+// Per-thread free lists, one per size class
+struct ThreadCache {
+    SlabPool::FreeBlock* heads[SlabPool::CLASS_COUNT] = {};
+    size_t counts[SlabPool::CLASS_COUNT] = {};
+    bool alive = true;
+
+    ~ThreadCache() {
+        // Blocks cached by an exiting thread go back to the shared lists
+        for (size_t c = 0; c < SlabPool::CLASS_COUNT; ++c) {
+            if (heads[c]) {
+                SlabPool::FreeBlock* tail = heads[c];
+                while (tail->next) {
+                    tail = tail->next;
+                }
+                SlabPool::instance().spill(c, heads[c], tail, counts[c]);
+            }
+        }
+        alive = false;
+    }
+};
+
+namespace {
+
+thread_local ThreadCache thread_cache;
+
+} // namespace
+
+SlabPool::SlabPool() : upstream_(std::pmr::new_delete_resource()) {
+}
+
+SlabPool& SlabPool::instance() {
+    // Never destroyed: thread caches drain into it during thread exit
+    static SlabPool* pool = new SlabPool();
+    return *pool;
+}
+
+SlabPool::Stats SlabPool::getStats() const {
+    Stats stats;
+    stats.upstream_allocations = upstream_allocations_.load(std::memory_order_relaxed);
+    stats.slabs = slab_count_.load(std::memory_order_relaxed);
+    stats.refills = refills_.load(std::memory_order_relaxed);
+    stats.spills = spills_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void SlabPool::resetStats() {
+    upstream_allocations_ = 0;
+    refills_ = 0;
+    spills_ = 0;
+}
+
+void* SlabPool::do_allocate(size_t bytes, size_t alignment) {
+    size_t size = std::max(bytes, alignment);
+    if (size > MAX_BLOCK_SIZE) {
+        upstream_allocations_.fetch_add(1, std::memory_order_relaxed);
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    size_t c = sizeClass(size);
+
+    ThreadCache& cache = thread_cache;
+    if (!cache.alive) {
+        // Allocation from a thread_local destructor after the cache is gone
+        FreeBlock* head = nullptr;
+        size_t count = refill(c, head);
+        FreeBlock* block = head;
+        head = head->next;
+        if (count > 1) {
+            FreeBlock* tail = head;
+            while (tail->next) {
+                tail = tail->next;
+            }
+            spill(c, head, tail, count - 1);
+        }
+        return block;
+    }
+
+    if (!cache.heads[c]) {
+        cache.counts[c] = refill(c, cache.heads[c]);
+    }
+
+    FreeBlock* block = cache.heads[c];
+    cache.heads[c] = block->next;
+    cache.counts[c]--;
+    return block;
+}
+
+void SlabPool::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    size_t size = std::max(bytes, alignment);
+    if (size > MAX_BLOCK_SIZE) {
+        upstream_->deallocate(p, bytes, alignment);
+        return;
+    }
+
+    size_t c = sizeClass(size);
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+
+    ThreadCache& cache = thread_cache;
+    if (!cache.alive) {
+        block->next = nullptr;
+        spill(c, block, block, 1);
+        return;
+    }
+
+    block->next = cache.heads[c];
+    cache.heads[c] = block;
+    cache.counts[c]++;
+
+    // Keep half the limit so alternating alloc/free does not bounce batches
+    if (cache.counts[c] > CACHE_LIMIT) {
+        size_t keep = CACHE_LIMIT / 2;
+        FreeBlock* last_kept = cache.heads[c];
+        for (size_t i = 1; i < keep; ++i) {
+            last_kept = last_kept->next;
+        }
+
+        FreeBlock* head = last_kept->next;
+        FreeBlock* tail = head;
+        size_t count = 1;
+        while (tail->next) {
+            tail = tail->next;
+            count++;
+        }
+
+        last_kept->next = nullptr;
+        cache.counts[c] = keep;
+        spill(c, head, tail, count);
+    }
+}
+
+bool SlabPool::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+size_t SlabPool::sizeClass(size_t bytes) {
+    size_t c = 0;
+    while (classSize(c) < bytes) {
+        c++;
+    }
+    return c;
+}
+
+size_t SlabPool::refill(size_t size_class, FreeBlock*& head) {
+    SharedList& list = shared_[size_class];
+    std::lock_guard<std::mutex> lock(list.mutex);
+
+    if (!list.head) {
+        // Carve a new slab; blocks are aligned to their size up to the page size
+        void* slab = upstream_->allocate(SLAB_SIZE, MAX_BLOCK_SIZE);
+        {
+            std::lock_guard<std::mutex> slab_lock(slab_mutex_);
+            slabs_.push_back(slab);
+        }
+        slab_count_.fetch_add(1, std::memory_order_relaxed);
+
+        size_t block_size = classSize(size_class);
+        uint8_t* base = static_cast<uint8_t*>(slab);
+        for (size_t offset = SLAB_SIZE; offset >= block_size; offset -= block_size) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(base + offset - block_size);
+            block->next = list.head;
+            list.head = block;
+            list.count++;
+        }
+    }
+
+    refills_.fetch_add(1, std::memory_order_relaxed);
+
+    head = list.head;
+    FreeBlock* tail = head;
+    size_t count = 1;
+    while (count < BATCH_SIZE && tail->next) {
+        tail = tail->next;
+        count++;
+    }
+
+    list.head = tail->next;
+    list.count -= count;
+    tail->next = nullptr;
+    return count;
+}
+
+void SlabPool::spill(size_t size_class, FreeBlock* head, FreeBlock* tail, size_t count) {
+    SharedList& list = shared_[size_class];
+    std::lock_guard<std::mutex> lock(list.mutex);
+    tail->next = list.head;
+    list.head = head;
+    list.count += count;
+    spills_.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace fmus::core
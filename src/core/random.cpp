@@ -0,0 +1,215 @@
+#include "fmus/core/random.hpp"
+#include <sys/random.h>
+#include <pthread.h>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace fmus::core {
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64;
+constexpr size_t BUFFER_BLOCKS = 16;
+constexpr size_t KEY_SIZE = 32;
+constexpr size_t RESEED_BYTES = 1 << 20;
+
+// Bumped in the child after fork() so each thread there reseeds
+std::atomic<uint32_t> fork_generation{0};
+
+void onFork() {
+    fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline uint32_t rotl(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+inline void quarterRound(uint32_t* x, int a, int b, int c, int d) {
+    x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+    x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 12);
+    x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+    x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 7);
+}
+
+// One 64-byte ChaCha20 block for key and 64-bit counter, zero nonce
+void chachaBlock(const uint32_t key[8], uint64_t counter, uint8_t* out) {
+    uint32_t input[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+        static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), 0, 0
+    };
+
+    uint32_t x[16];
+    std::memcpy(x, input, sizeof(x));
+    for (int round = 0; round < 10; ++round) {
+        quarterRound(x, 0, 4, 8, 12);
+        quarterRound(x, 1, 5, 9, 13);
+        quarterRound(x, 2, 6, 10, 14);
+        quarterRound(x, 3, 7, 11, 15);
+        quarterRound(x, 0, 5, 10, 15);
+        quarterRound(x, 1, 6, 11, 12);
+        quarterRound(x, 2, 7, 8, 13);
+        quarterRound(x, 3, 4, 9, 14);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        uint32_t word = x[i] + input[i];
+        out[i * 4] = static_cast<uint8_t>(word);
+        out[i * 4 + 1] = static_cast<uint8_t>(word >> 8);
+        out[i * 4 + 2] = static_cast<uint8_t>(word >> 16);
+        out[i * 4 + 3] = static_cast<uint8_t>(word >> 24);
+    }
+}
+
+class Generator {
+public:
+    void fill(uint8_t* out, size_t size) {
+        // A forked child must not repeat what the parent has buffered
+        if (generation_ != fork_generation.load(std::memory_order_relaxed)) {
+            std::memset(buffer_, 0, sizeof(buffer_));
+            position_ = sizeof(buffer_);
+            seeded_ = false;
+        }
+
+        while (size > 0) {
+            if (position_ == sizeof(buffer_)) {
+                refill();
+            }
+            size_t count = std::min(size, sizeof(buffer_) - position_);
+            std::memcpy(out, buffer_ + position_, count);
+            // Handed-out bytes must not stay in memory
+            std::memset(buffer_ + position_, 0, count);
+            position_ += count;
+            out += count;
+            size -= count;
+        }
+    }
+
+private:
+    void seed() {
+        static std::once_flag registered;
+        std::call_once(registered, [] { pthread_atfork(nullptr, nullptr, onFork); });
+
+        uint8_t seed[KEY_SIZE];
+        size_t filled = 0;
+        while (filled < sizeof(seed)) {
+            ssize_t result = getrandom(seed + filled, sizeof(seed) - filled, 0);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("getrandom failed: " + std::string(strerror(errno)));
+            }
+            filled += static_cast<size_t>(result);
+        }
+
+        std::memcpy(key_, seed, sizeof(key_));
+        std::memset(seed, 0, sizeof(seed));
+        counter_ = 0;
+        since_seed_ = 0;
+        generation_ = fork_generation.load(std::memory_order_relaxed);
+        seeded_ = true;
+    }
+
+    void refill() {
+        if (!seeded_ || since_seed_ >= RESEED_BYTES) {
+            seed();
+        }
+
+        uint8_t blocks[BUFFER_BLOCKS * BLOCK_SIZE];
+        for (size_t i = 0; i < BUFFER_BLOCKS; ++i) {
+            chachaBlock(key_, counter_++, blocks + i * BLOCK_SIZE);
+        }
+
+        // Fast key erasure: the first bytes become the next key
+        std::memcpy(key_, blocks, KEY_SIZE);
+        std::memcpy(buffer_, blocks + KEY_SIZE, sizeof(buffer_));
+        std::memset(blocks, 0, sizeof(blocks));
+        position_ = 0;
+        since_seed_ += sizeof(buffer_);
+    }
+
+    uint32_t key_[8] = {};
+    uint64_t counter_ = 0;
+    uint8_t buffer_[BUFFER_BLOCKS * BLOCK_SIZE - KEY_SIZE] = {};
+    size_t position_ = sizeof(buffer_);
+    size_t since_seed_ = 0;
+    uint32_t generation_ = 0;
+    bool seeded_ = false;
+};
+
+thread_local Generator generator;
+
+const char hex_digits[] = "0123456789abcdef";
+const char base32_digits[] = "abcdefghijklmnopqrstuvwxyz234567";
+
+} // namespace
+
+void SecureRandom::fill(void* data, size_t size) {
+    generator.fill(static_cast<uint8_t*>(data), size);
+}
+
+std::vector<uint8_t> SecureRandom::bytes(size_t size) {
+    std::vector<uint8_t> data(size);
+    fill(data.data(), size);
+    return data;
+}
+
+uint32_t SecureRandom::next32() {
+    uint32_t value;
+    fill(&value, sizeof(value));
+    return value;
+}
+
+uint64_t SecureRandom::next64() {
+    uint64_t value;
+    fill(&value, sizeof(value));
+    return value;
+}
+
+void SecureRandom::appendHex(std::string& out, size_t length) {
+    uint8_t random[32];
+    size_t offset = out.size();
+    out.resize(offset + length);
+    for (size_t done = 0; done < length;) {
+        size_t count = std::min(length - done, sizeof(random) * 2);
+        fill(random, (count + 1) / 2);
+        for (size_t i = 0; i < count; ++i) {
+            out[offset + done + i] = hex_digits[(random[i / 2] >> ((i & 1) * 4)) & 0x0F];
+        }
+        done += count;
+    }
+}
+
+void SecureRandom::appendBase32(std::string& out, size_t length) {
+    // One byte per character keeps it simple; 32 divides 256, so no bias
+    uint8_t random[32];
+    size_t offset = out.size();
+    out.resize(offset + length);
+    for (size_t done = 0; done < length;) {
+        size_t count = std::min(length - done, sizeof(random));
+        fill(random, count);
+        for (size_t i = 0; i < count; ++i) {
+            out[offset + done + i] = base32_digits[random[i] & 0x1F];
+        }
+        done += count;
+    }
+}
+
+std::string SecureRandom::hexToken(size_t length) {
+    std::string token;
+    appendHex(token, length);
+    return token;
+}
+
+std::string SecureRandom::base32Token(size_t length) {
+    std::string token;
+    appendBase32(token, length);
+    return token;
+}
+
+} // namespace fmus::core
@@ -0,0 +1,1160 @@
+#include "fmus/enterprise/b2bua.hpp"
+#include "fmus/network/relay.hpp"
+#include "fmus/sip/sdp.hpp"
+#include "fmus/rtp/packet.hpp"
+#include "fmus/core/logger.hpp"
+#include "fmus/core/pool.hpp"
+#include "fmus/core/random.hpp"
+#include <algorithm>
+#include <ctime>
+#include <cstdio>
+
+namespace fmus::enterprise {
+
+namespace {
+
+// How often an idle relay or receiver checks whether it should stop
+constexpr std::chrono::milliseconds MEDIA_POLL_INTERVAL{1000};
+
+constexpr size_t G711_FRAME_BYTES = 160; // 20 ms at 8 kHz
+
+struct MediaEndpoint {
+    std::string address;
+    uint16_t port = 0;
+    std::vector<uint8_t> formats;
+};
+
+// First audio stream of an SDP body
+std::optional<MediaEndpoint> parseAudio(const std::string& body) {
+    if (body.empty()) {
+        return std::nullopt;
+    }
+
+    try {
+        sip::SessionDescription sdp = sip::SessionDescription::fromString(body);
+        for (const auto& media : sdp.getMediaDescriptions()) {
+            if (media.getType() != sip::MediaType::AUDIO || media.getPort() == 0 || media.getFormats().empty()) {
+                continue;
+            }
+
+            MediaEndpoint endpoint;
+            if (media.hasConnectionData()) {
+                endpoint.address = media.getConnectionData().connection_address;
+            } else if (sdp.hasConnectionData()) {
+                endpoint.address = sdp.getConnectionData().connection_address;
+            }
+            if (endpoint.address.empty()) {
+                return std::nullopt;
+            }
+            endpoint.port = media.getPort();
+            endpoint.formats = media.getFormats();
+            return endpoint;
+        }
+    } catch (const std::exception& e) {
+        core::Logger::debug("Ignoring unparsable SDP: {}", e.what());
+    }
+
+    return std::nullopt;
+}
+
+void setSdp(sip::SipMessage& message, const std::string& ip, uint16_t port, const std::vector<uint8_t>& formats) {
+    std::string body = sip::SdpBuilder::createBasicAudioOffer(std::to_string(std::time(nullptr)), ip, port, formats).toString();
+    message.getHeaders().set("Content-Type", "application/sdp");
+    message.getHeaders().set("Content-Length", std::to_string(body.size()));
+    message.setBody(body);
+}
+
+std::string randomToken() {
+    return core::SecureRandom::hexToken(16);
+}
+
+// Stateless reply for code, serialized once per thread. A To tag is added
+// only when the request has none, so in-dialog replies keep the dialog's.
+const sip::ResponseTemplate& replyTemplate(sip::SipResponseCode code) {
+    thread_local std::unordered_map<int, sip::ResponseTemplate> templates;
+
+    auto it = templates.find(static_cast<int>(code));
+    if (it == templates.end()) {
+        it = templates.emplace(static_cast<int>(code), sip::ResponseTemplate(code).addToTag()).first;
+    }
+    return it->second;
+}
+
+// Header value up to its tag parameter
+std::string_view withoutTag(std::string_view header) {
+    return header.substr(0, header.find(";tag="));
+}
+
+bool isTranscodable(uint8_t payload_type) {
+    auto codec = static_cast<media::AudioCodecId>(payload_type);
+    return codec == media::AudioCodecId::PCMU || codec == media::AudioCodecId::PCMA;
+}
+
+std::shared_ptr<media::CodecManager> createTranscoder(uint8_t from, uint8_t to) {
+    media::CodecParameters params;
+    params.sample_rate = 8000;
+    params.channels = 1;
+
+    auto transcoder = std::make_shared<media::CodecManager>();
+    if (!transcoder->setAudioDecoder(static_cast<media::AudioCodecId>(from), params) ||
+        !transcoder->setAudioEncoder(static_cast<media::AudioCodecId>(to), params)) {
+        return nullptr;
+    }
+    return transcoder;
+}
+
+// The answered codec when the inbound leg offered it, otherwise an offered
+// one that can be transcoded to it
+std::optional<uint8_t> chooseInboundFormat(const std::vector<uint8_t>& offered, uint8_t outbound) {
+    if (std::find(offered.begin(), offered.end(), outbound) != offered.end()) {
+        return outbound;
+    }
+    if (!isTranscodable(outbound)) {
+        return std::nullopt;
+    }
+    for (uint8_t format : offered) {
+        if (isTranscodable(format)) {
+            return format;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+// B2buaEngine implementation
+B2buaEngine::B2buaEngine() : running_(false) {
+}
+
+B2buaEngine::~B2buaEngine() {
+    stop();
+}
+
+void B2buaEngine::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+bool B2buaEngine::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (running_) {
+        return true;
+    }
+
+    // Relays of an ended call notice within one poll interval; the pool
+    // holds its ports back until they have
+    network::RtpPortPool::Config port_config;
+    port_config.ip = config_.media_ip;
+    port_config.min_port = config_.rtp_port_min;
+    port_config.max_port = config_.rtp_port_max;
+    port_config.pre_bind = config_.pre_bind_ports;
+    port_config.quarantine = 2 * MEDIA_POLL_INTERVAL;
+    ports_.setConfig(port_config);
+    if (!ports_.start()) {
+        return false;
+    }
+
+    calls_.clear();
+    calls_.resize(config_.max_calls);
+    free_slots_.clear();
+    for (size_t slot = config_.max_calls; slot > 0; --slot) {
+        free_slots_.push_back(static_cast<uint32_t>(slot - 1));
+    }
+    slots_by_call_id_.clear();
+    slots_by_call_id_.reserve(2 * config_.max_calls);
+    contact_ = "<sip:b2bua@" + config_.sip_address.toString() + ">";
+
+    core::EventLoop::Config loop_config;
+    loop_config.threads = config_.media_threads;
+    loop_.setConfig(loop_config);
+    if (!loop_.start()) {
+        ports_.stop();
+        return false;
+    }
+
+    transport_.setMessageCallback([this](const sip::SipMessage& message, const network::SocketAddress& from) {
+        onMessage(message, from);
+    });
+    if (!transport_.startUdp(config_.sip_address)) {
+        loop_.stop();
+        ports_.stop();
+        return false;
+    }
+
+    running_ = true;
+    core::Logger::info("B2BUA started on {} for next hop {} with {} call slots and {} RTP ports",
+                       config_.sip_address.toString(), config_.next_hop.toString(),
+                       config_.max_calls, ports_.capacity());
+    return true;
+}
+
+void B2buaEngine::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+
+    // No new messages, then no more flows; suspended flows are left suspended
+    transport_.stop();
+    loop_.stop();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint32_t slot = 0; slot < calls_.size(); ++slot) {
+        if (calls_[slot].state != B2buaCall::State::FREE) {
+            releaseCall(slot);
+        }
+    }
+    ports_.stop();
+
+    core::Logger::info("B2BUA stopped");
+}
+
+B2buaEngine::Stats B2buaEngine::getStats() const {
+    Stats stats;
+    stats.calls_received = calls_received_;
+    stats.calls_answered = calls_answered_;
+    stats.calls_rejected = calls_rejected_;
+    stats.calls_failed = calls_failed_;
+    stats.calls_completed = calls_completed_;
+    stats.active_calls = active_calls_;
+    stats.retransmissions = retransmissions_;
+    stats.rtp_relayed = rtp_relayed_;
+    stats.rtp_transcoded = rtp_transcoded_;
+    stats.rtp_dropped = rtp_dropped_;
+    return stats;
+}
+
+void B2buaEngine::resetStats() {
+    calls_received_ = 0;
+    calls_answered_ = 0;
+    calls_rejected_ = 0;
+    calls_failed_ = 0;
+    calls_completed_ = 0;
+    retransmissions_ = 0;
+    rtp_relayed_ = 0;
+    rtp_transcoded_ = 0;
+    rtp_dropped_ = 0;
+}
+
+void B2buaEngine::onMessage(const sip::SipMessage& message, const network::SocketAddress& from) {
+    if (!running_) {
+        return;
+    }
+
+    if (message.isResponse()) {
+        onResponse(message);
+        return;
+    }
+
+    switch (message.getMethod()) {
+        case sip::SipMethod::INVITE:
+            onInvite(message, from);
+            break;
+        case sip::SipMethod::ACK:
+            onAck(message);
+            break;
+        case sip::SipMethod::BYE:
+            onBye(message, from);
+            break;
+        case sip::SipMethod::CANCEL:
+            onCancel(message, from);
+            break;
+        case sip::SipMethod::OPTIONS:
+            respond(message, sip::SipResponseCode::OK, from);
+            break;
+        default:
+            respond(message, sip::SipResponseCode::NotImplemented, from);
+            break;
+    }
+}
+
+void B2buaEngine::onInvite(const sip::SipMessage& invite, const network::SocketAddress& from) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (auto slot = findSlot(invite.getHeaders().view("Call-ID"))) {
+        B2buaCall& call = calls_[*slot];
+        Leg& inbound = call.legs[B2buaCall::INBOUND];
+        if (sip::Dialog::generateDialogId(invite) == sip::Dialog::generateDialogId(call.invite) && inbound.transaction) {
+            inbound.transaction->processMessage(invite); // Retransmission: resend the last response
+        } else {
+            // Re-INVITEs (hold, codec changes) are not supported
+            respond(invite, sip::SipResponseCode::NotAcceptableHere, from);
+        }
+        return;
+    }
+
+    calls_received_++;
+
+    auto offer = parseAudio(invite.getBody());
+    if (!offer) {
+        calls_rejected_++;
+        respond(invite, sip::SipResponseCode::NotAcceptableHere, from);
+        return;
+    }
+
+    if (free_slots_.empty()) {
+        calls_rejected_++;
+        respond(invite, sip::SipResponseCode::ServiceUnavailable, from);
+        return;
+    }
+
+    uint32_t slot = free_slots_.back();
+    B2buaCall& call = calls_[slot];
+    Leg& inbound = call.legs[B2buaCall::INBOUND];
+    Leg& outbound = call.legs[B2buaCall::OUTBOUND];
+
+    if (!openMedia(inbound) || !openMedia(outbound)) {
+        closeMedia(inbound);
+        closeMedia(outbound);
+        calls_rejected_++;
+        respond(invite, sip::SipResponseCode::ServiceUnavailable, from);
+        return;
+    }
+    free_slots_.pop_back();
+
+    call.generation++;
+    call.state = B2buaCall::State::INVITING;
+    call.created = std::chrono::steady_clock::now();
+    call.offered_formats = offer->formats;
+    call.invite = invite;
+
+    inbound.call_id = invite.getHeaders().view("Call-ID");
+    inbound.signaling = from;
+    inbound.media = network::SocketAddress(offer->address, offer->port);
+    inbound.dialog = core::makePooled<sip::Dialog>(sip::Dialog::generateDialogId(invite), invite);
+
+    auto transaction = core::makePooled<sip::ServerInviteTransaction>(
+        sip::TransactionIdGenerator::generateServerId(invite), invite);
+    transaction->setMessageCallback([this, from](const sip::SipMessage& message) {
+        if (message.isResponse()) {
+            send(message, from);
+        }
+    });
+    inbound.transaction = transaction;
+
+    outbound.call_id = "b2b-" + std::to_string(++next_call_number_) + "-" + randomToken() + "@" + config_.media_ip;
+    outbound.signaling = config_.next_hop;
+
+    slots_by_call_id_.emplace(inbound.call_id, slot);
+    slots_by_call_id_.emplace(outbound.call_id, slot);
+    active_calls_++;
+
+    transaction->sendProvisionalResponse(sip::SipResponseCode::Trying);
+    loop_.spawn(runCall(slot, call.generation));
+}
+
+void B2buaEngine::onAck(const sip::SipMessage& ack) {
+    std::shared_ptr<sip::Transaction> transaction;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto slot = findSlot(ack.getHeaders().view("Call-ID"));
+        if (!slot) {
+            return;
+        }
+        transaction = calls_[*slot].legs[B2buaCall::INBOUND].transaction;
+    }
+
+    // Ends the server transaction after a failure response; ACKs for 2xx have nothing to end
+    if (transaction && transaction->getType() == sip::TransactionType::SERVER_INVITE) {
+        transaction->processMessage(ack);
+    }
+}
+
+void B2buaEngine::onBye(const sip::SipMessage& bye, const network::SocketAddress& from) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto slot = findSlot(bye.getHeaders().view("Call-ID"));
+    if (!slot) {
+        respond(bye, sip::SipResponseCode::CallDoesNotExist, from);
+        return;
+    }
+
+    respond(bye, sip::SipResponseCode::OK, from);
+
+    B2buaCall& call = calls_[*slot];
+    size_t leg = call.legs[B2buaCall::OUTBOUND].call_id == bye.getHeaders().view("Call-ID")
+        ? B2buaCall::OUTBOUND : B2buaCall::INBOUND;
+
+    if (call.state != B2buaCall::State::ANSWERED) {
+        return; // Already tearing down; a BYE crossing ours needs no further action
+    }
+
+    call.state = B2buaCall::State::TERMINATING;
+    *call.media_active = false;
+    calls_completed_++;
+    loop_.spawn(hangup(*slot, call.generation, 1 - leg));
+}
+
+void B2buaEngine::onCancel(const sip::SipMessage& cancel, const network::SocketAddress& from) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto slot = findSlot(cancel.getHeaders().view("Call-ID"));
+    if (!slot) {
+        respond(cancel, sip::SipResponseCode::CallDoesNotExist, from);
+        return;
+    }
+
+    respond(cancel, sip::SipResponseCode::OK, from);
+
+    B2buaCall& call = calls_[*slot];
+    if (call.state != B2buaCall::State::INVITING && call.state != B2buaCall::State::EARLY) {
+        return; // Too late; the call is answered or already ending
+    }
+
+    Leg& inbound = call.legs[B2buaCall::INBOUND];
+    inbound.transaction->sendMessage(
+        inbound.dialog->createResponse(call.invite, sip::SipResponseCode::RequestTerminated));
+    call.state = B2buaCall::State::CANCELLING;
+
+    // Without a provisional response yet the CANCEL cannot be sent; runCall
+    // then ends the outbound leg once its final response arrives
+    auto outbound = std::dynamic_pointer_cast<sip::ClientInviteTransaction>(call.legs[B2buaCall::OUTBOUND].transaction);
+    if (outbound) {
+        outbound->sendCancel();
+    }
+}
+
+void B2buaEngine::onResponse(const sip::SipMessage& response) {
+    std::shared_ptr<sip::Transaction> transaction;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::string_view call_id = response.getHeaders().view("Call-ID");
+        auto slot = findSlot(call_id);
+        if (!slot) {
+            return; // Late response for a released call
+        }
+
+        B2buaCall& call = calls_[*slot];
+        size_t leg = call.legs[B2buaCall::OUTBOUND].call_id == call_id ? B2buaCall::OUTBOUND : B2buaCall::INBOUND;
+        transaction = call.legs[leg].transaction;
+        if (!transaction) {
+            return;
+        }
+
+        // Relay ringing and early media indications to the caller
+        sip::SipResponseCode code = response.getResponseCode();
+        if (leg == B2buaCall::OUTBOUND && transaction->getType() == sip::TransactionType::CLIENT_INVITE &&
+            (code == sip::SipResponseCode::Ringing || code == sip::SipResponseCode::SessionProgress) &&
+            (call.state == B2buaCall::State::INVITING || call.state == B2buaCall::State::EARLY)) {
+            Leg& inbound = call.legs[B2buaCall::INBOUND];
+            inbound.transaction->sendMessage(inbound.dialog->createResponse(call.invite, code));
+            call.state = B2buaCall::State::EARLY;
+        }
+    }
+
+    // Outside the lock: completing the final response may resume a flow inline
+    transaction->processMessage(response);
+}
+
+core::Task<void> B2buaEngine::runCall(uint32_t slot, uint32_t generation) {
+    sip::SipMessage invite;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        B2buaCall* call = findCall(slot, generation);
+        if (!call) {
+            co_return;
+        }
+        invite = createOutboundInvite(*call);
+    }
+
+    std::optional<sip::SipMessage> response = co_await sendInvite(slot, generation, invite);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    B2buaCall* call = findCall(slot, generation);
+    if (!call) {
+        co_return;
+    }
+
+    Leg& inbound = call->legs[B2buaCall::INBOUND];
+    Leg& outbound = call->legs[B2buaCall::OUTBOUND];
+    bool answered = response && response->getResponseCode() >= sip::SipResponseCode::OK &&
+                    response->getResponseCode() < sip::SipResponseCode::MultipleChoices;
+
+    if (answered) {
+        outbound.dialog = core::makePooled<sip::Dialog>(sip::Dialog::generateDialogId(*response), *response);
+    }
+
+    if (call->state == B2buaCall::State::CANCELLING) {
+        calls_failed_++;
+        if (answered) {
+            // The answer crossed the CANCEL; end the outbound leg instead
+            call->state = B2buaCall::State::TERMINATING;
+            loop_.spawn(hangup(slot, generation, B2buaCall::OUTBOUND));
+        } else {
+            releaseCall(slot);
+        }
+        co_return;
+    }
+
+    if (!answered) {
+        calls_failed_++;
+        sip::SipResponseCode code = response ? response->getResponseCode() : sip::SipResponseCode::RequestTimeout;
+        if (!response) {
+            if (auto transaction = std::dynamic_pointer_cast<sip::ClientInviteTransaction>(outbound.transaction)) {
+                transaction->sendCancel();
+            }
+        }
+        inbound.transaction->sendMessage(inbound.dialog->createResponse(call->invite, code));
+        releaseCall(slot);
+        co_return;
+    }
+
+    auto answer = parseAudio(response->getBody());
+    std::optional<uint8_t> inbound_format = answer ? chooseInboundFormat(call->offered_formats, answer->formats.front())
+                                                   : std::nullopt;
+    if (!inbound_format) {
+        calls_failed_++;
+        inbound.transaction->sendMessage(
+            inbound.dialog->createResponse(call->invite, sip::SipResponseCode::NotAcceptableHere));
+        call->state = B2buaCall::State::TERMINATING;
+        loop_.spawn(hangup(slot, generation, B2buaCall::OUTBOUND));
+        co_return;
+    }
+
+    outbound.media = network::SocketAddress(answer->address, answer->port);
+    outbound.payload_type = answer->formats.front();
+    inbound.payload_type = *inbound_format;
+    startMedia(*call);
+
+    sip::SipMessage ok = inbound.dialog->createResponse(call->invite, sip::SipResponseCode::OK);
+    ok.getHeaders().set("Contact", contact_);
+    setSdp(ok, config_.media_ip, inbound.ports.rtp_port, {inbound.payload_type});
+    inbound.transaction->sendMessage(ok);
+
+    call->state = B2buaCall::State::ANSWERED;
+    calls_answered_++;
+}
+
+core::Task<void> B2buaEngine::hangup(uint32_t slot, uint32_t generation, size_t leg) {
+    sip::SipMessage bye;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        B2buaCall* call = findCall(slot, generation);
+        if (!call) {
+            co_return;
+        }
+
+        Leg& target = call->legs[leg];
+        if (!target.dialog) {
+            releaseCall(slot);
+            co_return;
+        }
+
+        target.dialog->getNextLocalCSeq();
+        bye = target.dialog->createRequest(sip::SipMethod::BYE);
+        bye.getHeaders().set("Via", "SIP/2.0/UDP " + config_.sip_address.toString() + ";branch=" +
+                                    sip::TransactionIdGenerator::generateBranch());
+        bye.getHeaders().set("Max-Forwards", "70");
+        bye.getHeaders().set("Content-Length", "0");
+    }
+
+    co_await sendRequest(slot, generation, leg, bye);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (findCall(slot, generation)) {
+        releaseCall(slot);
+    }
+}
+
+core::Task<std::optional<sip::SipMessage>> B2buaEngine::sendInvite(uint32_t slot, uint32_t generation,
+                                                                  sip::SipMessage invite) {
+    auto transaction = core::makePooled<sip::ClientInviteTransaction>(
+        sip::TransactionIdGenerator::generateClientId(invite), invite);
+    network::SocketAddress destination;
+    std::chrono::milliseconds answer_timeout;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        B2buaCall* call = findCall(slot, generation);
+        if (!call) {
+            co_return std::nullopt;
+        }
+
+        destination = call->legs[B2buaCall::OUTBOUND].signaling;
+        answer_timeout = config_.answer_timeout;
+
+        // The transaction emits the INVITE, its ACK and any CANCEL
+        transaction->setMessageCallback([this, destination](const sip::SipMessage& message) {
+            if (message.isRequest()) {
+                send(message, destination);
+            }
+        });
+        call->legs[B2buaCall::OUTBOUND].transaction = transaction;
+    }
+
+    transaction->sendInvite();
+
+    // Timer A doubles from T1 until a provisional response arrives; Timer B
+    // bounds the wait for it and answer_timeout the wait for the answer
+    auto started = std::chrono::steady_clock::now();
+    std::chrono::milliseconds interval = sip::TIMER_T1;
+    while (true) {
+        std::optional<sip::SipMessage> response = co_await transaction->finalResponse(interval);
+        if (response) {
+            co_return response;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        if (transaction->getState() == sip::TransactionState::PROCEEDING) {
+            if (elapsed >= answer_timeout) {
+                co_return std::nullopt;
+            }
+            co_return co_await transaction->finalResponse(answer_timeout - elapsed);
+        }
+        if (elapsed >= sip::TIMER_B) {
+            co_return std::nullopt;
+        }
+
+        send(invite, destination);
+        retransmissions_++;
+        interval *= 2;
+    }
+}
+
+core::Task<std::optional<sip::SipMessage>> B2buaEngine::sendRequest(uint32_t slot, uint32_t generation, size_t leg,
+                                                                   sip::SipMessage request) {
+    auto transaction = core::makePooled<sip::ClientNonInviteTransaction>(
+        sip::TransactionIdGenerator::generateClientId(request), request);
+    network::SocketAddress destination;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        B2buaCall* call = findCall(slot, generation);
+        if (!call) {
+            co_return std::nullopt;
+        }
+        destination = call->legs[leg].signaling;
+        call->legs[leg].transaction = transaction;
+    }
+
+    transaction->sendMessage(request);
+    send(request, destination);
+
+    // Timer E doubles from T1 up to T2 until Timer F
+    auto deadline = std::chrono::steady_clock::now() + sip::TIMER_B;
+    std::chrono::milliseconds interval = sip::TIMER_T1;
+    while (true) {
+        std::optional<sip::SipMessage> response = co_await transaction->finalResponse(interval);
+        if (response || std::chrono::steady_clock::now() >= deadline) {
+            co_return response;
+        }
+
+        if (transaction->getState() != sip::TransactionState::PROCEEDING_NON_INVITE) {
+            send(request, destination);
+            retransmissions_++;
+        }
+        interval = std::min(interval * 2, sip::TIMER_T2);
+    }
+}
+
+core::Task<void> B2buaEngine::relayMedia(std::shared_ptr<network::UdpSocket> from,
+                                         std::shared_ptr<network::UdpSocket> to,
+                                         network::SocketAddress destination,
+                                         std::shared_ptr<media::CodecManager> transcoder,
+                                         uint8_t payload_type,
+                                         std::shared_ptr<std::atomic<bool>> active) {
+    if (!transcoder && config_.batched_relay) {
+        // Unchanged packets: move whole batches per syscall
+        network::UdpRelay relay(from, to, destination);
+        core::EventLoop* loop = core::EventLoop::current();
+        while (*active) {
+            bool readable = co_await loop->readable(from->getSocketFd(), MEDIA_POLL_INTERVAL);
+            if (readable && *active) {
+                rtp_relayed_ += relay.pump();
+            }
+        }
+        rtp_dropped_ += relay.getStats().dropped;
+        co_return;
+    }
+
+    while (*active) {
+        std::optional<network::Socket::Datagram> datagram = co_await from->recv(MEDIA_POLL_INTERVAL);
+        if (!datagram || !*active) {
+            continue;
+        }
+
+        if (transcoder) {
+            auto packet = rtp::RtpPacket::deserialize(datagram->data.data(), datagram->data.size());
+            if (!packet) {
+                rtp_dropped_++;
+                continue;
+            }
+
+            std::vector<uint8_t> payload = transcoder->encodeAudio(transcoder->decodeAudio(packet->getPayload()));
+            if (payload.empty()) {
+                rtp_dropped_++;
+                continue;
+            }
+            packet->getHeader().payload_type = payload_type;
+            packet->setPayload(payload);
+            datagram->data = packet->serialize();
+            rtp_transcoded_++;
+        }
+
+        if (to->send(datagram->data, destination)) {
+            rtp_relayed_++;
+        } else {
+            rtp_dropped_++;
+        }
+    }
+}
+
+B2buaCall* B2buaEngine::findCall(uint32_t slot, uint32_t generation) {
+    B2buaCall& call = calls_[slot];
+    if (call.generation != generation || call.state == B2buaCall::State::FREE) {
+        return nullptr;
+    }
+    return &call;
+}
+
+std::optional<uint32_t> B2buaEngine::findSlot(std::string_view call_id) const {
+    auto it = slots_by_call_id_.find(sip::SipIdentifier(call_id));
+    if (it == slots_by_call_id_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+bool B2buaEngine::openMedia(Leg& leg) {
+    std::optional<network::RtpPortPair> ports = ports_.allocate();
+    if (!ports) {
+        return false;
+    }
+    leg.ports = *ports;
+
+    if (!leg.ports.isBound()) {
+        // Pool without pre-binding: bind the RTP port for this call only
+        auto socket = network::createUdpSocket();
+        if (!socket->bind(network::SocketAddress(config_.media_ip, leg.ports.rtp_port))) {
+            ports_.release(leg.ports);
+            leg.ports = {};
+            return false;
+        }
+        leg.ports.rtp_socket = socket;
+    }
+    return true;
+}
+
+void B2buaEngine::closeMedia(Leg& leg) {
+    if (leg.ports.rtp_port == 0) {
+        return;
+    }
+
+    // Pre-bound sockets stay open for the next call; relays stop on media_active
+    if (!config_.pre_bind_ports && leg.ports.rtp_socket) {
+        leg.ports.rtp_socket->close();
+    }
+    ports_.release(leg.ports);
+    leg.ports = {};
+}
+
+void B2buaEngine::startMedia(B2buaCall& call) {
+    call.media_active = std::make_shared<std::atomic<bool>>(true);
+
+    for (size_t leg : {B2buaCall::INBOUND, B2buaCall::OUTBOUND}) {
+        const Leg& from = call.legs[leg];
+        const Leg& to = call.legs[1 - leg];
+
+        std::shared_ptr<media::CodecManager> transcoder;
+        if (from.payload_type != to.payload_type) {
+            transcoder = createTranscoder(from.payload_type, to.payload_type);
+        }
+        loop_.spawn(relayMedia(from.ports.rtp_socket, to.ports.rtp_socket, to.media, transcoder, to.payload_type, call.media_active));
+    }
+}
+
+void B2buaEngine::releaseCall(uint32_t slot) {
+    B2buaCall& call = calls_[slot];
+
+    if (call.media_active) {
+        *call.media_active = false;
+        call.media_active.reset();
+    }
+
+    for (Leg& leg : call.legs) {
+        closeMedia(leg);
+        slots_by_call_id_.erase(leg.call_id);
+        leg = Leg{};
+    }
+
+    call.state = B2buaCall::State::FREE;
+    call.offered_formats.clear();
+    call.invite = sip::SipMessage();
+    free_slots_.push_back(slot);
+    active_calls_--;
+}
+
+sip::SipMessage B2buaEngine::createOutboundInvite(const B2buaCall& call) const {
+    const Leg& outbound = call.legs[B2buaCall::OUTBOUND];
+    const sip::SipHeaders& inbound_headers = call.invite.getHeaders();
+
+    // Fresh Call-ID and tag: the two legs share nothing but the parties
+    sip::SipMessage invite(sip::SipMethod::INVITE, call.invite.getRequestUri());
+    sip::SipHeaders& headers = invite.getHeaders();
+    headers.set("Via", "SIP/2.0/UDP " + config_.sip_address.toString() + ";branch=" +
+                       sip::TransactionIdGenerator::generateBranch());
+    headers.set("Max-Forwards", "70");
+    headers.set("From", std::string(withoutTag(inbound_headers.view("From"))) + ";tag=" + randomToken());
+    headers.set("To", withoutTag(inbound_headers.view("To")));
+    headers.set("Call-ID", outbound.call_id.view());
+    headers.set("CSeq", "1 INVITE");
+    headers.set("Contact", contact_);
+
+    const std::vector<uint8_t>& formats = config_.outbound_codecs.empty() ? call.offered_formats : config_.outbound_codecs;
+    setSdp(invite, config_.media_ip, outbound.ports.rtp_port, formats);
+    return invite;
+}
+
+void B2buaEngine::respond(const sip::SipMessage& request, sip::SipResponseCode code, const network::SocketAddress& to) {
+    if (!transport_.sendResponse(replyTemplate(code), request, to)) {
+        core::Logger::warn("B2BUA failed to send SIP message to {}", to.toString());
+    }
+}
+
+void B2buaEngine::send(const sip::SipMessage& message, const network::SocketAddress& to) {
+    if (!transport_.sendMessage(message, to)) {
+        core::Logger::warn("B2BUA failed to send SIP message to {}", to.toString());
+    }
+}
+
+// CallGenerator implementation
+CallGenerator::CallGenerator() : running_(false) {
+}
+
+CallGenerator::~CallGenerator() {
+    stop();
+}
+
+void CallGenerator::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+bool CallGenerator::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (running_) {
+        return true;
+    }
+
+    core::EventLoop::Config loop_config;
+    loop_config.threads = config_.threads;
+    loop_.setConfig(loop_config);
+    if (!loop_.start()) {
+        return false;
+    }
+
+    uac_media_ = network::createUdpSocket();
+    uas_media_ = network::createUdpSocket();
+    for (const auto& socket : {uac_media_, uas_media_}) {
+        if (!socket->bind(network::SocketAddress(config_.media_ip, 0))) {
+            loop_.stop();
+            return false;
+        }
+        socket->setReceiveBufferSize(4 * 1024 * 1024);
+    }
+
+    uac_transport_.setMessageCallback([this](const sip::SipMessage& message, const network::SocketAddress& from) {
+        onUacMessage(message, from);
+    });
+    uas_transport_.setMessageCallback([this](const sip::SipMessage& message, const network::SocketAddress& from) {
+        onUasMessage(message, from);
+    });
+    if (!uac_transport_.startUdp(config_.uac_address) || !uas_transport_.startUdp(config_.uas_address)) {
+        uac_transport_.stop();
+        uas_transport_.stop();
+        loop_.stop();
+        return false;
+    }
+
+    running_ = true;
+    pacing_ = true;
+    loop_.spawn(receiveMedia(uac_media_));
+    loop_.spawn(receiveMedia(uas_media_));
+    loop_.spawn(pace());
+
+    core::Logger::info("Call generator started: {} calls/s towards {}", config_.calls_per_second,
+                       config_.target.toString());
+    return true;
+}
+
+void CallGenerator::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+
+    uac_transport_.stop();
+    uas_transport_.stop();
+    uac_media_->close();
+    uas_media_->close();
+    loop_.stop();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.clear();
+    for (auto& [call_id, active] : answered_) {
+        *active = false;
+    }
+    answered_.clear();
+
+    core::Logger::info("Call generator stopped");
+}
+
+bool CallGenerator::isFinished() const {
+    return !pacing_ && active_calls_ == 0;
+}
+
+CallGenerator::Stats CallGenerator::getStats() const {
+    Stats stats;
+    stats.calls_attempted = calls_attempted_;
+    stats.calls_answered = calls_answered_;
+    stats.calls_failed = calls_failed_;
+    stats.calls_completed = calls_completed_;
+    stats.active_calls = active_calls_;
+    stats.rtp_sent = rtp_sent_;
+    stats.rtp_received = rtp_received_;
+    stats.setup_time_us = setup_time_us_;
+    return stats;
+}
+
+void CallGenerator::resetStats() {
+    calls_attempted_ = 0;
+    calls_answered_ = 0;
+    calls_failed_ = 0;
+    calls_completed_ = 0;
+    rtp_sent_ = 0;
+    rtp_received_ = 0;
+    setup_time_us_ = 0;
+}
+
+void CallGenerator::onUacMessage(const sip::SipMessage& message, const network::SocketAddress& from) {
+    if (message.isRequest()) {
+        // Calls are hung up from this side, but answer a BYE from the far end
+        if (message.getMethod() != sip::SipMethod::ACK) {
+            uac_transport_.sendResponse(replyTemplate(sip::SipResponseCode::OK), message, from);
+        }
+        return;
+    }
+
+    if (message.getResponseCode() < sip::SipResponseCode::OK) {
+        return;
+    }
+
+    std::shared_ptr<core::Oneshot<sip::SipMessage>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(message.getHeaders().get("Call-ID"));
+        if (it == pending_.end()) {
+            return;
+        }
+        pending = it->second;
+    }
+    pending->set(message);
+}
+
+void CallGenerator::onUasMessage(const sip::SipMessage& message, const network::SocketAddress& from) {
+    if (message.isResponse()) {
+        return;
+    }
+
+    std::string call_id = message.getHeaders().get("Call-ID");
+
+    switch (message.getMethod()) {
+        case sip::SipMethod::INVITE: {
+            auto offer = parseAudio(message.getBody());
+            if (!offer) {
+                uas_transport_.sendResponse(replyTemplate(sip::SipResponseCode::NotAcceptableHere), message, from);
+                return;
+            }
+
+            sip::SipMessage ok = sip::SipMessage::createResponse(message, sip::SipResponseCode::OK);
+            ok.getHeaders().set("To", message.getHeaders().get("To") + ";tag=" + randomToken());
+            ok.getHeaders().set("Contact", "<sip:uas@" + config_.uas_address.toString() + ">");
+            setSdp(ok, config_.media_ip, uas_media_->getLocalAddress().port, {offer->formats.front()});
+
+            auto active = std::make_shared<std::atomic<bool>>(true);
+            bool is_new;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                is_new = answered_.emplace(call_id, active).second;
+            }
+            uas_transport_.sendMessage(ok, from);
+
+            if (is_new && config_.rtp_interval.count() > 0) {
+                loop_.spawn(sendMedia(uas_media_, network::SocketAddress(offer->address, offer->port),
+                                      offer->formats.front(), active));
+            }
+            break;
+        }
+        case sip::SipMethod::BYE:
+        case sip::SipMethod::CANCEL: {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = answered_.find(call_id);
+                if (it != answered_.end()) {
+                    *it->second = false;
+                    answered_.erase(it);
+                }
+            }
+            uas_transport_.sendResponse(replyTemplate(sip::SipResponseCode::OK), message, from);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+core::Task<void> CallGenerator::pace() {
+    // Place whatever is due since the start each millisecond, so the rate
+    // holds on average even when a tick runs late
+    auto started = std::chrono::steady_clock::now();
+    uint64_t placed = 0;
+
+    while (running_ && (config_.total_calls == 0 || placed < config_.total_calls)) {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        uint64_t due = static_cast<uint64_t>(elapsed * config_.calls_per_second);
+        if (config_.total_calls > 0) {
+            due = std::min<uint64_t>(due, config_.total_calls);
+        }
+
+        while (placed < due && (config_.max_concurrent == 0 || active_calls_ < config_.max_concurrent)) {
+            placed++;
+            calls_attempted_++;
+            active_calls_++;
+            loop_.spawn(placeCall(placed));
+        }
+
+        co_await core::sleepFor(std::chrono::milliseconds(1));
+    }
+
+    pacing_ = false;
+}
+
+core::Task<void> CallGenerator::placeCall(uint64_t number) {
+    std::string call_id = "gen-" + std::to_string(number) + "-" + randomToken() + "@" + config_.media_ip;
+    std::string from = "<sip:caller" + std::to_string(number) + "@" + config_.uac_address.toString() + ">;tag=" +
+                       randomToken();
+    std::string to = "<sip:callee" + std::to_string(number) + "@" + config_.target.toString() + ">";
+    std::string via = "SIP/2.0/UDP " + config_.uac_address.toString() + ";branch=";
+
+    sip::SipMessage invite(sip::SipMethod::INVITE,
+                           sip::SipUri("sip:callee" + std::to_string(number) + "@" + config_.target.toString()));
+    invite.getHeaders().set("Via", via + sip::TransactionIdGenerator::generateBranch());
+    invite.getHeaders().set("Max-Forwards", "70");
+    invite.getHeaders().set("From", from);
+    invite.getHeaders().set("To", to);
+    invite.getHeaders().set("Call-ID", call_id);
+    invite.getHeaders().set("CSeq", "1 INVITE");
+    invite.getHeaders().set("Contact", "<sip:caller" + std::to_string(number) + "@" + config_.uac_address.toString() + ">");
+    setSdp(invite, config_.media_ip, uac_media_->getLocalAddress().port, config_.codecs);
+
+    auto started = std::chrono::steady_clock::now();
+    std::optional<sip::SipMessage> response = co_await request(call_id, invite);
+    if (!response || response->getResponseCode() >= sip::SipResponseCode::MultipleChoices) {
+        calls_failed_++;
+        active_calls_--;
+        co_return;
+    }
+
+    calls_answered_++;
+    setup_time_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count();
+
+    sip::SipMessage ack(sip::SipMethod::ACK, invite.getRequestUri());
+    ack.getHeaders().set("Via", via + sip::TransactionIdGenerator::generateBranch());
+    ack.getHeaders().set("Max-Forwards", "70");
+    ack.getHeaders().set("From", from);
+    ack.getHeaders().set("To", response->getHeaders().view("To"));
+    ack.getHeaders().set("Call-ID", call_id);
+    ack.getHeaders().set("CSeq", "1 ACK");
+    uac_transport_.sendMessage(ack, config_.target);
+
+    auto active = std::make_shared<std::atomic<bool>>(true);
+    auto answer = parseAudio(response->getBody());
+    if (answer && config_.rtp_interval.count() > 0) {
+        loop_.spawn(sendMedia(uac_media_, network::SocketAddress(answer->address, answer->port),
+                              answer->formats.front(), active));
+    }
+
+    co_await core::sleepFor(config_.hold_time);
+    *active = false;
+
+    sip::SipMessage bye(sip::SipMethod::BYE, invite.getRequestUri());
+    bye.getHeaders().set("Via", via + sip::TransactionIdGenerator::generateBranch());
+    bye.getHeaders().set("Max-Forwards", "70");
+    bye.getHeaders().set("From", from);
+    bye.getHeaders().set("To", response->getHeaders().view("To"));
+    bye.getHeaders().set("Call-ID", call_id);
+    bye.getHeaders().set("CSeq", "2 BYE");
+
+    std::optional<sip::SipMessage> bye_response = co_await request(call_id, bye);
+    if (bye_response && bye_response->getResponseCode() == sip::SipResponseCode::OK) {
+        calls_completed_++;
+    } else {
+        calls_failed_++;
+    }
+    active_calls_--;
+}
+
+core::Task<std::optional<sip::SipMessage>> CallGenerator::request(const std::string& call_id,
+                                                                  const sip::SipMessage& message) {
+    auto response = std::make_shared<core::Oneshot<sip::SipMessage>>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_[call_id] = response;
+    }
+
+    uac_transport_.sendMessage(message, config_.target);
+    std::optional<sip::SipMessage> result = co_await response->wait(sip::TIMER_B);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(call_id);
+        if (it != pending_.end() && it->second == response) {
+            pending_.erase(it);
+        }
+    }
+    co_return result;
+}
+
+core::Task<void> CallGenerator::sendMedia(std::shared_ptr<network::UdpSocket> socket,
+                                          network::SocketAddress destination,
+                                          uint8_t payload_type,
+                                          std::shared_ptr<std::atomic<bool>> active) {
+    rtp::RtpHeader header;
+    header.payload_type = payload_type;
+    header.ssrc = core::SecureRandom::next32();
+
+    // Silence in either G.711 law
+    uint8_t silence = payload_type == static_cast<uint8_t>(media::AudioCodecId::PCMA) ? 0xD5 : 0xFF;
+    rtp::RtpPacket packet(header, std::vector<uint8_t>(G711_FRAME_BYTES, silence));
+
+    auto next = std::chrono::steady_clock::now();
+    while (*active && running_) {
+        if (socket->send(packet.serialize(), destination)) {
+            rtp_sent_++;
+        }
+        packet.getHeader().sequence_number++;
+        packet.getHeader().timestamp += G711_FRAME_BYTES;
+
+        next += config_.rtp_interval;
+        co_await core::sleepFor(next - std::chrono::steady_clock::now());
+    }
+}
+
+core::Task<void> CallGenerator::receiveMedia(std::shared_ptr<network::UdpSocket> socket) {
+    while (running_) {
+        std::optional<network::Socket::Datagram> datagram = co_await socket->recv(MEDIA_POLL_INTERVAL);
+        if (datagram) {
+            rtp_received_++;
+        }
+    }
+}
+
+} // namespace fmus::enterprise
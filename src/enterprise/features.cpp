@@ -1,7 +1,10 @@
 #include "fmus/enterprise/features.hpp"
+#include "fmus/enterprise/message_store.hpp"
+#include "fmus/sip/transaction.hpp"
 #include "fmus/core/logger.hpp"
+#include "fmus/core/random.hpp"
+#include <filesystem>
 #include <sstream>
-#include <random>
 #include <algorithm>
 #include <iomanip>
 
@@ -61,34 +64,238 @@ void ConferenceRoom::removeParticipant(const std::string& user_id) {
         participants.end());
 }
 
+// UserIdTable implementation
+UserId UserIdTable::intern(const std::string& user) {
+    auto it = ids_.find(user);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    
+    UserId id = static_cast<UserId>(names_.size());
+    names_.push_back(user);
+    ids_.emplace(user, id);
+    return id;
+}
+
+std::optional<UserId> UserIdTable::find(const std::string& user) const {
+    auto it = ids_.find(user);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+// UserIdSet implementation
+bool UserIdSet::insert(UserId id) {
+    auto it = std::lower_bound(ids_.begin(), ids_.end(), id);
+    if (it != ids_.end() && *it == id) {
+        return false;
+    }
+    ids_.insert(it, id);
+    return true;
+}
+
+bool UserIdSet::erase(UserId id) {
+    auto it = std::lower_bound(ids_.begin(), ids_.end(), id);
+    if (it == ids_.end() || *it != id) {
+        return false;
+    }
+    ids_.erase(it);
+    return true;
+}
+
+bool UserIdSet::contains(UserId id) const {
+    return std::binary_search(ids_.begin(), ids_.end(), id);
+}
+
 // PresenceManager implementation
-PresenceManager::PresenceManager() {
+namespace {
+
+std::string xmlEscape(const std::string& text) {
+    std::string result;
+    result.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '&': result += "&amp;"; break;
+            case '<': result += "&lt;"; break;
+            case '>': result += "&gt;"; break;
+            case '"': result += "&quot;"; break;
+            case '\'': result += "&apos;"; break;
+            default: result += c; break;
+        }
+    }
+    return result;
+}
+
+// RFC 3863 presence document for a single presentity
+std::string createPidfDocument(const PresenceInfo& info) {
+    bool open = info.state != PresenceState::OFFLINE && info.state != PresenceState::UNKNOWN;
+    
+    std::ostringstream pidf;
+    pidf << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+         << "<presence xmlns=\"urn:ietf:params:xml:ns:pidf\" entity=\"sip:" << xmlEscape(info.user_id) << "\">\r\n"
+         << "  <tuple id=\"" << xmlEscape(info.user_id) << "\">\r\n"
+         << "    <status><basic>" << (open ? "open" : "closed") << "</basic></status>\r\n"
+         << "    <note>" << xmlEscape(info.status_message.empty() ? presenceStateToString(info.state) : info.status_message) << "</note>\r\n"
+         << "  </tuple>\r\n"
+         << "</presence>\r\n";
+    return pidf.str();
+}
+
+constexpr const char* PRESENCE_BOUNDARY = "fmus-presence-batch";
+constexpr const char* RLMI_CONTENT_ID = "rlmi@presence";
+
+// Dialog for a subscriber whose SUBSCRIBE was not recorded
+PresenceManager::SubscriptionDialog createLocalDialog(const std::string& subscriber) {
+    PresenceManager::SubscriptionDialog dialog;
+    dialog.call_id = core::SecureRandom::hexToken(32);
+    dialog.local_uri = "sip:presence";
+    dialog.local_tag = core::SecureRandom::base32Token(10);
+    dialog.remote_uri = "sip:" + subscriber;
+    return dialog;
+}
+
+std::string presenceContentId(size_t index) {
+    return std::to_string(index) + "@presence";
+}
+
+// RFC 4662 list document naming one PIDF part per presentity
+std::string createRlmiDocument(const std::string& list_uri, uint32_t version, bool full_state,
+                               const std::vector<PresenceInfo>& updates) {
+    std::ostringstream rlmi;
+    rlmi << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+         << "<list xmlns=\"urn:ietf:params:xml:ns:rlmi\" uri=\"" << xmlEscape(list_uri) << "\" version=\"" << version
+         << "\" fullState=\"" << (full_state ? "true" : "false") << "\">\r\n";
+    for (size_t i = 0; i < updates.size(); ++i) {
+        rlmi << "  <resource uri=\"sip:" << xmlEscape(updates[i].user_id) << "\">\r\n"
+             << "    <instance id=\"" << xmlEscape(updates[i].user_id) << "\" state=\"active\" cid=\""
+             << presenceContentId(i) << "\"/>\r\n"
+             << "  </resource>\r\n";
+    }
+    rlmi << "</list>\r\n";
+    return rlmi.str();
+}
+
+void appendBodyPart(std::string& body, const std::string& content_id, const std::string& content_type,
+                    const std::string& document) {
+    body += "--";
+    body += PRESENCE_BOUNDARY;
+    body += "\r\nContent-Transfer-Encoding: binary\r\nContent-ID: <" + content_id + ">\r\nContent-Type: " +
+            content_type + ";charset=\"UTF-8\"\r\n\r\n";
+    body += document;
+}
+
+} // namespace
+
+PresenceManager::PresenceManager() : running_(false) {
 }
 
 PresenceManager::~PresenceManager() {
+    stop();
 }
 
-bool PresenceManager::updatePresence(const std::string& user_id, PresenceState state, const std::string& status) {
+bool PresenceManager::start() {
     std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return true;
+    }
+    
+    running_ = true;
+    dispatcher_thread_ = std::thread(&PresenceManager::dispatcherLoop, this);
+    
+    core::Logger::info("Presence dispatcher started ({}ms coalescing window)", config_.coalescing_window.count());
+    return true;
+}
+
+void PresenceManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    
+    dispatcher_cv_.notify_all();
+    if (dispatcher_thread_.joinable()) {
+        dispatcher_thread_.join();
+    }
     
-    PresenceInfo& info = presence_info_[user_id];
+    // Deliver whatever was still inside a coalescing window
+    std::vector<UserId> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& pending : pending_) {
+            remaining.push_back(pending.presentity);
+        }
+        pending_.clear();
+        pending_set_.clear();
+    }
+    flush(remaining);
+    
+    core::Logger::info("Presence dispatcher stopped");
+}
+
+void PresenceManager::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    if (config_.max_batch_size == 0) {
+        config_.max_batch_size = 1;
+    }
+}
+
+PresenceManager::Config PresenceManager::getConfig() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+bool PresenceManager::updatePresence(const std::string& user_id, PresenceState state, const std::string& status) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    UserId id = user_ids_.intern(user_id);
+    PresenceInfo& info = presence_info_[id];
     info.user_id = user_id;
     info.state = state;
     info.status_message = status;
     info.last_update = std::chrono::system_clock::now();
+    updates_received_++;
+    
+    auto now = std::chrono::steady_clock::now();
+    scheduleExpiry(id, now + config_.presence_timeout);
+    bool wake_dispatcher = expiry_heap_.front().presentity == id;
+    
+    core::Logger::debug("Updated presence for {}: {} - {}", user_id, presenceStateToString(state), status);
+    
+    if (!running_) {
+        lock.unlock();
+        flush({id});
+        return true;
+    }
     
-    notifySubscribers(info);
+    // Inside an open window the new state simply replaces the old one
+    if (!pending_set_.insert(id).second) {
+        updates_coalesced_++;
+    } else {
+        pending_.push_back({id, now + config_.coalescing_window});
+        wake_dispatcher = wake_dispatcher || pending_.size() == 1;
+    }
     
-    core::Logger::info("Updated presence for {}: {} - {}", user_id, presenceStateToString(state), status);
+    if (wake_dispatcher) {
+        lock.unlock();
+        dispatcher_cv_.notify_one();
+    }
     return true;
 }
 
 PresenceInfo PresenceManager::getPresence(const std::string& user_id) const {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    auto it = presence_info_.find(user_id);
-    if (it != presence_info_.end()) {
-        return it->second;
+    auto id = user_ids_.find(user_id);
+    if (id) {
+        auto it = presence_info_.find(*id);
+        if (it != presence_info_.end()) {
+            return it->second;
+        }
     }
     
     PresenceInfo info;
@@ -101,7 +308,8 @@ std::vector<PresenceInfo> PresenceManager::getAllPresence() const {
     std::lock_guard<std::mutex> lock(mutex_);
     
     std::vector<PresenceInfo> result;
-    for (const auto& [user_id, info] : presence_info_) {
+    result.reserve(presence_info_.size());
+    for (const auto& [id, info] : presence_info_) {
         result.push_back(info);
     }
     
@@ -111,76 +319,220 @@ std::vector<PresenceInfo> PresenceManager::getAllPresence() const {
 bool PresenceManager::subscribe(const std::string& subscriber, const std::string& presentity) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    auto& subscribers = subscriptions_[presentity];
-    if (std::find(subscribers.begin(), subscribers.end(), subscriber) == subscribers.end()) {
-        subscribers.push_back(subscriber);
-        
-        if (subscription_callback_) {
-            subscription_callback_(subscriber, presentity);
-        }
-        
-        core::Logger::info("User {} subscribed to presence of {}", subscriber, presentity);
-        return true;
+    UserId subscriber_id = user_ids_.intern(subscriber);
+    UserId presentity_id = user_ids_.intern(presentity);
+    
+    if (!subscribers_[presentity_id].insert(subscriber_id)) {
+        return false;
     }
+    subscriptions_[subscriber_id].insert(presentity_id);
     
-    return false;
+    if (subscription_callback_) {
+        subscription_callback_(subscriber, presentity);
+    }
+    
+    core::Logger::debug("User {} subscribed to presence of {}", subscriber, presentity);
+    return true;
 }
 
 bool PresenceManager::unsubscribe(const std::string& subscriber, const std::string& presentity) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    auto it = subscriptions_.find(presentity);
-    if (it != subscriptions_.end()) {
-        auto& subscribers = it->second;
-        subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
-        
-        if (subscribers.empty()) {
-            subscriptions_.erase(it);
+    auto subscriber_id = user_ids_.find(subscriber);
+    auto presentity_id = user_ids_.find(presentity);
+    if (!subscriber_id || !presentity_id) {
+        return false;
+    }
+    
+    auto it = subscribers_.find(*presentity_id);
+    if (it == subscribers_.end() || !it->second.erase(*subscriber_id)) {
+        return false;
+    }
+    if (it->second.empty()) {
+        subscribers_.erase(it);
+    }
+    
+    auto sub_it = subscriptions_.find(*subscriber_id);
+    if (sub_it != subscriptions_.end()) {
+        sub_it->second.erase(*presentity_id);
+        if (sub_it->second.empty()) {
+            subscriptions_.erase(sub_it);
+            dialogs_.erase(*subscriber_id);
         }
-        
-        core::Logger::info("User {} unsubscribed from presence of {}", subscriber, presentity);
-        return true;
     }
     
-    return false;
+    core::Logger::debug("User {} unsubscribed from presence of {}", subscriber, presentity);
+    return true;
 }
 
 std::vector<std::string> PresenceManager::getSubscribers(const std::string& presentity) const {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    auto it = subscriptions_.find(presentity);
-    if (it != subscriptions_.end()) {
-        return it->second;
+    std::vector<std::string> result;
+    auto id = user_ids_.find(presentity);
+    if (id) {
+        auto it = subscribers_.find(*id);
+        if (it != subscribers_.end()) {
+            result.reserve(it->second.size());
+            for (UserId subscriber : it->second.ids()) {
+                result.push_back(user_ids_.name(subscriber));
+            }
+        }
     }
     
-    return {};
+    return result;
 }
 
 std::vector<std::string> PresenceManager::getSubscriptions(const std::string& subscriber) const {
     std::lock_guard<std::mutex> lock(mutex_);
     
     std::vector<std::string> result;
-    for (const auto& [presentity, subscribers] : subscriptions_) {
-        if (std::find(subscribers.begin(), subscribers.end(), subscriber) != subscribers.end()) {
-            result.push_back(presentity);
+    auto id = user_ids_.find(subscriber);
+    if (id) {
+        auto it = subscriptions_.find(*id);
+        if (it != subscriptions_.end()) {
+            result.reserve(it->second.size());
+            for (UserId presentity : it->second.ids()) {
+                result.push_back(user_ids_.name(presentity));
+            }
         }
     }
     
     return result;
 }
 
-void PresenceManager::cleanupExpiredPresence() {
+void PresenceManager::setSubscriptionDialog(const std::string& subscriber, const SubscriptionDialog& dialog) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dialogs_[user_ids_.intern(subscriber)] = dialog;
+}
+
+std::optional<PresenceManager::SubscriptionDialog> PresenceManager::getSubscriptionDialog(
+    const std::string& subscriber) const {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    auto it = presence_info_.begin();
-    while (it != presence_info_.end()) {
-        if (it->second.isExpired()) {
-            core::Logger::debug("Cleaning up expired presence for {}", it->first);
-            it = presence_info_.erase(it);
-        } else {
-            ++it;
+    auto id = user_ids_.find(subscriber);
+    if (id) {
+        auto it = dialogs_.find(*id);
+        if (it != dialogs_.end()) {
+            return it->second;
         }
     }
+    return std::nullopt;
+}
+
+void PresenceManager::setTransport(network::SipTransport* transport, const network::SocketAddress& local_address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    transport_ = transport;
+    local_address_ = local_address;
+}
+
+sip::SipMessage PresenceManager::createNotifyMessage(const std::string& subscriber,
+                                                     const std::vector<PresenceInfo>& updates) {
+    SubscriptionDialog dialog;
+    network::SocketAddress local_address;
+    std::vector<PresenceInfo> entries;
+    bool full_state = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        UserId subscriber_id = user_ids_.intern(subscriber);
+        auto [it, created] = dialogs_.try_emplace(subscriber_id);
+        if (created) {
+            it->second = createLocalDialog(subscriber);
+        }
+        
+        SubscriptionDialog& current = it->second;
+        current.cseq++;
+        
+        // The first list notification reports every presentity on the list
+        if (current.event_list && current.version == 0) {
+            full_state = true;
+            auto sub_it = subscriptions_.find(subscriber_id);
+            if (sub_it != subscriptions_.end()) {
+                for (UserId presentity : sub_it->second.ids()) {
+                    auto info_it = presence_info_.find(presentity);
+                    if (info_it != presence_info_.end()) {
+                        entries.push_back(info_it->second);
+                    } else {
+                        PresenceInfo offline;
+                        offline.user_id = user_ids_.name(presentity);
+                        offline.state = PresenceState::OFFLINE;
+                        entries.push_back(offline);
+                    }
+                }
+            }
+        }
+        
+        dialog = current;
+        if (current.event_list) {
+            current.version++;
+        }
+        local_address = local_address_;
+    }
+    
+    // Updates for presentities no longer on the list still go out
+    for (const auto& update : updates) {
+        if (std::none_of(entries.begin(), entries.end(),
+                         [&update](const PresenceInfo& entry) { return entry.user_id == update.user_id; })) {
+            entries.push_back(update);
+        }
+    }
+    
+    sip::SipUri target(dialog.remote_target.empty() ? dialog.remote_uri : dialog.remote_target);
+    sip::SipMessage notify(sip::SipMethod::NOTIFY, target);
+    
+    auto& headers = notify.getHeaders();
+    if (local_address.port != 0) {
+        headers.setVia("SIP/2.0/UDP " + local_address.toString() + ";branch=" +
+                       sip::TransactionIdGenerator::generateBranch());
+    }
+    headers.set("Max-Forwards", "70");
+    headers.setFrom("<" + dialog.local_uri + ">;tag=" + dialog.local_tag);
+    headers.setTo("<" + dialog.remote_uri + ">" + (dialog.remote_tag.empty() ? "" : ";tag=" + dialog.remote_tag));
+    headers.setCallId(dialog.call_id);
+    headers.setCSeq(std::to_string(dialog.cseq) + " NOTIFY");
+    if (local_address.port != 0) {
+        headers.setContact("<sip:presence@" + local_address.toString() + ">");
+    }
+    headers.set("Event", "presence");
+    headers.set("Subscription-State", "active");
+    
+    std::string body;
+    if (!dialog.event_list) {
+        headers.setContentType("application/pidf+xml");
+        if (!entries.empty()) {
+            body = createPidfDocument(entries.front());
+        }
+    } else {
+        headers.set("Require", "eventlist");
+        headers.setContentType(std::string("multipart/related;type=\"application/rlmi+xml\";start=\"<") +
+                               RLMI_CONTENT_ID + ">\";boundary=" + PRESENCE_BOUNDARY);
+        appendBodyPart(body, RLMI_CONTENT_ID, "application/rlmi+xml",
+                       createRlmiDocument(dialog.local_uri, dialog.version, full_state, entries));
+        for (size_t i = 0; i < entries.size(); ++i) {
+            appendBodyPart(body, presenceContentId(i), "application/pidf+xml", createPidfDocument(entries[i]));
+        }
+        body += "--";
+        body += PRESENCE_BOUNDARY;
+        body += "--\r\n";
+    }
+    
+    headers.setContentLength(body.size());
+    notify.setBody(body);
+    return notify;
+}
+
+void PresenceManager::cleanupExpiredPresence() {
+    std::vector<UserId> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expired = collectExpired(std::chrono::steady_clock::now());
+    }
+    
+    if (!expired.empty()) {
+        flush(expired);
+        removeExpired(expired);
+    }
 }
 
 size_t PresenceManager::getPresenceCount() const {
@@ -192,166 +544,454 @@ size_t PresenceManager::getSubscriptionCount() const {
     std::lock_guard<std::mutex> lock(mutex_);
     
     size_t count = 0;
-    for (const auto& [presentity, subscribers] : subscriptions_) {
+    for (const auto& [presentity, subscribers] : subscribers_) {
         count += subscribers.size();
     }
     return count;
 }
 
-void PresenceManager::notifySubscribers(const PresenceInfo& presence) {
-    if (presence_callback_) {
-        presence_callback_(presence);
-    }
+PresenceManager::Stats PresenceManager::getStats() const {
+    Stats stats;
+    stats.updates_received = updates_received_;
+    stats.updates_coalesced = updates_coalesced_;
+    stats.presentities_flushed = presentities_flushed_;
+    stats.notifications_sent = notifications_sent_;
+    stats.deliveries = deliveries_;
+    stats.expirations = expirations_;
+    return stats;
 }
 
-// InstantMessagingManager implementation
-InstantMessagingManager::InstantMessagingManager() {
+void PresenceManager::resetStats() {
+    updates_received_ = 0;
+    updates_coalesced_ = 0;
+    presentities_flushed_ = 0;
+    notifications_sent_ = 0;
+    deliveries_ = 0;
+    expirations_ = 0;
 }
 
-InstantMessagingManager::~InstantMessagingManager() {
+void PresenceManager::dispatcherLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (running_) {
+        auto now = std::chrono::steady_clock::now();
+        
+        // Everything whose coalescing window has closed goes out in one pass,
+        // together with the presentities that just expired
+        std::vector<UserId> due = collectExpired(now);
+        size_t expired_count = due.size();
+        while (!pending_.empty() && pending_.front().deadline <= now) {
+            due.push_back(pending_.front().presentity);
+            pending_set_.erase(pending_.front().presentity);
+            pending_.pop_front();
+        }
+        
+        if (!due.empty()) {
+            std::vector<UserId> expired(due.begin(), due.begin() + expired_count);
+            std::sort(due.begin(), due.end());
+            due.erase(std::unique(due.begin(), due.end()), due.end());
+            
+            lock.unlock();
+            flush(due);
+            removeExpired(expired);
+            lock.lock();
+            continue;
+        }
+        
+        // Sleep until the next window closes or the next entry expires
+        std::optional<std::chrono::steady_clock::time_point> wake;
+        if (!pending_.empty()) {
+            wake = pending_.front().deadline;
+        }
+        if (!expiry_heap_.empty() && (!wake || expiry_heap_.front().deadline < *wake)) {
+            wake = expiry_heap_.front().deadline;
+        }
+        
+        if (wake) {
+            dispatcher_cv_.wait_until(lock, *wake);
+        } else {
+            dispatcher_cv_.wait(lock);
+        }
+    }
 }
 
-std::string InstantMessagingManager::sendMessage(const std::string& from, const std::string& to, 
-                                                const std::string& content, MessageType type) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    InstantMessage message;
-    message.id = generateMessageId();
-    message.from = from;
-    message.to = to;
-    message.type = type;
-    message.content = content;
-    message.timestamp = std::chrono::system_clock::now();
-    
-    messages_[message.id] = message;
-    user_messages_[from].push_back(message.id);
-    user_messages_[to].push_back(message.id);
+void PresenceManager::scheduleExpiry(UserId presentity, std::chrono::steady_clock::time_point deadline) {
+    expiry_deadlines_[presentity] = deadline;
+    expiry_heap_.push_back({deadline, presentity});
+    std::push_heap(expiry_heap_.begin(), expiry_heap_.end(), std::greater<>());
     
-    if (message_callback_) {
-        message_callback_(message);
+    // Superseded entries pile up under frequent updates; rebuild from the live deadlines
+    if (expiry_heap_.size() > 2 * expiry_deadlines_.size() + 1024) {
+        expiry_heap_.clear();
+        for (const auto& [id, current] : expiry_deadlines_) {
+            expiry_heap_.push_back({current, id});
+        }
+        std::make_heap(expiry_heap_.begin(), expiry_heap_.end(), std::greater<>());
     }
-    
-    core::Logger::info("Message sent from {} to {}: {}", from, to, content.substr(0, 50));
-    return message.id;
 }
 
-bool InstantMessagingManager::markDelivered(const std::string& message_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
+std::vector<UserId> PresenceManager::collectExpired(std::chrono::steady_clock::time_point now) {
+    std::vector<UserId> expired;
     
-    auto it = messages_.find(message_id);
-    if (it != messages_.end()) {
-        it->second.delivered = true;
+    while (!expiry_heap_.empty() && expiry_heap_.front().deadline <= now) {
+        ExpiryEntry entry = expiry_heap_.front();
+        std::pop_heap(expiry_heap_.begin(), expiry_heap_.end(), std::greater<>());
+        expiry_heap_.pop_back();
         
-        if (delivery_callback_) {
-            delivery_callback_(message_id, true);
+        auto it = expiry_deadlines_.find(entry.presentity);
+        if (it == expiry_deadlines_.end() || it->second != entry.deadline) {
+            continue; // Refreshed since this entry was pushed
         }
+        expiry_deadlines_.erase(it);
         
-        return true;
+        // Subscribers see the presentity go offline before the entry is dropped
+        auto info_it = presence_info_.find(entry.presentity);
+        if (info_it != presence_info_.end()) {
+            info_it->second.state = PresenceState::OFFLINE;
+            info_it->second.status_message.clear();
+            expired.push_back(entry.presentity);
+            core::Logger::debug("Presence expired for {}", info_it->second.user_id);
+        }
     }
     
-    return false;
+    expirations_ += expired.size();
+    return expired;
 }
 
-bool InstantMessagingManager::markRead(const std::string& message_id) {
+void PresenceManager::removeExpired(const std::vector<UserId>& presentities) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    auto it = messages_.find(message_id);
-    if (it != messages_.end()) {
-        it->second.read = true;
-        return true;
+    for (UserId presentity : presentities) {
+        // Keep entries that were published again while the notifications went out
+        if (expiry_deadlines_.find(presentity) == expiry_deadlines_.end()) {
+            presence_info_.erase(presentity);
+        }
     }
-    
-    return false;
 }
 
-std::vector<InstantMessage> InstantMessagingManager::getMessages(const std::string& user_id, size_t limit) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+void PresenceManager::flush(const std::vector<UserId>& presentities) {
+    if (presentities.empty()) {
+        return;
+    }
     
-    std::vector<InstantMessage> result;
+    std::vector<PresenceInfo> updates;
+    std::unordered_map<UserId, std::vector<uint32_t>> batches; // subscriber -> indexes into updates
+    struct Recipient {
+        const std::string* subscriber;
+        std::vector<uint32_t> indexes;
+        size_t batch_size;
+        network::SocketAddress address;
+    };
+    std::vector<Recipient> recipients;
+    network::SipTransport* transport;
     
-    auto it = user_messages_.find(user_id);
-    if (it != user_messages_.end()) {
-        const auto& message_ids = it->second;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        updates.reserve(presentities.size());
+        for (UserId presentity : presentities) {
+            auto it = presence_info_.find(presentity);
+            if (it == presence_info_.end()) {
+                continue;
+            }
+            
+            uint32_t index = static_cast<uint32_t>(updates.size());
+            updates.push_back(it->second);
+            
+            auto sub_it = subscribers_.find(presentity);
+            if (sub_it != subscribers_.end()) {
+                for (UserId subscriber : sub_it->second.ids()) {
+                    batches[subscriber].push_back(index);
+                }
+            }
+        }
         
-        size_t start = message_ids.size() > limit ? message_ids.size() - limit : 0;
-        for (size_t i = start; i < message_ids.size(); ++i) {
-            auto msg_it = messages_.find(message_ids[i]);
-            if (msg_it != messages_.end()) {
-                result.push_back(msg_it->second);
+        // Name references stay valid: the table only ever appends. A
+        // subscription to a single presentity gets one NOTIFY per update.
+        recipients.reserve(batches.size());
+        for (auto& [subscriber, indexes] : batches) {
+            Recipient recipient{&user_ids_.name(subscriber), std::move(indexes), config_.max_batch_size, {}};
+            auto dialog_it = dialogs_.find(subscriber);
+            if (dialog_it != dialogs_.end()) {
+                recipient.address = dialog_it->second.address;
+                if (!dialog_it->second.event_list) {
+                    recipient.batch_size = 1;
+                }
             }
+            recipients.push_back(std::move(recipient));
         }
+        transport = transport_;
     }
     
-    return result;
+    presentities_flushed_ += updates.size();
+    
+    // Callbacks run without the lock so they can call back into the manager
+    if (presence_callback_) {
+        for (const auto& update : updates) {
+            presence_callback_(update);
+        }
+    }
+    
+    if (!notification_callback_ && !transport) {
+        return;
+    }
+    
+    std::vector<PresenceInfo> batch;
+    for (const auto& [subscriber, indexes, batch_size, address] : recipients) {
+        bool send = transport && address.port != 0;
+        if (!notification_callback_ && !send) {
+            continue;
+        }
+        
+        for (size_t offset = 0; offset < indexes.size(); offset += batch_size) {
+            size_t end = std::min(indexes.size(), offset + batch_size);
+            batch.clear();
+            for (size_t i = offset; i < end; ++i) {
+                batch.push_back(updates[indexes[i]]);
+            }
+            
+            if (notification_callback_) {
+                notification_callback_(*subscriber, batch);
+            }
+            if (send && !transport->sendMessage(createNotifyMessage(*subscriber, batch), address)) {
+                core::Logger::warn("Failed to send presence NOTIFY to {}", *subscriber);
+            }
+            notifications_sent_++;
+            deliveries_ += batch.size();
+        }
+    }
 }
 
-std::vector<InstantMessage> InstantMessagingManager::getConversation(const std::string& user1, const std::string& user2, size_t limit) const {
+// InstantMessagingManager implementation
+InstantMessagingManager::InstantMessagingManager()
+    : store_(std::make_unique<MessageStore>()), registrar_(nullptr), tracking_online_(false), running_(false) {
+    store_->open(MessageStore::Config());
+}
+
+InstantMessagingManager::~InstantMessagingManager() {
+    detachRegistrar();
+    stop();
+}
+
+bool InstantMessagingManager::start() {
     std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return true;
+    }
     
-    std::vector<InstantMessage> result;
+    running_ = true;
+    delivery_thread_ = std::thread(&InstantMessagingManager::deliveryLoop, this);
+    return true;
+}
+
+void InstantMessagingManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    
+    delivery_cv_.notify_all();
+    if (delivery_thread_.joinable()) {
+        delivery_thread_.join();
+    }
+}
+
+void InstantMessagingManager::attachRegistrar(sip::SipRegistrar& registrar) {
+    detachRegistrar();
     
-    for (const auto& [id, message] : messages_) {
-        if ((message.from == user1 && message.to == user2) ||
-            (message.from == user2 && message.to == user1)) {
-            result.push_back(message);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& user : registrar.getRegisteredUsers()) {
+            online_users_.insert(user);
         }
+        tracking_online_ = true;
     }
     
-    // Sort by timestamp
-    std::sort(result.begin(), result.end(),
-             [](const InstantMessage& a, const InstantMessage& b) {
-                 return a.timestamp < b.timestamp;
-             });
+    registrar_ = &registrar;
+    previous_registration_callback_ = registrar.getRegistrationCallback();
+    registrar.setRegistrationCallback([this, previous = previous_registration_callback_](
+                                          const sip::UserAccount& user, sip::RegistrationState state) {
+        if (previous) {
+            previous(user, state);
+        }
+        setUserOnline(user.username, state == sip::RegistrationState::REGISTERED);
+    });
+}
+
+void InstantMessagingManager::detachRegistrar() {
+    if (!registrar_) {
+        return;
+    }
+    
+    registrar_->setRegistrationCallback(std::move(previous_registration_callback_));
+    previous_registration_callback_ = nullptr;
+    registrar_ = nullptr;
+}
+
+void InstantMessagingManager::setUserOnline(const std::string& user_id, bool online) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    tracking_online_ = true;
     
-    // Limit results
-    if (result.size() > limit) {
-        result.erase(result.begin(), result.end() - limit);
+    if (!online) {
+        online_users_.erase(user_id);
+        return;
     }
     
-    return result;
+    online_users_.insert(user_id);
+    if (offline_queue_.getDepth(user_id) == 0) {
+        return;
+    }
+    
+    if (running_) {
+        ready_users_.push_back(user_id);
+        lock.unlock();
+        delivery_cv_.notify_one();
+    } else {
+        lock.unlock();
+        deliverQueued(user_id);
+    }
 }
 
-InstantMessage InstantMessagingManager::getMessage(const std::string& message_id) const {
+bool InstantMessagingManager::isUserOnline(const std::string& user_id) const {
     std::lock_guard<std::mutex> lock(mutex_);
+    return !tracking_online_ || online_users_.count(user_id) > 0;
+}
+
+std::string InstantMessagingManager::sendMessage(const std::string& from, const std::string& to, 
+                                                const std::string& content, MessageType type) {
+    InstantMessage message;
+    message.id = generateMessageId();
+    message.from = from;
+    message.to = to;
+    message.type = type;
+    message.content = content;
+    message.timestamp = std::chrono::system_clock::now();
     
-    auto it = messages_.find(message_id);
-    if (it != messages_.end()) {
-        return it->second;
+    if (!store_->append(message)) {
+        core::Logger::error("Failed to store message from {} to {}", from, to);
+        return "";
     }
     
-    return InstantMessage();
+    {
+        // Queued under the lock so a registration arriving now cannot miss it
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tracking_online_ && !online_users_.count(to)) {
+            offline_queue_.enqueue(to, message.id);
+            core::Logger::debug("Queued message {} for offline user {}", message.id, to);
+            return message.id;
+        }
+    }
+    
+    if (message_callback_) {
+        message_callback_(message);
+    }
+    
+    core::Logger::info("Message sent from {} to {}: {}", from, to, content.substr(0, 50));
+    return message.id;
+}
+
+bool InstantMessagingManager::markDelivered(const std::string& message_id) {
+    if (!store_->markDelivered(message_id)) {
+        return false;
+    }
+    
+    if (delivery_callback_) {
+        delivery_callback_(message_id, true);
+    }
+    
+    return true;
+}
+
+bool InstantMessagingManager::markRead(const std::string& message_id) {
+    return store_->markRead(message_id);
+}
+
+std::vector<InstantMessage> InstantMessagingManager::getMessages(const std::string& user_id, size_t limit) const {
+    return store_->getUserMessages(user_id, std::chrono::system_clock::time_point::min(),
+                                   std::chrono::system_clock::time_point::max(), limit);
+}
+
+std::vector<InstantMessage> InstantMessagingManager::getConversation(const std::string& user1, const std::string& user2, size_t limit) const {
+    return store_->getConversation(user1, user2, std::chrono::system_clock::time_point::min(),
+                                   std::chrono::system_clock::time_point::max(), limit);
+}
+
+std::vector<InstantMessage> InstantMessagingManager::getMessages(const std::string& user_id,
+                                                                 std::chrono::system_clock::time_point from,
+                                                                 std::chrono::system_clock::time_point until,
+                                                                 size_t limit) const {
+    return store_->getUserMessages(user_id, from, until, limit);
+}
+
+std::vector<InstantMessage> InstantMessagingManager::getConversation(const std::string& user1, const std::string& user2,
+                                                                     std::chrono::system_clock::time_point from,
+                                                                     std::chrono::system_clock::time_point until,
+                                                                     size_t limit) const {
+    return store_->getConversation(user1, user2, from, until, limit);
+}
+
+InstantMessage InstantMessagingManager::getMessage(const std::string& message_id) const {
+    return store_->get(message_id).value_or(InstantMessage());
 }
 
 size_t InstantMessagingManager::getMessageCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return messages_.size();
+    return store_->getMessageCount();
 }
 
 size_t InstantMessagingManager::getUndeliveredCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return store_->getUndeliveredCount();
+}
+
+void InstantMessagingManager::deliveryLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
     
-    size_t count = 0;
-    for (const auto& [id, message] : messages_) {
-        if (!message.delivered) {
-            count++;
+    while (running_) {
+        delivery_cv_.wait(lock, [this] { return !running_ || !ready_users_.empty(); });
+        
+        while (!ready_users_.empty()) {
+            std::string user_id = std::move(ready_users_.front());
+            ready_users_.pop_front();
+            
+            lock.unlock();
+            deliverQueued(user_id);
+            lock.lock();
         }
     }
-    return count;
 }
 
-std::string InstantMessagingManager::generateMessageId() const {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 15);
-    
-    std::ostringstream oss;
-    oss << "msg-";
+void InstantMessagingManager::deliverQueued(const std::string& user_id) {
+    auto message_ids = offline_queue_.drain(user_id);
+    if (message_ids.empty()) {
+        return;
+    }
     
-    for (int i = 0; i < 16; ++i) {
-        oss << std::hex << dis(gen);
+    std::vector<InstantMessage> messages;
+    messages.reserve(message_ids.size());
+    for (const auto& message_id : message_ids) {
+        auto message = store_->get(message_id);
+        if (message && !message->delivered) {
+            messages.push_back(std::move(*message));
+        }
     }
     
-    return oss.str();
+    core::Logger::info("Delivering {} queued messages to {}", messages.size(), user_id);
+    
+    if (batch_delivery_callback_) {
+        batch_delivery_callback_(user_id, messages);
+    } else if (message_callback_) {
+        for (const auto& message : messages) {
+            message_callback_(message);
+        }
+    }
+}
+
+std::string InstantMessagingManager::generateMessageId() const {
+    std::string id = "msg-";
+    core::SecureRandom::appendHex(id, 16);
+    return id;
 }
 
 // Utility functions
@@ -425,6 +1065,7 @@ ConferenceType stringToConferenceType(const std::string& type) {
 
 // EnterpriseManager implementation
 EnterpriseManager::EnterpriseManager() : initialized_(false) {
+    conference_manager_.setRecordingManager(&recording_manager_);
 }
 
 EnterpriseManager::~EnterpriseManager() {
@@ -436,6 +1077,10 @@ bool EnterpriseManager::initialize() {
         return true;
     }
 
+    if (!presence_manager_.start() || !messaging_manager_.start() || !recording_manager_.start()) {
+        return false;
+    }
+
     initialized_ = true;
     core::Logger::info("Enterprise manager initialized");
     return true;
@@ -446,12 +1091,32 @@ void EnterpriseManager::shutdown() {
         return;
     }
 
+    messaging_manager_.detachRegistrar();
+    presence_manager_.stop();
+    messaging_manager_.stop();
+    recording_manager_.stop();
+
     initialized_ = false;
     core::Logger::info("Enterprise manager shutdown");
 }
 
+void EnterpriseManager::attachRegistrar(sip::SipRegistrar& registrar) {
+    messaging_manager_.attachRegistrar(registrar);
+}
+
+bool EnterpriseManager::setOfflineQueueDirectory(const std::string& directory) {
+    auto& offline_queue = messaging_manager_.getOfflineQueue();
+    OfflineMessageQueue::Config config = offline_queue.getConfig();
+    config.spill_directory = directory;
+    return offline_queue.setConfig(config);
+}
+
 void EnterpriseManager::performMaintenance() {
-    presence_manager_.cleanupExpiredPresence();
+    // Presence expiry is timer driven while the dispatcher runs
+    if (!presence_manager_.isRunning()) {
+        presence_manager_.cleanupExpiredPresence();
+    }
+    messaging_manager_.getStore().applyRetention();
     core::Logger::debug("Enterprise maintenance completed");
 }
 
@@ -461,13 +1126,13 @@ EnterpriseManager::Stats EnterpriseManager::getStats() const {
     stats.total_messages = messaging_manager_.getMessageCount();
     stats.active_transfers = transfer_manager_.getActiveTransfers().size();
     stats.active_conferences = conference_manager_.getConferenceCount();
-    stats.active_recordings = 0; // Placeholder
+    stats.active_recordings = recording_manager_.getActiveRecordings().size();
 
     return stats;
 }
 
 // ConferenceManager implementation
-ConferenceManager::ConferenceManager() {
+ConferenceManager::ConferenceManager() : recording_manager_(nullptr) {
 }
 
 ConferenceManager::~ConferenceManager() {
@@ -492,6 +1157,14 @@ std::string ConferenceManager::createConference(const std::string& name, const s
     moderator.is_moderator = true;
     room.addParticipant(moderator);
 
+    room.speakers = std::make_shared<DominantSpeakerDetector>();
+    room.speakers->addParticipant(moderator_id);
+    room.speakers->setSpeakerCallback([this, room_id](const std::string& user_id) {
+        if (speaker_callback_) {
+            speaker_callback_(room_id, user_id);
+        }
+    });
+
     conferences_[room_id] = room;
 
     notifyConferenceEvent(room_id, "created");
@@ -506,6 +1179,13 @@ bool ConferenceManager::destroyConference(const std::string& room_id) {
 
     auto it = conferences_.find(room_id);
     if (it != conferences_.end()) {
+        if (it->second.recording_enabled && recording_manager_) {
+            recording_manager_->stopRecording(room_id);
+        }
+
+        // Media threads may still hold the detector
+        it->second.speakers->setSpeakerCallback(nullptr);
+
         notifyConferenceEvent(room_id, "destroyed");
         conferences_.erase(it);
 
@@ -549,6 +1229,7 @@ bool ConferenceManager::joinConference(const std::string& room_id, const std::st
         participant.joined_time = std::chrono::system_clock::now();
 
         it->second.addParticipant(participant);
+        it->second.speakers->addParticipant(user_id);
 
         notifyParticipantEvent(room_id, participant, true);
 
@@ -560,10 +1241,17 @@ bool ConferenceManager::joinConference(const std::string& room_id, const std::st
 }
 
 bool ConferenceManager::leaveConference(const std::string& room_id, const std::string& user_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    // The detector may report a speaker change synchronously, and the
+    // callback may call back in here, so it is updated without mutex_
+    std::shared_ptr<DominantSpeakerDetector> speakers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = conferences_.find(room_id);
+        if (it == conferences_.end()) {
+            return false;
+        }
 
-    auto it = conferences_.find(room_id);
-    if (it != conferences_.end()) {
         // Find participant before removing
         ConferenceParticipant participant;
         for (const auto& p : it->second.participants) {
@@ -574,6 +1262,7 @@ bool ConferenceManager::leaveConference(const std::string& room_id, const std::s
         }
 
         it->second.removeParticipant(user_id);
+        speakers = it->second.speakers;
 
         if (!participant.user_id.empty()) {
             notifyParticipantEvent(room_id, participant, false);
@@ -585,30 +1274,39 @@ bool ConferenceManager::leaveConference(const std::string& room_id, const std::s
         }
 
         core::Logger::info("User {} left conference {}", user_id, room_id);
-        return true;
     }
 
-    return false;
+    speakers->removeParticipant(user_id);
+    return true;
 }
 
 bool ConferenceManager::muteParticipant(const std::string& room_id, const std::string& user_id, bool audio, bool video) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<DominantSpeakerDetector> speakers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
 
-    auto it = conferences_.find(room_id);
-    if (it != conferences_.end()) {
-        for (auto& participant : it->second.participants) {
-            if (participant.user_id == user_id) {
-                participant.audio_muted = audio;
-                participant.video_muted = video;
+        auto it = conferences_.find(room_id);
+        if (it == conferences_.end()) {
+            return false;
+        }
 
-                core::Logger::info("Muted participant {} in conference {}: audio={}, video={}",
-                                  user_id, room_id, audio, video);
-                return true;
-            }
+        auto participant = std::find_if(it->second.participants.begin(), it->second.participants.end(),
+                                        [&user_id](const ConferenceParticipant& p) { return p.user_id == user_id; });
+        if (participant == it->second.participants.end()) {
+            return false;
         }
+
+        participant->audio_muted = audio;
+        participant->video_muted = video;
+        speakers = it->second.speakers;
+
+        core::Logger::info("Muted participant {} in conference {}: audio={}, video={}",
+                          user_id, room_id, audio, video);
     }
 
-    return false;
+    // Outside mutex_, as in leaveConference()
+    speakers->setMuted(speakers->findParticipant(user_id), audio);
+    return true;
 }
 
 bool ConferenceManager::setModerator(const std::string& room_id, const std::string& user_id) {
@@ -641,6 +1339,10 @@ bool ConferenceManager::startRecording(const std::string& room_id, const std::st
 
     auto it = conferences_.find(room_id);
     if (it != conferences_.end()) {
+        if (recording_manager_ && !recording_manager_->startRecording(room_id, output_path)) {
+            return false;
+        }
+
         it->second.recording_enabled = true;
         it->second.recording_path = output_path;
 
@@ -658,6 +1360,10 @@ bool ConferenceManager::stopRecording(const std::string& room_id) {
 
     auto it = conferences_.find(room_id);
     if (it != conferences_.end()) {
+        if (it->second.recording_enabled && recording_manager_) {
+            recording_manager_->stopRecording(room_id);
+        }
+
         it->second.recording_enabled = false;
 
         notifyConferenceEvent(room_id, "recording_stopped");
@@ -680,6 +1386,47 @@ bool ConferenceManager::isRecording(const std::string& room_id) const {
     return false;
 }
 
+bool ConferenceManager::setAudioLevelId(const std::string& room_id, const std::string& user_id, uint8_t audio_level_id) {
+    auto speakers = getSpeakerDetector(room_id);
+    if (!speakers) {
+        return false;
+    }
+
+    int slot = speakers->findParticipant(user_id);
+    if (slot < 0) {
+        return false;
+    }
+    speakers->setAudioLevelId(slot, audio_level_id);
+    return true;
+}
+
+std::shared_ptr<DominantSpeakerDetector> ConferenceManager::getSpeakerDetector(const std::string& room_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = conferences_.find(room_id);
+    if (it != conferences_.end()) {
+        return it->second.speakers;
+    }
+
+    return nullptr;
+}
+
+bool ConferenceManager::onAudioPacket(const std::string& room_id, const std::string& user_id,
+                                      const uint8_t* packet, size_t size) {
+    auto speakers = getSpeakerDetector(room_id);
+    return speakers && speakers->onPacket(speakers->findParticipant(user_id), packet, size);
+}
+
+std::string ConferenceManager::getDominantSpeaker(const std::string& room_id) const {
+    auto speakers = getSpeakerDetector(room_id);
+    return speakers ? speakers->getDominantSpeaker() : std::string();
+}
+
+std::vector<std::string> ConferenceManager::getActiveSpeakers(const std::string& room_id, size_t count) const {
+    auto speakers = getSpeakerDetector(room_id);
+    return speakers ? speakers->getActiveSpeakers(count) : std::vector<std::string>();
+}
+
 size_t ConferenceManager::getConferenceCount() const {
     std::lock_guard<std::mutex> lock(mutex_);
     return conferences_.size();
@@ -696,18 +1443,9 @@ size_t ConferenceManager::getTotalParticipants() const {
 }
 
 std::string ConferenceManager::generateRoomId() const {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 15);
-
-    std::ostringstream oss;
-    oss << "conf-";
-
-    for (int i = 0; i < 12; ++i) {
-        oss << std::hex << dis(gen);
-    }
-
-    return oss.str();
+    std::string id = "conf-";
+    core::SecureRandom::appendHex(id, 12);
+    return id;
 }
 
 void ConferenceManager::notifyConferenceEvent(const std::string& room_id, const std::string& event) {
@@ -853,18 +1591,34 @@ CallRecordingManager::CallRecordingManager() {
 }
 
 CallRecordingManager::~CallRecordingManager() {
+    // Complete open files before the writer goes away
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [call_id, session] : recordings_) {
+        writer_.close(session.stream);
+    }
 }
 
 bool CallRecordingManager::startRecording(const std::string& call_id, const std::string& output_path) {
     std::lock_guard<std::mutex> lock(mutex_);
 
+    auto stream = writer_.open(output_path, recordingFormatForPath(output_path));
+    if (!stream) {
+        return false;
+    }
+
+    auto it = recordings_.find(call_id);
+    if (it != recordings_.end()) {
+        writer_.close(it->second.stream);
+    }
+
     RecordingSession session;
     session.call_id = call_id;
     session.file_path = output_path;
     session.active = true;
     session.start_time = std::chrono::system_clock::now();
+    session.stream = std::move(stream);
 
-    recordings_[call_id] = session;
+    recordings_[call_id] = std::move(session);
 
     if (recording_callback_) {
         recording_callback_(call_id, output_path, true);
@@ -880,6 +1634,8 @@ bool CallRecordingManager::stopRecording(const std::string& call_id) {
     auto it = recordings_.find(call_id);
     if (it != recordings_.end()) {
         it->second.active = false;
+        writer_.close(it->second.stream);
+        it->second.stream.reset();
 
         if (recording_callback_) {
             recording_callback_(call_id, it->second.file_path, false);
@@ -898,6 +1654,7 @@ bool CallRecordingManager::pauseRecording(const std::string& call_id) {
     auto it = recordings_.find(call_id);
     if (it != recordings_.end() && it->second.active) {
         it->second.paused = true;
+        it->second.stream->pause();
         core::Logger::info("Paused recording call {}", call_id);
         return true;
     }
@@ -911,6 +1668,7 @@ bool CallRecordingManager::resumeRecording(const std::string& call_id) {
     auto it = recordings_.find(call_id);
     if (it != recordings_.end() && it->second.active) {
         it->second.paused = false;
+        it->second.stream->resume();
         core::Logger::info("Resumed recording call {}", call_id);
         return true;
     }
@@ -949,13 +1707,64 @@ std::vector<std::string> CallRecordingManager::getActiveRecordings() const {
     return active;
 }
 
+std::shared_ptr<RecordingStream> CallRecordingManager::getStream(const std::string& call_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = recordings_.find(call_id);
+    if (it != recordings_.end() && it->second.active && !it->second.paused) {
+        return it->second.stream;
+    }
+
+    return nullptr;
+}
+
+bool CallRecordingManager::recordRtp(const std::string& call_id, const uint8_t* packet, size_t size) {
+    auto stream = getStream(call_id);
+    return stream && stream->writeRtp(packet, size);
+}
+
+bool CallRecordingManager::recordAudio(const std::string& call_id, const int16_t* samples, size_t count) {
+    auto stream = getStream(call_id);
+    return stream && stream->writeAudio(samples, count);
+}
+
 std::vector<std::string> CallRecordingManager::getRecordingFiles(const std::string& directory) const {
-    // Placeholder implementation - would scan directory in production
-    return {"recording1.wav", "recording2.wav", "recording3.mp4"};
+    std::vector<std::string> files;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file(ec)) {
+            continue;
+        }
+        std::string extension = entry.path().extension().string();
+        if (extension == ".wav" || extension == ".rtp" || extension == ".rtpdump") {
+            files.push_back(entry.path().filename().string());
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
 }
 
 bool CallRecordingManager::deleteRecording(const std::string& file_path) {
-    // Placeholder implementation - would delete file in production
+    {
+        // Files still being written are not deleted
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [call_id, session] : recordings_) {
+            if (session.active && session.file_path == file_path) {
+                return false;
+            }
+        }
+    }
+
+    std::error_code ec;
+    if (!std::filesystem::remove(file_path, ec)) {
+        core::Logger::warn("Failed to delete recording file {}: {}", file_path,
+                          ec ? ec.message() : "not found");
+        return false;
+    }
+    std::filesystem::remove(recordingIndexPath(file_path), ec);
+
     core::Logger::info("Deleted recording file: {}", file_path);
     return true;
 }
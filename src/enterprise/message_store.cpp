@@ -0,0 +1,674 @@
+#include "fmus/enterprise/message_store.hpp"
+#include "fmus/core/logger.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <cstring>
+#include <cstdio>
+
+namespace fmus::enterprise {
+
+namespace {
+
+constexpr size_t record_header_size = 5; // u32 payload length + u8 record type
+
+int64_t toMillis(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point fromMillis(int64_t millis) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(millis)));
+}
+
+// Little-endian record encoding
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void putI64(std::vector<uint8_t>& out, int64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+    }
+}
+
+void putString(std::vector<uint8_t>& out, const std::string& value) {
+    putU32(out, static_cast<uint32_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+uint32_t getU32(const uint8_t* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+class RecordReader {
+public:
+    RecordReader(const uint8_t* data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) {}
+
+    uint8_t u8() {
+        if (!require(1)) return 0;
+        return data_[pos_++];
+    }
+
+    int64_t i64() {
+        if (!require(8)) return 0;
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(data_[pos_ + i]) << (8 * i);
+        }
+        pos_ += 8;
+        return static_cast<int64_t>(value);
+    }
+
+    std::string str() {
+        if (!require(4)) return {};
+        uint32_t length = getU32(data_ + pos_);
+        pos_ += 4;
+        if (!require(length)) return {};
+        std::string value(reinterpret_cast<const char*>(data_ + pos_), length);
+        pos_ += length;
+        return value;
+    }
+
+    bool ok() const { return ok_; }
+
+private:
+    bool require(size_t count) {
+        if (!ok_ || size_ - pos_ < count) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+    bool ok_;
+};
+
+std::vector<uint8_t> encodeMessage(const InstantMessage& message, uint8_t flags) {
+    std::vector<uint8_t> payload;
+    payload.reserve(32 + message.id.size() + message.from.size() + message.to.size() + message.content.size());
+    putI64(payload, toMillis(message.timestamp));
+    payload.push_back(static_cast<uint8_t>(message.type));
+    payload.push_back(flags);
+    putString(payload, message.id);
+    putString(payload, message.from);
+    putString(payload, message.to);
+    putString(payload, message.content);
+    return payload;
+}
+
+bool decodeMessage(const uint8_t* data, size_t size, InstantMessage& message, uint8_t& flags) {
+    RecordReader reader(data, size);
+    message.timestamp = fromMillis(reader.i64());
+    message.type = static_cast<MessageType>(reader.u8());
+    flags = reader.u8();
+    message.id = reader.str();
+    message.from = reader.str();
+    message.to = reader.str();
+    message.content = reader.str();
+    return reader.ok();
+}
+
+} // namespace
+
+// MessageStore implementation
+MessageStore::MessageStore()
+    : open_(false), next_segment_id_(0), retention_generation_(0), undelivered_count_(0) {
+}
+
+MessageStore::~MessageStore() {
+    close();
+}
+
+bool MessageStore::open(const Config& config) {
+    close();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    if (config_.segment_size == 0) {
+        config_.segment_size = Config().segment_size;
+    }
+
+    if (!config_.directory.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(config_.directory, ec);
+        if (ec) {
+            core::Logger::error("Failed to create message store directory {}: {}", config_.directory, ec.message());
+            return false;
+        }
+
+        // Replay existing segments oldest first
+        std::vector<uint32_t> ids;
+        for (const auto& entry : std::filesystem::directory_iterator(config_.directory, ec)) {
+            unsigned int id;
+            char suffix;
+            if (std::sscanf(entry.path().filename().c_str(), "segment-%8u.lo%c", &id, &suffix) == 2 && suffix == 'g') {
+                ids.push_back(id);
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+
+        for (uint32_t id : ids) {
+            if (!openSegment(id) || !replaySegment(segments_.back())) {
+                core::Logger::error("Failed to replay message segment {}", segmentPath(id));
+                return false;
+            }
+            next_segment_id_ = id + 1;
+        }
+    }
+
+    if (segments_.empty() && !openSegment(next_segment_id_++)) {
+        return false;
+    }
+
+    open_ = true;
+    core::Logger::info("Message store opened ({}): {} messages in {} segments",
+                      config_.directory.empty() ? "memory" : config_.directory,
+                      messages_.size(), segments_.size());
+    return true;
+}
+
+void MessageStore::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto& segment : segments_) {
+        if (segment.fd >= 0) {
+            ::close(segment.fd);
+        }
+    }
+    segments_.clear();
+    messages_.clear();
+    user_index_.clear();
+    conversation_index_.clear();
+    cache_.clear();
+    cache_index_.clear();
+    undelivered_count_ = 0;
+    next_segment_id_ = 0;
+    open_ = false;
+}
+
+bool MessageStore::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_;
+}
+
+bool MessageStore::append(const InstantMessage& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!open_ || messages_.count(message.id)) {
+        return false;
+    }
+
+    uint8_t flags = (message.delivered ? STATUS_DELIVERED : 0) | (message.read ? STATUS_READ : 0);
+
+    Location location;
+    if (!writeRecord(RECORD_MESSAGE, encodeMessage(message, flags), location)) {
+        return false;
+    }
+
+    indexMessage(message, location, toMillis(message.timestamp));
+    applyStatus(message.id, flags);
+    stats_.messages_appended++;
+
+    // Freshly sent messages are the ones most likely to be read back
+    cache_.emplace_front(cacheKey(location), message);
+    cache_index_[cacheKey(location)] = cache_.begin();
+    if (cache_.size() > config_.cache_capacity) {
+        cache_index_.erase(cache_.back().first);
+        cache_.pop_back();
+    }
+
+    return true;
+}
+
+bool MessageStore::markDelivered(const std::string& message_id) {
+    return setStatus(message_id, STATUS_DELIVERED);
+}
+
+bool MessageStore::markRead(const std::string& message_id) {
+    return setStatus(message_id, STATUS_READ);
+}
+
+std::optional<InstantMessage> MessageStore::get(const std::string& message_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = messages_.find(message_id);
+    if (it == messages_.end()) {
+        return std::nullopt;
+    }
+    return loadMessage(it->second.location);
+}
+
+std::vector<InstantMessage> MessageStore::getUserMessages(const std::string& user_id, TimePoint from, TimePoint until,
+                                                          size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = user_index_.find(user_id);
+    return query(it != user_index_.end() ? &it->second : nullptr, from, until, limit);
+}
+
+std::vector<InstantMessage> MessageStore::getConversation(const std::string& user1, const std::string& user2,
+                                                          TimePoint from, TimePoint until, size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = conversation_index_.find(conversationKey(user1, user2));
+    return query(it != conversation_index_.end() ? &it->second : nullptr, from, until, limit);
+}
+
+size_t MessageStore::applyRetention() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    int64_t cutoff = toMillis(std::chrono::system_clock::now() - config_.retention);
+    size_t removed = 0;
+
+    // Segments are time ordered, so only the oldest can be due; the active one always stays
+    while (segments_.size() > 1) {
+        const Segment& oldest = segments_.front();
+        bool expired = config_.retention.count() > 0 && oldest.last_timestamp < cutoff;
+        bool over_limit = config_.max_segments > 0 && segments_.size() > config_.max_segments;
+        if (!expired && !over_limit) {
+            break;
+        }
+
+        removed += oldest.message_ids.size();
+        dropOldestSegment();
+    }
+
+    if (removed > 0) {
+        core::Logger::info("Message store retention removed {} messages", removed);
+    }
+    return removed;
+}
+
+size_t MessageStore::getMessageCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return messages_.size();
+}
+
+size_t MessageStore::getUndeliveredCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return undelivered_count_;
+}
+
+MessageStore::Stats MessageStore::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.segment_count = segments_.size();
+    return stats;
+}
+
+void MessageStore::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = Stats();
+}
+
+bool MessageStore::openSegment(uint32_t id) {
+    Segment segment;
+    segment.id = id;
+
+    if (!config_.directory.empty()) {
+        std::string path = segmentPath(id);
+        segment.fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (segment.fd < 0) {
+            core::Logger::error("Failed to open message segment {}: {}", path, strerror(errno));
+            return false;
+        }
+    }
+
+    segments_.push_back(std::move(segment));
+    stats_.segments_created++;
+    return true;
+}
+
+bool MessageStore::replaySegment(Segment& segment) {
+    struct stat file_stat;
+    if (fstat(segment.fd, &file_stat) < 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> data(static_cast<size_t>(file_stat.st_size));
+    size_t loaded = 0;
+    while (loaded < data.size()) {
+        ssize_t count = ::pread(segment.fd, data.data() + loaded, data.size() - loaded, loaded);
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        loaded += count;
+    }
+
+    size_t pos = 0;
+    while (pos + record_header_size <= data.size()) {
+        uint32_t length = getU32(data.data() + pos);
+        uint8_t type = data[pos + 4];
+        if (data.size() - pos - record_header_size < length) {
+            break; // Torn write at the tail
+        }
+
+        const uint8_t* payload = data.data() + pos + record_header_size;
+        Location location{segment.id, static_cast<uint32_t>(pos), length};
+
+        if (type == RECORD_MESSAGE) {
+            InstantMessage message;
+            uint8_t flags;
+            if (!decodeMessage(payload, length, message, flags)) {
+                break;
+            }
+            if (!messages_.count(message.id)) {
+                indexMessage(message, location, toMillis(message.timestamp));
+                applyStatus(message.id, flags);
+            }
+        } else if (type == RECORD_STATUS) {
+            RecordReader reader(payload, length);
+            uint8_t flags = reader.u8();
+            std::string message_id = reader.str();
+            if (!reader.ok()) {
+                break;
+            }
+            applyStatus(message_id, flags);
+        } else {
+            break;
+        }
+
+        pos += record_header_size + length;
+    }
+
+    // Drop anything after the last intact record so appends continue cleanly
+    if (pos < data.size()) {
+        core::Logger::warn("Truncating message segment {} from {} to {} bytes",
+                          segmentPath(segment.id), data.size(), pos);
+        if (ftruncate(segment.fd, static_cast<off_t>(pos)) < 0) {
+            return false;
+        }
+    }
+
+    segment.size = pos;
+    return true;
+}
+
+bool MessageStore::writeRecord(RecordType type, const std::vector<uint8_t>& payload, Location& location) {
+    size_t record_size = record_header_size + payload.size();
+
+    if (segments_.back().size > 0 && segments_.back().size + record_size > config_.segment_size) {
+        if (!openSegment(next_segment_id_++)) {
+            return false;
+        }
+    }
+    Segment& active = segments_.back();
+
+    uint8_t header[record_header_size];
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    for (int i = 0; i < 4; ++i) {
+        header[i] = static_cast<uint8_t>(length >> (8 * i));
+    }
+    header[4] = type;
+
+    if (active.fd >= 0) {
+        iovec iov[2];
+        iov[0].iov_base = header;
+        iov[0].iov_len = sizeof(header);
+        iov[1].iov_base = const_cast<uint8_t*>(payload.data());
+        iov[1].iov_len = payload.size();
+
+        ssize_t written = ::writev(active.fd, iov, 2);
+        if (written != static_cast<ssize_t>(record_size)) {
+            core::Logger::error("Failed to append to message segment {}: {}",
+                               segmentPath(active.id), written < 0 ? strerror(errno) : "short write");
+            // Cut off a partial record so the log stays parseable
+            if (ftruncate(active.fd, static_cast<off_t>(active.size)) < 0) {
+                core::Logger::error("Failed to truncate message segment {}", segmentPath(active.id));
+            }
+            return false;
+        }
+    } else {
+        active.memory.insert(active.memory.end(), header, header + sizeof(header));
+        active.memory.insert(active.memory.end(), payload.begin(), payload.end());
+    }
+
+    location = Location{active.id, static_cast<uint32_t>(active.size), length};
+    active.size += record_size;
+    stats_.bytes_appended += record_size;
+    return true;
+}
+
+bool MessageStore::readRecord(const Location& location, std::vector<uint8_t>& payload) const {
+    auto it = std::lower_bound(segments_.begin(), segments_.end(), location.segment,
+                               [](const Segment& segment, uint32_t id) { return segment.id < id; });
+    if (it == segments_.end() || it->id != location.segment) {
+        return false;
+    }
+
+    payload.resize(location.length);
+    size_t offset = location.offset + record_header_size;
+
+    if (it->fd < 0) {
+        std::memcpy(payload.data(), it->memory.data() + offset, location.length);
+        return true;
+    }
+
+    size_t loaded = 0;
+    while (loaded < payload.size()) {
+        ssize_t count = ::pread(it->fd, payload.data() + loaded, payload.size() - loaded, offset + loaded);
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        loaded += count;
+    }
+    return true;
+}
+
+bool MessageStore::setStatus(const std::string& message_id, uint8_t flags) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = messages_.find(message_id);
+    if (!open_ || it == messages_.end()) {
+        return false;
+    }
+
+    uint8_t updated = it->second.flags | flags;
+    if (updated == it->second.flags) {
+        return true;
+    }
+
+    std::vector<uint8_t> payload;
+    payload.push_back(updated);
+    putString(payload, message_id);
+
+    Location location;
+    if (!writeRecord(RECORD_STATUS, payload, location)) {
+        return false;
+    }
+
+    applyStatus(message_id, updated);
+    return true;
+}
+
+void MessageStore::indexMessage(const InstantMessage& message, const Location& location, int64_t timestamp) {
+    MessageRef& ref = messages_[message.id];
+    ref.location = location;
+    ref.flags = 0;
+    undelivered_count_++;
+
+    // Records are only ever indexed from the segment being appended or replayed
+    Segment& segment = segments_.back();
+    segment.last_timestamp = std::max(segment.last_timestamp, timestamp);
+    segment.message_ids.push_back(message.id);
+
+    // Appends are almost always in time order; the sorted insert only covers clock skew
+    IndexEntry entry{timestamp, location};
+    auto insert = [&entry](Index& index) {
+        if (index.entries.empty() || index.entries.back().timestamp <= entry.timestamp) {
+            index.entries.push_back(entry);
+        } else {
+            auto pos = std::upper_bound(index.entries.begin(), index.entries.end(), entry.timestamp,
+                                        [](int64_t ts, const IndexEntry& e) { return ts < e.timestamp; });
+            index.entries.insert(pos, entry);
+        }
+    };
+
+    insert(user_index_[message.from]);
+    if (message.to != message.from) {
+        insert(user_index_[message.to]);
+    }
+    insert(conversation_index_[conversationKey(message.from, message.to)]);
+}
+
+void MessageStore::applyStatus(const std::string& message_id, uint8_t flags) {
+    auto it = messages_.find(message_id);
+    if (it == messages_.end()) {
+        return;
+    }
+
+    if (!(it->second.flags & STATUS_DELIVERED) && (flags & STATUS_DELIVERED)) {
+        undelivered_count_--;
+    }
+    it->second.flags = flags;
+
+    auto cached = cache_index_.find(cacheKey(it->second.location));
+    if (cached != cache_index_.end()) {
+        cached->second->second.delivered = (flags & STATUS_DELIVERED) != 0;
+        cached->second->second.read = (flags & STATUS_READ) != 0;
+    }
+}
+
+std::vector<InstantMessage> MessageStore::query(Index* index, TimePoint from, TimePoint until,
+                                                size_t limit) const {
+    std::vector<InstantMessage> result;
+    if (!index || limit == 0) {
+        return result;
+    }
+
+    trimIndex(*index);
+    const auto& entries = index->entries;
+
+    auto by_timestamp = [](const IndexEntry& e, int64_t ts) { return e.timestamp < ts; };
+    auto begin = std::lower_bound(entries.begin(), entries.end(), toMillis(from), by_timestamp);
+    auto end = std::lower_bound(begin, entries.end(), toMillis(until), by_timestamp);
+
+    // Newest page within the range
+    if (static_cast<size_t>(end - begin) > limit) {
+        begin = end - limit;
+    }
+
+    result.reserve(end - begin);
+    for (auto it = begin; it != end; ++it) {
+        auto message = loadMessage(it->location);
+        if (message) {
+            result.push_back(std::move(*message));
+        }
+    }
+    return result;
+}
+
+void MessageStore::trimIndex(Index& index) const {
+    if (index.trimmed_generation == retention_generation_) {
+        return;
+    }
+
+    uint32_t first_live = segments_.front().id;
+    index.entries.erase(std::remove_if(index.entries.begin(), index.entries.end(),
+                                       [first_live](const IndexEntry& e) { return e.location.segment < first_live; }),
+                        index.entries.end());
+    index.trimmed_generation = retention_generation_;
+}
+
+std::optional<InstantMessage> MessageStore::loadMessage(const Location& location) const {
+    uint64_t key = cacheKey(location);
+
+    auto cached = cache_index_.find(key);
+    if (cached != cache_index_.end()) {
+        cache_.splice(cache_.begin(), cache_, cached->second);
+        stats_.cache_hits++;
+        return cached->second->second;
+    }
+    stats_.cache_misses++;
+
+    std::vector<uint8_t> payload;
+    InstantMessage message;
+    uint8_t flags;
+    if (!readRecord(location, payload) || !decodeMessage(payload.data(), payload.size(), message, flags)) {
+        core::Logger::error("Failed to read message record at segment {} offset {}", location.segment, location.offset);
+        return std::nullopt;
+    }
+
+    // Status changes are separate records; the index holds the current flags
+    auto it = messages_.find(message.id);
+    if (it != messages_.end()) {
+        flags = it->second.flags;
+    }
+    message.delivered = (flags & STATUS_DELIVERED) != 0;
+    message.read = (flags & STATUS_READ) != 0;
+
+    if (config_.cache_capacity > 0) {
+        cache_.emplace_front(key, message);
+        cache_index_[key] = cache_.begin();
+        if (cache_.size() > config_.cache_capacity) {
+            cache_index_.erase(cache_.back().first);
+            cache_.pop_back();
+        }
+    }
+
+    return message;
+}
+
+void MessageStore::dropOldestSegment() {
+    Segment& segment = segments_.front();
+
+    for (const auto& message_id : segment.message_ids) {
+        auto it = messages_.find(message_id);
+        if (it != messages_.end() && it->second.location.segment == segment.id) {
+            if (!(it->second.flags & STATUS_DELIVERED)) {
+                undelivered_count_--;
+            }
+            messages_.erase(it);
+        }
+    }
+
+    for (auto it = cache_.begin(); it != cache_.end();) {
+        if ((it->first >> 32) == segment.id) {
+            cache_index_.erase(it->first);
+            it = cache_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (segment.fd >= 0) {
+        ::close(segment.fd);
+        ::unlink(segmentPath(segment.id).c_str());
+    }
+
+    core::Logger::debug("Dropped message segment {} ({} messages)", segment.id, segment.message_ids.size());
+
+    segments_.pop_front();
+    retention_generation_++;
+    stats_.segments_dropped++;
+}
+
+std::string MessageStore::segmentPath(uint32_t id) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%08u.log", id);
+    return (std::filesystem::path(config_.directory) / name).string();
+}
+
+std::string MessageStore::conversationKey(const std::string& user1, const std::string& user2) {
+    // Same key regardless of direction
+    return user1 < user2 ? user1 + '\n' + user2 : user2 + '\n' + user1;
+}
+
+} // namespace fmus::enterprise
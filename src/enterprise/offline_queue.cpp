@@ -0,0 +1,216 @@
+#include "fmus/enterprise/offline_queue.hpp"
+#include "fmus/core/logger.hpp"
+#include <filesystem>
+#include <fstream>
+
+namespace fmus::enterprise {
+
+namespace {
+
+constexpr const char* spill_suffix = ".queue";
+
+// User names may contain anything; hex keeps the file names safe and reversible
+std::string hexEncode(const std::string& value) {
+    static const char hex[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(value.size() * 2);
+    for (unsigned char c : value) {
+        result += hex[c >> 4];
+        result += hex[c & 0x0F];
+    }
+    return result;
+}
+
+bool hexDecode(const std::string& value, std::string& result) {
+    if (value.size() % 2 != 0) {
+        return false;
+    }
+
+    auto digit = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+
+    result.clear();
+    for (size_t i = 0; i < value.size(); i += 2) {
+        int high = digit(value[i]);
+        int low = digit(value[i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        result += static_cast<char>((high << 4) | low);
+    }
+    return true;
+}
+
+} // namespace
+
+// OfflineMessageQueue implementation
+OfflineMessageQueue::OfflineMessageQueue() : total_depth_(0) {
+}
+
+OfflineMessageQueue::~OfflineMessageQueue() {
+}
+
+bool OfflineMessageQueue::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+
+    if (config_.spill_directory.empty()) {
+        return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(config_.spill_directory, ec);
+    if (ec) {
+        core::Logger::error("Failed to create offline queue directory {}: {}", config_.spill_directory, ec.message());
+        config_.spill_directory.clear();
+        return false;
+    }
+
+    // Queues spilled by a previous run drain on the user's next registration
+    for (const auto& entry : std::filesystem::directory_iterator(config_.spill_directory, ec)) {
+        std::string user_id;
+        if (entry.path().extension() != spill_suffix || !hexDecode(entry.path().stem().string(), user_id)) {
+            continue;
+        }
+
+        std::ifstream file(entry.path());
+        std::string line;
+        size_t count = 0;
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                count++;
+            }
+        }
+
+        UserQueue& queue = queues_[user_id];
+        if (queue.spilled == 0 && count > 0) {
+            queue.spilled = count;
+            total_depth_ += count;
+            core::Logger::info("Recovered {} queued messages for {}", count, user_id);
+        }
+    }
+
+    return true;
+}
+
+OfflineMessageQueue::Config OfflineMessageQueue::getConfig() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+bool OfflineMessageQueue::enqueue(const std::string& user_id, const std::string& message_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    UserQueue& queue = queues_[user_id];
+    size_t depth = queue.memory.size() + queue.spilled;
+    if (depth >= config_.max_queue_depth) {
+        dropped_++;
+        core::Logger::warn("Offline queue for {} is full ({} messages), not queueing {}", user_id, depth, message_id);
+        return false;
+    }
+
+    // Once anything is spilled, newer IDs follow it to the file to keep the order
+    if (queue.spilled == 0 && queue.memory.size() < config_.max_memory_depth) {
+        queue.memory.push_back(message_id);
+    } else if (!config_.spill_directory.empty() && appendToSpill(user_id, message_id)) {
+        queue.spilled++;
+        spilled_++;
+    } else {
+        dropped_++;
+        if (config_.spill_directory.empty()) {
+            core::Logger::warn("Offline queue for {} is full in memory and spilling is off, not queueing {}",
+                               user_id, message_id);
+        }
+        return false;
+    }
+
+    total_depth_++;
+    enqueued_++;
+    return true;
+}
+
+std::vector<std::string> OfflineMessageQueue::drain(const std::string& user_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<std::string> message_ids;
+    auto it = queues_.find(user_id);
+    if (it == queues_.end()) {
+        return message_ids;
+    }
+
+    UserQueue& queue = it->second;
+    message_ids.reserve(queue.memory.size() + queue.spilled);
+    message_ids.insert(message_ids.end(), std::make_move_iterator(queue.memory.begin()),
+                       std::make_move_iterator(queue.memory.end()));
+    if (queue.spilled > 0) {
+        readSpill(user_id, message_ids);
+    }
+
+    total_depth_ -= queue.memory.size() + queue.spilled;
+    drained_ += message_ids.size();
+    queues_.erase(it);
+    return message_ids;
+}
+
+size_t OfflineMessageQueue::getDepth(const std::string& user_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = queues_.find(user_id);
+    return it != queues_.end() ? it->second.memory.size() + it->second.spilled : 0;
+}
+
+size_t OfflineMessageQueue::getTotalDepth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_depth_;
+}
+
+OfflineMessageQueue::Stats OfflineMessageQueue::getStats() const {
+    Stats stats;
+    stats.enqueued = enqueued_;
+    stats.drained = drained_;
+    stats.spilled = spilled_;
+    stats.dropped = dropped_;
+    return stats;
+}
+
+void OfflineMessageQueue::resetStats() {
+    enqueued_ = 0;
+    drained_ = 0;
+    spilled_ = 0;
+    dropped_ = 0;
+}
+
+std::string OfflineMessageQueue::spillPath(const std::string& user_id) const {
+    return (std::filesystem::path(config_.spill_directory) / (hexEncode(user_id) + spill_suffix)).string();
+}
+
+bool OfflineMessageQueue::appendToSpill(const std::string& user_id, const std::string& message_id) {
+    std::ofstream file(spillPath(user_id), std::ios::app);
+    file << message_id << '\n';
+    if (!file) {
+        core::Logger::error("Failed to spill queued message {} for {}", message_id, user_id);
+        return false;
+    }
+    return true;
+}
+
+void OfflineMessageQueue::readSpill(const std::string& user_id, std::vector<std::string>& message_ids) {
+    std::string path = spillPath(user_id);
+
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            message_ids.push_back(std::move(line));
+        }
+    }
+    file.close();
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+} // namespace fmus::enterprise
@@ -0,0 +1,808 @@
+#include "fmus/enterprise/recording.hpp"
+#include "fmus/network/uring.hpp"
+#include "fmus/core/logger.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdlib>
+#include <cstring>
+
+namespace fmus::enterprise {
+
+namespace {
+
+// O_DIRECT needs buffer, offset and length aligned to the logical block size
+constexpr size_t IO_ALIGNMENT = 4096;
+constexpr size_t WAV_HEADER_SIZE = 44;
+
+// Sidecar index: magic, then fixed-size little-endian entries
+constexpr char INDEX_MAGIC[8] = {'F', 'M', 'R', 'I', 'D', 'X', '0', '1'};
+constexpr size_t INDEX_ENTRY_SIZE = 32;
+
+void putLe16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void putLe32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void putBe16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+void putBe32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * (3 - i)));
+    }
+}
+
+void putLe64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t getLe32(const uint8_t* in) {
+    return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+           (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+uint64_t getLe64(const uint8_t* in) {
+    return static_cast<uint64_t>(getLe32(in)) | (static_cast<uint64_t>(getLe32(in + 4)) << 32);
+}
+
+int64_t toMillis(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+bool pwriteAll(int fd, const uint8_t* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+RecordingFormat recordingFormatForPath(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".rtp" || extension == ".rtpdump") {
+        return RecordingFormat::RTPDUMP;
+    }
+    return RecordingFormat::WAV;
+}
+
+std::string recordingIndexPath(const std::string& recording_path) {
+    return recording_path + ".idx";
+}
+
+bool readRecordingHeader(const std::string& recording_path, uint64_t data_size, std::string& header,
+                         uint64_t& header_size) {
+    int fd = ::open(recording_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    uint8_t buffer[256];
+    ssize_t length = ::pread(fd, buffer, sizeof(buffer), 0);
+    ::close(fd);
+    if (length <= 0) {
+        return false;
+    }
+
+    if (recordingFormatForPath(recording_path) == RecordingFormat::WAV) {
+        if (length < static_cast<ssize_t>(WAV_HEADER_SIZE) || memcmp(buffer, "RIFF", 4) != 0) {
+            return false;
+        }
+        uint32_t size = static_cast<uint32_t>(std::min<uint64_t>(data_size, UINT32_MAX - 36));
+        putLe32(buffer + 4, size + 36);
+        putLe32(buffer + 40, size);
+        header_size = WAV_HEADER_SIZE;
+    } else {
+        // Text line followed by the binary start time and source
+        auto newline = static_cast<const uint8_t*>(memchr(buffer, '\n', length));
+        if (!newline || newline - buffer + 1 + 16 > length) {
+            return false;
+        }
+        header_size = static_cast<uint64_t>(newline - buffer) + 1 + 16;
+    }
+
+    header.assign(reinterpret_cast<const char*>(buffer), header_size);
+    return true;
+}
+
+// RecordingIndex implementation
+bool RecordingIndex::load(const std::string& recording_path) {
+    entries_.clear();
+
+    std::error_code ec;
+    file_size_ = std::filesystem::file_size(recording_path, ec);
+    if (ec) {
+        return false;
+    }
+
+    int fd = ::open(recordingIndexPath(recording_path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[64 * 1024];
+    ssize_t length;
+    while ((length = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        data.insert(data.end(), buffer, buffer + length);
+    }
+    ::close(fd);
+
+    if (data.size() < sizeof(INDEX_MAGIC) || memcmp(data.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        return false;
+    }
+
+    // A torn last entry from an interrupted recording is ignored
+    for (size_t pos = sizeof(INDEX_MAGIC); pos + INDEX_ENTRY_SIZE <= data.size(); pos += INDEX_ENTRY_SIZE) {
+        RecordingIndexEntry entry;
+        entry.type = getLe32(&data[pos]);
+        entry.media_ms = getLe64(&data[pos + 8]);
+        entry.wall_ms = getLe64(&data[pos + 16]);
+        entry.offset = getLe64(&data[pos + 24]);
+        entries_.push_back(entry);
+    }
+
+    return true;
+}
+
+uint64_t RecordingIndex::getDurationMs() const {
+    return entries_.empty() ? 0 : entries_.back().media_ms;
+}
+
+std::vector<RecordingIndex::Pause> RecordingIndex::getPauses() const {
+    std::vector<Pause> pauses;
+    bool paused = false;
+
+    for (const auto& entry : entries_) {
+        if (entry.type == RecordingIndexEntry::PAUSE && !paused) {
+            pauses.push_back({entry.media_ms, entry.wall_ms, entry.wall_ms});
+            paused = true;
+        } else if ((entry.type == RecordingIndexEntry::RESUME || entry.type == RecordingIndexEntry::END) && paused) {
+            pauses.back().wall_end_ms = entry.wall_ms;
+            paused = false;
+        }
+    }
+
+    return pauses;
+}
+
+bool RecordingIndex::findRange(uint64_t from_ms, uint64_t until_ms, uint64_t& begin, uint64_t& end) const {
+    if (entries_.empty() || until_ms <= from_ms) {
+        return false;
+    }
+
+    // Every entry sits on a record boundary and media time never decreases
+    auto first = std::upper_bound(entries_.begin(), entries_.end(), from_ms,
+        [](uint64_t ms, const RecordingIndexEntry& entry) { return ms < entry.media_ms; });
+    begin = (first == entries_.begin()) ? first->offset : std::prev(first)->offset;
+
+    auto last = std::lower_bound(entries_.begin(), entries_.end(), until_ms,
+        [](const RecordingIndexEntry& entry, uint64_t ms) { return entry.media_ms < ms; });
+    end = (last == entries_.end()) ? file_size_ : last->offset;
+
+    // Entries of a recording in progress can point past what is on disk yet
+    end = std::min(end, file_size_);
+    return begin < end;
+}
+
+// RecordingStream implementation
+RecordingStream::RecordingStream(RecordingWriter& writer, const std::string& path, RecordingFormat format,
+                                 int fd, int index_fd, bool direct_io, size_t page_size, size_t worker,
+                                 uint32_t sample_rate, std::chrono::milliseconds index_interval)
+    : writer_(writer), path_(path), format_(format), fd_(fd), index_fd_(index_fd), direct_io_(direct_io),
+      page_size_(page_size), worker_(worker), sample_rate_(sample_rate), pages_{nullptr, nullptr},
+      buffer_index_{-1, -1}, used_{0, 0}, active_(0), file_offset_(0), index_interval_(index_interval), next_index_ms_(0),
+      header_written_(false), start_time_(std::chrono::steady_clock::now()), paused_total_(0),
+      paused_(false), closed_(false) {
+    in_flight_[0] = false;
+    in_flight_[1] = false;
+}
+
+RecordingStream::~RecordingStream() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    if (index_fd_ >= 0) {
+        ::close(index_fd_);
+    }
+    for (int index : buffer_index_) {
+        if (index >= 0) {
+            network::IoUring::shared().unregisterBuffer(index);
+        }
+    }
+    free(pages_[0]);
+    free(pages_[1]);
+}
+
+bool RecordingStream::writeAudio(const int16_t* samples, size_t count) {
+    if (format_ != RecordingFormat::WAV) {
+        return false;
+    }
+
+    // WAV is little-endian, like every host this runs on
+    return append(nullptr, 0, reinterpret_cast<const uint8_t*>(samples), count * sizeof(int16_t));
+}
+
+bool RecordingStream::writeRtp(const uint8_t* packet, size_t size) {
+    if (format_ != RecordingFormat::RTPDUMP || size + 8 > UINT16_MAX) {
+        return false;
+    }
+
+    // rtpdump packet header: total length, RTP length, milliseconds since start
+    auto offset = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time_).count();
+    uint8_t header[8];
+    putBe16(header, static_cast<uint16_t>(size + 8));
+    putBe16(header + 2, static_cast<uint16_t>(size));
+    putBe32(header + 4, static_cast<uint32_t>(offset));
+
+    return append(header, sizeof(header), packet, size);
+}
+
+void RecordingStream::pause() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (closed_ || paused_) {
+        return;
+    }
+
+    pause_start_ = std::chrono::steady_clock::now();
+    paused_ = true;
+    addIndexEntry(RecordingIndexEntry::PAUSE, pause_start_);
+}
+
+void RecordingStream::resume() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (closed_ || !paused_) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    paused_total_ += now - pause_start_;
+    paused_ = false;
+    addIndexEntry(RecordingIndexEntry::RESUME, now);
+}
+
+uint64_t RecordingStream::mediaTimeMs(std::chrono::steady_clock::time_point now) const {
+    if (format_ == RecordingFormat::WAV) {
+        // Exact from the sample count
+        uint64_t recorded = bytes_recorded_.load(std::memory_order_relaxed);
+        uint64_t data = recorded > WAV_HEADER_SIZE ? recorded - WAV_HEADER_SIZE : 0;
+        return data * 1000 / (2 * static_cast<uint64_t>(sample_rate_));
+    }
+
+    auto elapsed = now - start_time_ - paused_total_;
+    if (paused_) {
+        elapsed -= now - pause_start_;
+    }
+    return static_cast<uint64_t>(std::max<int64_t>(0, toMillis(elapsed)));
+}
+
+void RecordingStream::addIndexEntry(uint32_t type, std::chrono::steady_clock::time_point now) {
+    if (!header_written_ || index_fd_ < 0) {
+        return;
+    }
+
+    RecordingIndexEntry entry;
+    entry.type = type;
+    entry.media_ms = mediaTimeMs(now);
+    entry.wall_ms = static_cast<uint64_t>(toMillis(now - start_time_));
+    entry.offset = bytes_recorded_.load(std::memory_order_relaxed);
+    pending_index_.push_back(entry);
+}
+
+bool RecordingStream::append(const uint8_t* prefix, size_t prefix_size, const uint8_t* data, size_t size) {
+    size_t total = prefix_size + size;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (closed_ || paused_) {
+        return false;
+    }
+
+    // A record that fills the active page needs the other page back from the
+    // I/O thread, and must fit in it without filling it too
+    size_t space = page_size_ - used_[active_];
+    if (total >= space && (in_flight_[active_ ^ 1].load(std::memory_order_acquire) ||
+                           total - space >= page_size_)) {
+        bytes_dropped_ += total;
+        return false;
+    }
+
+    // Index the record about to be copied once per interval
+    if (header_written_ && index_fd_ >= 0) {
+        auto now = std::chrono::steady_clock::now();
+        uint64_t media_ms = mediaTimeMs(now);
+        if (media_ms >= next_index_ms_) {
+            addIndexEntry(RecordingIndexEntry::CHUNK, now);
+            next_index_ms_ = media_ms + static_cast<uint64_t>(index_interval_.count());
+        }
+    }
+
+    auto copy = [this](const uint8_t* source, size_t length) {
+        while (length > 0) {
+            size_t count = std::min(length, page_size_ - used_[active_]);
+            memcpy(pages_[active_] + used_[active_], source, count);
+            used_[active_] += count;
+            source += count;
+            length -= count;
+
+            if (used_[active_] == page_size_) {
+                int full = active_;
+                in_flight_[full].store(true, std::memory_order_release);
+                active_ ^= 1;
+                used_[active_] = 0;
+                writer_.submit({shared_from_this(), full, page_size_, false, std::move(pending_index_)}, worker_);
+                pending_index_.clear();
+            }
+        }
+    };
+
+    copy(prefix, prefix_size);
+    copy(data, size);
+
+    bytes_recorded_ += total;
+    return true;
+}
+
+void RecordingStream::writeFileHeader() {
+    if (format_ == RecordingFormat::WAV) {
+        // Sizes are patched when the recording is closed
+        uint8_t header[WAV_HEADER_SIZE] = {};
+        memcpy(header, "RIFF", 4);
+        putLe32(header + 4, 36);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        putLe32(header + 16, 16);
+        putLe16(header + 20, 1);               // PCM
+        putLe16(header + 22, 1);               // Mono
+        putLe32(header + 24, sample_rate_);
+        putLe32(header + 28, sample_rate_ * 2); // Byte rate
+        putLe16(header + 32, 2);               // Block align
+        putLe16(header + 34, 16);              // Bits per sample
+        memcpy(header + 36, "data", 4);
+        putLe32(header + 40, 0);
+        append(header, sizeof(header), nullptr, 0);
+        header_written_ = true;
+        return;
+    }
+
+    // rtptools file header: text line, then start time, source address and port
+    static const char magic[] = "#!rtpplay1.0 0.0.0.0/0\n";
+    auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch - seconds);
+
+    uint8_t header[16] = {};
+    putBe32(header, static_cast<uint32_t>(seconds.count()));
+    putBe32(header + 4, static_cast<uint32_t>(micros.count()));
+    append(reinterpret_cast<const uint8_t*>(magic), sizeof(magic) - 1, header, sizeof(header));
+    header_written_ = true;
+}
+
+// RecordingWriter implementation
+RecordingWriter::RecordingWriter() : running_(false) {
+}
+
+RecordingWriter::~RecordingWriter() {
+    stop();
+}
+
+void RecordingWriter::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    config_.page_size = std::max<size_t>(IO_ALIGNMENT,
+        (config.page_size + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT);
+}
+
+bool RecordingWriter::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (running_) {
+        return true;
+    }
+
+    if (workers_.empty()) {
+        size_t count = std::max<size_t>(1, config_.io_threads);
+        for (size_t i = 0; i < count; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+    }
+
+    use_ring_ = network::Socket::getIoBackend() == network::IoBackend::IO_URING &&
+                network::IoUring::shared().isRunning();
+
+    running_ = true;
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&RecordingWriter::workerLoop, this, std::ref(*worker));
+    }
+
+    core::Logger::info("Recording writer started with {} I/O threads{}", workers_.size(),
+                      use_ring_ ? " on io_uring" : "");
+    return true;
+}
+
+void RecordingWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+
+    // Workers drain their queues before exiting; later pages are written inline
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->cv.notify_all();
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    core::Logger::info("Recording writer stopped");
+}
+
+std::shared_ptr<RecordingStream> RecordingWriter::open(const std::string& path, RecordingFormat format) {
+    Config config;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config = config_;
+    }
+
+    std::error_code ec;
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, ec);
+    }
+
+    // Filesystems without O_DIRECT support (tmpfs, some overlays) reject it at open
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    bool direct_io = config.direct_io;
+    int fd = direct_io ? ::open(path.c_str(), flags | O_DIRECT, 0644) : -1;
+    if (fd < 0) {
+        direct_io = false;
+        fd = ::open(path.c_str(), flags, 0644);
+    }
+    if (fd < 0) {
+        core::Logger::error("Failed to open recording file {}: {}", path, strerror(errno));
+        return nullptr;
+    }
+
+    // The index is small and appended with ordinary writes
+    int index_fd = ::open(recordingIndexPath(path).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (index_fd >= 0 && ::write(index_fd, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != sizeof(INDEX_MAGIC)) {
+        ::close(index_fd);
+        index_fd = -1;
+    }
+    if (index_fd < 0) {
+        core::Logger::warn("Recording {} has no time index: {}", path, strerror(errno));
+    }
+
+    size_t worker = workers_.empty() ? 0 : next_worker_++ % workers_.size();
+    std::shared_ptr<RecordingStream> stream(
+        new RecordingStream(*this, path, format, fd, index_fd, direct_io, config.page_size, worker,
+                            config.sample_rate, config.index_interval));
+
+    for (auto& page : stream->pages_) {
+        void* memory = nullptr;
+        if (posix_memalign(&memory, IO_ALIGNMENT, config.page_size) != 0) {
+            core::Logger::error("Failed to allocate recording pages for {}", path);
+            ::unlink(path.c_str());
+            return nullptr;
+        }
+        page = static_cast<uint8_t*>(memory);
+    }
+
+    // Pinned pages skip the per-write page lookup; streams past the
+    // registered table or RLIMIT_MEMLOCK use plain ring writes
+    if (use_ring_) {
+        for (int i = 0; i < 2; ++i) {
+            stream->buffer_index_[i] = network::IoUring::shared().registerBuffer(stream->pages_[i], config.page_size);
+        }
+    }
+
+    stream->writeFileHeader();
+
+    streams_opened_++;
+    if (direct_io) {
+        direct_io_streams_++;
+    }
+
+    core::Logger::debug("Opened recording {} ({})", path, direct_io ? "direct I/O" : "buffered");
+    return stream;
+}
+
+void RecordingWriter::close(const std::shared_ptr<RecordingStream>& stream) {
+    if (!stream) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(stream->mutex_);
+
+    if (stream->closed_.exchange(true)) {
+        return;
+    }
+
+    if (stream->paused_) {
+        stream->paused_total_ += std::chrono::steady_clock::now() - stream->pause_start_;
+        stream->paused_ = false;
+    }
+    stream->addIndexEntry(RecordingIndexEntry::END, std::chrono::steady_clock::now());
+
+    int page = stream->active_;
+    stream->in_flight_[page] = true;
+    submit({stream, page, stream->used_[page], true, std::move(stream->pending_index_)}, stream->worker_);
+    stream->pending_index_.clear();
+}
+
+RecordingWriter::Stats RecordingWriter::getStats() const {
+    Stats stats;
+    stats.streams_opened = streams_opened_;
+    stats.streams_closed = streams_closed_;
+    stats.direct_io_streams = direct_io_streams_;
+    stats.pages_written = pages_written_;
+    stats.bytes_written = bytes_written_;
+    stats.write_errors = write_errors_;
+    return stats;
+}
+
+void RecordingWriter::resetStats() {
+    streams_opened_ = 0;
+    streams_closed_ = 0;
+    direct_io_streams_ = 0;
+    pages_written_ = 0;
+    bytes_written_ = 0;
+    write_errors_ = 0;
+}
+
+void RecordingWriter::submit(WriteRequest request, size_t worker_index) {
+    if (running_ && !workers_.empty()) {
+        Worker& worker = *workers_[worker_index % workers_.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (running_) {
+            worker.queue.push_back(std::move(request));
+            worker.cv.notify_one();
+            return;
+        }
+    }
+
+    // No I/O thread, write from the caller
+    process(request);
+}
+
+void RecordingWriter::workerLoop(Worker& worker) {
+    std::deque<WriteRequest> batch;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [&] { return !worker.queue.empty() || !running_; });
+            if (worker.queue.empty()) {
+                break;
+            }
+            batch.swap(worker.queue);
+        }
+
+        if (use_ring_) {
+            processOnRing(batch);
+        } else {
+            for (const auto& request : batch) {
+                process(request);
+            }
+        }
+        batch.clear();
+    }
+}
+
+void RecordingWriter::process(const WriteRequest& request) {
+    writePage(*request.stream, request.page, request.size);
+    if (!request.index.empty()) {
+        writeIndex(*request.stream, request.index);
+    }
+    if (request.finish) {
+        finishStream(*request.stream);
+    }
+}
+
+void RecordingWriter::processOnRing(const std::deque<WriteRequest>& batch) {
+    // Every page in the batch goes out with one submission. A stream's pages
+    // are planned back to back from its current offset, and a page is handed
+    // back to its stream as soon as its own write has landed.
+    std::vector<network::IoUring::FileWrite> writes;
+    std::vector<uint64_t> offsets(batch.size(), 0);
+    std::vector<int> slots(batch.size(), -1);
+    std::vector<std::pair<RecordingStream*, uint64_t>> ends;
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        RecordingStream& stream = *batch[i].stream;
+        auto end = std::find_if(ends.begin(), ends.end(), [&](const auto& entry) { return entry.first == &stream; });
+        if (end == ends.end()) {
+            end = ends.insert(ends.end(), {&stream, stream.file_offset_});
+        }
+        offsets[i] = end->second;
+        if (stream.fd_ < 0 || batch[i].size == 0) {
+            continue;
+        }
+        end->second += batch[i].size;
+
+        size_t length = batch[i].size;
+        if (stream.direct_io_) {
+            length = (length + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT;
+            memset(stream.pages_[batch[i].page] + batch[i].size, 0, length - batch[i].size);
+        }
+
+        std::atomic<bool>* in_flight = &stream.in_flight_[batch[i].page];
+        slots[i] = static_cast<int>(writes.size());
+        writes.push_back({stream.fd_, stream.pages_[batch[i].page], length, offsets[i],
+                          stream.buffer_index_[batch[i].page], [in_flight, length](int result) {
+                              if (result == static_cast<int>(length)) {
+                                  in_flight->store(false, std::memory_order_release);
+                              }
+                          }});
+    }
+
+    std::vector<int> results(writes.size(), -EIO);
+    if (!network::IoUring::shared().writeFiles(writes.data(), writes.size(), results.data())) {
+        std::fill(results.begin(), results.end(), -ECANCELED);
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const WriteRequest& request = batch[i];
+        RecordingStream& stream = *request.stream;
+
+        // A page that failed before this one leaves a gap rather than
+        // shifting what was already written behind it
+        stream.file_offset_ = offsets[i];
+
+        int slot = slots[i];
+        if (slot >= 0 && results[slot] == static_cast<int>(writes[slot].size)) {
+            stream.file_offset_ += request.size;
+            pages_written_++;
+            bytes_written_ += request.size;
+        } else {
+            // Short, failed or refused for O_DIRECT: the page is still
+            // ours, redo it with the synchronous path
+            writePage(stream, request.page, request.size);
+        }
+
+        if (!request.index.empty()) {
+            writeIndex(stream, request.index);
+        }
+        if (request.finish) {
+            finishStream(stream);
+        }
+    }
+}
+
+void RecordingWriter::writePage(RecordingStream& stream, int page, size_t size) {
+    if (stream.fd_ >= 0 && size > 0) {
+        // Direct writes go out in whole aligned blocks; a padded tail is
+        // truncated away when the file is finished
+        size_t length = size;
+        if (stream.direct_io_) {
+            length = (size + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT;
+            memset(stream.pages_[page] + size, 0, length - size);
+        }
+
+        bool ok = pwriteAll(stream.fd_, stream.pages_[page], length, stream.file_offset_);
+        if (!ok && errno == EINVAL && stream.direct_io_) {
+            // Accepted at open but not supported for writes, continue buffered
+            int flags = fcntl(stream.fd_, F_GETFL);
+            if (flags >= 0 && fcntl(stream.fd_, F_SETFL, flags & ~O_DIRECT) == 0) {
+                stream.direct_io_ = false;
+                direct_io_streams_--;
+                ok = pwriteAll(stream.fd_, stream.pages_[page], size, stream.file_offset_);
+            }
+        }
+
+        if (ok) {
+            stream.file_offset_ += size;
+            pages_written_++;
+            bytes_written_ += size;
+        } else {
+            write_errors_++;
+            core::Logger::error("Failed to write recording {}: {}", stream.path_, strerror(errno));
+        }
+    }
+
+    stream.in_flight_[page].store(false, std::memory_order_release);
+}
+
+void RecordingWriter::writeIndex(RecordingStream& stream, const std::vector<RecordingIndexEntry>& entries) {
+    if (stream.index_fd_ < 0) {
+        return;
+    }
+
+    std::vector<uint8_t> data(entries.size() * INDEX_ENTRY_SIZE, 0);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        uint8_t* out = &data[i * INDEX_ENTRY_SIZE];
+        putLe32(out, entries[i].type);
+        putLe64(out + 8, entries[i].media_ms);
+        putLe64(out + 16, entries[i].wall_ms);
+        putLe64(out + 24, entries[i].offset);
+    }
+
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = ::write(stream.index_fd_, data.data() + written, data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            write_errors_++;
+            return;
+        }
+        written += static_cast<size_t>(result);
+    }
+}
+
+void RecordingWriter::finishStream(RecordingStream& stream) {
+    if (stream.fd_ < 0) {
+        return;
+    }
+
+    // The header patch and truncation are unaligned, so drop O_DIRECT first
+    if (stream.direct_io_) {
+        int flags = fcntl(stream.fd_, F_GETFL);
+        if (flags >= 0) {
+            fcntl(stream.fd_, F_SETFL, flags & ~O_DIRECT);
+        }
+    }
+
+    if (ftruncate(stream.fd_, static_cast<off_t>(stream.file_offset_)) < 0) {
+        write_errors_++;
+    }
+
+    if (stream.format_ == RecordingFormat::WAV && stream.file_offset_ >= WAV_HEADER_SIZE) {
+        uint64_t data_size = std::min<uint64_t>(stream.file_offset_ - WAV_HEADER_SIZE, UINT32_MAX - 36);
+        uint8_t size[4];
+        putLe32(size, static_cast<uint32_t>(data_size + 36));
+        bool ok = pwriteAll(stream.fd_, size, 4, 4);
+        putLe32(size, static_cast<uint32_t>(data_size));
+        if (!ok || !pwriteAll(stream.fd_, size, 4, 40)) {
+            write_errors_++;
+        }
+    }
+
+    fdatasync(stream.fd_);
+    ::close(stream.fd_);
+    stream.fd_ = -1;
+
+    if (stream.index_fd_ >= 0) {
+        fdatasync(stream.index_fd_);
+        ::close(stream.index_fd_);
+        stream.index_fd_ = -1;
+    }
+
+    streams_closed_++;
+    core::Logger::debug("Finished recording {} ({} bytes, {} dropped)", stream.path_,
+                       stream.file_offset_, stream.bytes_dropped_.load());
+}
+
+} // namespace fmus::enterprise
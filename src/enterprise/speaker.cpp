@@ -0,0 +1,349 @@
+#include "fmus/enterprise/speaker.hpp"
+#include "fmus/rtp/extension.hpp"
+#include "fmus/core/logger.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace fmus::enterprise {
+
+namespace {
+
+// Window sizes: frames per block, blocks per medium window, medium windows
+// per long window
+constexpr int SHORT_FRAMES = 13;
+constexpr int MEDIUM_BLOCKS = 5;
+constexpr int LONG_WINDOWS = 10;
+
+// A block or medium window counts as active at these counts
+constexpr int SHORT_ACTIVE = 7;
+constexpr int MEDIUM_ACTIVE = 3;
+
+// Speech model per window: activity probability and the exponential prior
+// rate, and how far (natural log) a challenger must lead in each
+constexpr double SHORT_P = 0.5, SHORT_LAMBDA = 0.78, SHORT_MARGIN = 3.0;
+constexpr double MEDIUM_P = 0.5, MEDIUM_LAMBDA = 24.0, MEDIUM_MARGIN = 2.0;
+constexpr double LONG_P = 0.5, LONG_LAMBDA = 47.0, LONG_MARGIN = 0.0;
+constexpr double MIN_SCORE = 1e-10;
+
+constexpr uint8_t SILENCE = 127;
+
+// Log-likelihood that v active units out of n came from speech, floored so
+// ratios stay finite
+double activityScore(int v, int n, double p, double lambda) {
+    double score = std::lgamma(n + 1.0) - std::lgamma(v + 1.0) - std::lgamma(n - v + 1.0) +
+                   v * std::log(p) + (n - v) * std::log(1 - p) - std::log(lambda) + lambda * v;
+    return std::max(score, MIN_SCORE);
+}
+
+// Sliding count of set bits over the last n pushes, n <= 16
+struct ActivityWindow {
+    uint16_t bits = 0;
+    int count = 0;
+
+    void push(bool active, int n) {
+        count -= (bits >> (n - 1)) & 1;
+        bits = static_cast<uint16_t>(((bits << 1) | (active ? 1 : 0)) & ((1u << n) - 1));
+        count += active ? 1 : 0;
+    }
+};
+
+} // namespace
+
+struct DominantSpeakerDetector::Participant {
+    std::atomic<bool> active{false};
+    std::atomic<bool> muted{false};
+    std::atomic<uint8_t> audio_level_id{0};
+    std::atomic<uint8_t> frame_level{SILENCE}; // Loudest -dBov seen in the current frame
+    std::string user_id;
+
+    // Scoring state, under mutex_
+    ActivityWindow frames;
+    ActivityWindow blocks;
+    ActivityWindow windows;
+    int frame_in_block = 0;
+    double short_score = MIN_SCORE;
+    double medium_score = MIN_SCORE;
+    double long_score = MIN_SCORE;
+
+    void reset() {
+        frame_level = SILENCE;
+        frames = blocks = windows = {};
+        frame_in_block = 0;
+        short_score = medium_score = long_score = MIN_SCORE;
+    }
+
+    bool isSpeaking() const { return frames.count + blocks.count + windows.count > 0; }
+};
+
+DominantSpeakerDetector::DominantSpeakerDetector()
+    : DominantSpeakerDetector(Config{}) {
+}
+
+DominantSpeakerDetector::DominantSpeakerDetector(const Config& config)
+    : config_(config),
+      participants_(std::make_unique<Participant[]>(config.max_participants)),
+      next_decision_(Clock::now() + config.decision_interval) {
+    frame_end_ = (Clock::now() + config_.frame).time_since_epoch().count();
+}
+
+DominantSpeakerDetector::~DominantSpeakerDetector() {
+}
+
+int DominantSpeakerDetector::addParticipant(const std::string& user_id, uint8_t audio_level_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    int free_slot = -1;
+    for (size_t i = 0; i < config_.max_participants; ++i) {
+        Participant& participant = participants_[i];
+        if (participant.active && participant.user_id == user_id) {
+            participant.audio_level_id = audio_level_id;
+            return static_cast<int>(i);
+        }
+        if (!participant.active && free_slot < 0) {
+            free_slot = static_cast<int>(i);
+        }
+    }
+    if (free_slot < 0) {
+        core::Logger::warn("Speaker detection full, not tracking {}", user_id);
+        return -1;
+    }
+
+    Participant& participant = participants_[free_slot];
+    participant.reset();
+    participant.user_id = user_id;
+    participant.muted = false;
+    participant.audio_level_id = audio_level_id;
+    participant.active = true;
+    return free_slot;
+}
+
+void DominantSpeakerDetector::removeParticipant(const std::string& user_id) {
+    SpeakerCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < config_.max_participants; ++i) {
+            Participant& participant = participants_[i];
+            if (participant.active && participant.user_id == user_id) {
+                participant.active = false;
+                if (dominant_ == static_cast<int>(i)) {
+                    dominant_ = -1;
+                    speaker_changes_++;
+                    callback = speaker_callback_;
+                }
+                break;
+            }
+        }
+    }
+
+    if (callback) {
+        callback("");
+    }
+}
+
+int DominantSpeakerDetector::findParticipant(const std::string& user_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < config_.max_participants; ++i) {
+        if (participants_[i].active && participants_[i].user_id == user_id) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void DominantSpeakerDetector::setAudioLevelId(int slot, uint8_t audio_level_id) {
+    if (slot >= 0 && static_cast<size_t>(slot) < config_.max_participants) {
+        participants_[slot].audio_level_id = audio_level_id;
+    }
+}
+
+void DominantSpeakerDetector::setMuted(int slot, bool muted) {
+    if (slot >= 0 && static_cast<size_t>(slot) < config_.max_participants) {
+        participants_[slot].muted = muted;
+    }
+}
+
+bool DominantSpeakerDetector::onPacket(int slot, const uint8_t* packet, size_t size, Clock::time_point now) {
+    if (slot < 0 || static_cast<size_t>(slot) >= config_.max_participants) {
+        return false;
+    }
+    packets_.fetch_add(1, std::memory_order_relaxed);
+
+    Participant& participant = participants_[slot];
+    uint8_t id = participant.audio_level_id.load(std::memory_order_relaxed);
+    std::optional<rtp::RtpExtensionElement> element;
+    if (id != 0) {
+        element = rtp::RtpExtensionView::fromPacket(packet, size).find(id);
+    }
+    if (!element || element->size < 1) {
+        packets_without_level_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Finish earlier frames first so this level lands in the right one
+    if (now.time_since_epoch().count() >= frame_end_.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (lock.owns_lock()) {
+            advance(now);
+            auto speaker = decide(now);
+            SpeakerCallback callback = speaker_callback_;
+            lock.unlock();
+            if (callback && speaker) {
+                callback(*speaker);
+            }
+        }
+    }
+
+    uint8_t level = element->data[0] & 0x7F;
+    uint8_t loudest = participant.frame_level.load(std::memory_order_relaxed);
+    while (level < loudest &&
+           !participant.frame_level.compare_exchange_weak(loudest, level, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+void DominantSpeakerDetector::update(Clock::time_point now) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    advance(now);
+    auto speaker = decide(now);
+    SpeakerCallback callback = speaker_callback_;
+    lock.unlock();
+    if (callback && speaker) {
+        callback(*speaker);
+    }
+}
+
+void DominantSpeakerDetector::advance(Clock::time_point now) {
+    int64_t frame = std::chrono::duration_cast<Clock::duration>(config_.frame).count();
+    int64_t frame_end = frame_end_.load(std::memory_order_relaxed);
+    int64_t ticks = now.time_since_epoch().count();
+    if (ticks < frame_end) {
+        return;
+    }
+
+    // After a long gap every window is silent; rolling more frames changes nothing
+    int64_t elapsed = (ticks - frame_end) / frame + 1;
+    int64_t frames = std::min<int64_t>(elapsed, SHORT_FRAMES * MEDIUM_BLOCKS * LONG_WINDOWS);
+    for (int64_t i = 0; i < frames; ++i) {
+        rollFrame();
+    }
+    frame_end_.store(frame_end + elapsed * frame, std::memory_order_release);
+}
+
+void DominantSpeakerDetector::rollFrame() {
+    for (size_t i = 0; i < config_.max_participants; ++i) {
+        Participant& participant = participants_[i];
+        if (!participant.active) {
+            continue;
+        }
+
+        uint8_t level = participant.frame_level.exchange(SILENCE, std::memory_order_relaxed);
+        bool active = !participant.muted && level <= config_.activity_threshold;
+        participant.frames.push(active, SHORT_FRAMES);
+        participant.short_score = activityScore(participant.frames.count, SHORT_FRAMES, SHORT_P, SHORT_LAMBDA);
+
+        if (++participant.frame_in_block == SHORT_FRAMES) {
+            participant.frame_in_block = 0;
+            participant.blocks.push(participant.frames.count >= SHORT_ACTIVE, MEDIUM_BLOCKS);
+            participant.windows.push(participant.blocks.count >= MEDIUM_ACTIVE, LONG_WINDOWS);
+            participant.medium_score = activityScore(participant.blocks.count, MEDIUM_BLOCKS, MEDIUM_P, MEDIUM_LAMBDA);
+            participant.long_score = activityScore(participant.windows.count, LONG_WINDOWS, LONG_P, LONG_LAMBDA);
+        }
+    }
+}
+
+std::optional<std::string> DominantSpeakerDetector::decide(Clock::time_point now) {
+    if (now < next_decision_) {
+        return std::nullopt;
+    }
+    next_decision_ = now + config_.decision_interval;
+    decisions_++;
+
+    int challenger = -1;
+    double best_lead = 0;
+    for (size_t i = 0; i < config_.max_participants; ++i) {
+        const Participant& participant = participants_[i];
+        if (!participant.active || participant.muted || static_cast<int>(i) == dominant_ ||
+            !participant.isSpeaking()) {
+            continue;
+        }
+
+        if (dominant_ < 0) {
+            // Nobody holds the floor: take whoever has spoken most
+            double lead = participant.long_score + participant.medium_score + participant.short_score;
+            if (challenger < 0 || lead > best_lead) {
+                challenger = static_cast<int>(i);
+                best_lead = lead;
+            }
+            continue;
+        }
+
+        const Participant& dominant = participants_[dominant_];
+        double short_lead = std::log(participant.short_score / dominant.short_score);
+        double medium_lead = std::log(participant.medium_score / dominant.medium_score);
+        double long_lead = std::log(participant.long_score / dominant.long_score);
+        if (short_lead > SHORT_MARGIN && medium_lead > MEDIUM_MARGIN && long_lead > LONG_MARGIN &&
+            (challenger < 0 || medium_lead > best_lead)) {
+            challenger = static_cast<int>(i);
+            best_lead = medium_lead;
+        }
+    }
+
+    if (challenger < 0) {
+        return std::nullopt;
+    }
+    dominant_ = challenger;
+    speaker_changes_++;
+    return participants_[challenger].user_id;
+}
+
+std::string DominantSpeakerDetector::getDominantSpeaker() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dominant_ >= 0 ? participants_[dominant_].user_id : std::string();
+}
+
+std::vector<std::string> DominantSpeakerDetector::getActiveSpeakers(size_t count) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<const Participant*> speaking;
+    for (size_t i = 0; i < config_.max_participants; ++i) {
+        const Participant& participant = participants_[i];
+        if (participant.active && !participant.muted && participant.isSpeaking()) {
+            speaking.push_back(&participant);
+        }
+    }
+
+    // Dominant speaker first, then by medium then short activity
+    const Participant* dominant = dominant_ >= 0 ? &participants_[dominant_] : nullptr;
+    std::sort(speaking.begin(), speaking.end(), [dominant](const Participant* a, const Participant* b) {
+        if ((a == dominant) != (b == dominant)) {
+            return a == dominant;
+        }
+        if (a->blocks.count != b->blocks.count) {
+            return a->blocks.count > b->blocks.count;
+        }
+        return a->frames.count > b->frames.count;
+    });
+
+    std::vector<std::string> result;
+    for (size_t i = 0; i < speaking.size() && i < count; ++i) {
+        result.push_back(speaking[i]->user_id);
+    }
+    return result;
+}
+
+void DominantSpeakerDetector::setSpeakerCallback(SpeakerCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    speaker_callback_ = std::move(callback);
+}
+
+DominantSpeakerDetector::Stats DominantSpeakerDetector::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.packets = packets_;
+    stats.packets_without_level = packets_without_level_;
+    stats.decisions = decisions_;
+    stats.speaker_changes = speaker_changes_;
+    return stats;
+}
+
+} // namespace fmus::enterprise
@@ -1,4 +1,5 @@
 #include "fmus/core/logger.hpp"
+#include "fmus/core/executor.hpp"
 #include "fmus/sip/message.hpp"
 #include "fmus/sip/sdp.hpp"
 #include "fmus/sip/registrar.hpp"
@@ -455,6 +456,36 @@ int main() {
                               static_cast<int>(parsed_frame.opcode), parsed_frame.payload.size());
         }
 
+        // Test incremental decoding of a fragmented, masked message
+        webrtc::WebSocketFrame first_fragment;
+        first_fragment.opcode = webrtc::WebSocketOpcode::TEXT;
+        first_fragment.fin = false;
+        first_fragment.masked = true;
+        first_fragment.mask = 0x37FA213D;
+        first_fragment.payload.assign(json_message.begin(), json_message.begin() + json_message.size() / 2);
+
+        webrtc::WebSocketFrame last_fragment = first_fragment;
+        last_fragment.opcode = webrtc::WebSocketOpcode::CONTINUATION;
+        last_fragment.fin = true;
+        last_fragment.payload.assign(json_message.begin() + json_message.size() / 2, json_message.end());
+
+        auto fragmented_data = first_fragment.serialize();
+        auto last_data = last_fragment.serialize();
+        fragmented_data.insert(fragmented_data.end(), last_data.begin(), last_data.end());
+
+        webrtc::WebSocketFrameDecoder frame_decoder;
+        frame_decoder.setFrameCallback([&json_message](const webrtc::WebSocketFrame& frame) {
+            std::string text(frame.payload.begin(), frame.payload.end());
+            core::Logger::info("Reassembled WebSocket message: {} bytes, matches={}",
+                              text.size(), text == json_message ? "yes" : "no");
+        });
+
+        // Feed a few bytes at a time, as a TCP stream would deliver them
+        for (size_t offset = 0; offset < fragmented_data.size(); offset += 7) {
+            frame_decoder.feed(fragmented_data.data() + offset,
+                               std::min<size_t>(7, fragmented_data.size() - offset));
+        }
+
         // Test signaling server
         webrtc::SignalingServer signaling_server;
 
@@ -518,12 +549,19 @@ int main() {
         core::Logger::info("Testing Enterprise Features functionality...");
 
         enterprise::EnterpriseManager enterprise_mgr;
+        enterprise_mgr.setOfflineQueueDirectory("/tmp/fmus_offline_queue");
         if (enterprise_mgr.initialize()) {
             core::Logger::info("Enterprise manager initialized successfully");
+            enterprise_mgr.attachRegistrar(reg_manager.getRegistrar());
 
             // Test Presence Management
             auto& presence_mgr = enterprise_mgr.getPresenceManager();
 
+            presence_mgr.setNotificationCallback([](const std::string& subscriber,
+                                                    const std::vector<enterprise::PresenceInfo>& updates) {
+                core::Logger::info("Presence notification to {}: {} update(s)", subscriber, updates.size());
+            });
+
             presence_mgr.updatePresence("alice", enterprise::PresenceState::ONLINE, "Available");
             presence_mgr.updatePresence("bob", enterprise::PresenceState::BUSY, "In a meeting");
             presence_mgr.updatePresence("charlie", enterprise::PresenceState::AWAY, "Out for lunch");
@@ -648,8 +686,13 @@ int main() {
         // Test Management API functionality
         core::Logger::info("Testing Management API functionality...");
 
+        // Shared executor for transport and API work
+        core::Executor executor;
+        executor.start();
+
         management::RestApiServer api_server;
         management::ManagementApi management_api(enterprise_mgr, reg_manager, signaling_server);
+        api_server.setExecutor(&executor);
 
         // Setup API routes
         management_api.setupRoutes(api_server);
@@ -695,6 +738,7 @@ int main() {
         // Test network transport
         core::Logger::info("Testing network transport functionality...");
         network::TransportManager transport_manager;
+        transport_manager.setExecutor(&executor);
 
         network::TransportManager::Config config;
         config.sip_udp_address = network::SocketAddress("127.0.0.1", 5060);
@@ -762,6 +806,16 @@ int main() {
             core::Logger::error("Failed to initialize network transport");
         }
 
+        auto overload_stats = transport_manager.getSipTransport().getOverloadController().getStats();
+        core::Logger::info("SIP overload control: {}, {} of {} new requests rejected",
+                          network::overloadStateToString(overload_stats.state), overload_stats.rejected,
+                          overload_stats.offered);
+
+        auto executor_stats = executor.getStats();
+        core::Logger::info("Executor: {} tasks on {} workers, {} stolen", executor_stats.executed,
+                          executor.getThreadCount(), executor_stats.stolen);
+        executor.stop();
+
         core::Logger::info("All tests completed successfully!");
         
     } catch (const std::exception& e) {
@@ -1,9 +1,15 @@
 #include "fmus/management/api.hpp"
 #include "fmus/core/logger.hpp"
+#include "fmus/core/sha1.hpp"
+#include "fmus/core/base64.hpp"
+#include <filesystem>
+#include <charconv>
 #include <sstream>
 #include <regex>
 #include <algorithm>
 #include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace fmus::management {
 
@@ -99,6 +105,14 @@ void HttpResponse::setPlainText(const std::string& text) {
     body = text;
 }
 
+void HttpResponse::setFile(const std::string& path, uint64_t offset, uint64_t length,
+                           const std::string& content_type) {
+    headers["Content-Type"] = content_type;
+    file_path = path;
+    file_offset = offset;
+    file_length = length;
+}
+
 void HttpResponse::setCors() {
     headers["Access-Control-Allow-Origin"] = "*";
     headers["Access-Control-Allow-Methods"] = "GET, POST, PUT, DELETE, OPTIONS";
@@ -117,7 +131,7 @@ std::string HttpResponse::toString() const {
     }
     
     // Content-Length
-    response << "Content-Length: " << body.length() << "\r\n";
+    response << "Content-Length: " << body.length() + file_length << "\r\n";
     
     // Empty line
     response << "\r\n";
@@ -178,6 +192,9 @@ RestApiServer::RestApiServer() : running_(false), cors_enabled_(false) {
 
 RestApiServer::~RestApiServer() {
     stop();
+    while (pending_tasks_ > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
 }
 
 bool RestApiServer::start(const network::SocketAddress& bind_address) {
@@ -264,7 +281,21 @@ void RestApiServer::onNewConnection(std::shared_ptr<network::Socket> connection)
     
     tcp_connection->setDataCallback([this, tcp_connection](const std::vector<uint8_t>& data, const network::SocketAddress& from) {
         std::string request(data.begin(), data.end());
-        handleRequest(request, tcp_connection);
+        
+        core::Executor* executor = executor_;
+        if (!executor) {
+            handleRequest(request, tcp_connection);
+            return;
+        }
+        
+        pending_tasks_++;
+        core::Executor::Task task = [this, request = std::move(request), tcp_connection]() {
+            handleRequest(request, tcp_connection);
+            pending_tasks_--;
+        };
+        if (!executor->post(std::move(task), core::TaskPriority::MANAGEMENT)) {
+            task();
+        }
     });
     
     tcp_connection->startReceiving();
@@ -278,7 +309,21 @@ void RestApiServer::handleRequest(const std::string& raw_request, std::shared_pt
         std::string response_str = response.toString();
         std::vector<uint8_t> response_data(response_str.begin(), response_str.end());
         
-        connection->send(response_data);
+        // File bodies go straight from the page cache to the socket
+        int file_fd = -1;
+        if (!response.file_path.empty()) {
+            file_fd = ::open(response.file_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file_fd < 0) {
+                throw std::runtime_error("Failed to open " + response.file_path);
+            }
+        }
+        
+        if (connection->send(response_data) && file_fd >= 0) {
+            connection->sendFile(file_fd, response.file_offset, response.file_length);
+        }
+        if (file_fd >= 0) {
+            ::close(file_fd);
+        }
         connection->close(); // HTTP/1.0 style - close after response
         
     } catch (const std::exception& e) {
@@ -346,6 +391,91 @@ HttpResponse RestApiServer::handleError(const std::exception& e) {
     return response;
 }
 
+// AuthMiddleware implementation
+AuthMiddleware::AuthMiddleware(const std::string& secret_key) : secret_key_(secret_key) {
+}
+
+bool AuthMiddleware::authenticate(HttpRequest& request, HttpResponse& response) {
+    // CORS preflight requests carry no credentials
+    if (request.method == HttpMethod::OPTIONS) {
+        return true;
+    }
+
+    std::string authorization = request.getHeader("Authorization");
+    if (authorization.empty()) {
+        authorization = request.getHeader("authorization");
+    }
+
+    if (authorization.compare(0, 6, "Basic ") == 0) {
+        std::vector<uint8_t> decoded;
+        if (core::base64Decode(std::string_view(authorization).substr(6), decoded)) {
+            std::string credentials(decoded.begin(), decoded.end());
+            size_t colon_pos = credentials.find(':');
+            if (colon_pos != std::string::npos &&
+                constantTimeEquals(credentials.substr(colon_pos + 1), secret_key_)) {
+                request.headers["X-Authenticated-User"] = credentials.substr(0, colon_pos);
+                return true;
+            }
+        }
+    } else if (authorization.compare(0, 7, "Bearer ") == 0) {
+        if (validateToken(authorization.substr(7))) {
+            return true;
+        }
+    }
+
+    response.status = HttpStatus::UNAUTHORIZED;
+    response.headers["WWW-Authenticate"] = "Basic realm=\"fmus-3g\"";
+    response.setJson(R"({"error": "Unauthorized", "message": "Valid credentials are required"})");
+    return false;
+}
+
+std::string AuthMiddleware::generateToken(const std::string& username) const {
+    static std::atomic<uint64_t> counter{0};
+
+    auto now = std::chrono::system_clock::now();
+
+    core::Sha1 sha1;
+    sha1.update(username);
+    sha1.update(secret_key_);
+    sha1.update(std::to_string(now.time_since_epoch().count()));
+    sha1.update(std::to_string(counter++));
+    auto digest = sha1.finalize();
+
+    std::ostringstream token;
+    for (uint8_t byte : digest) {
+        token << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Drop expired tokens while we hold the lock
+    for (auto it = active_tokens_.begin(); it != active_tokens_.end();) {
+        it = (it->second <= now) ? active_tokens_.erase(it) : std::next(it);
+    }
+
+    active_tokens_[token.str()] = now + std::chrono::hours(1);
+    return token.str();
+}
+
+bool AuthMiddleware::validateToken(const std::string& token) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = active_tokens_.find(token);
+    return it != active_tokens_.end() && it->second > std::chrono::system_clock::now();
+}
+
+bool AuthMiddleware::constantTimeEquals(const std::string& a, const std::string& b) {
+    // Only the length may leak, not the position of the first mismatch
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff |= static_cast<uint8_t>(a[i]) ^ static_cast<uint8_t>(b[i]);
+    }
+    return diff == 0;
+}
+
 // ManagementApi implementation
 ManagementApi::ManagementApi(enterprise::EnterpriseManager& enterprise_mgr,
                             sip::RegistrationManager& reg_mgr,
@@ -394,6 +524,11 @@ void ManagementApi::setupRoutes(RestApiServer& server) {
     server.post("/api/messages", [this](const HttpRequest& req) { return sendMessage(req); });
     server.get("/api/conversations/{user1}/{user2}", [this](const HttpRequest& req) { return getConversation(req); });
 
+    // Recording endpoints. Read-only: recordings are started by the server,
+    // never from a client-supplied path.
+    server.get("/api/recordings", [this](const HttpRequest& req) { return getRecordings(req); });
+    server.get("/api/recordings/{id}/download", [this](const HttpRequest& req) { return downloadRecording(req); });
+
     core::Logger::info("Management API routes configured");
 }
 
@@ -712,12 +847,14 @@ std::string httpStatusToString(HttpStatus status) {
         case HttpStatus::OK: return "OK";
         case HttpStatus::CREATED: return "Created";
         case HttpStatus::NO_CONTENT: return "No Content";
+        case HttpStatus::PARTIAL_CONTENT: return "Partial Content";
         case HttpStatus::BAD_REQUEST: return "Bad Request";
         case HttpStatus::UNAUTHORIZED: return "Unauthorized";
         case HttpStatus::FORBIDDEN: return "Forbidden";
         case HttpStatus::NOT_FOUND: return "Not Found";
         case HttpStatus::METHOD_NOT_ALLOWED: return "Method Not Allowed";
         case HttpStatus::CONFLICT: return "Conflict";
+        case HttpStatus::RANGE_NOT_SATISFIABLE: return "Range Not Satisfiable";
         case HttpStatus::INTERNAL_SERVER_ERROR: return "Internal Server Error";
         case HttpStatus::NOT_IMPLEMENTED: return "Not Implemented";
         case HttpStatus::SERVICE_UNAVAILABLE: return "Service Unavailable";
@@ -970,12 +1107,28 @@ HttpResponse ManagementApi::leaveConference(const HttpRequest& request) {
     return response;
 }
 
+// Optional paging bounds, milliseconds since the epoch
+static std::chrono::system_clock::time_point parseTimestampParam(const std::string& value,
+                                                                 std::chrono::system_clock::time_point fallback) {
+    if (value.empty()) {
+        return fallback;
+    }
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(std::stoll(value))));
+}
+
+static int64_t timestampToMillis(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
 HttpResponse ManagementApi::getMessages(const HttpRequest& request) {
     std::string user_id = request.getQueryParam("user_id");
     size_t limit = request.getQueryParam("limit").empty() ? 50 : std::stoi(request.getQueryParam("limit"));
+    auto since = parseTimestampParam(request.getQueryParam("since"), std::chrono::system_clock::time_point::min());
+    auto before = parseTimestampParam(request.getQueryParam("before"), std::chrono::system_clock::time_point::max());
 
     if (!user_id.empty()) {
-        auto messages = enterprise_mgr_.getMessagingManager().getMessages(user_id, limit);
+        auto messages = enterprise_mgr_.getMessagingManager().getMessages(user_id, since, before, limit);
 
         std::ostringstream json;
         json << "{\"messages\": [";
@@ -988,6 +1141,7 @@ HttpResponse ManagementApi::getMessages(const HttpRequest& request) {
                  << R"("to": ")" << messages[i].to << R"(",)"
                  << R"("content": ")" << messages[i].content << R"(",)"
                  << R"("type": ")" << enterprise::messageTypeToString(messages[i].type) << R"(",)"
+                 << R"("timestamp": )" << timestampToMillis(messages[i].timestamp) << ","
                  << R"("delivered": )" << (messages[i].delivered ? "true" : "false") << ","
                  << R"("read": )" << (messages[i].read ? "true" : "false")
                  << "}";
@@ -1035,8 +1189,10 @@ HttpResponse ManagementApi::getConversation(const HttpRequest& request) {
     std::string user1 = request.getPathParam("user1");
     std::string user2 = request.getPathParam("user2");
     size_t limit = request.getQueryParam("limit").empty() ? 50 : std::stoi(request.getQueryParam("limit"));
+    auto since = parseTimestampParam(request.getQueryParam("since"), std::chrono::system_clock::time_point::min());
+    auto before = parseTimestampParam(request.getQueryParam("before"), std::chrono::system_clock::time_point::max());
 
-    auto messages = enterprise_mgr_.getMessagingManager().getConversation(user1, user2, limit);
+    auto messages = enterprise_mgr_.getMessagingManager().getConversation(user1, user2, since, before, limit);
 
     std::ostringstream json;
     json << "{\"conversation\": [";
@@ -1048,7 +1204,8 @@ HttpResponse ManagementApi::getConversation(const HttpRequest& request) {
              << R"("from": ")" << messages[i].from << R"(",)"
              << R"("to": ")" << messages[i].to << R"(",)"
              << R"("content": ")" << messages[i].content << R"(",)"
-             << R"("type": ")" << enterprise::messageTypeToString(messages[i].type) << R"(")"
+             << R"("type": ")" << enterprise::messageTypeToString(messages[i].type) << R"(",)"
+             << R"("timestamp": )" << timestampToMillis(messages[i].timestamp)
              << "}";
     }
 
@@ -1059,4 +1216,172 @@ HttpResponse ManagementApi::getConversation(const HttpRequest& request) {
     return response;
 }
 
+HttpResponse ManagementApi::getRecordings(const HttpRequest& request) {
+    auto& recording_mgr = enterprise_mgr_.getRecordingManager();
+    auto call_ids = recording_mgr.getActiveRecordings();
+
+    std::ostringstream json;
+    json << "{\"recordings\": [";
+
+    for (size_t i = 0; i < call_ids.size(); ++i) {
+        std::string path = recording_mgr.getRecordingPath(call_ids[i]);
+        enterprise::RecordingIndex index;
+        index.load(path);
+
+        if (i > 0) json << ",";
+        json << "{"
+             << R"("call_id": ")" << call_ids[i] << R"(",)"
+             << R"("path": ")" << path << R"(",)"
+             << R"("duration_ms": )" << index.getDurationMs() << ","
+             << R"("size": )" << index.getFileSize() << ","
+             << R"("pauses": [)";
+
+        auto pauses = index.getPauses();
+        for (size_t j = 0; j < pauses.size(); ++j) {
+            if (j > 0) json << ",";
+            json << "{"
+                 << R"("at_ms": )" << pauses[j].media_ms << ","
+                 << R"("wall_start_ms": )" << pauses[j].wall_start_ms << ","
+                 << R"("wall_end_ms": )" << pauses[j].wall_end_ms
+                 << "}";
+        }
+
+        json << "]}";
+    }
+
+    json << "]}";
+
+    HttpResponse response;
+    response.setJson(json.str());
+    return response;
+}
+
+// Single "bytes=" range against a file of `size` bytes, as [begin, end)
+enum class ByteRange {
+    NONE,
+    VALID,
+    UNSATISFIABLE
+};
+
+static ByteRange parseByteRange(const std::string& value, uint64_t size, uint64_t& begin, uint64_t& end) {
+    // Multiple ranges are answered with the whole file
+    if (value.compare(0, 6, "bytes=") != 0 || value.find(',') != std::string::npos) {
+        return ByteRange::NONE;
+    }
+
+    std::string_view spec = std::string_view(value).substr(6);
+    size_t dash = spec.find('-');
+    if (dash == std::string_view::npos) {
+        return ByteRange::NONE;
+    }
+
+    auto parse = [](std::string_view text, uint64_t& number) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), number);
+        return !text.empty() && result.ec == std::errc() && result.ptr == text.data() + text.size();
+    };
+
+    uint64_t first = 0;
+    uint64_t last = 0;
+    std::string_view first_text = spec.substr(0, dash);
+    std::string_view last_text = spec.substr(dash + 1);
+
+    if (first_text.empty()) {
+        // Suffix range: the final N bytes
+        if (!parse(last_text, last)) {
+            return ByteRange::NONE;
+        }
+        if (last == 0 || size == 0) {
+            return ByteRange::UNSATISFIABLE;
+        }
+        begin = size - std::min(last, size);
+        end = size;
+        return ByteRange::VALID;
+    }
+
+    if (!parse(first_text, first) || (!last_text.empty() && (!parse(last_text, last) || last < first))) {
+        return ByteRange::NONE;
+    }
+    if (first >= size) {
+        return ByteRange::UNSATISFIABLE;
+    }
+
+    begin = first;
+    end = last_text.empty() ? size : std::min(last + 1, size);
+    return ByteRange::VALID;
+}
+
+HttpResponse ManagementApi::downloadRecording(const HttpRequest& request) {
+    std::string path = enterprise_mgr_.getRecordingManager().getRecordingPath(request.getPathParam("id"));
+
+    std::error_code ec;
+    uint64_t size = path.empty() ? 0 : std::filesystem::file_size(path, ec);
+    if (path.empty() || ec) {
+        HttpResponse response(HttpStatus::NOT_FOUND);
+        response.setJson(R"({"error": "Recording not found"})");
+        return response;
+    }
+
+    std::string content_type = enterprise::recordingFormatForPath(path) == enterprise::RecordingFormat::WAV
+        ? "audio/wav" : "application/octet-stream";
+
+    // Time range in recording milliseconds (pauses excluded), resolved through
+    // the sidecar index and served as a standalone file
+    std::string start = request.getQueryParam("start");
+    std::string end = request.getQueryParam("end");
+    if (!start.empty() || !end.empty()) {
+        enterprise::RecordingIndex index;
+        uint64_t from_ms = start.empty() ? 0 : std::stoull(start);
+        uint64_t until_ms = end.empty() ? UINT64_MAX : std::stoull(end);
+        uint64_t begin = 0;
+        uint64_t finish = 0;
+        std::string header;
+        uint64_t header_size = 0;
+
+        if (!index.load(path)) {
+            HttpResponse response(HttpStatus::NOT_FOUND);
+            response.setJson(R"({"error": "Recording has no time index"})");
+            return response;
+        }
+        if (!index.findRange(from_ms, until_ms, begin, finish) ||
+            !enterprise::readRecordingHeader(path, finish - begin, header, header_size)) {
+            HttpResponse response(HttpStatus::RANGE_NOT_SATISFIABLE);
+            response.setJson(R"({"error": "Time range not in recording"})");
+            return response;
+        }
+
+        HttpResponse response;
+        response.body = header;
+        response.setFile(path, begin, finish - begin, content_type);
+        return response;
+    }
+
+    std::string range = request.getHeader("Range");
+    if (range.empty()) {
+        range = request.getHeader("range");
+    }
+
+    HttpResponse response;
+    uint64_t begin = 0;
+    uint64_t finish = size;
+
+    switch (parseByteRange(range, size, begin, finish)) {
+        case ByteRange::UNSATISFIABLE:
+            response.status = HttpStatus::RANGE_NOT_SATISFIABLE;
+            response.headers["Content-Range"] = "bytes */" + std::to_string(size);
+            response.setJson(R"({"error": "Range not satisfiable"})");
+            return response;
+        case ByteRange::VALID:
+            response.status = HttpStatus::PARTIAL_CONTENT;
+            response.headers["Content-Range"] = "bytes " + std::to_string(begin) + "-" +
+                                                std::to_string(finish - 1) + "/" + std::to_string(size);
+            break;
+        case ByteRange::NONE:
+            break;
+    }
+
+    response.headers["Accept-Ranges"] = "bytes";
+    response.setFile(path, begin, finish - begin, content_type);
+    return response;
+}
+
 } // namespace fmus::management
@@ -0,0 +1,375 @@
+#include "fmus/network/outbound.hpp"
+#include "fmus/network/socket.hpp"
+#include "fmus/core/logger.hpp"
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+
+namespace fmus::network {
+
+SharedBuffer makeSharedBuffer(std::vector<uint8_t> data) {
+    return std::make_shared<const std::vector<uint8_t>>(std::move(data));
+}
+
+SharedBuffer makeSharedBuffer(const uint8_t* data, size_t size) {
+    return std::make_shared<const std::vector<uint8_t>>(data, data + size);
+}
+
+// OutboundQueue implementation
+OutboundQueue::OutboundQueue() {
+    Node* sentinel = new Node();
+    head_.store(sentinel);
+    tail_ = sentinel;
+}
+
+OutboundQueue::~OutboundQueue() {
+    clear();
+    delete tail_;
+}
+
+void OutboundQueue::push(SharedBuffer buffer) {
+    Node* node = new Node();
+    node->buffer = std::move(buffer);
+
+    Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+}
+
+const SharedBuffer* OutboundQueue::front() const {
+    Node* next = tail_->next.load(std::memory_order_acquire);
+    return next ? &next->buffer : nullptr;
+}
+
+size_t OutboundQueue::peek(const SharedBuffer** buffers, size_t max_count) const {
+    size_t count = 0;
+    Node* node = tail_->next.load(std::memory_order_acquire);
+    while (node && count < max_count) {
+        buffers[count++] = &node->buffer;
+        node = node->next.load(std::memory_order_acquire);
+    }
+    return count;
+}
+
+void OutboundQueue::pop() {
+    Node* next = tail_->next.load(std::memory_order_acquire);
+    if (!next) {
+        return;
+    }
+
+    delete tail_;
+    tail_ = next;
+    tail_->buffer.reset();
+}
+
+void OutboundQueue::clear() {
+    while (front()) {
+        pop();
+    }
+}
+
+// SocketWriter implementation
+SocketWriter::SocketWriter(size_t thread_count)
+    : thread_count_(thread_count > 0 ? thread_count : 1), epoll_fd_(-1), running_(false) {
+}
+
+SocketWriter::~SocketWriter() {
+    stop();
+}
+
+bool SocketWriter::start() {
+    if (running_) {
+        return true;
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        core::Logger::error("Failed to create writer epoll instance: {}", strerror(errno));
+        return false;
+    }
+
+    running_ = true;
+    for (size_t i = 0; i < thread_count_; ++i) {
+        threads_.emplace_back(&SocketWriter::writerLoop, this);
+    }
+
+    core::Logger::debug("Socket writer started with {} threads", thread_count_);
+    return true;
+}
+
+void SocketWriter::stop() {
+    if (!running_) {
+        return;
+    }
+
+    running_ = false;
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+
+    // Sockets still attached fall back to synchronous sends
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [socket, owner] : sockets_) {
+            socket->writer_ = nullptr;
+        }
+        sockets_.clear();
+    }
+
+    ::close(epoll_fd_);
+    epoll_fd_ = -1;
+}
+
+bool SocketWriter::attach(Socket& socket) {
+    auto owner = socket.weak_from_this();
+    if (!running_ || socket.getSocketFd() < 0 || owner.expired()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    epoll_event event{};
+    event.events = EPOLLONESHOT;
+    event.data.ptr = &socket;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket.getSocketFd(), &event) < 0) {
+        core::Logger::error("Failed to register socket with writer: {}", strerror(errno));
+        return false;
+    }
+
+    sockets_.emplace(&socket, std::move(owner));
+    socket.writer_ = this;
+    sockets_attached_++;
+    return true;
+}
+
+void SocketWriter::detach(Socket& socket) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (sockets_.erase(&socket) == 0) {
+        return;
+    }
+
+    congested_.erase(&socket);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket.getSocketFd(), nullptr);
+    socket.writer_ = nullptr;
+
+    // Wait for an in-flight flush, then make a last non-blocking attempt so a
+    // closing connection still gets its final frames out when the peer keeps up
+    std::lock_guard<std::mutex> write_lock(socket.write_mutex_);
+    lock.unlock();
+
+    std::string error;
+    bool drained = false;
+    flush(socket, error, drained);
+    socket.send_queue_.clear();
+    socket.send_offset_ = 0;
+    socket.queued_bytes_ = 0;
+    socket.above_high_watermark_ = false;
+}
+
+SocketWriter::Stats SocketWriter::getStats() const {
+    Stats stats;
+    stats.sockets_attached = sockets_attached_;
+    stats.buffers_written = buffers_written_;
+    stats.bytes_written = bytes_written_;
+    stats.would_block = would_block_;
+    stats.write_errors = write_errors_;
+    stats.evictions = evictions_;
+    return stats;
+}
+
+void SocketWriter::resetStats() {
+    sockets_attached_ = 0;
+    buffers_written_ = 0;
+    bytes_written_ = 0;
+    would_block_ = 0;
+    write_errors_ = 0;
+    evictions_ = 0;
+}
+
+void SocketWriter::schedule(Socket& socket) {
+    epoll_event event{};
+    event.events = EPOLLOUT | EPOLLONESHOT;
+    event.data.ptr = &socket;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, socket.getSocketFd(), &event);
+}
+
+void SocketWriter::markCongested(Socket& socket) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sockets_.find(&socket) != sockets_.end()) {
+        congested_.emplace(&socket, std::chrono::steady_clock::now());
+    }
+}
+
+void SocketWriter::writerLoop() {
+    epoll_event events[64];
+
+    while (running_) {
+        int count = epoll_wait(epoll_fd_, events, 64, 100);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            core::Logger::error("Writer epoll_wait failed: {}", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            std::shared_ptr<Socket> socket;
+            std::string error;
+            bool drained = false;
+            bool ok;
+
+            {
+                // Hold a reference so the callbacks below can't outlive the socket
+                std::unique_lock<std::mutex> lock(mutex_);
+                auto it = sockets_.find(static_cast<Socket*>(events[i].data.ptr));
+                if (it == sockets_.end() || !(socket = it->second.lock())) {
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> write_lock(socket->write_mutex_);
+                lock.unlock();
+
+                ok = flush(*socket, error, drained);
+            }
+
+            // Callbacks run outside the locks, they may queue more data or close the socket
+            if (drained) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    congested_.erase(socket.get());
+                }
+                if (socket->low_watermark_callback_) {
+                    socket->low_watermark_callback_(socket->queued_bytes_);
+                }
+            }
+
+            if (!ok) {
+                socket->notifyError(error);
+            }
+        }
+
+        evictSlowConsumers();
+    }
+}
+
+void SocketWriter::evictSlowConsumers() {
+    // One writer thread checks at a time, at most every 100ms
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t last = last_eviction_check_;
+    if (now_ms - last < 100 || !last_eviction_check_.compare_exchange_strong(last, now_ms)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto it = congested_.begin(); it != congested_.end();) {
+        Socket* socket = it->first;
+        auto timeout = socket->write_limits_.eviction_timeout;
+        if (timeout.count() == 0 || now - it->second < timeout) {
+            ++it;
+            continue;
+        }
+
+        core::Logger::warn("Evicting slow consumer {}: {} bytes queued for {}ms",
+                          socket->getRemoteAddress().toString(), socket->queued_bytes_.load(),
+                          std::chrono::duration_cast<std::chrono::milliseconds>(now - it->second).count());
+
+        it = congested_.erase(it);
+        sockets_.erase(socket);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, socket->getSocketFd(), nullptr);
+        socket->writer_ = nullptr;
+        socket->evicted_ = true;
+
+        // The receive loop sees the shutdown and reports the eviction to the owner
+        ::shutdown(socket->getSocketFd(), SHUT_RDWR);
+
+        std::lock_guard<std::mutex> write_lock(socket->write_mutex_);
+        socket->send_queue_.clear();
+        socket->send_offset_ = 0;
+        socket->queued_bytes_ = 0;
+        evictions_++;
+    }
+}
+
+bool SocketWriter::flush(Socket& socket, std::string& error, bool& drained) {
+    constexpr size_t max_batch = 64;
+    const SharedBuffer* buffers[max_batch];
+    iovec iov[max_batch];
+
+    while (true) {
+        size_t count = socket.send_queue_.peek(buffers, max_batch);
+        if (count == 0) {
+            // Re-check after clearing the flag so a concurrent push is never stranded
+            socket.write_scheduled_ = false;
+            if (socket.send_queue_.empty() || socket.write_scheduled_.exchange(true)) {
+                return true;
+            }
+            continue;
+        }
+
+        // Gather queued buffers into a single write
+        for (size_t i = 0; i < count; ++i) {
+            const std::vector<uint8_t>& data = **buffers[i];
+            size_t offset = (i == 0) ? socket.send_offset_ : 0;
+            iov[i].iov_base = const_cast<uint8_t*>(data.data() + offset);
+            iov[i].iov_len = data.size() - offset;
+        }
+
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+
+        ssize_t sent = ::sendmsg(socket.getSocketFd(), &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                would_block_++;
+                if (socket.writer_ == this) {
+                    schedule(socket);
+                }
+                return true;
+            }
+
+            error = "Send failed: " + std::string(strerror(errno));
+            write_errors_++;
+            socket.send_queue_.clear();
+            socket.send_offset_ = 0;
+            socket.queued_bytes_ = 0;
+            socket.write_scheduled_ = false;
+            return false;
+        }
+
+        bytes_written_ += sent;
+        size_t remaining = socket.queued_bytes_.fetch_sub(sent) - sent;
+
+        // Retire fully written buffers, keep the offset into a partially written one
+        size_t written = static_cast<size_t>(sent);
+        for (size_t i = 0; i < count && written > 0; ++i) {
+            if (written < iov[i].iov_len) {
+                socket.send_offset_ += written;
+                break;
+            }
+            written -= iov[i].iov_len;
+            socket.send_queue_.pop();
+            socket.send_offset_ = 0;
+            buffers_written_++;
+        }
+
+        if (remaining <= socket.write_limits_.low_watermark && socket.above_high_watermark_.exchange(false)) {
+            drained = true;
+        }
+    }
+}
+
+} // namespace fmus::network
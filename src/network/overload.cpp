@@ -0,0 +1,192 @@
+#include "fmus/network/overload.hpp"
+#include "fmus/core/logger.hpp"
+#include "fmus/core/random.hpp"
+#include <algorithm>
+
+namespace fmus::network {
+
+namespace {
+
+constexpr uint32_t MAX_PERCENT = 100;
+
+int64_t toNanoseconds(OverloadController::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+void updateMin(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void updateMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+const char* overloadStateToString(OverloadController::State state) {
+    switch (state) {
+        case OverloadController::State::NORMAL: return "normal";
+        case OverloadController::State::THROTTLING: return "throttling";
+        case OverloadController::State::OVERLOADED: return "overloaded";
+    }
+    return "unknown";
+}
+
+// OverloadController implementation
+OverloadController::OverloadController() : OverloadController(Config{}) {
+}
+
+OverloadController::OverloadController(const Config& config) {
+    setConfig(config);
+}
+
+void OverloadController::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    hard_backlog_ = config_.enabled ? config_.hard_backlog : SIZE_MAX;
+    next_adjust_ns_ = 0;
+    if (!config_.enabled) {
+        reject_percent_ = 0;
+        setState(State::NORMAL);
+    }
+}
+
+OverloadController::Config OverloadController::getConfig() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+bool OverloadController::admit(size_t backlog, Clock::time_point now) {
+    uint64_t sequence = offered_.fetch_add(1, std::memory_order_relaxed);
+    backlog_.store(backlog, std::memory_order_relaxed);
+    maybeAdjust(now);
+
+    uint32_t percent = reject_percent_.load(std::memory_order_relaxed);
+    if (percent < MAX_PERCENT && backlog >= hard_backlog_.load(std::memory_order_relaxed)) {
+        // Far past the limit; do not wait for the next interval
+        std::lock_guard<std::mutex> lock(mutex_);
+        reject_percent_ = percent = MAX_PERCENT;
+        setState(State::OVERLOADED);
+    }
+
+    // Spread rejections evenly: reject when sequence * percent / 100 steps
+    bool reject = percent > 0 && (sequence + 1) * percent / MAX_PERCENT != sequence * percent / MAX_PERCENT;
+    if (reject) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        admitted_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return !reject;
+}
+
+void OverloadController::onProcessed(Clock::duration queue_delay, size_t backlog, Clock::time_point now) {
+    uint64_t delay = static_cast<uint64_t>(
+        std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(queue_delay).count()));
+    updateMin(min_delay_ns_, delay);
+    updateMax(max_delay_ns_, delay);
+    backlog_.store(backlog, std::memory_order_relaxed);
+    maybeAdjust(now);
+}
+
+uint32_t OverloadController::retryAfter() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t base = static_cast<uint32_t>(config_.retry_after.count());
+    uint32_t spread = static_cast<uint32_t>(config_.retry_after_spread.count());
+    return spread == 0 ? base : base + core::SecureRandom::next32() % (spread + 1);
+}
+
+void OverloadController::maybeAdjust(Clock::time_point now) {
+    if (toNanoseconds(now) < next_adjust_ns_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Whoever gets the lock rolls the interval over; the rest carry on
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (lock.owns_lock() && toNanoseconds(now) >= next_adjust_ns_.load(std::memory_order_relaxed)) {
+        adjust(now);
+    }
+}
+
+void OverloadController::adjust(Clock::time_point now) {
+    uint64_t min_delay = min_delay_ns_.exchange(UINT64_MAX, std::memory_order_relaxed);
+    uint64_t max_delay = max_delay_ns_.exchange(0, std::memory_order_relaxed);
+    size_t backlog = backlog_.load(std::memory_order_relaxed);
+    bool sampled = min_delay != UINT64_MAX;
+
+    // Adjustments only happen when traffic arrives, so after a quiet spell
+    // this one stands in for every interval that passed without a call
+    int64_t interval_ns = std::max<int64_t>(1, std::chrono::nanoseconds(config_.interval).count());
+    int64_t due_ns = next_adjust_ns_.load(std::memory_order_relaxed);
+    uint64_t intervals = 1;
+    if (due_ns != 0) {
+        intervals += static_cast<uint64_t>(std::max<int64_t>(0, toNanoseconds(now) - due_ns) / interval_ns);
+    }
+
+    last_min_delay_ns_.store(sampled ? min_delay : 0, std::memory_order_relaxed);
+    last_max_delay_ns_.store(max_delay, std::memory_order_relaxed);
+    next_adjust_ns_.store(toNanoseconds(now + config_.interval), std::memory_order_relaxed);
+
+    if (!config_.enabled) {
+        return;
+    }
+
+    // Even the luckiest message waited too long, so the queue is not a burst
+    uint64_t target = static_cast<uint64_t>(std::chrono::nanoseconds(config_.target_delay).count());
+    bool overloaded = (sampled && min_delay > target) || backlog > config_.max_backlog;
+
+    uint32_t percent = reject_percent_.load(std::memory_order_relaxed);
+    if (overloaded) {
+        percent = std::min(MAX_PERCENT, percent + config_.increase_percent);
+    } else {
+        uint64_t decrease = std::min<uint64_t>(MAX_PERCENT, intervals * config_.decrease_percent);
+        percent = percent > decrease ? percent - static_cast<uint32_t>(decrease) : 0;
+    }
+    reject_percent_.store(percent, std::memory_order_relaxed);
+
+    setState(percent == 0 ? State::NORMAL : percent >= MAX_PERCENT ? State::OVERLOADED : State::THROTTLING);
+}
+
+void OverloadController::setState(State state) {
+    State previous = state_.exchange(state, std::memory_order_relaxed);
+    if (previous == state) {
+        return;
+    }
+
+    if (previous == State::NORMAL) {
+        episodes_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (state == State::NORMAL) {
+        core::Logger::info("SIP overload cleared");
+    } else {
+        core::Logger::warn("SIP overload {}: rejecting {}% of new requests, backlog {}", overloadStateToString(state),
+                           reject_percent_.load(std::memory_order_relaxed),
+                           backlog_.load(std::memory_order_relaxed));
+    }
+}
+
+OverloadController::Stats OverloadController::getStats() const {
+    Stats stats;
+    stats.offered = offered_.load(std::memory_order_relaxed);
+    stats.admitted = admitted_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.overload_episodes = episodes_.load(std::memory_order_relaxed);
+    stats.state = state_.load(std::memory_order_relaxed);
+    stats.reject_percent = reject_percent_.load(std::memory_order_relaxed);
+    stats.queue_delay_min_us = last_min_delay_ns_.load(std::memory_order_relaxed) / 1000;
+    stats.queue_delay_max_us = last_max_delay_ns_.load(std::memory_order_relaxed) / 1000;
+    stats.backlog = backlog_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void OverloadController::resetStats() {
+    offered_ = 0;
+    admitted_ = 0;
+    rejected_ = 0;
+    episodes_ = 0;
+}
+
+} // namespace fmus::network
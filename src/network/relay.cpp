@@ -0,0 +1,316 @@
+#include "fmus/network/relay.hpp"
+#include "fmus/core/logger.hpp"
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <cstring>
+#include <algorithm>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // Linux 4.18
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104     // Linux 5.0
+#endif
+
+namespace fmus::network {
+
+namespace {
+
+constexpr size_t GRO_SLOT_SIZE = 65536; // A coalesced read can be this large
+constexpr size_t GRO_SLOTS = 8;
+constexpr size_t MAX_SEGMENTS = 64;     // UDP_MAX_SEGMENTS on older kernels
+constexpr size_t MAX_SEGMENTED_BYTES = 65000;
+
+struct Datagram {
+    const uint8_t* data;
+    uint16_t length;
+};
+
+// One outgoing message: a run of datagrams, segmented when longer than one
+struct Run {
+    size_t first;
+    size_t count;
+    uint16_t segment_size;
+};
+
+// Receive and send state shared by the relays pumped on one thread; pump()
+// never suspends, so they cannot interleave
+struct Scratch {
+    std::vector<uint8_t> buffer;
+    std::vector<mmsghdr> messages;
+    std::vector<iovec> iovecs;
+    std::vector<char> controls;
+    std::vector<Datagram> datagrams;
+
+    std::vector<Run> runs;
+    std::vector<mmsghdr> send_messages;
+    std::vector<iovec> send_iovecs;
+    std::vector<char> send_controls;
+
+    static constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(int));
+
+    void prepare(size_t slots, size_t slot_size) {
+        if (buffer.size() < slots * slot_size) {
+            buffer.resize(slots * slot_size);
+        }
+        if (messages.size() < slots) {
+            messages.resize(slots);
+            iovecs.resize(slots);
+            controls.resize(slots * CONTROL_SIZE);
+        }
+    }
+};
+
+thread_local Scratch scratch;
+
+bool isGsoUnsupported(int error) {
+    return error == EINVAL || error == EIO || error == ENOPROTOOPT || error == EOPNOTSUPP;
+}
+
+} // namespace
+
+UdpRelay::UdpRelay(std::shared_ptr<UdpSocket> input, std::shared_ptr<UdpSocket> output,
+                   const SocketAddress& destination)
+    : UdpRelay(std::move(input), std::move(output), destination, Config{}) {
+}
+
+UdpRelay::UdpRelay(std::shared_ptr<UdpSocket> input, std::shared_ptr<UdpSocket> output,
+                   const SocketAddress& destination, const Config& config)
+    : input_(std::move(input)), output_(std::move(output)), destination_(destination), config_(config) {
+    connected_ = output_->setPeer(destination_);
+
+    int on = 1;
+    if (config_.use_gro) {
+        gro_ = setsockopt(input_->getSocketFd(), SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+    }
+    if (config_.use_gso) {
+        // Readable only where the kernel knows the option
+        int segment = 0;
+        socklen_t length = sizeof(segment);
+        gso_ = getsockopt(output_->getSocketFd(), SOL_UDP, UDP_SEGMENT, &segment, &length) == 0;
+    }
+}
+
+UdpRelay::~UdpRelay() {
+    // Pooled sockets outlive the relay; leave them as they were found
+    if (gro_) {
+        int off = 0;
+        setsockopt(input_->getSocketFd(), SOL_UDP, UDP_GRO, &off, sizeof(off));
+    }
+    if (connected_) {
+        output_->clearPeer();
+    }
+}
+
+size_t UdpRelay::pump(size_t budget) {
+    int fd = input_->getSocketFd();
+    if (fd < 0) {
+        return 0;
+    }
+
+    size_t slots = gro_ ? GRO_SLOTS : std::max<size_t>(1, config_.batch_size);
+    size_t slot_size = gro_ ? GRO_SLOT_SIZE : config_.max_datagram_size;
+    scratch.prepare(slots, slot_size);
+
+    uint64_t sent_before = stats_.datagrams;
+    size_t received_total = 0;
+    while (received_total < budget) {
+        for (size_t i = 0; i < slots; ++i) {
+            scratch.iovecs[i] = {scratch.buffer.data() + i * slot_size, slot_size};
+            msghdr& header = scratch.messages[i].msg_hdr;
+            header = {};
+            header.msg_iov = &scratch.iovecs[i];
+            header.msg_iovlen = 1;
+            if (gro_) {
+                header.msg_control = scratch.controls.data() + i * Scratch::CONTROL_SIZE;
+                header.msg_controllen = Scratch::CONTROL_SIZE;
+            }
+        }
+
+        int received = recvmmsg(fd, scratch.messages.data(), static_cast<unsigned int>(slots), MSG_DONTWAIT, nullptr);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                core::Logger::debug("Relay receive failed: {}", strerror(errno));
+            }
+            break;
+        }
+        stats_.receive_calls++;
+
+        scratch.datagrams.clear();
+        for (int i = 0; i < received; ++i) {
+            const msghdr& header = scratch.messages[i].msg_hdr;
+            size_t length = scratch.messages[i].msg_len;
+            if (header.msg_flags & MSG_TRUNC) {
+                stats_.dropped++;
+                continue;
+            }
+            if (length == 0) {
+                continue; // Socket wakeup, not media
+            }
+
+            // A GRO read holds same-size datagrams back to back; the last may be shorter
+            size_t segment = length;
+            if (gro_) {
+                for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg)) {
+                    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                        int gso_size;
+                        std::memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                        segment = static_cast<size_t>(gso_size);
+                    }
+                }
+            }
+
+            const uint8_t* data = scratch.buffer.data() + i * slot_size;
+            for (size_t offset = 0; offset < length; offset += segment) {
+                size_t size = std::min(segment, length - offset);
+                if (size > config_.max_datagram_size) {
+                    stats_.dropped++;
+                    continue;
+                }
+                scratch.datagrams.push_back({data + offset, static_cast<uint16_t>(size)});
+            }
+        }
+
+        received_total += scratch.datagrams.size();
+        sendRuns();
+
+        if (static_cast<size_t>(received) < slots) {
+            break; // Drained
+        }
+    }
+
+    return static_cast<size_t>(stats_.datagrams - sent_before);
+}
+
+void UdpRelay::sendRuns() {
+    const std::vector<Datagram>& datagrams = scratch.datagrams;
+    std::vector<Run>& runs = scratch.runs;
+
+    // Group same-size datagrams; a shorter one may close a run, as GSO allows
+    runs.clear();
+    for (size_t i = 0; i < datagrams.size();) {
+        Run run{i, 1, datagrams[i].length};
+        if (gso_) {
+            size_t bytes = run.segment_size;
+            while (i + run.count < datagrams.size() && run.count < MAX_SEGMENTS) {
+                uint16_t next = datagrams[i + run.count].length;
+                if (next > run.segment_size || bytes + next > MAX_SEGMENTED_BYTES) {
+                    break;
+                }
+                run.count++;
+                bytes += next;
+                if (next < run.segment_size) {
+                    break;
+                }
+            }
+        }
+        runs.push_back(run);
+        i += run.count;
+    }
+
+    size_t next = 0;
+    while (next < runs.size()) {
+        next = sendFrom(next);
+    }
+}
+
+size_t UdpRelay::sendFrom(size_t first_run) {
+    std::vector<Run>& runs = scratch.runs;
+    size_t run_count = runs.size() - first_run;
+    sockaddr_in destination = destination_.toSockAddr();
+
+    size_t iovecs = 0;
+    for (size_t r = first_run; r < runs.size(); ++r) {
+        iovecs += runs[r].count;
+    }
+    if (scratch.send_iovecs.size() < iovecs) {
+        scratch.send_iovecs.resize(iovecs);
+    }
+    if (scratch.send_messages.size() < run_count) {
+        scratch.send_messages.resize(run_count);
+        scratch.send_controls.resize(run_count * Scratch::CONTROL_SIZE);
+    }
+
+    size_t iov = 0;
+    for (size_t r = 0; r < run_count; ++r) {
+        const Run& run = runs[first_run + r];
+        msghdr& header = scratch.send_messages[r].msg_hdr;
+        header = {};
+        if (!connected_) {
+            header.msg_name = &destination;
+            header.msg_namelen = sizeof(destination);
+        }
+        header.msg_iov = &scratch.send_iovecs[iov];
+        header.msg_iovlen = run.count;
+        for (size_t d = 0; d < run.count; ++d) {
+            const Datagram& datagram = scratch.datagrams[run.first + d];
+            scratch.send_iovecs[iov++] = {const_cast<uint8_t*>(datagram.data), datagram.length};
+        }
+
+        if (run.count > 1) {
+            header.msg_control = scratch.send_controls.data() + r * Scratch::CONTROL_SIZE;
+            header.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            std::memcpy(CMSG_DATA(cmsg), &run.segment_size, sizeof(uint16_t));
+        }
+    }
+
+    size_t done = 0;
+    while (done < run_count) {
+        int sent = sendmmsg(output_->getSocketFd(), scratch.send_messages.data() + done,
+                            static_cast<unsigned int>(run_count - done), MSG_DONTWAIT);
+        stats_.send_calls++;
+
+        if (sent > 0) {
+            for (size_t r = done; r < done + static_cast<size_t>(sent); ++r) {
+                const Run& run = runs[first_run + r];
+                stats_.datagrams += run.count;
+                stats_.bytes += scratch.send_messages[r].msg_len;
+                if (run.count > 1) {
+                    stats_.segmented += run.count;
+                }
+            }
+            done += sent;
+            continue;
+        }
+
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+
+        size_t failed = first_run + done;
+        if (sent < 0 && runs[failed].count > 1 && isGsoUnsupported(errno)) {
+            // Kernel or device without UDP GSO: split what is left into single sends
+            core::Logger::info("UDP GSO unavailable ({}), relaying without segmentation", strerror(errno));
+            gso_ = false;
+
+            std::vector<Run> rest(runs.begin() + failed, runs.end());
+            runs.resize(failed);
+            for (const Run& run : rest) {
+                for (size_t d = 0; d < run.count; ++d) {
+                    runs.push_back({run.first + d, 1, scratch.datagrams[run.first + d].length});
+                }
+            }
+            return failed;
+        }
+
+        // Full socket buffer or an unreachable peer: late media is useless, drop it
+        stats_.dropped += runs[failed].count;
+        done++;
+    }
+
+    return runs.size();
+}
+
+} // namespace fmus::network
@@ -1,13 +1,55 @@
 #include "fmus/network/socket.hpp"
+#include "fmus/network/uring.hpp"
 #include "fmus/core/logger.hpp"
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <cstring>
 #include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/ioctl.h>
+#include <linux/net_tstamp.h>
+#include <algorithm>
 
 namespace fmus::network {
 
+namespace {
+
+std::atomic<IoBackend> io_backend{IoBackend::THREADS};
+
+ReceiveTime wallClockNow() {
+    timespec now{};
+    clock_gettime(CLOCK_REALTIME, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+}
+
+ReceiveTime toReceiveTime(const timespec& time) {
+    return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+}
+
+} // namespace
+
+ReceiveTime receiveTimestamp(const msghdr& header) {
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING && cmsg->cmsg_len >= CMSG_LEN(3 * sizeof(timespec))) {
+            // Software stamp first, raw hardware stamp last
+            timespec stamps[3];
+            std::memcpy(stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            const timespec& best = (stamps[2].tv_sec || stamps[2].tv_nsec) ? stamps[2] : stamps[0];
+            return toReceiveTime(best);
+        }
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS && cmsg->cmsg_len >= CMSG_LEN(sizeof(timespec))) {
+            timespec stamp;
+            std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+            return toReceiveTime(stamp);
+        }
+    }
+    return ReceiveTime(0);
+}
+
 sockaddr_in SocketAddress::toSockAddr() const {
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
@@ -43,6 +85,7 @@ bool Socket::bind(const SocketAddress& address) {
     }
     
     setState(SocketState::BINDING);
+    closing_ = false;
     
     // Create socket
     int domain = AF_INET;
@@ -80,7 +123,7 @@ bool Socket::bind(const SocketAddress& address) {
     }
     
     setState(SocketState::BOUND);
-    core::Logger::info("Socket bound to {}", local_address_.toString());
+    core::Logger::debug("Socket bound to {}", local_address_.toString());
     return true;
 }
 
@@ -123,6 +166,7 @@ bool Socket::connect(const SocketAddress& address) {
     
     if (state_ == SocketState::CLOSED) {
         // Create socket if not already created
+        closing_ = false;
         socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
         if (socket_fd_ < 0) {
             notifyError("Failed to create socket: " + std::string(strerror(errno)));
@@ -147,10 +191,26 @@ bool Socket::connect(const SocketAddress& address) {
 }
 
 void Socket::close() {
+    if (SocketWriter* writer = writer_.load()) {
+        writer->detach(*this);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+        if (socket_fd_ >= 0) {
+            // Wake a receive thread blocked in recv() or a flow waiting for
+            // readability; unconnected UDP sockets report ENOTCONN but still
+            // wake their waiters
+            ::shutdown(socket_fd_, SHUT_RDWR);
+        }
+    }
+    
+    stopReceiving();
+    
     std::lock_guard<std::mutex> lock(mutex_);
     
     if (socket_fd_ >= 0) {
-        stopReceiving();
         ::close(socket_fd_);
         socket_fd_ = -1;
     }
@@ -163,6 +223,11 @@ bool Socket::send(const std::vector<uint8_t>& data, const SocketAddress& to) {
 }
 
 bool Socket::send(const uint8_t* data, size_t size, const SocketAddress& to) {
+    // Keep ordering with queued sends once a writer owns the stream
+    if (type_ == SocketType::TCP && writer_.load()) {
+        return queueSend(makeSharedBuffer(data, size));
+    }
+    
     std::lock_guard<std::mutex> lock(mutex_);
     
     if (socket_fd_ < 0) {
@@ -170,23 +235,153 @@ bool Socket::send(const uint8_t* data, size_t size, const SocketAddress& to) {
         return false;
     }
     
-    ssize_t sent;
     if (type_ == SocketType::UDP) {
         sockaddr_in addr = to.toSockAddr();
-        sent = sendto(socket_fd_, data, size, 0, (struct sockaddr*)&addr, sizeof(addr));
-    } else {
-        sent = ::send(socket_fd_, data, size, 0);
+        ssize_t sent = sendto(socket_fd_, data, size, 0, (struct sockaddr*)&addr, sizeof(addr));
+        if (sent < 0) {
+            notifyError("Send failed: " + std::string(strerror(errno)));
+            return false;
+        }
+        return true;
+    }
+    
+    // A stream send may be partial, keep going until everything is written
+    size_t total = 0;
+    while (total < size) {
+        ssize_t sent = ::send(socket_fd_, data + total, size - total, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            notifyError("Send failed after " + std::to_string(total) + " of " + std::to_string(size) +
+                        " bytes: " + std::string(strerror(errno)));
+            return false;
+        }
+        total += sent;
+    }
+    
+    return true;
+}
+
+bool Socket::sendFile(int file_fd, uint64_t offset, uint64_t length) {
+    if (type_ != SocketType::TCP) {
+        return false;
+    }
+    
+    bool copy = writer_.load() != nullptr;
+    
+    if (!copy) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        if (socket_fd_ < 0) {
+            notifyError("Socket not open");
+            return false;
+        }
+        
+        off_t file_offset = static_cast<off_t>(offset);
+        while (length > 0) {
+            ssize_t sent = ::sendfile(socket_fd_, file_fd, &file_offset, length);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if ((errno == EINVAL || errno == ENOSYS) && file_offset == static_cast<off_t>(offset)) {
+                    // File type without sendfile support, copy it instead
+                    copy = true;
+                    break;
+                }
+                notifyError("sendfile failed: " + std::string(strerror(errno)));
+                return false;
+            }
+            if (sent == 0) {
+                notifyError("sendfile hit end of file");
+                return false;
+            }
+            length -= static_cast<uint64_t>(sent);
+        }
+        
+        if (!copy) {
+            return true;
+        }
+    }
+    
+    std::vector<uint8_t> chunk(std::min<uint64_t>(length, 256 * 1024));
+    while (length > 0) {
+        ssize_t count = ::pread(file_fd, chunk.data(), std::min<uint64_t>(length, chunk.size()),
+                                static_cast<off_t>(offset));
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            notifyError("File read failed while sending");
+            return false;
+        }
+        if (!send(chunk.data(), static_cast<size_t>(count))) {
+            return false;
+        }
+        offset += static_cast<uint64_t>(count);
+        length -= static_cast<uint64_t>(count);
     }
     
-    if (sent < 0) {
-        notifyError("Send failed: " + std::string(strerror(errno)));
+    return true;
+}
+
+bool Socket::queueSend(SharedBuffer buffer) {
+    if (!buffer) {
         return false;
     }
     
-    if (static_cast<size_t>(sent) != size) {
-        core::Logger::warn("Partial send: {} of {} bytes", sent, size);
+    SocketWriter* writer = writer_.load();
+    if (!writer) {
+        if (type_ == SocketType::UDP && ring_receiver_) {
+            // Fire and forget on the ring; the buffer is held until the send
+            // completes or its timeout cancels it
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (socket_fd_ >= 0 && IoUring::shared().send(socket_fd_, buffer)) {
+                return true;
+            }
+        }
+        return send(buffer->data(), buffer->size());
+    }
+    
+    size_t size = buffer->size();
+    size_t queued = 0;
+    {
+        // detach() and eviction clear the queue under this lock once writer_
+        // is reset, so whatever is pushed here is either flushed or discarded
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        if (socket_fd_ < 0 || evicted_) {
+            return false;
+        }
+        if (writer_.load() != writer) {
+            writer = nullptr;
+        } else {
+            queued = queued_bytes_.fetch_add(size) + size;
+            if (queued > write_limits_.max_queued_bytes) {
+                queued_bytes_ -= size;
+                core::Logger::warn("Outbound queue to {} full ({} bytes), dropping {} bytes",
+                                  remote_address_.toString(), queued - size, size);
+                return false;
+            }
+            send_queue_.push(std::move(buffer));
+        }
+    }
+    
+    if (!writer) {
+        // Detached since the check above
+        return send(buffer->data(), buffer->size());
+    }
+    
+    if (!write_scheduled_.exchange(true)) {
+        writer->schedule(*this);
     }
     
+    if (queued >= write_limits_.high_watermark && !above_high_watermark_.exchange(true)) {
+        writer->markCongested(*this);
+        if (high_watermark_callback_) {
+            high_watermark_callback_(queued);
+        }
+    }
     return true;
 }
 
@@ -197,14 +392,149 @@ void Socket::startReceiving() {
         return;
     }
     
+    if (type_ == SocketType::UDP && io_backend == IoBackend::IO_URING) {
+        uint64_t id = IoUring::shared().addReceiver(socket_fd_,
+            [this](const uint8_t* data, size_t size, const sockaddr_in& from, ReceiveTime received) {
+                if (size > 0) { // Empty datagrams only wake receive threads
+                    deliver(data, size, from, received);
+                }
+            });
+        if (id != 0) {
+            ring_receiver_ = id;
+            receiving_ = true;
+            return;
+        }
+        core::Logger::warn("io_uring receive unavailable for {}, using a thread", local_address_.toString());
+    }
+    
     receiving_ = true;
-    receive_thread_ = std::thread(&Socket::receiveLoop, this);
+    // A callback may close the socket and drop the owner's last reference
+    // while the loop still runs; the thread releases its own on exit
+    receive_thread_ = std::thread([this, self = weak_from_this().lock()] {
+        receiveLoop();
+    });
 }
 
 void Socket::stopReceiving() {
     receiving_ = false;
+    if (uint64_t id = ring_receiver_.exchange(0)) {
+        IoUring::shared().removeReceiver(id);
+    }
     if (receive_thread_.joinable()) {
-        receive_thread_.join();
+        // Closing from a data or error callback runs on the receive thread itself
+        if (receive_thread_.get_id() == std::this_thread::get_id()) {
+            receive_thread_.detach();
+        } else {
+            if (type_ == SocketType::UDP && !closing_) {
+                wakeReceiver();
+            }
+            receive_thread_.join();
+        }
+    }
+}
+
+bool Socket::setIoBackend(IoBackend backend) {
+    if (backend == IoBackend::IO_URING) {
+        if (!IoUring::isSupported()) {
+            core::Logger::warn("io_uring not supported by this kernel, keeping receive threads");
+            return false;
+        }
+        if (!IoUring::shared().start()) {
+            return false;
+        }
+    }
+    
+    io_backend = backend;
+    core::Logger::info("Socket I/O backend: {}", backend == IoBackend::IO_URING ? "io_uring" : "threads");
+    return true;
+}
+
+IoBackend Socket::getIoBackend() {
+    return io_backend;
+}
+
+void Socket::wakeReceiver() {
+    // An empty datagram to ourselves ends a blocked recvfrom() while the
+    // socket stays bound, e.g. for a pooled RTP port
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_fd_ < 0) {
+        return;
+    }
+    
+    sockaddr_in self = local_address_.toSockAddr();
+    if (self.sin_addr.s_addr == htonl(INADDR_ANY)) {
+        self.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+    ::sendto(socket_fd_, nullptr, 0, 0, (struct sockaddr*)&self, sizeof(self));
+}
+
+core::Task<std::optional<Socket::Datagram>> Socket::recv(std::chrono::milliseconds timeout) {
+    core::EventLoop* loop = core::EventLoop::current();
+
+    while (socket_fd_ >= 0 && !closing_) {
+        // Size the buffer from what is pending so an idle flow holds no buffer
+        int pending = 0;
+        ioctl(socket_fd_, FIONREAD, &pending);
+
+        Datagram datagram;
+        datagram.data.resize(std::max(pending, 1));
+        sockaddr_in from_addr{};
+        alignas(cmsghdr) char control[RECEIVE_TIMESTAMP_CONTROL_SIZE];
+        iovec iov{datagram.data.data(), datagram.data.size()};
+        msghdr header{};
+        header.msg_name = &from_addr;
+        header.msg_namelen = sizeof(from_addr);
+        header.msg_iov = &iov;
+        header.msg_iovlen = 1;
+        if (timestamps_) {
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+        }
+
+        ssize_t received = recvmsg(socket_fd_, &header, MSG_DONTWAIT);
+        if (received >= 0) {
+            if (received == 0 && type_ == SocketType::TCP) {
+                co_return std::nullopt; // Closed by peer
+            }
+            datagram.data.resize(received);
+            datagram.from = type_ == SocketType::UDP ? SocketAddress::fromSockAddr(from_addr) : remote_address_;
+            datagram.received = timestamps_ ? receiveTimestamp(header) : ReceiveTime(0);
+            if (datagram.received.count() == 0) {
+                datagram.received = wallClockNow();
+            }
+            co_return datagram;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            notifyError("Receive failed: " + std::string(strerror(errno)));
+            co_return std::nullopt;
+        }
+
+        if (!loop) {
+            core::Logger::error("Socket recv() awaited outside an event loop");
+            co_return std::nullopt;
+        }
+        if (!co_await loop->readable(socket_fd_, timeout)) {
+            co_return std::nullopt;
+        }
+    }
+
+    co_return std::nullopt;
+}
+
+void Socket::deliver(const uint8_t* data, size_t size, const sockaddr_in& from, ReceiveTime received) {
+    if (timed_data_callback_) {
+        if (received.count() == 0) {
+            received = wallClockNow();
+        }
+        std::vector<uint8_t> datagram(data, data + size);
+        timed_data_callback_(datagram, SocketAddress::fromSockAddr(from), received);
+    } else if (data_callback_) {
+        std::vector<uint8_t> datagram(data, data + size);
+        data_callback_(datagram, SocketAddress::fromSockAddr(from));
     }
 }
 
@@ -226,17 +556,29 @@ void Socket::receiveLoop() {
     core::Logger::debug("Starting receive loop for socket");
     
     std::vector<uint8_t> buffer(65536); // 64KB buffer
+    alignas(cmsghdr) char control[RECEIVE_TIMESTAMP_CONTROL_SIZE];
     
     while (receiving_) {
         sockaddr_in from_addr{};
         socklen_t from_len = sizeof(from_addr);
+        ReceiveTime stamp(0);
         
         ssize_t received;
         if (type_ == SocketType::UDP) {
-            received = recvfrom(socket_fd_, buffer.data(), buffer.size(), 0,
-                              (struct sockaddr*)&from_addr, &from_len);
+            iovec iov{buffer.data(), buffer.size()};
+            msghdr header{};
+            header.msg_name = &from_addr;
+            header.msg_namelen = from_len;
+            header.msg_iov = &iov;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+            received = recvmsg(socket_fd_, &header, 0);
+            if (received > 0 && timestamps_) {
+                stamp = receiveTimestamp(header);
+            }
         } else {
-            received = recv(socket_fd_, buffer.data(), buffer.size(), 0);
+            received = ::recv(socket_fd_, buffer.data(), buffer.size(), 0);
             // For TCP, we need to get peer address differently
             if (received > 0 && getpeername(socket_fd_, (struct sockaddr*)&from_addr, &from_len) != 0) {
                 from_addr = remote_address_.toSockAddr();
@@ -252,19 +594,23 @@ void Socket::receiveLoop() {
             }
             break;
         } else if (received == 0) {
+            if (type_ == SocketType::UDP) {
+                continue; // Empty datagram, also how stopReceiving() wakes us
+            }
+            
             // Connection closed
             if (type_ == SocketType::TCP) {
-                core::Logger::info("TCP connection closed by peer");
+                if (evicted_) {
+                    notifyError("Connection evicted: outbound queue stayed above high watermark");
+                } else {
+                    core::Logger::info("TCP connection closed by peer");
+                }
                 setState(SocketState::CLOSED);
             }
             break;
         }
         
-        if (data_callback_) {
-            std::vector<uint8_t> data(buffer.begin(), buffer.begin() + received);
-            SocketAddress from = SocketAddress::fromSockAddr(from_addr);
-            data_callback_(data, from);
-        }
+        deliver(buffer.data(), static_cast<size_t>(received), from_addr, stamp);
     }
     
     core::Logger::debug("Receive loop ended");
@@ -311,6 +657,92 @@ bool UdpSocket::enableMulticast(const std::string& group) {
     return true;
 }
 
+size_t UdpSocket::discardPending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    size_t discarded = 0;
+    if (socket_fd_ < 0) {
+        return discarded;
+    }
+    
+    // MSG_TRUNC reports the real length, so wakeup datagrams are not counted
+    uint8_t byte;
+    ssize_t length;
+    while ((length = ::recv(socket_fd_, &byte, sizeof(byte), MSG_DONTWAIT | MSG_TRUNC)) >= 0) {
+        if (length > 0) {
+            discarded++;
+        }
+    }
+    return discarded;
+}
+
+bool UdpSocket::setPeer(const SocketAddress& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (socket_fd_ < 0) {
+        return false;
+    }
+    
+    sockaddr_in addr = peer.toSockAddr();
+    if (::connect(socket_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        notifyError("Failed to set UDP peer: " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    remote_address_ = peer;
+    return true;
+}
+
+bool UdpSocket::clearPeer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (socket_fd_ < 0) {
+        return false;
+    }
+    
+    // AF_UNSPEC dissolves the association and keeps the local binding
+    sockaddr addr{};
+    addr.sa_family = AF_UNSPEC;
+    if (::connect(socket_fd_, &addr, sizeof(addr)) < 0) {
+        return false;
+    }
+    
+    remote_address_ = {};
+    return true;
+}
+
+bool UdpSocket::enableReceiveTimestamps(bool enable) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (socket_fd_ < 0) {
+        notifyError("Socket not created");
+        return false;
+    }
+    
+    if (!enable) {
+        int off = 0;
+        setsockopt(socket_fd_, SOL_SOCKET, SO_TIMESTAMPING, &off, sizeof(off));
+        setsockopt(socket_fd_, SOL_SOCKET, SO_TIMESTAMPNS, &off, sizeof(off));
+        timestamps_ = false;
+        return true;
+    }
+    
+    // Hardware stamps only appear once the interface is configured for them
+    // (SIOCSHWTSTAMP, e.g. by a PTP daemon); software stamps always do
+    int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        int on = 1;
+        if (setsockopt(socket_fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+            notifyError("Failed to enable receive timestamps: " + std::string(strerror(errno)));
+            return false;
+        }
+    }
+    
+    timestamps_ = true;
+    return true;
+}
+
 bool UdpSocket::setReceiveBufferSize(int size) {
     std::lock_guard<std::mutex> lock(mutex_);
     
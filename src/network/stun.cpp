@@ -1,6 +1,6 @@
 #include "fmus/network/stun.hpp"
 #include "fmus/core/logger.hpp"
-#include <random>
+#include "fmus/core/random.hpp"
 #include <cstring>
 #include <sstream>
 #include <arpa/inet.h>
@@ -258,16 +258,7 @@ bool StunMessage::isValid() const {
 }
 
 std::vector<uint8_t> StunMessage::generateTransactionId() {
-    std::vector<uint8_t> id(12);
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<uint8_t> dis(0, 255);
-    
-    for (auto& byte : id) {
-        byte = dis(gen);
-    }
-    
-    return id;
+    return core::SecureRandom::bytes(12);
 }
 
 bool StunMessage::isStunMessage(const uint8_t* data, size_t size) {
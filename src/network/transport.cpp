@@ -1,15 +1,90 @@
 #include "fmus/network/transport.hpp"
 #include "fmus/core/logger.hpp"
 #include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cctype>
+#include <sys/resource.h>
 
 namespace fmus::network {
 
+namespace {
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+// Header value by full or compact name, without a full parse
+std::string_view findHeader(std::string_view message, std::string_view name, std::string_view compact) {
+    size_t pos = message.find('\n');
+    while (pos != std::string_view::npos && pos + 1 < message.size()) {
+        size_t start = pos + 1;
+        size_t end = message.find('\n', start);
+        std::string_view line = message.substr(start, end == std::string_view::npos ? end : end - start);
+        if (trim(line).empty()) {
+            break; // End of headers
+        }
+
+        size_t colon = line.find(':');
+        if (colon != std::string_view::npos) {
+            std::string_view header = trim(line.substr(0, colon));
+            if (equalsIgnoreCase(header, name) || equalsIgnoreCase(header, compact)) {
+                return trim(line.substr(colon + 1));
+            }
+        }
+        pos = end;
+    }
+    return {};
+}
+
+// New INVITE or REGISTER, the only requests overload control turns away;
+// a To tag marks a request inside an existing dialog
+bool isInitialRequest(std::string_view message) {
+    if (!message.starts_with("INVITE ") && !message.starts_with("REGISTER ")) {
+        return false;
+    }
+    return findHeader(message, "To", "t").find(";tag=") == std::string_view::npos;
+}
+
+// Spreads RTP transports over the executor's workers in turn
+std::atomic<uint64_t> next_rtp_affinity{0};
+
+void waitForTasks(const std::atomic<size_t>& pending) {
+    while (pending > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Descriptors a pre-binding port pool leaves for signaling, files and the like
+constexpr size_t FD_HEADROOM = 1024;
+
+} // namespace
+
 // SipTransport implementation
 SipTransport::SipTransport() {
 }
 
 SipTransport::~SipTransport() {
     stop();
+    waitForTasks(pending_tasks_);
 }
 
 bool SipTransport::startUdp(const SocketAddress& bind_address) {
@@ -68,12 +143,63 @@ bool SipTransport::startTcp(const SocketAddress& bind_address) {
         return false;
     }
     
+    if (!tcp_writer_.start()) {
+        tcp_server_->close();
+        tcp_server_.reset();
+        return false;
+    }
+    
     tcp_server_->acceptConnections();
     core::Logger::info("SIP TCP transport started on {}", bind_address.toString());
     return true;
 }
 
+bool SipTransport::startWebSocket(const SocketAddress& bind_address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (ws_server_) {
+        core::Logger::warn("WebSocket transport already started");
+        return true;
+    }
+    
+    ws_server_ = createTcpSocket();
+    
+    ws_server_->setConnectionCallback([this](std::shared_ptr<Socket> connection) {
+        onWebSocketConnection(connection);
+    });
+    
+    ws_server_->setErrorCallback([this](const std::string& error) {
+        onError("WebSocket Server: " + error);
+    });
+    
+    if (!ws_server_->bind(bind_address) || !ws_server_->listen()) {
+        ws_server_.reset();
+        return false;
+    }
+    
+    if (!tcp_writer_.start()) {
+        ws_server_->close();
+        ws_server_.reset();
+        return false;
+    }
+    
+    ws_server_->acceptConnections();
+    core::Logger::info("SIP WebSocket transport started on {}", bind_address.toString());
+    return true;
+}
+
 void SipTransport::stop() {
+    // Close callbacks take mutex_, so WebSocket connections are closed outside it
+    std::unordered_map<std::string, std::shared_ptr<WebSocketConnection>> ws_connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ws_connections.swap(ws_connections_);
+    }
+    for (auto& [addr, connection] : ws_connections) {
+        connection->close();
+    }
+    ws_connections.clear();
+    
     std::lock_guard<std::mutex> lock(mutex_);
     
     if (udp_socket_) {
@@ -86,10 +212,16 @@ void SipTransport::stop() {
         tcp_server_.reset();
     }
     
+    if (ws_server_) {
+        ws_server_->close();
+        ws_server_.reset();
+    }
+    
     for (auto& [addr, connection] : tcp_connections_) {
         connection->close();
     }
     tcp_connections_.clear();
+    tcp_writer_.stop();
     
     core::Logger::info("SIP transport stopped");
 }
@@ -99,14 +231,36 @@ bool SipTransport::sendMessage(const fmus::sip::SipMessage& message, const Socke
 }
 
 bool SipTransport::sendMessage(const std::string& raw_message, const SocketAddress& destination) {
+    return sendRaw(raw_message, destination);
+}
+
+bool SipTransport::sendResponse(const fmus::sip::ResponseTemplate& response, const fmus::sip::SipMessage& request,
+                                const SocketAddress& destination, const fmus::sip::ResponseTemplate::Values& values) {
+    return sendRaw(response.render(request, values), destination);
+}
+
+bool SipTransport::sendRaw(std::string_view raw_message, const SocketAddress& destination) {
     std::lock_guard<std::mutex> lock(mutex_);
     
+    // Web clients are only reachable over their WebSocket, one message per frame
+    auto ws_it = ws_connections_.find(destination.toString());
+    if (ws_it != ws_connections_.end()) {
+        if (ws_it->second->sendMessage(std::string(raw_message))) {
+            stats_.messages_sent++;
+            stats_.bytes_sent += raw_message.size();
+            return true;
+        }
+        stats_.errors++;
+        return false;
+    }
+    
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(raw_message.data());
+    
     // Try UDP first if available
     if (udp_socket_) {
-        std::vector<uint8_t> data(raw_message.begin(), raw_message.end());
-        if (udp_socket_->send(data, destination)) {
+        if (udp_socket_->send(data, raw_message.size(), destination)) {
             stats_.messages_sent++;
-            stats_.bytes_sent += data.size();
+            stats_.bytes_sent += raw_message.size();
             return true;
         }
     }
@@ -114,10 +268,9 @@ bool SipTransport::sendMessage(const std::string& raw_message, const SocketAddre
     // Fall back to TCP
     auto connection = getTcpConnection(destination);
     if (connection) {
-        std::vector<uint8_t> data(raw_message.begin(), raw_message.end());
-        if (connection->send(data)) {
+        if (connection->send(data, raw_message.size())) {
             stats_.messages_sent++;
-            stats_.bytes_sent += data.size();
+            stats_.bytes_sent += raw_message.size();
             return true;
         }
     }
@@ -147,6 +300,7 @@ std::shared_ptr<TcpSocket> SipTransport::getTcpConnection(const SocketAddress& a
     });
     
     if (connection->connect(address)) {
+        attachTcpConnection(connection);
         connection->startReceiving();
         tcp_connections_[key] = connection;
         return connection;
@@ -164,18 +318,28 @@ void SipTransport::closeTcpConnection(const SocketAddress& address) {
     }
 }
 
+void SipTransport::attachTcpConnection(const std::shared_ptr<TcpSocket>& connection) {
+    // Outbound-only connections may exist without a listening transport
+    if (!tcp_writer_.isRunning()) {
+        tcp_writer_.start();
+    }
+    
+    if (!tcp_writer_.attach(*connection)) {
+        core::Logger::warn("SIP TCP connection {} uses synchronous sends",
+                          connection->getRemoteAddress().toString());
+    }
+}
+
 void SipTransport::onUdpData(const std::vector<uint8_t>& data, const SocketAddress& from) {
-    std::string message(data.begin(), data.end());
-    processMessage(message, from);
     stats_.messages_received++;
     stats_.bytes_received += data.size();
+    dispatchMessage(std::string(data.begin(), data.end()), from);
 }
 
 void SipTransport::onTcpData(const std::vector<uint8_t>& data, const SocketAddress& from) {
-    std::string message(data.begin(), data.end());
-    processMessage(message, from);
     stats_.messages_received++;
     stats_.bytes_received += data.size();
+    dispatchMessage(std::string(data.begin(), data.end()), from);
 }
 
 void SipTransport::onTcpConnection(std::shared_ptr<Socket> connection) {
@@ -192,6 +356,7 @@ void SipTransport::onTcpConnection(std::shared_ptr<Socket> connection) {
         onError("TCP Connection " + key + ": " + error);
     });
     
+    attachTcpConnection(tcp_conn);
     tcp_conn->startReceiving();
     
     std::lock_guard<std::mutex> lock(mutex_);
@@ -200,6 +365,55 @@ void SipTransport::onTcpConnection(std::shared_ptr<Socket> connection) {
     core::Logger::info("New TCP connection established: {}", key);
 }
 
+void SipTransport::onWebSocketConnection(std::shared_ptr<Socket> connection) {
+    auto tcp_conn = std::dynamic_pointer_cast<TcpSocket>(connection);
+    if (!tcp_conn) return;
+    
+    SocketAddress remote = tcp_conn->getRemoteAddress();
+    std::string key = remote.toString();
+    
+    // Attach before the connection starts receiving so every send is queued
+    attachTcpConnection(tcp_conn);
+    
+    auto ws_conn = std::make_shared<WebSocketConnection>(tcp_conn);
+    ws_conn->setSubprotocol("sip");
+    
+    ws_conn->setMessageCallback([this, remote](const std::string& message) {
+        stats_.messages_received++;
+        stats_.bytes_received += message.size();
+        dispatchMessage(message, remote);
+    });
+    
+    ws_conn->setErrorCallback([this, key](const std::string& error) {
+        onError("WebSocket Connection " + key + ": " + error);
+    });
+    
+    std::weak_ptr<WebSocketConnection> weak_conn = ws_conn;
+    ws_conn->setCloseCallback([this, key, weak_conn]() {
+        // Keep the connection alive until its own callback has returned
+        auto self = weak_conn.lock();
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = ws_connections_.find(key);
+        if (it != ws_connections_.end() && it->second == self) {
+            ws_connections_.erase(it);
+            core::Logger::info("WebSocket connection closed: {}", key);
+        }
+    });
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ws_connections_[key] = ws_conn;
+    }
+    ws_conn->start();
+    
+    core::Logger::info("New WebSocket connection established: {}", key);
+}
+
+size_t SipTransport::getWebSocketConnectionCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ws_connections_.size();
+}
+
 void SipTransport::onError(const std::string& error) {
     stats_.errors++;
     if (error_callback_) {
@@ -207,6 +421,35 @@ void SipTransport::onError(const std::string& error) {
     }
 }
 
+void SipTransport::dispatchMessage(std::string message, const SocketAddress& from) {
+    // Shed before queueing, so a rejected request costs a parse and a send
+    if (isInitialRequest(message) && !overload_.admit(pending_tasks_)) {
+        rejectOverloaded(message, from);
+        return;
+    }
+
+    core::Executor* executor = executor_;
+    if (!executor) {
+        processMessage(message, from);
+        return;
+    }
+
+    // One call's messages stay on one worker and keep their order
+    std::string_view call_id = findHeader(message, "Call-ID", "i");
+    uint64_t affinity = core::Executor::affinityKey(call_id.empty() ? std::string_view(from.toString()) : call_id);
+
+    pending_tasks_++;
+    auto queued = OverloadController::Clock::now();
+    core::Executor::Task task = [this, message = std::move(message), from, queued]() {
+        overload_.onProcessed(OverloadController::Clock::now() - queued, pending_tasks_);
+        processMessage(message, from);
+        pending_tasks_--;
+    };
+    if (!executor->post(std::move(task), core::TaskPriority::SIGNALING, affinity)) {
+        task();
+    }
+}
+
 void SipTransport::processMessage(const std::string& message, const SocketAddress& from) {
     try {
         if (message_callback_) {
@@ -218,12 +461,41 @@ void SipTransport::processMessage(const std::string& message, const SocketAddres
     }
 }
 
+void SipTransport::rejectOverloaded(const std::string& message, const SocketAddress& from) {
+    try {
+        fmus::sip::SipMessage request = fmus::sip::SipMessage::fromString(message);
+        std::string retry_after = std::to_string(overload_.retryAfter());
+        fmus::sip::ResponseTemplate::Values values;
+        values.value = retry_after;
+        sendResponse(overload_reply_, request, from, values);
+    } catch (const std::exception& e) {
+        onError("Failed to parse SIP message from " + from.toString() + ": " + e.what());
+    }
+}
+
 // RtpTransport implementation
-RtpTransport::RtpTransport() {
+RtpTransport::RtpTransport() : affinity_(next_rtp_affinity++) {
+    // RFC 3551 static payload types; dynamic ones default to 8000 Hz
+    for (uint32_t type = 0; type < clock_rates_.size(); ++type) {
+        uint32_t rate = 8000;
+        if (type == 10 || type == 11) {
+            rate = 44100;
+        } else if (type == 14 || (type >= 25 && type <= 34)) {
+            rate = 90000;
+        } else if (type == 6) {
+            rate = 16000;
+        } else if (type == 16) {
+            rate = 11025;
+        } else if (type == 17) {
+            rate = 22050;
+        }
+        clock_rates_[type] = rate;
+    }
 }
 
 RtpTransport::~RtpTransport() {
     stop();
+    waitForTasks(pending_tasks_);
 }
 
 bool RtpTransport::start(const SocketAddress& rtp_address, const SocketAddress& rtcp_address) {
@@ -236,42 +508,26 @@ bool RtpTransport::start(const SocketAddress& rtp_address, const SocketAddress&
     
     // Start RTP socket
     rtp_socket_ = createUdpSocket();
-    
-    rtp_socket_->setDataCallback([this](const std::vector<uint8_t>& data, const SocketAddress& from) {
-        onRtpData(data, from);
-    });
-    
-    rtp_socket_->setErrorCallback([this](const std::string& error) {
-        onError("RTP: " + error);
-    });
-    
     if (!rtp_socket_->bind(rtp_address)) {
         rtp_socket_.reset();
         return false;
     }
     
-    rtp_socket_->startReceiving();
-    
     // Start RTCP socket if address provided
     if (rtcp_address.port != 0) {
         rtcp_socket_ = createUdpSocket();
-        
-        rtcp_socket_->setDataCallback([this](const std::vector<uint8_t>& data, const SocketAddress& from) {
-            onRtcpData(data, from);
-        });
-        
-        rtcp_socket_->setErrorCallback([this](const std::string& error) {
-            onError("RTCP: " + error);
-        });
-        
         if (!rtcp_socket_->bind(rtcp_address)) {
             rtp_socket_->close();
             rtp_socket_.reset();
             rtcp_socket_.reset();
             return false;
         }
-        
-        rtcp_socket_->startReceiving();
+    }
+    
+    owns_sockets_ = true;
+    attachSockets();
+    
+    if (rtcp_socket_) {
         core::Logger::info("RTP transport started on {} (RTCP: {})", 
                           rtp_address.toString(), rtcp_address.toString());
     } else {
@@ -281,17 +537,72 @@ bool RtpTransport::start(const SocketAddress& rtp_address, const SocketAddress&
     return true;
 }
 
-void RtpTransport::stop() {
+bool RtpTransport::start(const RtpPortPair& ports) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     if (rtp_socket_) {
-        rtp_socket_->close();
-        rtp_socket_.reset();
+        core::Logger::warn("RTP transport already started");
+        return true;
+    }
+    
+    if (!ports.isBound()) {
+        core::Logger::error("RTP transport needs a pre-bound port pair");
+        return false;
     }
     
+    rtp_socket_ = ports.rtp_socket;
+    rtcp_socket_ = ports.rtcp_socket;
+    owns_sockets_ = false;
+    attachSockets();
+    
+    core::Logger::debug("RTP transport started on pooled port {}", ports.rtp_port);
+    return true;
+}
+
+void RtpTransport::attachSockets() {
+    if (receive_timestamps_ && !rtp_socket_->enableReceiveTimestamps()) {
+        core::Logger::warn("RTP receive timestamps unavailable, timing packets as they are read");
+    }
+    rtp_socket_->setTimedDataCallback([this](const std::vector<uint8_t>& data, const SocketAddress& from,
+                                             ReceiveTime received) {
+        onRtpData(data, from, received);
+    });
+    rtp_socket_->setErrorCallback([this](const std::string& error) {
+        onError("RTP: " + error);
+    });
+    rtp_socket_->startReceiving();
+    
     if (rtcp_socket_) {
-        rtcp_socket_->close();
-        rtcp_socket_.reset();
+        rtcp_socket_->setDataCallback([this](const std::vector<uint8_t>& data, const SocketAddress& from) {
+            onRtcpData(data, from);
+        });
+        rtcp_socket_->setErrorCallback([this](const std::string& error) {
+            onError("RTCP: " + error);
+        });
+        rtcp_socket_->startReceiving();
+    }
+}
+
+void RtpTransport::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    for (auto* socket : {&rtp_socket_, &rtcp_socket_}) {
+        if (!*socket) {
+            continue;
+        }
+        if (owns_sockets_) {
+            (*socket)->close();
+        } else {
+            // Pooled sockets stay bound; detach so the pool can hand them out again
+            (*socket)->stopReceiving();
+            (*socket)->setDataCallback(nullptr);
+            (*socket)->setTimedDataCallback(nullptr);
+            (*socket)->setErrorCallback(nullptr);
+            if ((*socket)->hasReceiveTimestamps()) {
+                (*socket)->enableReceiveTimestamps(false);
+            }
+        }
+        socket->reset();
     }
     
     core::Logger::info("RTP transport stopped");
@@ -307,12 +618,12 @@ bool RtpTransport::sendRtpPacket(const fmus::rtp::RtpPacket& packet, const Socke
 
     auto data = packet.serialize();
     if (rtp_socket_->send(data, destination)) {
-        stats_.rtp_packets_sent++;
-        stats_.bytes_sent += data.size();
+        rtp_packets_sent_++;
+        bytes_sent_ += data.size();
         return true;
     }
 
-    stats_.errors++;
+    errors_++;
     return false;
 }
 
@@ -326,48 +637,378 @@ bool RtpTransport::sendRtcpPacket(const fmus::rtp::RtcpPacket& packet, const Soc
 
     auto data = packet.serialize();
     if (rtcp_socket_->send(data, destination)) {
-        stats_.rtcp_packets_sent++;
-        stats_.bytes_sent += data.size();
+        rtcp_packets_sent_++;
+        bytes_sent_ += data.size();
         return true;
     }
 
-    stats_.errors++;
+    errors_++;
     return false;
 }
 
-void RtpTransport::onRtpData(const std::vector<uint8_t>& data, const SocketAddress& from) {
+void RtpTransport::onRtpData(const std::vector<uint8_t>& data, const SocketAddress& from, ReceiveTime received) {
+    dispatchPacket(data, from, false, received);
+}
+
+void RtpTransport::onRtcpData(const std::vector<uint8_t>& data, const SocketAddress& from) {
+    dispatchPacket(data, from, true);
+}
+
+void RtpTransport::dispatchPacket(const std::vector<uint8_t>& data, const SocketAddress& from, bool rtcp,
+                                  ReceiveTime received) {
+    core::Executor* executor = executor_;
+    if (!executor) {
+        rtcp ? processRtcp(data, from) : processRtp(data, from, received);
+        return;
+    }
+
+    // Keyed by transport, so callbacks never overlap and each stream stays in order
+    uint64_t affinity = affinity_;
+
+    pending_tasks_++;
+    // The receive time travels with the packet, so executor queueing does
+    // not show up as jitter
+    core::Executor::Task task = [this, data, from, rtcp, received]() {
+        rtcp ? processRtcp(data, from) : processRtp(data, from, received);
+        pending_tasks_--;
+    };
+    if (!executor->post(std::move(task), core::TaskPriority::MEDIA, affinity)) {
+        task();
+    }
+}
+
+void RtpTransport::processRtp(const std::vector<uint8_t>& data, const SocketAddress& from, ReceiveTime received) {
     try {
         auto packet = fmus::rtp::RtpPacket::deserialize(data.data(), data.size());
+        if (packet && received.count() != 0) {
+            updateSource(*packet, received);
+        }
         if (packet && rtp_callback_) {
             rtp_callback_(*packet, from);
-            stats_.rtp_packets_received++;
-            stats_.bytes_received += data.size();
+            rtp_packets_received_++;
+            bytes_received_ += data.size();
         }
     } catch (const std::exception& e) {
         onError("Failed to parse RTP packet from " + from.toString() + ": " + e.what());
     }
 }
 
-void RtpTransport::onRtcpData(const std::vector<uint8_t>& data, const SocketAddress& from) {
+void RtpTransport::processRtcp(const std::vector<uint8_t>& data, const SocketAddress& from) {
     try {
         auto packet = fmus::rtp::RtcpPacket::deserialize(data.data(), data.size());
         if (packet && rtcp_callback_) {
             rtcp_callback_(*packet, from);
-            stats_.rtcp_packets_received++;
-            stats_.bytes_received += data.size();
+            rtcp_packets_received_++;
+            bytes_received_ += data.size();
         }
     } catch (const std::exception& e) {
         onError("Failed to parse RTCP packet from " + from.toString() + ": " + e.what());
     }
 }
 
+void RtpTransport::updateSource(const fmus::rtp::RtpPacket& packet, ReceiveTime received) {
+    const auto& header = packet.getHeader();
+    uint32_t clock_rate = clock_rates_[header.payload_type & 0x7f];
+
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    auto it = sources_.find(header.ssrc);
+    if (it == sources_.end()) {
+        if (sources_.size() >= MAX_SOURCES) {
+            return;
+        }
+        it = sources_.emplace(header.ssrc, SourceState{}).first;
+        it->second.stats.ssrc = header.ssrc;
+    }
+
+    SourceState& source = it->second;
+    source.stats.packets++;
+
+    // A new clock (codec switch) restarts the comparison
+    if (source.clock_rate == clock_rate && source.last_arrival.count() != 0) {
+        // Difference in transit time between this packet and the last,
+        // RFC 3550 6.4.1; the signed cast handles timestamp wrap
+        double arrival_delta = std::chrono::duration<double>(received - source.last_arrival).count();
+        double timestamp_delta = static_cast<int32_t>(header.timestamp - source.last_timestamp) /
+                                 static_cast<double>(clock_rate);
+        double d = arrival_delta - timestamp_delta;
+
+        source.jitter += (std::abs(d) - source.jitter) / 16.0;
+        source.transit += d;
+        source.min_transit = std::min(source.min_transit, source.transit);
+
+        source.stats.jitter_ms = source.jitter * 1000.0;
+        source.stats.relative_delay_ms = (source.transit - source.min_transit) * 1000.0;
+        source.stats.max_relative_delay_ms = std::max(source.stats.max_relative_delay_ms,
+                                                      source.stats.relative_delay_ms);
+    } else if (source.clock_rate != clock_rate) {
+        source.clock_rate = clock_rate;
+        source.transit = 0;
+        source.min_transit = 0;
+    }
+
+    source.last_timestamp = header.timestamp;
+    source.last_arrival = received;
+}
+
+void RtpTransport::setClockRate(uint8_t payload_type, uint32_t clock_rate) {
+    if (payload_type < clock_rates_.size() && clock_rate > 0) {
+        clock_rates_[payload_type] = clock_rate;
+    }
+}
+
+std::vector<RtpTransport::SourceStats> RtpTransport::getSourceStats() const {
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    std::vector<SourceStats> stats;
+    stats.reserve(sources_.size());
+    for (const auto& [ssrc, source] : sources_) {
+        stats.push_back(source.stats);
+    }
+    return stats;
+}
+
+RtpTransport::Stats RtpTransport::getStats() const {
+    Stats stats;
+    stats.rtp_packets_sent = rtp_packets_sent_;
+    stats.rtp_packets_received = rtp_packets_received_;
+    stats.rtcp_packets_sent = rtcp_packets_sent_;
+    stats.rtcp_packets_received = rtcp_packets_received_;
+    stats.bytes_sent = bytes_sent_;
+    stats.bytes_received = bytes_received_;
+    stats.errors = errors_;
+    return stats;
+}
+
+void RtpTransport::resetStats() {
+    rtp_packets_sent_ = 0;
+    rtp_packets_received_ = 0;
+    rtcp_packets_sent_ = 0;
+    rtcp_packets_received_ = 0;
+    bytes_sent_ = 0;
+    bytes_received_ = 0;
+    errors_ = 0;
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    sources_.clear();
+}
+
 void RtpTransport::onError(const std::string& error) {
-    stats_.errors++;
+    errors_++;
     if (error_callback_) {
         error_callback_(error);
     }
 }
 
+// RtpPortPool implementation
+RtpPortPool::RtpPortPool() {
+}
+
+RtpPortPool::RtpPortPool(const Config& config) : config_(config) {
+}
+
+RtpPortPool::~RtpPortPool() {
+    stop();
+}
+
+void RtpPortPool::setConfig(const Config& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+bool RtpPortPool::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (running_) {
+        return true;
+    }
+    
+    first_port_ = static_cast<uint16_t>(config_.min_port + (config_.min_port & 1));
+    size_t pairs = config_.max_port > first_port_ ? (config_.max_port - first_port_ + 1) / 2 : 0;
+    
+    if (config_.pre_bind) {
+        // Two descriptors per pair; leave headroom for everything else
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+            size_t budget = limit.rlim_cur > FD_HEADROOM ? (limit.rlim_cur - FD_HEADROOM) / 2 : 0;
+            if (budget < pairs) {
+                core::Logger::warn("RTP port pool limited to {} of {} pairs by the open file limit ({})",
+                                   budget, pairs, limit.rlim_cur);
+                pairs = budget;
+            }
+        }
+    }
+    
+    entries_.clear();
+    entries_.resize(pairs);
+    free_.clear();
+    free_.reserve(pairs);
+    quarantine_.clear();
+    
+    size_t failures = 0;
+    for (size_t i = 0; i < pairs; ++i) {
+        Entry& entry = entries_[i];
+        entry.pair.rtp_port = static_cast<uint16_t>(first_port_ + 2 * i);
+        if (config_.pre_bind && !bindPair(entry.pair)) {
+            bind_failures_++;
+            failures++;
+            continue;
+        }
+        free_.push_back(static_cast<uint32_t>(i));
+    }
+    
+    // Lowest ports on top of the stack
+    std::reverse(free_.begin(), free_.end());
+    
+    if (failures > 0) {
+        core::Logger::warn("RTP port pool skipped {} pairs that could not be bound", failures);
+    }
+    if (free_.empty()) {
+        core::Logger::error("RTP port pool has no usable ports in {}-{}", config_.min_port, config_.max_port);
+        entries_.clear();
+        return false;
+    }
+    
+    capacity_ = free_.size();
+    running_ = true;
+    core::Logger::info("RTP port pool ready with {} pairs from {}{}", free_.size(), first_port_,
+                       config_.pre_bind ? " (pre-bound)" : "");
+    return true;
+}
+
+void RtpPortPool::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!running_) {
+        return;
+    }
+    
+    for (Entry& entry : entries_) {
+        for (auto* socket : {&entry.pair.rtp_socket, &entry.pair.rtcp_socket}) {
+            if (*socket) {
+                (*socket)->close();
+            }
+        }
+    }
+    entries_.clear();
+    free_.clear();
+    quarantine_.clear();
+    capacity_ = 0;
+    running_ = false;
+}
+
+std::optional<RtpPortPair> RtpPortPool::allocate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!running_) {
+        return std::nullopt;
+    }
+    
+    if (!quarantine_.empty()) {
+        reclaim(std::chrono::steady_clock::now());
+    }
+    
+    if (free_.empty()) {
+        exhausted_++;
+        return std::nullopt;
+    }
+    
+    uint32_t index = free_.back();
+    free_.pop_back();
+    
+    Entry& entry = entries_[index];
+    entry.allocated = true;
+    allocations_++;
+    return entry.pair;
+}
+
+void RtpPortPool::release(const RtpPortPair& pair) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!running_ || pair.rtp_port < first_port_ || (pair.rtp_port - first_port_) % 2 != 0) {
+        return;
+    }
+    
+    uint32_t index = (pair.rtp_port - first_port_) / 2;
+    if (index >= entries_.size() || !entries_[index].allocated) {
+        core::Logger::warn("Ignoring release of RTP port {} which is not allocated", pair.rtp_port);
+        return;
+    }
+    
+    entries_[index].allocated = false;
+    releases_++;
+    
+    if (config_.quarantine.count() > 0) {
+        quarantine_.emplace_back(std::chrono::steady_clock::now() + config_.quarantine, index);
+    } else {
+        free_.push_back(index);
+    }
+}
+
+size_t RtpPortPool::available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+}
+
+size_t RtpPortPool::quarantined() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return quarantine_.size();
+}
+
+size_t RtpPortPool::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+RtpPortPool::Stats RtpPortPool::getStats() const {
+    Stats stats;
+    stats.allocations = allocations_;
+    stats.releases = releases_;
+    stats.exhausted = exhausted_;
+    stats.bind_failures = bind_failures_;
+    stats.stray_packets = stray_packets_;
+    return stats;
+}
+
+void RtpPortPool::resetStats() {
+    allocations_ = 0;
+    releases_ = 0;
+    exhausted_ = 0;
+    stray_packets_ = 0;
+}
+
+bool RtpPortPool::bindPair(RtpPortPair& pair) {
+    auto rtp = createUdpSocket();
+    auto rtcp = createUdpSocket();
+    
+    if (!rtp->bind(SocketAddress(config_.ip, pair.rtp_port))) {
+        return false;
+    }
+    if (!rtcp->bind(SocketAddress(config_.ip, pair.rtcpPort()))) {
+        rtp->close();
+        return false;
+    }
+    
+    if (config_.receive_buffer_size > 0) {
+        rtp->setReceiveBufferSize(config_.receive_buffer_size);
+    }
+    
+    pair.rtp_socket = std::move(rtp);
+    pair.rtcp_socket = std::move(rtcp);
+    return true;
+}
+
+void RtpPortPool::reclaim(std::chrono::steady_clock::time_point now) {
+    // Quarantine is in release order, so only its front can have expired
+    while (!quarantine_.empty() && quarantine_.front().first <= now) {
+        uint32_t index = quarantine_.front().second;
+        quarantine_.pop_front();
+        
+        const RtpPortPair& pair = entries_[index].pair;
+        if (pair.isBound()) {
+            stray_packets_ += pair.rtp_socket->discardPending() + pair.rtcp_socket->discardPending();
+        }
+        free_.push_back(index);
+    }
+}
+
 // TransportManager implementation
 TransportManager::TransportManager() {
 }
@@ -395,6 +1036,13 @@ bool TransportManager::initialize(const Config& config) {
         }
     }
 
+    if (config_.enable_sip_ws) {
+        if (!sip_transport_.startWebSocket(config_.sip_ws_address)) {
+            core::Logger::error("Failed to start SIP WebSocket transport");
+            success = false;
+        }
+    }
+
     if (config_.enable_rtp) {
         if (!rtp_transport_.start(config_.rtp_address, config_.rtcp_address)) {
             core::Logger::error("Failed to start RTP transport");
@@ -410,6 +1058,11 @@ bool TransportManager::initialize(const Config& config) {
     return success;
 }
 
+void TransportManager::setExecutor(core::Executor* executor) {
+    sip_transport_.setExecutor(executor);
+    rtp_transport_.setExecutor(executor);
+}
+
 void TransportManager::shutdown() {
     if (initialized_) {
         sip_transport_.stop();
@@ -0,0 +1,915 @@
+#include "fmus/network/uring.hpp"
+#include "fmus/core/logger.hpp"
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+namespace fmus::network {
+
+namespace {
+
+constexpr uint16_t BUFFER_GROUP = 0;
+constexpr auto DRAIN_TIMEOUT = std::chrono::seconds(1);
+
+int ringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int ringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+// The rings are shared with the kernel: indices are read with acquire and
+// published with release ordering
+unsigned loadAcquire(const unsigned* value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(unsigned* value, unsigned update) {
+    __atomic_store_n(value, update, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+T* at(void* base, size_t offset) {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(base) + offset);
+}
+
+// Multishot RECVMSG and provided buffer rings arrived in 6.0
+bool kernelAtLeast(int major, int minor) {
+    utsname name{};
+    if (uname(&name) != 0) {
+        return false;
+    }
+    int have_major = 0;
+    int have_minor = 0;
+    if (sscanf(name.release, "%d.%d", &have_major, &have_minor) != 2) {
+        return false;
+    }
+    return have_major > major || (have_major == major && have_minor >= minor);
+}
+
+} // namespace
+
+struct IoUring::Operation {
+    enum class Kind {
+        WAKE,
+        RECEIVE,
+        SEND,
+        WRITE
+    };
+
+    explicit Operation(Kind kind) : kind(kind) {}
+    Kind kind;
+};
+
+struct IoUring::Receiver : Operation {
+    Receiver() : Operation(Kind::RECEIVE) {}
+
+    uint64_t id = 0;
+    int slot = -1;
+    ReceiveHandler handler;
+    msghdr header{}; // Read by the kernel for as long as the request is armed
+    std::atomic<bool> active{true};
+};
+
+struct IoUring::SendOperation : Operation {
+    SendOperation() : Operation(Kind::SEND) {}
+
+    SharedBuffer buffer;
+    sockaddr_in address{};
+    iovec iov{};
+    msghdr header{};
+    __kernel_timespec timeout{};
+    Completion done;
+};
+
+struct IoUring::WriteOperation : Operation {
+    WriteOperation() : Operation(Kind::WRITE) {}
+
+    WriteBatch* batch = nullptr;
+    int* result = nullptr;
+    const Completion* done = nullptr;
+};
+
+struct IoUring::WriteBatch {
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t remaining = 0;
+};
+
+struct IoUring::SubmissionQueue {
+    unsigned* head;
+    unsigned* tail;
+    unsigned mask;
+    unsigned entries;
+    io_uring_sqe* sqes;
+};
+
+struct IoUring::CompletionQueue {
+    unsigned* head;
+    unsigned* tail;
+    unsigned mask;
+    io_uring_cqe* cqes;
+};
+
+IoUring::IoUring() : running_(false), wake_op_(std::make_unique<Operation>(Operation::Kind::WAKE)) {
+}
+
+IoUring::~IoUring() {
+    stop();
+}
+
+bool IoUring::isSupported() {
+    static const bool supported = [] {
+        if (!kernelAtLeast(6, 0)) {
+            return false;
+        }
+
+        io_uring_params params{};
+        int fd = ringSetup(8, &params);
+        if (fd < 0) {
+            return false; // ENOSYS, or disabled by io_uring_disabled / seccomp
+        }
+
+        // The probe reports opcodes; the flags used with them came no later
+        std::vector<uint8_t> memory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(memory.data());
+        bool ok = ringRegister(fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+        for (int op : {IORING_OP_RECVMSG, IORING_OP_SENDMSG, IORING_OP_LINK_TIMEOUT, IORING_OP_WRITE,
+                       IORING_OP_WRITE_FIXED, IORING_OP_READ, IORING_OP_ASYNC_CANCEL}) {
+            ok = ok && op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        }
+        ::close(fd);
+        return ok;
+    }();
+    return supported;
+}
+
+IoUring& IoUring::shared() {
+    static IoUring ring;
+    return ring;
+}
+
+void IoUring::setConfig(const Config& config) {
+    config_ = config;
+    // The buffer ring indexes with a mask and buffer ids are 16 bits
+    unsigned count = 1;
+    while (count < std::clamp<unsigned>(config.buffer_count, 1, 32768)) {
+        count <<= 1;
+    }
+    config_.buffer_count = count;
+}
+
+bool IoUring::start() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (running_) {
+        return true;
+    }
+
+    if (!setupRing() || !setupBufferRing()) {
+        teardown();
+        return false;
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        core::Logger::error("Failed to create io_uring wake eventfd: {}", strerror(errno));
+        teardown();
+        return false;
+    }
+
+    running_ = true;
+    completion_thread_ = std::thread(&IoUring::completionLoop, this);
+    completion_thread_id_ = completion_thread_.get_id();
+
+    core::Logger::info("io_uring ring started: {} entries, {} x {} byte receive buffers",
+                      sq_->entries, config_.buffer_count, config_.buffer_size);
+    return true;
+}
+
+void IoUring::stop() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (!running_) {
+        return;
+    }
+
+    running_ = false;
+    wake();
+    if (completion_thread_.joinable()) {
+        completion_thread_.join();
+    }
+    teardown();
+    core::Logger::info("io_uring ring stopped");
+}
+
+bool IoUring::setupRing() {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    // Multishot receives post many completions per submission
+    params.cq_entries = std::max(config_.entries, 1u) * 4;
+
+    ring_fd_ = ringSetup(std::max(config_.entries, 1u), &params);
+    if (ring_fd_ < 0) {
+        core::Logger::error("io_uring_setup failed: {}", strerror(errno));
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_NODROP)) {
+        core::Logger::error("io_uring lacks IORING_FEAT_NODROP");
+        return false;
+    }
+
+    sq_map_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_map_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_map_size_ = cq_map_size_ = std::max(sq_map_size_, cq_map_size_);
+    }
+
+    sq_map_ = mmap(nullptr, sq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_map_ == MAP_FAILED) {
+        sq_map_ = nullptr;
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_map_ = sq_map_;
+    } else {
+        cq_map_ = mmap(nullptr, cq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_map_ == MAP_FAILED) {
+            cq_map_ = nullptr;
+            return false;
+        }
+    }
+    sqe_map_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqe_map_ = mmap(nullptr, sqe_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQES);
+    if (sqe_map_ == MAP_FAILED) {
+        sqe_map_ = nullptr;
+        return false;
+    }
+
+    sq_ = std::make_unique<SubmissionQueue>();
+    sq_->head = at<unsigned>(sq_map_, params.sq_off.head);
+    sq_->tail = at<unsigned>(sq_map_, params.sq_off.tail);
+    sq_->mask = *at<unsigned>(sq_map_, params.sq_off.ring_mask);
+    sq_->entries = params.sq_entries;
+    sq_->sqes = static_cast<io_uring_sqe*>(sqe_map_);
+
+    // Slots are used in order, so the indirection array is the identity
+    unsigned* array = at<unsigned>(sq_map_, params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i) {
+        array[i] = i;
+    }
+
+    cq_ = std::make_unique<CompletionQueue>();
+    cq_->head = at<unsigned>(cq_map_, params.cq_off.head);
+    cq_->tail = at<unsigned>(cq_map_, params.cq_off.tail);
+    cq_->mask = *at<unsigned>(cq_map_, params.cq_off.ring_mask);
+    cq_->cqes = at<io_uring_cqe>(cq_map_, params.cq_off.cqes);
+
+    // Sparse tables: slots are filled and cleared one at a time later
+    io_uring_rsrc_register files{};
+    files.nr = config_.fixed_files;
+    files.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (config_.fixed_files > 0 &&
+        ringRegister(ring_fd_, IORING_REGISTER_FILES2, &files, sizeof(files)) == 0) {
+        free_file_slots_.clear();
+        for (int slot = static_cast<int>(config_.fixed_files) - 1; slot >= 0; --slot) {
+            free_file_slots_.push_back(slot);
+        }
+    } else {
+        core::Logger::warn("io_uring registered files unavailable: {}", strerror(errno));
+    }
+
+    unsigned workers[2] = {16, 0}; // Bounded (file) workers, unbounded unchanged
+    ringRegister(ring_fd_, IORING_REGISTER_IOWQ_MAX_WORKERS, workers, 2);
+
+    io_uring_rsrc_register buffers{};
+    buffers.nr = config_.fixed_buffers;
+    buffers.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (config_.fixed_buffers > 0 &&
+        ringRegister(ring_fd_, IORING_REGISTER_BUFFERS2, &buffers, sizeof(buffers)) == 0) {
+        free_buffer_slots_.clear();
+        for (int slot = static_cast<int>(config_.fixed_buffers) - 1; slot >= 0; --slot) {
+            free_buffer_slots_.push_back(slot);
+        }
+    } else {
+        core::Logger::warn("io_uring registered buffers unavailable: {}", strerror(errno));
+    }
+
+    return true;
+}
+
+bool IoUring::setupBufferRing() {
+    buffer_ring_size_ = config_.buffer_count * sizeof(io_uring_buf);
+    buffer_ring_ = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer_ring_ == MAP_FAILED) {
+        buffer_ring_ = nullptr;
+        return false;
+    }
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(buffer_ring_);
+    registration.ring_entries = config_.buffer_count;
+    registration.bgid = BUFFER_GROUP;
+    if (ringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &registration, 1) != 0) {
+        core::Logger::error("io_uring provided buffer ring registration failed: {}", strerror(errno));
+        return false;
+    }
+
+    buffers_.assign(static_cast<size_t>(config_.buffer_count) * config_.buffer_size, 0);
+    buffer_tail_ = 0;
+    for (unsigned id = 0; id < config_.buffer_count; ++id) {
+        recycleBuffer(static_cast<uint16_t>(id));
+    }
+    return true;
+}
+
+void IoUring::teardown() {
+    {
+        std::lock_guard<std::mutex> lock(receiver_mutex_);
+        receivers_.clear();
+        arm_queue_.clear();
+    }
+    receiver_cv_.notify_all();
+
+    // Closing the ring cancels what is left and drops every registration
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    if (sqe_map_) {
+        munmap(sqe_map_, sqe_map_size_);
+        sqe_map_ = nullptr;
+    }
+    if (cq_map_ && cq_map_ != sq_map_) {
+        munmap(cq_map_, cq_map_size_);
+    }
+    cq_map_ = nullptr;
+    if (sq_map_) {
+        munmap(sq_map_, sq_map_size_);
+        sq_map_ = nullptr;
+    }
+    if (buffer_ring_) {
+        munmap(buffer_ring_, buffer_ring_size_);
+        buffer_ring_ = nullptr;
+    }
+    buffers_.clear();
+    buffers_.shrink_to_fit();
+    sq_.reset();
+    cq_.reset();
+
+    std::lock_guard<std::mutex> lock(resource_mutex_);
+    free_file_slots_.clear();
+    free_buffer_slots_.clear();
+}
+
+uint64_t IoUring::addReceiver(int fd, ReceiveHandler handler) {
+    if (!running_ || fd < 0) {
+        return 0;
+    }
+
+    int slot = allocateFileSlot(fd);
+    if (slot < 0) {
+        return 0;
+    }
+
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(receiver_mutex_);
+        auto receiver = std::make_unique<Receiver>();
+        id = receiver->id = next_receiver_id_++;
+        receiver->slot = slot;
+        receiver->handler = std::move(handler);
+        // The kernel lays out each buffer as header, source address, control
+        // messages (room for a receive timestamp), payload
+        receiver->header.msg_namelen = sizeof(sockaddr_in);
+        receiver->header.msg_controllen = RECEIVE_TIMESTAMP_CONTROL_SIZE;
+        arm_queue_.push_back(receiver.get());
+        receivers_.emplace(id, std::move(receiver));
+    }
+
+    // Armed from the completion thread: a request belongs to the thread that
+    // submitted it and would be cancelled when that thread exits
+    wake();
+    return id;
+}
+
+void IoUring::removeReceiver(uint64_t id) {
+    std::unique_lock<std::mutex> lock(receiver_mutex_);
+    auto it = receivers_.find(id);
+    if (it == receivers_.end()) {
+        return;
+    }
+
+    Receiver* receiver = it->second.get();
+    receiver->active = false;
+    auto queued = std::find(arm_queue_.begin(), arm_queue_.end(), receiver);
+    if (queued != arm_queue_.end()) {
+        // Never armed, nothing to cancel
+        arm_queue_.erase(queued);
+        releaseFileSlot(receiver->slot);
+        receivers_.erase(it);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+        if (io_uring_sqe* sqe = nextSqe()) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(static_cast<Operation*>(receiver));
+            submit();
+        }
+    }
+
+    // The last completion removes the receiver; from its own handler, let it
+    if (std::this_thread::get_id() == completion_thread_id_) {
+        return;
+    }
+    receiver_cv_.wait(lock, [&] { return receivers_.count(id) == 0 || !running_; });
+}
+
+bool IoUring::send(int fd, SharedBuffer buffer, const SocketAddress& to, Completion done) {
+    if (!running_ || fd < 0 || !buffer) {
+        return false;
+    }
+
+    auto* operation = new SendOperation();
+    operation->buffer = std::move(buffer);
+    operation->done = std::move(done);
+    operation->iov = {const_cast<uint8_t*>(operation->buffer->data()), operation->buffer->size()};
+    operation->header.msg_iov = &operation->iov;
+    operation->header.msg_iovlen = 1;
+    if (!to.ip.empty() || to.port != 0) {
+        operation->address = to.toSockAddr();
+        operation->header.msg_name = &operation->address;
+        operation->header.msg_namelen = sizeof(operation->address);
+    }
+    auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.send_timeout);
+    operation->timeout.tv_sec = timeout.count() / 1000000000;
+    operation->timeout.tv_nsec = timeout.count() % 1000000000;
+
+    std::lock_guard<std::mutex> lock(submit_mutex_);
+    // The pair must sit in adjacent slots, so reserve both before filling
+    if (sq_->entries - (*sq_->tail - loadAcquire(sq_->head)) < 2) {
+        submit();
+    }
+    io_uring_sqe* sqe = nextSqe();
+    io_uring_sqe* timeout_sqe = sqe ? nextSqe() : nullptr;
+    if (!timeout_sqe) {
+        delete operation;
+        return false; // Unreachable: a just-submitted ring has room for two
+    }
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->addr = reinterpret_cast<uint64_t>(&operation->header);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = reinterpret_cast<uint64_t>(static_cast<Operation*>(operation));
+
+    timeout_sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    timeout_sqe->fd = -1;
+    timeout_sqe->addr = reinterpret_cast<uint64_t>(&operation->timeout);
+    timeout_sqe->len = 1;
+
+    in_flight_++;
+    // Submitted here rather than by the completion thread, so the socket
+    // is referenced before the caller can close it
+    submit();
+    return true;
+}
+
+bool IoUring::writeFiles(const FileWrite* writes, size_t count, int* results) {
+    if (!running_) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    WriteBatch batch;
+    batch.remaining = count;
+    std::vector<WriteOperation> operations(count);
+
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            io_uring_sqe* sqe = nextSqe();
+            if (!sqe) {
+                // Unreachable: nextSqe() makes room by submitting
+                std::lock_guard<std::mutex> batch_lock(batch.mutex);
+                batch.remaining -= count - i;
+                for (size_t j = i; j < count; ++j) {
+                    results[j] = -EAGAIN;
+                }
+                break;
+            }
+
+            const FileWrite& write = writes[i];
+            operations[i].batch = &batch;
+            operations[i].result = &results[i];
+            operations[i].done = &write.done;
+            sqe->opcode = write.buffer_index >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe->fd = write.fd;
+            sqe->addr = reinterpret_cast<uint64_t>(write.data);
+            sqe->len = static_cast<uint32_t>(write.size);
+            sqe->off = write.offset;
+            if (write.buffer_index >= 0) {
+                sqe->buf_index = static_cast<uint16_t>(write.buffer_index);
+                fixed_writes_++;
+            }
+            sqe->user_data = reinterpret_cast<uint64_t>(static_cast<Operation*>(&operations[i]));
+            in_flight_++;
+        }
+        submit();
+    }
+    file_writes_ += count;
+
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.cv.wait(lock, [&] { return batch.remaining == 0; });
+    return true;
+}
+
+int IoUring::registerBuffer(void* data, size_t size) {
+    std::lock_guard<std::mutex> lock(resource_mutex_);
+    if (!running_ || free_buffer_slots_.empty()) {
+        return -1;
+    }
+
+    int slot = free_buffer_slots_.back();
+    iovec buffer{data, size};
+    io_uring_rsrc_update2 update{};
+    update.offset = static_cast<uint32_t>(slot);
+    update.data = reinterpret_cast<uint64_t>(&buffer);
+    update.nr = 1;
+    // Fails once pinned memory would pass RLIMIT_MEMLOCK; plain writes still work
+    if (ringRegister(ring_fd_, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) != 1) {
+        return -1;
+    }
+    free_buffer_slots_.pop_back();
+    return slot;
+}
+
+void IoUring::unregisterBuffer(int index) {
+    std::lock_guard<std::mutex> lock(resource_mutex_);
+    if (index < 0 || ring_fd_ < 0) {
+        return;
+    }
+
+    // An empty entry clears the slot; writes in flight keep their own reference
+    iovec empty{nullptr, 0};
+    io_uring_rsrc_update2 update{};
+    update.offset = static_cast<uint32_t>(index);
+    update.data = reinterpret_cast<uint64_t>(&empty);
+    update.nr = 1;
+    ringRegister(ring_fd_, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update));
+    free_buffer_slots_.push_back(index);
+}
+
+int IoUring::allocateFileSlot(int fd) {
+    std::lock_guard<std::mutex> lock(resource_mutex_);
+    if (free_file_slots_.empty()) {
+        core::Logger::warn("io_uring registered file table full");
+        return -1;
+    }
+
+    int slot = free_file_slots_.back();
+    io_uring_rsrc_update2 update{};
+    update.offset = static_cast<uint32_t>(slot);
+    update.data = reinterpret_cast<uint64_t>(&fd);
+    update.nr = 1;
+    if (ringRegister(ring_fd_, IORING_REGISTER_FILES_UPDATE2, &update, sizeof(update)) != 1) {
+        core::Logger::warn("io_uring file registration failed: {}", strerror(errno));
+        return -1;
+    }
+    free_file_slots_.pop_back();
+    return slot;
+}
+
+void IoUring::releaseFileSlot(int slot) {
+    std::lock_guard<std::mutex> lock(resource_mutex_);
+    if (slot < 0 || ring_fd_ < 0) {
+        return;
+    }
+
+    // The table holds a reference; clear it so closing the socket frees it
+    int empty = -1;
+    io_uring_rsrc_update2 update{};
+    update.offset = static_cast<uint32_t>(slot);
+    update.data = reinterpret_cast<uint64_t>(&empty);
+    update.nr = 1;
+    ringRegister(ring_fd_, IORING_REGISTER_FILES_UPDATE2, &update, sizeof(update));
+    free_file_slots_.push_back(slot);
+}
+
+io_uring_sqe* IoUring::nextSqe() {
+    unsigned tail = *sq_->tail;
+    if (tail - loadAcquire(sq_->head) >= sq_->entries) {
+        submit();
+        if (tail - loadAcquire(sq_->head) >= sq_->entries) {
+            return nullptr;
+        }
+    }
+
+    io_uring_sqe* sqe = &sq_->sqes[tail & sq_->mask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    // Visible to the kernel only through submit()
+    storeRelease(sq_->tail, tail + 1);
+    return sqe;
+}
+
+bool IoUring::submit() {
+    unsigned ready = *sq_->tail - loadAcquire(sq_->head);
+    while (ready > 0) {
+        int submitted = ringEnter(ring_fd_, ready, 0, 0);
+        submit_calls_++;
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EBUSY) {
+                // Out of kernel memory or completions backed up; the
+                // completion thread makes progress, try again shortly
+                std::this_thread::yield();
+                continue;
+            }
+            core::Logger::error("io_uring submit failed: {}", strerror(errno));
+            return false;
+        }
+        ready = *sq_->tail - loadAcquire(sq_->head);
+    }
+    return true;
+}
+
+void IoUring::wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+}
+
+void IoUring::armWake() {
+    if (io_uring_sqe* sqe = nextSqe()) {
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = wake_fd_;
+        sqe->addr = reinterpret_cast<uint64_t>(&wake_value_);
+        sqe->len = sizeof(wake_value_);
+        sqe->user_data = reinterpret_cast<uint64_t>(wake_op_.get());
+    }
+}
+
+bool IoUring::armReceiver(Receiver& receiver) {
+    io_uring_sqe* sqe = nextSqe();
+    if (!sqe) {
+        return false;
+    }
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = receiver.slot;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->addr = reinterpret_cast<uint64_t>(&receiver.header);
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = reinterpret_cast<uint64_t>(static_cast<Operation*>(&receiver));
+    return true;
+}
+
+void IoUring::armQueued() {
+    std::lock_guard<std::mutex> lock(receiver_mutex_);
+    if (arm_queue_.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+    for (Receiver* receiver : arm_queue_) {
+        if (armReceiver(*receiver)) {
+            in_flight_++;
+        }
+    }
+    arm_queue_.clear();
+    submit();
+}
+
+void IoUring::recycleBuffer(uint16_t buffer_id) {
+    // Only the completion thread returns buffers after start(), so the tail
+    // has a single writer. The ring is addressed by hand: in C++ the header's
+    // flexible array starts after an empty struct, one byte off.
+    auto* entries = static_cast<io_uring_buf*>(buffer_ring_);
+    io_uring_buf& entry = entries[buffer_tail_ & (config_.buffer_count - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffers_.data() + static_cast<size_t>(buffer_id) * config_.buffer_size);
+    entry.len = static_cast<uint32_t>(config_.buffer_size);
+    entry.bid = buffer_id;
+    buffer_tail_++;
+    // The tail overlays the first entry's reserved field
+    __atomic_store_n(&entries[0].resv, buffer_tail_, __ATOMIC_RELEASE);
+}
+
+void IoUring::completionLoop() {
+    core::Logger::debug("io_uring completion thread started");
+
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        armWake();
+        submit();
+    }
+    armQueued();
+
+    bool cancelled = false;
+    std::chrono::steady_clock::time_point deadline;
+
+    while (true) {
+        if (!running_ && !cancelled) {
+            // Cancel everything still armed and wait for the completions
+            std::lock_guard<std::mutex> lock(submit_mutex_);
+            if (io_uring_sqe* sqe = nextSqe()) {
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+            }
+            submit();
+            cancelled = true;
+            deadline = std::chrono::steady_clock::now() + DRAIN_TIMEOUT;
+        }
+        if (cancelled && (in_flight_ == 0 || std::chrono::steady_clock::now() > deadline)) {
+            break;
+        }
+
+        int result = ringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+        wait_calls_++;
+        if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            core::Logger::error("io_uring wait failed: {}", strerror(errno));
+            break;
+        }
+
+        unsigned head = *cq_->head;
+        unsigned tail = loadAcquire(cq_->tail);
+        while (head != tail) {
+            io_uring_cqe cqe = cq_->cqes[head & cq_->mask];
+            head++;
+            // Hand the slot back before running handlers, which may be slow
+            storeRelease(cq_->head, head);
+
+            auto* operation = reinterpret_cast<Operation*>(cqe.user_data);
+            if (!operation) {
+                continue; // Link timeouts and cancellations
+            }
+
+            switch (operation->kind) {
+            case Operation::Kind::WAKE:
+                if (running_) {
+                    armQueued();
+                    std::lock_guard<std::mutex> lock(submit_mutex_);
+                    armWake();
+                    submit();
+                }
+                break;
+
+            case Operation::Kind::RECEIVE:
+                handleReceive(*static_cast<Receiver*>(operation), cqe.res, cqe.flags);
+                break;
+
+            case Operation::Kind::SEND: {
+                std::unique_ptr<SendOperation> send(static_cast<SendOperation*>(operation));
+                if (cqe.res >= 0) {
+                    sends_++;
+                } else if (cqe.res == -ECANCELED) {
+                    send_timeouts_++;
+                } else {
+                    send_errors_++;
+                }
+                in_flight_--;
+                if (send->done) {
+                    send->done(cqe.res);
+                }
+                break;
+            }
+
+            case Operation::Kind::WRITE: {
+                auto* write = static_cast<WriteOperation*>(operation);
+                *write->result = cqe.res;
+                in_flight_--;
+                if (*write->done) {
+                    (*write->done)(cqe.res);
+                }
+                std::lock_guard<std::mutex> lock(write->batch->mutex);
+                if (--write->batch->remaining == 0) {
+                    write->batch->cv.notify_all();
+                }
+                break;
+            }
+            }
+
+            tail = loadAcquire(cq_->tail);
+        }
+    }
+
+    core::Logger::debug("io_uring completion thread ended");
+}
+
+void IoUring::handleReceive(Receiver& receiver, int result, uint32_t flags) {
+    if (flags & IORING_CQE_F_BUFFER) {
+        auto buffer_id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        const uint8_t* buffer = buffers_.data() + static_cast<size_t>(buffer_id) * config_.buffer_size;
+
+        size_t prefix = sizeof(io_uring_recvmsg_out) + receiver.header.msg_namelen + receiver.header.msg_controllen;
+        if (result > 0 && static_cast<size_t>(result) >= prefix && receiver.active) {
+            io_uring_recvmsg_out out;
+            std::memcpy(&out, buffer, sizeof(out));
+
+            if (out.flags & MSG_TRUNC) {
+                truncated_++;
+            } else {
+                sockaddr_in from{};
+                std::memcpy(&from, buffer + sizeof(out), std::min<size_t>(out.namelen, sizeof(from)));
+                size_t size = std::min<size_t>(out.payloadlen, static_cast<size_t>(result) - prefix);
+
+                ReceiveTime received(0);
+                if (out.controllen > 0) {
+                    msghdr control{};
+                    control.msg_control = const_cast<uint8_t*>(buffer + sizeof(out) + receiver.header.msg_namelen);
+                    control.msg_controllen = std::min<size_t>(out.controllen, receiver.header.msg_controllen);
+                    received = receiveTimestamp(control);
+                }
+
+                datagrams_received_++;
+                bytes_received_ += size;
+                receiver.handler(buffer + prefix, size, from, received);
+            }
+        }
+        recycleBuffer(buffer_id);
+    }
+
+    if (flags & IORING_CQE_F_MORE) {
+        return;
+    }
+
+    // The request ended: out of buffers, or cancelled, or failed. Checked
+    // again under the lock so a concurrent removeReceiver() cancels the new one
+    if (receiver.active && (result >= 0 || result == -ENOBUFS)) {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        if (receiver.active && armReceiver(receiver)) {
+            receive_rearms_++;
+            submit();
+            return;
+        }
+    }
+
+    if (receiver.active && result < 0 && running_) {
+        core::Logger::warn("io_uring receive ended: {}", strerror(-result));
+    }
+
+    std::lock_guard<std::mutex> lock(receiver_mutex_);
+    in_flight_--;
+    releaseFileSlot(receiver.slot);
+    receivers_.erase(receiver.id);
+    receiver_cv_.notify_all();
+}
+
+IoUring::Stats IoUring::getStats() const {
+    Stats stats;
+    stats.datagrams_received = datagrams_received_;
+    stats.bytes_received = bytes_received_;
+    stats.receive_rearms = receive_rearms_;
+    stats.truncated = truncated_;
+    stats.sends = sends_;
+    stats.send_errors = send_errors_;
+    stats.send_timeouts = send_timeouts_;
+    stats.file_writes = file_writes_;
+    stats.fixed_writes = fixed_writes_;
+    stats.submit_calls = submit_calls_;
+    stats.wait_calls = wait_calls_;
+    return stats;
+}
+
+void IoUring::resetStats() {
+    datagrams_received_ = 0;
+    bytes_received_ = 0;
+    receive_rearms_ = 0;
+    truncated_ = 0;
+    sends_ = 0;
+    send_errors_ = 0;
+    send_timeouts_ = 0;
+    file_writes_ = 0;
+    fixed_writes_ = 0;
+    submit_calls_ = 0;
+    wait_calls_ = 0;
+}
+
+} // namespace fmus::network
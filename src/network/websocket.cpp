@@ -0,0 +1,691 @@
+#include "fmus/network/websocket.hpp"
+#include "fmus/core/logger.hpp"
+#include "fmus/core/sha1.hpp"
+#include "fmus/core/base64.hpp"
+#include "fmus/core/random.hpp"
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace fmus::network {
+
+namespace {
+
+constexpr size_t max_handshake_size = 8192;
+
+std::string generateConnectionId() {
+    std::string id = "client-";
+    core::SecureRandom::appendHex(id, 12);
+    return id;
+}
+
+// Case-insensitive lookup of an HTTP header value in a raw request
+std::string findHeaderValue(const std::string& request, const std::string& name) {
+    size_t line_start = request.find("\r\n");
+    while (line_start != std::string::npos) {
+        line_start += 2;
+        size_t line_end = request.find("\r\n", line_start);
+        if (line_end == std::string::npos || line_end == line_start) {
+            break;
+        }
+
+        size_t colon = request.find(':', line_start);
+        if (colon != std::string::npos && colon < line_end && colon - line_start == name.size() &&
+            std::equal(name.begin(), name.end(), request.begin() + line_start,
+                       [](char a, char b) { return std::tolower(a) == std::tolower(b); })) {
+            size_t value_start = request.find_first_not_of(" \t", colon + 1);
+            size_t value_end = request.find_last_not_of(" \t", line_end - 1);
+            if (value_start == std::string::npos || value_start > value_end) {
+                return "";
+            }
+            return request.substr(value_start, value_end - value_start + 1);
+        }
+
+        line_start = line_end;
+    }
+
+    return "";
+}
+
+// Whether a comma-separated header value lists token, ignoring case
+bool containsToken(const std::string& value, const std::string& token) {
+    auto it = std::search(value.begin(), value.end(), token.begin(), token.end(),
+                          [](char a, char b) { return std::tolower(a) == std::tolower(b); });
+    return it != value.end();
+}
+
+} // namespace
+
+// WebSocketFrame implementation
+std::vector<uint8_t> WebSocketFrame::serialize() const {
+    const uint64_t payload_size = payload.size();
+    std::vector<uint8_t> frame;
+    frame.reserve(14 + payload.size());
+    
+    // First byte: FIN + RSV + Opcode
+    uint8_t first_byte = (fin ? 0x80 : 0x00) | static_cast<uint8_t>(opcode);
+    frame.push_back(first_byte);
+    
+    // Second byte: MASK + Payload length
+    uint8_t second_byte = masked ? 0x80 : 0x00;
+    
+    if (payload_size < 126) {
+        second_byte |= static_cast<uint8_t>(payload_size);
+        frame.push_back(second_byte);
+    } else if (payload_size < 65536) {
+        second_byte |= 126;
+        frame.push_back(second_byte);
+        frame.push_back((payload_size >> 8) & 0xFF);
+        frame.push_back(payload_size & 0xFF);
+    } else {
+        second_byte |= 127;
+        frame.push_back(second_byte);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame.push_back((payload_size >> shift) & 0xFF);
+        }
+    }
+    
+    // Masking key (if masked)
+    if (masked) {
+        frame.push_back((mask >> 24) & 0xFF);
+        frame.push_back((mask >> 16) & 0xFF);
+        frame.push_back((mask >> 8) & 0xFF);
+        frame.push_back(mask & 0xFF);
+    }
+    
+    // Payload (apply mask if needed)
+    size_t header_size = frame.size();
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    if (masked) {
+        applyWebSocketMask(frame.data() + header_size, payload.size(), mask);
+    }
+    
+    return frame;
+}
+
+WebSocketFrame WebSocketFrame::deserialize(const uint8_t* data, size_t size) {
+    WebSocketFrame frame;
+    
+    if (size < 2) {
+        return frame; // Invalid frame
+    }
+    
+    // Parse first byte
+    frame.fin = (data[0] & 0x80) != 0;
+    frame.opcode = static_cast<WebSocketOpcode>(data[0] & 0x0F);
+    
+    // Parse second byte
+    frame.masked = (data[1] & 0x80) != 0;
+    uint8_t payload_len = data[1] & 0x7F;
+    
+    size_t header_size = 2;
+    uint64_t payload_size = payload_len;
+    
+    // Extended payload length
+    if (payload_len == 126) {
+        if (size < 4) return frame;
+        payload_size = (static_cast<uint64_t>(data[2]) << 8) | data[3];
+        header_size = 4;
+    } else if (payload_len == 127) {
+        if (size < 10) return frame;
+        payload_size = 0;
+        for (size_t i = 2; i < 10; ++i) {
+            payload_size = (payload_size << 8) | data[i];
+        }
+        header_size = 10;
+    }
+    
+    // Masking key
+    if (frame.masked) {
+        if (size < header_size + 4) return frame;
+        frame.mask = (static_cast<uint32_t>(data[header_size]) << 24) |
+                     (static_cast<uint32_t>(data[header_size + 1]) << 16) |
+                     (static_cast<uint32_t>(data[header_size + 2]) << 8) |
+                     data[header_size + 3];
+        header_size += 4;
+    }
+    
+    // Payload
+    if (payload_size > size - header_size) return frame;
+    
+    frame.payload.assign(data + header_size, data + header_size + payload_size);
+    if (frame.masked) {
+        applyWebSocketMask(frame.payload.data(), frame.payload.size(), frame.mask);
+    }
+    
+    return frame;
+}
+
+bool WebSocketFrame::isWebSocketFrame(const uint8_t* data, size_t size) {
+    if (size < 2) return false;
+    
+    // Check if it looks like a WebSocket frame
+    uint8_t opcode = data[0] & 0x0F;
+    return opcode <= 0x0A; // Valid opcodes are 0x0-0x2 and 0x8-0xA
+}
+
+// WebSocketFrameDecoder implementation
+WebSocketFrameDecoder::WebSocketFrameDecoder(size_t max_message_size)
+    : max_message_size_(max_message_size) {
+}
+
+bool WebSocketFrameDecoder::feed(const uint8_t* data, size_t size) {
+    if (hasError()) {
+        return false;
+    }
+    
+    while (size > 0) {
+        size_t consumed = (state_ == State::HEADER) ? consumeHeader(data, size)
+                                                    : consumePayload(data, size);
+        if (hasError()) {
+            return false;
+        }
+        
+        data += consumed;
+        size -= consumed;
+        stats_.bytes_consumed += consumed;
+    }
+    
+    return true;
+}
+
+void WebSocketFrameDecoder::reset() {
+    state_ = State::HEADER;
+    header_size_ = 0;
+    header_needed_ = 2;
+    frame_received_ = 0;
+    message_.payload.clear();
+    control_.payload.clear();
+    in_message_ = false;
+    error_.clear();
+}
+
+size_t WebSocketFrameDecoder::consumeHeader(const uint8_t* data, size_t size) {
+    size_t consumed = 0;
+    
+    while (consumed < size && header_size_ < header_needed_) {
+        header_[header_size_++] = data[consumed++];
+        
+        // Once the first two bytes are in, the full header length is known
+        if (header_size_ == 2) {
+            uint8_t payload_len = header_[1] & 0x7F;
+            if (payload_len == 126) header_needed_ += 2;
+            else if (payload_len == 127) header_needed_ += 8;
+            if (header_[1] & 0x80) header_needed_ += 4;
+        }
+    }
+    
+    if (header_size_ == header_needed_ && beginFrame() && frame_length_ == 0) {
+        finishFrame();
+    }
+    
+    return consumed;
+}
+
+size_t WebSocketFrameDecoder::consumePayload(const uint8_t* data, size_t size) {
+    WebSocketFrame& target = (static_cast<uint8_t>(frame_opcode_) & 0x08) ? control_ : message_;
+    
+    size_t chunk = static_cast<size_t>(std::min<uint64_t>(size, frame_length_ - frame_received_));
+    size_t position = target.payload.size();
+    target.payload.insert(target.payload.end(), data, data + chunk);
+    
+    if (frame_masked_) {
+        applyWebSocketMask(target.payload.data() + position, chunk, frame_mask_, frame_received_);
+    }
+    
+    frame_received_ += chunk;
+    if (frame_received_ == frame_length_) {
+        finishFrame();
+    }
+    
+    return chunk;
+}
+
+bool WebSocketFrameDecoder::beginFrame() {
+    frame_fin_ = (header_[0] & 0x80) != 0;
+    frame_opcode_ = static_cast<WebSocketOpcode>(header_[0] & 0x0F);
+    frame_masked_ = (header_[1] & 0x80) != 0;
+    
+    if (header_[0] & 0x70) {
+        return fail("Reserved bits set without negotiated extension");
+    }
+    
+    if (require_masked_ && !frame_masked_) {
+        return fail("Unmasked frame from client");
+    }
+    
+    size_t offset = 2;
+    frame_length_ = header_[1] & 0x7F;
+    if (frame_length_ == 126) {
+        frame_length_ = (static_cast<uint64_t>(header_[2]) << 8) | header_[3];
+        offset = 4;
+    } else if (frame_length_ == 127) {
+        frame_length_ = 0;
+        for (size_t i = 2; i < 10; ++i) {
+            frame_length_ = (frame_length_ << 8) | header_[i];
+        }
+        offset = 10;
+    }
+    
+    frame_mask_ = 0;
+    if (frame_masked_) {
+        frame_mask_ = (static_cast<uint32_t>(header_[offset]) << 24) |
+                      (static_cast<uint32_t>(header_[offset + 1]) << 16) |
+                      (static_cast<uint32_t>(header_[offset + 2]) << 8) |
+                      header_[offset + 3];
+    }
+    
+    switch (frame_opcode_) {
+        case WebSocketOpcode::CLOSE:
+        case WebSocketOpcode::PING:
+        case WebSocketOpcode::PONG:
+            if (!frame_fin_ || frame_length_ > 125) {
+                return fail("Invalid control frame");
+            }
+            control_.payload.clear();
+            break;
+            
+        case WebSocketOpcode::TEXT:
+        case WebSocketOpcode::BINARY:
+            if (in_message_) {
+                return fail("New data frame while a fragmented message is in progress");
+            }
+            in_message_ = true;
+            message_.opcode = frame_opcode_;
+            message_.payload.clear();
+            break;
+            
+        case WebSocketOpcode::CONTINUATION:
+            if (!in_message_) {
+                return fail("Continuation frame without an initial frame");
+            }
+            stats_.continuation_frames++;
+            break;
+            
+        default:
+            return fail("Unknown opcode " + std::to_string(static_cast<int>(frame_opcode_)));
+    }
+    
+    if (frame_length_ > max_message_size_ ||
+        (!(static_cast<uint8_t>(frame_opcode_) & 0x08) &&
+         message_.payload.size() + frame_length_ > max_message_size_)) {
+        return fail("Message exceeds maximum size");
+    }
+    
+    // The payload grows as bytes arrive; reserving the declared length would
+    // let a bare header pin max_message_size_ bytes
+    frame_received_ = 0;
+    state_ = State::PAYLOAD;
+    return true;
+}
+
+void WebSocketFrameDecoder::finishFrame() {
+    stats_.frames_decoded++;
+    
+    state_ = State::HEADER;
+    header_size_ = 0;
+    header_needed_ = 2;
+    
+    if (static_cast<uint8_t>(frame_opcode_) & 0x08) {
+        stats_.control_frames++;
+        control_.opcode = frame_opcode_;
+        if (frame_callback_) {
+            frame_callback_(control_);
+        }
+        return;
+    }
+    
+    if (frame_fin_) {
+        in_message_ = false;
+        stats_.messages_decoded++;
+        if (frame_callback_) {
+            frame_callback_(message_);
+        }
+        message_.payload.clear();
+    }
+}
+
+bool WebSocketFrameDecoder::fail(const std::string& error) {
+    error_ = error;
+    stats_.protocol_errors++;
+    return false;
+}
+
+// WebSocketConnection implementation
+WebSocketConnection::WebSocketConnection(std::shared_ptr<TcpSocket> socket)
+    : socket_(socket), connected_(false), handshake_complete_(false) {
+    
+    connection_id_ = generateConnectionId();
+    
+    decoder_.setFrameCallback([this](const WebSocketFrame& frame) {
+        processWebSocketFrame(frame);
+    });
+    decoder_.setRequireMasked(true);
+}
+
+void WebSocketConnection::start() {
+    // The socket outlives us on its receive thread, so its callbacks only
+    // hold a weak reference, and keep the connection alive while they run:
+    // a CLOSE frame ends in the close callback, which may drop the last owner
+    std::weak_ptr<WebSocketConnection> weak_self = weak_from_this();
+    
+    socket_->setDataCallback([weak_self](const std::vector<uint8_t>& data, const SocketAddress& from) {
+        if (auto self = weak_self.lock()) {
+            self->onSocketData(data, from);
+        }
+    });
+    
+    socket_->setErrorCallback([weak_self](const std::string& error) {
+        if (auto self = weak_self.lock()) {
+            self->onSocketError(error);
+        }
+    });
+    
+    // Peer close or slow-consumer eviction
+    socket_->setStateCallback([weak_self](SocketState state) {
+        auto self = weak_self.lock();
+        if (self && state == SocketState::CLOSED && self->connected_.exchange(false) && self->close_callback_) {
+            self->close_callback_();
+        }
+    });
+    
+    socket_->startReceiving();
+}
+
+WebSocketConnection::~WebSocketConnection() {
+    close();
+}
+
+bool WebSocketConnection::performHandshake(const std::string& request) {
+    std::string websocket_key = findHeaderValue(request, "Sec-WebSocket-Key");
+    if (websocket_key.empty()) {
+        return false;
+    }
+    
+    // A required subprotocol must be among those the client offered
+    if (!subprotocol_.empty()) {
+        bool offered = false;
+        std::istringstream protocols(findHeaderValue(request, "Sec-WebSocket-Protocol"));
+        std::string protocol;
+        while (std::getline(protocols, protocol, ',')) {
+            size_t start = protocol.find_first_not_of(" \t");
+            size_t end = protocol.find_last_not_of(" \t");
+            if (start != std::string::npos && protocol.substr(start, end - start + 1) == subprotocol_) {
+                offered = true;
+                break;
+            }
+        }
+        
+        if (!offered) {
+            core::Logger::warn("WebSocket connection {} did not offer subprotocol {}", connection_id_, subprotocol_);
+            std::string rejection = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+            socket_->send(reinterpret_cast<const uint8_t*>(rejection.data()), rejection.size());
+            return false;
+        }
+    }
+    
+    std::string websocket_accept = generateWebSocketAccept(websocket_key);
+    
+    // Create handshake response
+    std::ostringstream response;
+    response << "HTTP/1.1 101 Switching Protocols\r\n"
+             << "Upgrade: websocket\r\n"
+             << "Connection: Upgrade\r\n"
+             << "Sec-WebSocket-Accept: " << websocket_accept << "\r\n";
+    if (!subprotocol_.empty()) {
+        response << "Sec-WebSocket-Protocol: " << subprotocol_ << "\r\n";
+    }
+    response << "\r\n";
+    
+    std::string response_str = response.str();
+    auto response_data = makeSharedBuffer(reinterpret_cast<const uint8_t*>(response_str.data()),
+                                          response_str.size());
+    
+    if (socket_->queueSend(response_data)) {
+        handshake_complete_ = true;
+        connected_ = true;
+        core::Logger::info("WebSocket handshake completed for connection {}", connection_id_);
+        return true;
+    }
+    
+    return false;
+}
+
+void WebSocketConnection::close() {
+    // The close callback may release the owner's reference
+    auto self = weak_from_this().lock();
+    bool was_connected = connected_.exchange(false);
+    
+    if (was_connected) {
+        // Send close frame
+        WebSocketFrame close_frame;
+        close_frame.opcode = WebSocketOpcode::CLOSE;
+        close_frame.fin = true;
+        
+        socket_->queueSend(makeSharedBuffer(close_frame.serialize()));
+    }
+    
+    if (socket_) {
+        socket_->close();
+    }
+    
+    if (was_connected && close_callback_) {
+        close_callback_();
+    }
+}
+
+bool WebSocketConnection::sendMessage(const std::string& message) {
+    if (!connected_) {
+        return false;
+    }
+    
+    return socket_->queueSend(encodeMessage(message));
+}
+
+bool WebSocketConnection::sendFrame(const SharedBuffer& frame) {
+    if (!connected_) {
+        return false;
+    }
+    
+    return socket_->queueSend(frame);
+}
+
+SharedBuffer WebSocketConnection::encodeMessage(const std::string& message) {
+    WebSocketFrame frame;
+    frame.opcode = WebSocketOpcode::TEXT;
+    frame.fin = true;
+    frame.payload.assign(message.begin(), message.end());
+    
+    return makeSharedBuffer(frame.serialize());
+}
+
+bool WebSocketConnection::sendPing() {
+    if (!connected_) {
+        return false;
+    }
+    
+    WebSocketFrame frame;
+    frame.opcode = WebSocketOpcode::PING;
+    frame.fin = true;
+    
+    return socket_->queueSend(makeSharedBuffer(frame.serialize()));
+}
+
+bool WebSocketConnection::sendPong() {
+    if (!connected_) {
+        return false;
+    }
+    
+    WebSocketFrame frame;
+    frame.opcode = WebSocketOpcode::PONG;
+    frame.fin = true;
+    
+    return socket_->queueSend(makeSharedBuffer(frame.serialize()));
+}
+
+SocketAddress WebSocketConnection::getRemoteAddress() const {
+    if (socket_) {
+        return socket_->getRemoteAddress();
+    }
+    return {};
+}
+
+void WebSocketConnection::onSocketData(const std::vector<uint8_t>& data, const SocketAddress& /* from */) {
+    if (!handshake_complete_) {
+        // Handle HTTP handshake, which may arrive split across reads
+        handshake_buffer_.append(data.begin(), data.end());
+        size_t header_end = handshake_buffer_.find("\r\n\r\n");
+        if (header_end == std::string::npos) {
+            if (handshake_buffer_.size() > max_handshake_size) {
+                core::Logger::warn("WebSocket handshake from {} too large", getRemoteAddress().toString());
+                handshake_buffer_.clear();
+                socket_->close();
+            }
+            return;
+        }
+        
+        std::string request = handshake_buffer_.substr(0, header_end + 4);
+        std::string pipelined = handshake_buffer_.substr(header_end + 4);
+        handshake_buffer_.clear();
+        
+        if (request.find("GET") != 0 || !containsToken(findHeaderValue(request, "Upgrade"), "websocket") ||
+            !performHandshake(request)) {
+            socket_->close();
+            return;
+        }
+        
+        // Frames pipelined behind the upgrade request
+        if (pipelined.empty()) {
+            return;
+        }
+        if (!decoder_.feed(reinterpret_cast<const uint8_t*>(pipelined.data()), pipelined.size())) {
+            core::Logger::error("WebSocket connection {} protocol error: {}", connection_id_, decoder_.getError());
+            close();
+        }
+        return;
+    }
+    
+    if (!decoder_.feed(data.data(), data.size())) {
+        core::Logger::error("WebSocket connection {} protocol error: {}", connection_id_, decoder_.getError());
+        if (error_callback_) {
+            error_callback_(decoder_.getError());
+        }
+        close();
+    }
+}
+
+void WebSocketConnection::onSocketError(const std::string& error) {
+    core::Logger::error("WebSocket connection {} error: {}", connection_id_, error);
+    connected_ = false;
+    
+    if (error_callback_) {
+        error_callback_(error);
+    }
+}
+
+void WebSocketConnection::processWebSocketFrame(const WebSocketFrame& frame) {
+    switch (frame.opcode) {
+        case WebSocketOpcode::TEXT:
+        case WebSocketOpcode::BINARY: {
+            std::string message(frame.payload.begin(), frame.payload.end());
+            if (message_callback_) {
+                message_callback_(message);
+            }
+            break;
+        }
+        
+        case WebSocketOpcode::PING:
+            sendPong();
+            break;
+            
+        case WebSocketOpcode::PONG:
+            // Handle pong if needed
+            break;
+            
+        case WebSocketOpcode::CLOSE:
+            close();
+            break;
+            
+        default:
+            core::Logger::debug("Unhandled WebSocket opcode: {}", static_cast<int>(frame.opcode));
+            break;
+    }
+}
+
+std::string WebSocketConnection::generateWebSocketAccept(const std::string& key) const {
+    static constexpr std::string_view magic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    core::Sha1 sha1;
+    sha1.update(key);
+    sha1.update(magic);
+    auto digest = sha1.finalize();
+    return core::base64Encode(digest.data(), digest.size());
+}
+
+// Utility functions
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static size_t applyWebSocketMaskAvx2(uint8_t* data, size_t size, uint32_t key) {
+    const __m256i mask = _mm256_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(a, mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i + 32), _mm256_xor_si256(b, mask));
+    }
+    return i;
+}
+
+static size_t applyWebSocketMaskSse2(uint8_t* data, size_t size, uint32_t key) {
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(a, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i + 16), _mm_xor_si128(b, mask));
+    }
+    return i;
+}
+#endif
+
+void applyWebSocketMask(uint8_t* data, size_t size, uint32_t mask, uint64_t offset) {
+    // Rotate the key so that byte 0 of the buffer lines up with key byte (offset % 4),
+    // then XOR whole words; the key repeats every 4 bytes so any multiple of 4 keeps it aligned
+    uint8_t key_bytes[4];
+    for (size_t i = 0; i < 4; ++i) {
+        key_bytes[i] = (mask >> (8 * (3 - ((offset + i) % 4)))) & 0xFF;
+    }
+    
+    uint32_t key;
+    std::memcpy(&key, key_bytes, sizeof(key));
+    
+    size_t i = 0;
+#if defined(__x86_64__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (size >= 64 && has_avx2) {
+        i = applyWebSocketMaskAvx2(data, size, key);
+    }
+    i += applyWebSocketMaskSse2(data + i, size - i, key);
+#endif
+    
+    const uint64_t key64 = (static_cast<uint64_t>(key) << 32) | key;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        word ^= key64;
+        std::memcpy(data + i, &word, sizeof(word));
+    }
+    
+    for (; i < size; ++i) {
+        data[i] ^= key_bytes[i % 4];
+    }
+}
+
+} // namespace fmus::network
@@ -0,0 +1,185 @@
+#include "fmus/rtp/extension.hpp"
+
+namespace fmus::rtp {
+
+namespace {
+
+struct KnownExtension {
+    RtpExtensionType type;
+    const char* uri;
+};
+
+const KnownExtension known_extensions[] = {
+    {RtpExtensionType::AUDIO_LEVEL, "urn:ietf:params:rtp-hdrext:ssrc-audio-level"},
+    {RtpExtensionType::ABS_SEND_TIME, "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time"},
+    {RtpExtensionType::TRANSPORT_SEQUENCE_NUMBER,
+     "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"},
+    {RtpExtensionType::MID, "urn:ietf:params:rtp-hdrext:sdes:mid"},
+};
+
+} // namespace
+
+const char* extensionTypeToUri(RtpExtensionType type) {
+    for (const auto& known : known_extensions) {
+        if (known.type == type) {
+            return known.uri;
+        }
+    }
+    return "";
+}
+
+RtpExtensionType uriToExtensionType(std::string_view uri) {
+    for (const auto& known : known_extensions) {
+        if (uri == known.uri) {
+            return known.type;
+        }
+    }
+    return RtpExtensionType::UNKNOWN;
+}
+
+// RtpExtensionView implementation
+RtpExtensionView RtpExtensionView::fromPacket(const uint8_t* packet, size_t size) {
+    if (size < 12 || (packet[0] & 0x10) == 0) {
+        return {};
+    }
+
+    size_t offset = 12 + (packet[0] & 0x0F) * 4;
+    if (size < offset + 4) {
+        return {};
+    }
+
+    uint16_t profile = (static_cast<uint16_t>(packet[offset]) << 8) | packet[offset + 1];
+    size_t length = ((static_cast<size_t>(packet[offset + 2]) << 8) | packet[offset + 3]) * 4;
+    if (size < offset + 4 + length) {
+        return {};
+    }
+    return RtpExtensionView(profile, packet + offset + 4, length);
+}
+
+std::optional<RtpExtensionElement> RtpExtensionView::find(uint8_t id) const {
+    for (const auto& element : *this) {
+        if (element.id == id) {
+            return element;
+        }
+    }
+    return std::nullopt;
+}
+
+void RtpExtensionView::Iterator::advance() {
+    const uint8_t* data = view_->data_;
+    size_t size = view_->size_;
+    bool one_byte = view_->isOneByte();
+
+    // Padding bytes (ID 0) may sit between elements
+    while (next_ < size && data[next_] == 0) {
+        next_++;
+    }
+
+    size_t header_size = one_byte ? 1 : 2;
+    if (next_ == END || next_ + header_size > size) {
+        offset_ = next_ = END;
+        return;
+    }
+
+    uint8_t id;
+    size_t length;
+    if (one_byte) {
+        id = data[next_] >> 4;
+        length = (data[next_] & 0x0F) + 1;
+        if (id == 0 || id == 15) {
+            // Non-zero padding is malformed and 15 is reserved: stop parsing the block
+            offset_ = next_ = END;
+            return;
+        }
+    } else {
+        id = data[next_];
+        length = data[next_ + 1];
+    }
+
+    if (next_ + header_size + length > size) {
+        offset_ = next_ = END;
+        return;
+    }
+
+    offset_ = next_;
+    element_ = {id, data + next_ + header_size, static_cast<uint8_t>(length)};
+    next_ += header_size + length;
+}
+
+// RtpExtensionMap implementation
+bool RtpExtensionMap::add(uint8_t id, std::string_view uri) {
+    return add(id, uriToExtensionType(uri));
+}
+
+bool RtpExtensionMap::add(uint8_t id, RtpExtensionType type) {
+    // One-byte IDs are 1-14; two-byte ones go up to 255
+    if (id == 0 || type == RtpExtensionType::UNKNOWN) {
+        return false;
+    }
+
+    remove(id);
+    uint8_t& previous = ids_[static_cast<size_t>(type)];
+    if (previous != 0) {
+        types_[previous] = RtpExtensionType::UNKNOWN;
+    }
+    previous = id;
+    types_[id] = type;
+    return true;
+}
+
+void RtpExtensionMap::remove(uint8_t id) {
+    RtpExtensionType type = types_[id];
+    if (type != RtpExtensionType::UNKNOWN) {
+        ids_[static_cast<size_t>(type)] = 0;
+        types_[id] = RtpExtensionType::UNKNOWN;
+    }
+}
+
+void RtpExtensionMap::clear() {
+    types_.fill(RtpExtensionType::UNKNOWN);
+    ids_.fill(0);
+}
+
+std::optional<RtpExtensionElement> RtpExtensionMap::find(const RtpExtensionView& view, RtpExtensionType type) const {
+    uint8_t id = getId(type);
+    if (id == 0) {
+        return std::nullopt;
+    }
+    return view.find(id);
+}
+
+std::optional<RtpExtensionMap::AudioLevel> RtpExtensionMap::getAudioLevel(const RtpExtensionView& view) const {
+    auto element = find(view, RtpExtensionType::AUDIO_LEVEL);
+    if (!element || element->size < 1) {
+        return std::nullopt;
+    }
+    return AudioLevel{(element->data[0] & 0x80) != 0, static_cast<uint8_t>(element->data[0] & 0x7F)};
+}
+
+std::optional<uint32_t> RtpExtensionMap::getAbsSendTime(const RtpExtensionView& view) const {
+    auto element = find(view, RtpExtensionType::ABS_SEND_TIME);
+    if (!element || element->size < 3) {
+        return std::nullopt;
+    }
+    return (static_cast<uint32_t>(element->data[0]) << 16) |
+           (static_cast<uint32_t>(element->data[1]) << 8) |
+           static_cast<uint32_t>(element->data[2]);
+}
+
+std::optional<uint16_t> RtpExtensionMap::getTransportSequenceNumber(const RtpExtensionView& view) const {
+    auto element = find(view, RtpExtensionType::TRANSPORT_SEQUENCE_NUMBER);
+    if (!element || element->size < 2) {
+        return std::nullopt;
+    }
+    return static_cast<uint16_t>((element->data[0] << 8) | element->data[1]);
+}
+
+std::optional<std::string_view> RtpExtensionMap::getMid(const RtpExtensionView& view) const {
+    auto element = find(view, RtpExtensionType::MID);
+    if (!element || element->size == 0) {
+        return std::nullopt;
+    }
+    return std::string_view(reinterpret_cast<const char*>(element->data), element->size);
+}
+
+} // namespace fmus::rtp
@@ -7,7 +7,7 @@ namespace fmus::rtp {
 // RtpHeader implementation
 std::vector<uint8_t> RtpHeader::serialize() const {
     std::vector<uint8_t> data;
-    data.reserve(12 + csrc_list.size() * 4);
+    data.reserve(getSize());
     
     // First byte: V(2) + P(1) + X(1) + CC(4)
     uint8_t byte0 = (version << 6) | (padding ? 0x20 : 0) | (extension ? 0x10 : 0) | csrc_count;
@@ -41,6 +41,17 @@ std::vector<uint8_t> RtpHeader::serialize() const {
         data.push_back(csrc & 0xFF);
     }
     
+    // Header extension, length in 32-bit words
+    if (extension) {
+        size_t words = (extension_data.size() + 3) / 4;
+        data.push_back((extension_profile >> 8) & 0xFF);
+        data.push_back(extension_profile & 0xFF);
+        data.push_back((words >> 8) & 0xFF);
+        data.push_back(words & 0xFF);
+        data.insert(data.end(), extension_data.begin(), extension_data.end());
+        data.resize(data.size() + words * 4 - extension_data.size(), 0);
+    }
+    
     return data;
 }
 
@@ -94,11 +105,29 @@ RtpHeader RtpHeader::deserialize(const uint8_t* data, size_t size) {
         header.csrc_list.push_back(csrc);
     }
     
+    // Parse header extension
+    if (header.extension) {
+        if (size < expected_size + 4) {
+            throw std::runtime_error("RTP header extension incomplete");
+        }
+        const uint8_t* block = data + expected_size;
+        header.extension_profile = (static_cast<uint16_t>(block[0]) << 8) | block[1];
+        size_t length = ((static_cast<size_t>(block[2]) << 8) | block[3]) * 4;
+        if (size < expected_size + 4 + length) {
+            throw std::runtime_error("RTP header extension incomplete");
+        }
+        header.extension_data.assign(block + 4, block + 4 + length);
+    }
+    
     return header;
 }
 
 size_t RtpHeader::getSize() const {
-    return 12 + csrc_list.size() * 4;
+    size_t size = 12 + csrc_list.size() * 4;
+    if (extension) {
+        size += 4 + (extension_data.size() + 3) / 4 * 4;
+    }
+    return size;
 }
 
 // RtpPacket implementation
@@ -135,9 +164,21 @@ std::unique_ptr<RtpPacket> RtpPacket::deserialize(const uint8_t* data, size_t si
             return nullptr;
         }
         
+        // The last padding byte counts the padding, itself included
+        size_t payload_end = size;
+        if (header.padding) {
+            size_t padding = data[size - 1];
+            if (padding == 0 || padding > size - header_size) {
+                return nullptr;
+            }
+            payload_end -= padding;
+            // The padding is gone, so a re-serialized packet must not claim any
+            header.padding = false;
+        }
+        
         std::vector<uint8_t> payload;
-        if (size > header_size) {
-            payload.assign(data + header_size, data + size);
+        if (payload_end > header_size) {
+            payload.assign(data + header_size, data + payload_end);
         }
         
         return std::make_unique<RtpPacket>(header, payload);
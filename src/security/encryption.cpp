@@ -1,6 +1,6 @@
 #include "fmus/security/encryption.hpp"
 #include "fmus/core/logger.hpp"
-#include <random>
+#include "fmus/core/random.hpp"
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
@@ -126,16 +126,7 @@ bool BasicCryptoEngine::verify(const std::vector<uint8_t>& data, const std::vect
 }
 
 std::vector<uint8_t> BasicCryptoEngine::generateRandom(size_t length) {
-    std::vector<uint8_t> random_data(length);
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<uint8_t> dis(0, 255);
-    
-    for (size_t i = 0; i < length; ++i) {
-        random_data[i] = dis(gen);
-    }
-    
-    return random_data;
+    return core::SecureRandom::bytes(length);
 }
 
 EncryptionKey BasicCryptoEngine::deriveKey(const std::vector<uint8_t>& master_key, const std::string& label, size_t key_length) {
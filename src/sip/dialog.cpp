@@ -1,13 +1,38 @@
 #include "fmus/sip/dialog.hpp"
 #include "fmus/core/logger.hpp"
+#include "fmus/core/pool.hpp"
+#include "fmus/core/random.hpp"
 #include <sstream>
 #include <algorithm>
-#include <random>
 
 namespace fmus::sip {
 
+namespace {
+
+// Value of the tag parameter in a From or To header, empty if absent
+std::string_view tagParameter(std::string_view header) {
+    size_t tag_pos = header.find("tag=");
+    if (tag_pos == std::string_view::npos) {
+        return {};
+    }
+    std::string_view tag = header.substr(tag_pos + 4);
+    return tag.substr(0, tag.find(';'));
+}
+
+// URI of a Contact header value, without display name or brackets
+std::string_view contactUri(std::string_view contact) {
+    size_t open = contact.find('<');
+    if (open == std::string_view::npos) {
+        return contact.substr(0, contact.find(';'));
+    }
+    size_t close = contact.find('>', open);
+    return contact.substr(open + 1, close == std::string_view::npos ? std::string_view::npos : close - open - 1);
+}
+
+} // namespace
+
 // Dialog implementation
-Dialog::Dialog(const std::string& dialog_id, const SipMessage& initial_request)
+Dialog::Dialog(const DialogId& dialog_id, const SipMessage& initial_request)
     : dialog_id_(dialog_id), state_(DialogState::EARLY), local_cseq_(1), remote_cseq_(0) {
     
     extractDialogInfo(initial_request);
@@ -58,9 +83,16 @@ SipMessage Dialog::createRequest(SipMethod method) const {
     SipMessage request(method, target_uri);
     
     // Set required headers
-    request.getHeaders().setCallId(call_id_);
-    request.getHeaders().setFrom(local_uri_ + ";tag=" + local_tag_);
-    request.getHeaders().setTo(remote_uri_ + (remote_tag_.empty() ? "" : ";tag=" + remote_tag_));
+    request.getHeaders().set("Call-ID", call_id_.view());
+    std::string from = local_uri_;
+    from.append(";tag=").append(local_tag_.view());
+    request.getHeaders().setFrom(from);
+
+    std::string to = remote_uri_;
+    if (!remote_tag_.empty()) {
+        to.append(";tag=").append(remote_tag_.view());
+    }
+    request.getHeaders().setTo(to);
     request.getHeaders().setCSeq(std::to_string(local_cseq_) + " " + methodToString(method));
     
     // Add route set if present
@@ -75,18 +107,11 @@ SipMessage Dialog::createRequest(SipMethod method) const {
 
 SipMessage Dialog::createResponse(const SipMessage& request, SipResponseCode code, 
                                  const std::string& reason) const {
-    SipMessage response(code, reason);
-    
-    // Copy headers from request
-    response.getHeaders().setCallId(request.getHeaders().getCallId());
-    response.getHeaders().setFrom(request.getHeaders().getFrom());
-    response.getHeaders().setTo(request.getHeaders().getTo());
-    response.getHeaders().setCSeq(request.getHeaders().getCSeq());
-    response.getHeaders().setVia(request.getHeaders().getVia());
+    SipMessage response = SipMessage::createResponse(request, code, reason);
     
     // Add To tag if not present and this is a final response
     if (code >= SipResponseCode::OK && response.getHeaders().getTo().find("tag=") == std::string::npos) {
-        response.getHeaders().setTo(response.getHeaders().getTo() + ";tag=" + local_tag_);
+        response.getHeaders().setTo(response.getHeaders().getTo() + ";tag=" + local_tag_.str());
     }
     
     return response;
@@ -133,7 +158,7 @@ void Dialog::addTransaction(std::shared_ptr<Transaction> transaction) {
     transaction->setDialog(shared_from_this());
 }
 
-void Dialog::removeTransaction(const std::string& transaction_id) {
+void Dialog::removeTransaction(const TransactionId& transaction_id) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     transactions_.erase(
@@ -145,7 +170,7 @@ void Dialog::removeTransaction(const std::string& transaction_id) {
         transactions_.end());
 }
 
-std::shared_ptr<Transaction> Dialog::findTransaction(const std::string& transaction_id) const {
+std::shared_ptr<Transaction> Dialog::findTransaction(const TransactionId& transaction_id) const {
     std::lock_guard<std::mutex> lock(mutex_);
     
     for (const auto& weak_tx : transactions_) {
@@ -160,7 +185,7 @@ std::shared_ptr<Transaction> Dialog::findTransaction(const std::string& transact
 
 bool Dialog::validateMessage(const SipMessage& message) const {
     // Check Call-ID
-    if (message.getHeaders().getCallId() != call_id_) {
+    if (call_id_ != message.getHeaders().view("Call-ID")) {
         return false;
     }
     
@@ -177,25 +202,21 @@ bool Dialog::validateMessage(const SipMessage& message) const {
     return true;
 }
 
-std::string Dialog::generateDialogId(const SipMessage& message) {
-    std::ostringstream oss;
-    oss << message.getHeaders().getCallId();
+DialogId Dialog::generateDialogId(const SipMessage& message) {
+    const SipHeaders& headers = message.getHeaders();
+    DialogId dialog_id(headers.view("Call-ID"));
     
     // Add tags if present
-    std::string from = message.getHeaders().getFrom();
-    std::string to = message.getHeaders().getTo();
-    
-    size_t from_tag_pos = from.find("tag=");
-    if (from_tag_pos != std::string::npos) {
-        oss << ":" << from.substr(from_tag_pos + 4);
-    }
-    
-    size_t to_tag_pos = to.find("tag=");
-    if (to_tag_pos != std::string::npos) {
-        oss << ":" << to.substr(to_tag_pos + 4);
+    for (std::string_view name : {"From", "To"}) {
+        std::string_view value = headers.view(name);
+        size_t tag_pos = value.find("tag=");
+        if (tag_pos != std::string_view::npos) {
+            dialog_id.append(":");
+            dialog_id.append(value.substr(tag_pos + 4));
+        }
     }
     
-    return oss.str();
+    return dialog_id;
 }
 
 void Dialog::notifyStateChange(DialogState old_state) {
@@ -211,47 +232,34 @@ void Dialog::notifyMessage(const SipMessage& message) {
 }
 
 void Dialog::extractDialogInfo(const SipMessage& message) {
-    call_id_ = message.getHeaders().getCallId();
+    const SipHeaders& headers = message.getHeaders();
+    call_id_ = headers.view("Call-ID");
     
     // Extract tags from From and To headers
-    std::string from = message.getHeaders().getFrom();
-    std::string to = message.getHeaders().getTo();
+    std::string_view from = headers.view("From");
+    std::string_view to = headers.view("To");
+    std::string_view from_tag = tagParameter(from);
+    std::string_view to_tag = tagParameter(to);
     
-    size_t from_tag_pos = from.find("tag=");
-    if (from_tag_pos != std::string::npos) {
-        size_t end_pos = from.find(';', from_tag_pos + 4);
-        if (end_pos == std::string::npos) end_pos = from.length();
-        
+    if (!from_tag.empty()) {
         if (message.isRequest()) {
-            remote_tag_ = from.substr(from_tag_pos + 4, end_pos - from_tag_pos - 4);
+            remote_tag_ = from_tag;
         } else {
-            local_tag_ = from.substr(from_tag_pos + 4, end_pos - from_tag_pos - 4);
+            local_tag_ = from_tag;
         }
     }
     
-    size_t to_tag_pos = to.find("tag=");
-    if (to_tag_pos != std::string::npos) {
-        size_t end_pos = to.find(';', to_tag_pos + 4);
-        if (end_pos == std::string::npos) end_pos = to.length();
-        
+    if (!to_tag.empty()) {
         if (message.isRequest()) {
-            local_tag_ = to.substr(to_tag_pos + 4, end_pos - to_tag_pos - 4);
+            local_tag_ = to_tag;
         } else {
-            remote_tag_ = to.substr(to_tag_pos + 4, end_pos - to_tag_pos - 4);
+            remote_tag_ = to_tag;
         }
     }
     
     // Generate local tag if not present
     if (local_tag_.empty()) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, 15);
-        
-        std::ostringstream oss;
-        for (int i = 0; i < 8; ++i) {
-            oss << std::hex << dis(gen);
-        }
-        local_tag_ = oss.str();
+        local_tag_ = core::SecureRandom::base32Token(10); // 50 bits; RFC 3261 asks for at least 32
     }
     
     // Extract URIs
@@ -260,9 +268,9 @@ void Dialog::extractDialogInfo(const SipMessage& message) {
         local_uri_ = to.substr(0, to.find(';'));
         
         // Remote target is the Contact header or Request-URI
-        std::string contact = message.getHeaders().get("Contact");
+        std::string_view contact = headers.view("Contact");
         if (!contact.empty()) {
-            remote_target_ = contact;
+            remote_target_ = contactUri(contact);
         } else {
             remote_target_ = message.getRequestUri().toString();
         }
@@ -271,9 +279,9 @@ void Dialog::extractDialogInfo(const SipMessage& message) {
         remote_uri_ = to.substr(0, to.find(';'));
         
         // Remote target from Contact header
-        std::string contact = message.getHeaders().get("Contact");
+        std::string_view contact = headers.view("Contact");
         if (!contact.empty()) {
-            remote_target_ = contact;
+            remote_target_ = contactUri(contact);
         }
     }
 }
@@ -294,7 +302,7 @@ DialogManager::~DialogManager() {
 }
 
 std::shared_ptr<Dialog> DialogManager::createDialog(const SipMessage& initial_request) {
-    std::string dialog_id = Dialog::generateDialogId(initial_request);
+    DialogId dialog_id = Dialog::generateDialogId(initial_request);
 
     // Check if dialog already exists
     auto existing = findDialog(dialog_id);
@@ -303,7 +311,7 @@ std::shared_ptr<Dialog> DialogManager::createDialog(const SipMessage& initial_re
     }
 
     // Create new dialog
-    auto dialog = std::make_shared<Dialog>(dialog_id, initial_request);
+    auto dialog = core::makePooled<Dialog>(dialog_id, initial_request);
 
     // Set up callbacks
     dialog->setStateCallback([this, dialog](DialogState old_state, DialogState new_state) {
@@ -311,7 +319,7 @@ std::shared_ptr<Dialog> DialogManager::createDialog(const SipMessage& initial_re
     });
 
     std::lock_guard<std::mutex> lock(mutex_);
-    dialogs_.push_back(dialog);
+    dialogs_.emplace(dialog_id, dialog);
 
     if (dialog_created_callback_) {
         dialog_created_callback_(dialog);
@@ -321,34 +329,24 @@ std::shared_ptr<Dialog> DialogManager::createDialog(const SipMessage& initial_re
     return dialog;
 }
 
-std::shared_ptr<Dialog> DialogManager::findDialog(const std::string& dialog_id) const {
+std::shared_ptr<Dialog> DialogManager::findDialog(const DialogId& dialog_id) const {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    for (const auto& dialog : dialogs_) {
-        if (dialog->getId() == dialog_id) {
-            return dialog;
-        }
-    }
-
-    return nullptr;
+    auto it = dialogs_.find(dialog_id);
+    return it != dialogs_.end() ? it->second : nullptr;
 }
 
 std::shared_ptr<Dialog> DialogManager::findDialogByMessage(const SipMessage& message) const {
-    std::string dialog_id = Dialog::generateDialogId(message);
-    return findDialog(dialog_id);
+    return findDialog(Dialog::generateDialogId(message));
 }
 
-void DialogManager::removeDialog(const std::string& dialog_id) {
+void DialogManager::removeDialog(const DialogId& dialog_id) {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    auto it = std::find_if(dialogs_.begin(), dialogs_.end(),
-                          [&dialog_id](const std::shared_ptr<Dialog>& dialog) {
-                              return dialog->getId() == dialog_id;
-                          });
-
+    auto it = dialogs_.find(dialog_id);
     if (it != dialogs_.end()) {
         if (dialog_terminated_callback_) {
-            dialog_terminated_callback_(*it);
+            dialog_terminated_callback_(it->second);
         }
         dialogs_.erase(it);
         core::Logger::info("Removed dialog {}", dialog_id);
@@ -402,20 +400,22 @@ size_t DialogManager::getDialogCount() const {
 
 std::vector<std::shared_ptr<Dialog>> DialogManager::getAllDialogs() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return dialogs_;
+
+    std::vector<std::shared_ptr<Dialog>> dialogs;
+    dialogs.reserve(dialogs_.size());
+    for (const auto& [id, dialog] : dialogs_) {
+        dialogs.push_back(dialog);
+    }
+    return dialogs;
 }
 
 void DialogManager::cleanup() {
     std::lock_guard<std::mutex> lock(mutex_);
 
     // Remove terminated dialogs
-    auto it = std::remove_if(dialogs_.begin(), dialogs_.end(),
-                            [](const std::shared_ptr<Dialog>& dialog) {
-                                return dialog->isTerminated();
-                            });
-
-    size_t removed = std::distance(it, dialogs_.end());
-    dialogs_.erase(it, dialogs_.end());
+    size_t removed = std::erase_if(dialogs_, [](const auto& entry) {
+        return entry.second->isTerminated();
+    });
 
     if (removed > 0) {
         core::Logger::debug("Cleaned up {} terminated dialogs", removed);
@@ -65,21 +65,90 @@ std::string SipUri::toString() const {
 }
 
 // SipHeaders implementation
-void SipHeaders::set(const std::string& name, const std::string& value) {
-    headers_[name] = value;
+namespace {
+
+constexpr size_t HEADER_ARENA_SIZE = 512; // Typical header block of a call setup message
+
+} // namespace
+
+SipHeaders::SipHeaders(const SipHeaders& other) {
+    entries_.reserve(other.entries_.size());
+    arena_.reserve(other.arena_.size());
+    other.forEach([this](std::string_view name, std::string_view value) {
+        entries_.push_back(Entry{store(name), static_cast<uint32_t>(name.size()),
+                                 store(value), static_cast<uint32_t>(value.size())});
+    });
+}
+
+SipHeaders& SipHeaders::operator=(const SipHeaders& other) {
+    if (this != &other) {
+        SipHeaders copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+void SipHeaders::set(std::string_view name, std::string_view value) {
+    Entry* entry = const_cast<Entry*>(find(name));
+    if (!entry) {
+        uint32_t name_offset = store(name);
+        entries_.push_back(Entry{name_offset, static_cast<uint32_t>(name.size()), 0, 0});
+        entry = &entries_.back();
+    } else if (value.size() <= entry->value_length) {
+        // Reuse the old value's bytes
+        std::char_traits<char>::move(arena_.data() + entry->value_offset, value.data(), value.size());
+        entry->value_length = static_cast<uint32_t>(value.size());
+        return;
+    }
+
+    entry->value_offset = store(value);
+    entry->value_length = static_cast<uint32_t>(value.size());
 }
 
-std::string SipHeaders::get(const std::string& name) const {
-    auto it = headers_.find(name);
-    return (it != headers_.end()) ? it->second : "";
+std::string SipHeaders::get(std::string_view name) const {
+    return std::string(view(name));
 }
 
-bool SipHeaders::has(const std::string& name) const {
-    return headers_.find(name) != headers_.end();
+std::string_view SipHeaders::view(std::string_view name) const {
+    const Entry* entry = find(name);
+    return entry ? text(entry->value_offset, entry->value_length) : std::string_view();
 }
 
-void SipHeaders::remove(const std::string& name) {
-    headers_.erase(name);
+bool SipHeaders::has(std::string_view name) const {
+    return find(name) != nullptr;
+}
+
+void SipHeaders::remove(std::string_view name) {
+    const Entry* entry = find(name);
+    if (entry) {
+        entries_.erase(entries_.begin() + (entry - entries_.data()));
+    }
+}
+
+uint32_t SipHeaders::store(std::string_view value) {
+    if (arena_.capacity() == 0) {
+        arena_.reserve(HEADER_ARENA_SIZE);
+    }
+
+    uint32_t offset = static_cast<uint32_t>(arena_.size());
+    if (!arena_.empty() && value.data() >= arena_.data() && value.data() < arena_.data() + arena_.size()) {
+        // Copying one of our own headers; the insert may reallocate under it
+        std::string copy(value);
+        arena_.insert(arena_.end(), copy.begin(), copy.end());
+    } else {
+        arena_.insert(arena_.end(), value.begin(), value.end());
+    }
+    return offset;
+}
+
+const SipHeaders::Entry* SipHeaders::find(std::string_view name) const {
+    // A message has a dozen or so headers; a scan beats hashing the name
+    for (const auto& entry : entries_) {
+        if (text(entry.name_offset, entry.name_length) == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
 }
 
 size_t SipHeaders::getContentLength() const {
@@ -99,107 +168,146 @@ SipMessage::SipMessage(SipResponseCode code, const std::string& reason_phrase)
     }
 }
 
+SipMessage SipMessage::createResponse(const SipMessage& request, SipResponseCode code,
+                                      const std::string& reason_phrase) {
+    SipMessage response(code, reason_phrase);
+    for (const char* name : {"Via", "From", "To", "Call-ID", "CSeq"}) {
+        response.headers_.set(name, request.headers_.view(name));
+    }
+    return response;
+}
+
 std::string SipMessage::toString() const {
-    std::ostringstream oss;
-    
+    std::string status_line;
     if (is_request_) {
-        oss << methodToString(method_) << " " << request_uri_.toString() << " SIP/2.0\r\n";
+        status_line = methodToString(method_) + " " + request_uri_.toString() + " SIP/2.0\r\n";
     } else {
-        oss << "SIP/2.0 " << static_cast<int>(response_code_) << " " << reason_phrase_ << "\r\n";
+        status_line = "SIP/2.0 " + std::to_string(static_cast<int>(response_code_)) + " " + reason_phrase_ + "\r\n";
     }
-    
+
+    size_t size = status_line.size() + 2 + body_.size();
+    headers_.forEach([&size](std::string_view name, std::string_view value) {
+        size += name.size() + value.size() + 4;
+    });
+
+    std::string result;
+    result.reserve(size);
+    result += status_line;
+
     // Add headers
-    for (const auto& [name, value] : headers_.getAll()) {
-        oss << name << ": " << value << "\r\n";
+    headers_.forEach([&result](std::string_view name, std::string_view value) {
+        result.append(name).append(": ").append(value).append("\r\n");
+    });
+
+    result += "\r\n";
+    result += body_;
+
+    return result;
+}
+
+namespace {
+
+// Next line of a message without its line ending; false at the end
+bool nextLine(std::string_view& rest, std::string_view& line) {
+    if (rest.empty()) {
+        return false;
     }
-    
-    oss << "\r\n";
-    
-    if (!body_.empty()) {
-        oss << body_;
+
+    size_t end = rest.find('\n');
+    if (end == std::string_view::npos) {
+        line = rest;
+        rest = std::string_view();
+    } else {
+        line = rest.substr(0, end);
+        rest.remove_prefix(end + 1);
     }
-    
-    return oss.str();
+
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    return true;
 }
 
+// Next whitespace-separated token of line
+std::string_view nextToken(std::string_view& line) {
+    size_t begin = line.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        line = std::string_view();
+        return std::string_view();
+    }
+
+    size_t end = line.find_first_of(" \t", begin);
+    std::string_view token = line.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+    line.remove_prefix(end == std::string_view::npos ? line.size() : end);
+    return token;
+}
+
+} // namespace
+
 SipMessage SipMessage::fromString(const std::string& message) {
-    // Simple parsing - split by lines
-    std::istringstream iss(message);
-    std::string line;
-    
+    // Parsed in place; header text is copied once, into the message's arena
+    std::string_view rest(message);
+    std::string_view line;
+
     // Parse first line
-    if (!std::getline(iss, line)) {
+    if (!nextLine(rest, line)) {
         throw std::runtime_error("Invalid SIP message: empty");
     }
-    
-    // Remove \r if present
-    if (!line.empty() && line.back() == '\r') {
-        line.pop_back();
-    }
-    
+
     SipMessage msg;
-    
+
     // Check if request or response
-    if (line.find("SIP/2.0") == 0) {
+    if (line.substr(0, 7) == "SIP/2.0") {
         // Response
         msg.is_request_ = false;
-        std::istringstream line_stream(line);
-        std::string version, code_str;
-        line_stream >> version >> code_str;
-        msg.response_code_ = static_cast<SipResponseCode>(std::stoi(code_str));
-        
+        std::string_view status = line;
+        nextToken(status); // Version
+        std::string_view code = nextToken(status);
+        msg.response_code_ = static_cast<SipResponseCode>(std::stoi(std::string(code)));
+
         // Get reason phrase (rest of line)
-        std::string reason;
-        std::getline(line_stream, reason);
-        if (!reason.empty() && reason[0] == ' ') {
-            reason = reason.substr(1);
+        if (!status.empty() && status[0] == ' ') {
+            status.remove_prefix(1);
         }
-        msg.reason_phrase_ = reason;
+        msg.reason_phrase_ = std::string(status);
     } else {
         // Request
         msg.is_request_ = true;
-        std::istringstream line_stream(line);
-        std::string method_str, uri_str, version;
-        line_stream >> method_str >> uri_str >> version;
-        msg.method_ = stringToMethod(method_str);
-        msg.request_uri_ = SipUri(uri_str);
+        std::string_view request_line = line;
+        std::string_view method = nextToken(request_line);
+        std::string_view uri = nextToken(request_line);
+        msg.method_ = stringToMethod(std::string(method));
+        msg.request_uri_ = SipUri(std::string(uri));
     }
-    
+
     // Parse headers
-    while (std::getline(iss, line)) {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-        
+    while (nextLine(rest, line)) {
         if (line.empty()) {
             // End of headers
             break;
         }
-        
+
         size_t colon_pos = line.find(':');
-        if (colon_pos != std::string::npos) {
-            std::string name = line.substr(0, colon_pos);
-            std::string value = line.substr(colon_pos + 1);
-            
+        if (colon_pos != std::string_view::npos) {
+            std::string_view name = line.substr(0, colon_pos);
+            std::string_view value = line.substr(colon_pos + 1);
+
             // Trim whitespace
-            value.erase(0, value.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t") + 1);
-            
+            size_t begin = value.find_first_not_of(" \t");
+            value = begin == std::string_view::npos ? std::string_view() : value.substr(begin);
+            size_t end = value.find_last_not_of(" \t");
+            value = value.substr(0, end == std::string_view::npos ? 0 : end + 1);
+
             msg.headers_.set(name, value);
         }
     }
-    
-    // Parse body (rest of message)
-    std::ostringstream body_stream;
-    while (std::getline(iss, line)) {
-        body_stream << line << "\n";
-    }
-    std::string body = body_stream.str();
-    if (!body.empty() && body.back() == '\n') {
-        body.pop_back();
+
+    // Parse body (rest of message, less a final newline)
+    if (!rest.empty() && rest.back() == '\n') {
+        rest.remove_suffix(1);
     }
-    msg.body_ = body;
-    
+    msg.body_ = std::string(rest);
+
     return msg;
 }
 
@@ -255,7 +363,12 @@ std::string responseCodeToString(SipResponseCode code) {
         case SipResponseCode::Forbidden: return "Forbidden";
         case SipResponseCode::NotFound: return "Not Found";
         case SipResponseCode::MethodNotAllowed: return "Method Not Allowed";
+        case SipResponseCode::ProxyAuthenticationRequired: return "Proxy Authentication Required";
         case SipResponseCode::RequestTimeout: return "Request Timeout";
+        case SipResponseCode::CallDoesNotExist: return "Call/Transaction Does Not Exist";
+        case SipResponseCode::BusyHere: return "Busy Here";
+        case SipResponseCode::RequestTerminated: return "Request Terminated";
+        case SipResponseCode::NotAcceptableHere: return "Not Acceptable Here";
         case SipResponseCode::ServerInternalError: return "Internal Server Error";
         case SipResponseCode::NotImplemented: return "Not Implemented";
         case SipResponseCode::BadGateway: return "Bad Gateway";
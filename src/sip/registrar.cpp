@@ -1,7 +1,8 @@
 #include "fmus/sip/registrar.hpp"
 #include "fmus/core/logger.hpp"
+#include "fmus/core/pool.hpp"
+#include "fmus/core/random.hpp"
 #include <sstream>
-#include <random>
 #include <iomanip>
 #include <algorithm>
 
@@ -165,19 +166,19 @@ const UserAccount* SipRegistrar::findUser(const std::string& username) const {
 
 SipMessage SipRegistrar::processRegister(const SipMessage& request) {
     if (request.getMethod() != SipMethod::REGISTER) {
-        return SipMessage(SipResponseCode::BadRequest, "Method not allowed");
+        return SipMessage::createResponse(request, SipResponseCode::BadRequest, "Method not allowed");
     }
     
     // Extract username from To header
     std::string to_header = request.getHeaders().getTo();
     size_t uri_start = to_header.find("sip:");
     if (uri_start == std::string::npos) {
-        return SipMessage(SipResponseCode::BadRequest, "Invalid To header");
+        return SipMessage::createResponse(request, SipResponseCode::BadRequest, "Invalid To header");
     }
     
     size_t uri_end = to_header.find("@", uri_start);
     if (uri_end == std::string::npos) {
-        return SipMessage(SipResponseCode::BadRequest, "Invalid To header");
+        return SipMessage::createResponse(request, SipResponseCode::BadRequest, "Invalid To header");
     }
     
     std::string username = to_header.substr(uri_start + 4, uri_end - uri_start - 4);
@@ -185,11 +186,11 @@ SipMessage SipRegistrar::processRegister(const SipMessage& request) {
     // Find user
     UserAccount* user = findUser(username);
     if (!user) {
-        return SipMessage(SipResponseCode::NotFound, "User not found");
+        return SipMessage::createResponse(request, SipResponseCode::NotFound, "User not found");
     }
     
     if (!user->enabled) {
-        return SipMessage(SipResponseCode::Forbidden, "User disabled");
+        return SipMessage::createResponse(request, SipResponseCode::Forbidden, "User disabled");
     }
     
     // Check for authentication
@@ -199,14 +200,14 @@ SipMessage SipRegistrar::processRegister(const SipMessage& request) {
         user->nonce = challenge.nonce;
         user->nonce_expires = std::chrono::system_clock::now() + std::chrono::minutes(5);
         
-        SipMessage response(SipResponseCode::Unauthorized, "Authentication Required");
+        SipMessage response = SipMessage::createResponse(request, SipResponseCode::Unauthorized, "Authentication Required");
         response.getHeaders().set("WWW-Authenticate", challenge.toString());
         return response;
     }
     
     // Verify authentication
     if (!authenticateRequest(request, *user)) {
-        return SipMessage(SipResponseCode::Forbidden, "Authentication failed");
+        return SipMessage::createResponse(request, SipResponseCode::Forbidden, "Authentication failed");
     }
     
     // Process registration
@@ -245,12 +246,7 @@ SipMessage SipRegistrar::processRegister(const SipMessage& request) {
     }
     
     // Create success response
-    SipMessage response(SipResponseCode::OK, "OK");
-    response.getHeaders().setFrom(request.getHeaders().getFrom());
-    response.getHeaders().setTo(request.getHeaders().getTo());
-    response.getHeaders().setCallId(request.getHeaders().getCallId());
-    response.getHeaders().setCSeq(request.getHeaders().getCSeq());
-    response.getHeaders().setVia(request.getHeaders().getVia());
+    SipMessage response = SipMessage::createResponse(request, SipResponseCode::OK, "OK");
     
     if (!contact.empty()) {
         response.getHeaders().set("Contact", contact + ";expires=" + std::to_string(expires));
@@ -381,6 +377,10 @@ bool SipRegistrationClient::registerUser() {
         return false;
     }
 
+    if (loop_ && send_callback_) {
+        return loop_->spawn(registerFlow(expires_));
+    }
+
     setState(RegistrationState::REGISTERING);
 
     SipMessage request = createRegisterRequest(expires_);
@@ -398,6 +398,10 @@ bool SipRegistrationClient::unregisterUser() {
         return false;
     }
 
+    if (loop_ && send_callback_) {
+        return loop_->spawn(registerFlow(0));
+    }
+
     setState(RegistrationState::UNREGISTERING);
 
     SipMessage request = createRegisterRequest(0); // Expires = 0 means unregister
@@ -422,6 +426,16 @@ bool SipRegistrationClient::processResponse(const SipMessage& response) {
         return false;
     }
 
+    // Responses for a running flow complete its transaction, which resumes it
+    std::shared_ptr<ClientNonInviteTransaction> transaction;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        transaction = transaction_;
+    }
+    if (transaction && transaction->processMessage(response)) {
+        return true;
+    }
+
     SipResponseCode code = response.getResponseCode();
 
     switch (code) {
@@ -469,6 +483,110 @@ bool SipRegistrationClient::processResponse(const SipMessage& response) {
     return false;
 }
 
+core::Task<bool> SipRegistrationClient::registerFlow(uint32_t expires) {
+    if (username_.empty() || user_uri_.empty()) {
+        notifyError("Username and user URI must be set");
+        co_return false;
+    }
+
+    setState(expires > 0 ? RegistrationState::REGISTERING : RegistrationState::UNREGISTERING);
+    core::Logger::info("Sending REGISTER request for user: {} (expires {})", username_, expires);
+
+    SipMessage request = createRegisterRequest(expires);
+    std::optional<SipMessage> response = co_await sendRequest(request);
+
+    if (response && (response->getResponseCode() == SipResponseCode::Unauthorized ||
+                     response->getResponseCode() == SipResponseCode::ProxyAuthenticationRequired)) {
+        bool proxy = response->getResponseCode() == SipResponseCode::ProxyAuthenticationRequired;
+        std::string auth_header = response->getHeaders().get(proxy ? "Proxy-Authenticate" : "WWW-Authenticate");
+
+        // Remove "Digest " prefix
+        if (auth_header.substr(0, 7) == "Digest ") {
+            auth_header = auth_header.substr(7);
+        }
+
+        AuthChallenge challenge = AuthChallenge::fromString(auth_header);
+        current_realm_ = challenge.realm;
+        current_nonce_ = challenge.nonce;
+        nonce_count_++;
+
+        // Same Call-ID with the next CSeq (RFC 3261 Section 10.2)
+        request.getHeaders().setCSeq("2 REGISTER");
+        request.getHeaders().set(proxy ? "Proxy-Authorization" : "Authorization",
+                                 "Digest " + calculateAuthResponse(challenge, "REGISTER", user_uri_));
+
+        core::Logger::info("Sending authenticated REGISTER request for user: {}", username_);
+        response = co_await sendRequest(request);
+    }
+
+    if (!response) {
+        setState(RegistrationState::FAILED);
+        notifyError("Registration timed out");
+        co_return false;
+    }
+
+    SipResponseCode code = response->getResponseCode();
+    if (code >= SipResponseCode::OK && code < SipResponseCode::MultipleChoices) {
+        setState(expires > 0 ? RegistrationState::REGISTERED : RegistrationState::UNREGISTERED);
+        core::Logger::info("{} successful for user: {}", expires > 0 ? "Registration" : "Unregistration", username_);
+        co_return true;
+    }
+
+    setState(RegistrationState::FAILED);
+    notifyError("Registration failed with code: " + std::to_string(static_cast<int>(code)));
+    co_return false;
+}
+
+core::Task<std::optional<SipMessage>> SipRegistrationClient::sendRequest(SipMessage request) {
+    request.getHeaders().setVia("SIP/2.0/UDP " + registrar_.toString() + ";branch=" +
+                                TransactionIdGenerator::generateBranch());
+
+    auto transaction = core::makePooled<ClientNonInviteTransaction>(
+        TransactionIdGenerator::generateClientId(request), request);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        transaction_ = transaction;
+    }
+    transaction->sendMessage(request);
+
+    std::optional<SipMessage> response;
+    if (!send_callback_ || !send_callback_(request)) {
+        notifyError("Failed to send REGISTER request");
+    } else {
+        // Timer E doubles from T1 up to T2 until a provisional response moves
+        // the transaction to Proceeding; Timer F bounds the whole wait
+        auto deadline = std::chrono::steady_clock::now() + TIMER_B;
+        std::chrono::milliseconds interval = TIMER_T1;
+
+        while (true) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                break;
+            }
+
+            response = co_await transaction->finalResponse(std::min(interval, remaining));
+            if (response) {
+                break;
+            }
+
+            if (transaction->getState() == TransactionState::TRYING_NON_INVITE) {
+                core::Logger::debug("Retransmitting REGISTER for user: {}", username_);
+                send_callback_(request);
+            }
+            interval = std::min(interval * 2, TIMER_T2);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (transaction_ == transaction) {
+            transaction_.reset();
+        }
+    }
+    co_return response;
+}
+
 void SipRegistrationClient::setState(RegistrationState new_state) {
     RegistrationState old_state = state_.exchange(new_state);
     if (old_state != new_state && state_callback_) {
@@ -527,7 +645,7 @@ SipMessage SipRegistrationClient::createAuthenticatedRequest(const SipMessage& /
 std::string SipRegistrationClient::calculateAuthResponse(const AuthChallenge& challenge,
                                                         const std::string& method,
                                                         const std::string& uri) const {
-    std::string cnonce = auth::generateNonce().substr(0, 8);
+    std::string cnonce = core::SecureRandom::hexToken(16);
     std::string nc = std::to_string(nonce_count_);
 
     // Pad nc to 8 digits
@@ -590,10 +708,6 @@ void RegistrationManager::performMaintenance() {
 namespace auth {
 
 std::string generateNonce() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 15);
-
     std::ostringstream oss;
 
     // Add timestamp
@@ -601,12 +715,10 @@ std::string generateNonce() {
     auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
     oss << std::hex << timestamp;
 
-    // Add random part
-    for (int i = 0; i < 16; ++i) {
-        oss << std::hex << dis(gen);
-    }
-
-    return oss.str();
+    // Add 128 random bits
+    std::string nonce = oss.str();
+    core::SecureRandom::appendHex(nonce, 32);
+    return nonce;
 }
 
 std::string calculateMD5Hash(const std::string& data) {
@@ -0,0 +1,190 @@
+#include "fmus/sip/response_template.hpp"
+#include "fmus/core/random.hpp"
+#include <cstring>
+
+namespace fmus::sip {
+
+namespace {
+
+constexpr std::string_view CONTENT_LENGTH = "Content-Length: 0\r\n\r\n";
+constexpr std::string_view TAG_PARAMETER = ";tag=";
+constexpr size_t TAG_LENGTH = 10;
+
+enum HeaderIndex { VIA, FROM, TO, CALL_ID, CSEQ, HEADER_COUNT };
+
+// One pass over the request picks up every copied header
+void findHeaders(const SipMessage& request, std::string_view* views) {
+    request.getHeaders().forEach([views](std::string_view name, std::string_view value) {
+        switch (name.size()) {
+            case 2:
+                if (name == "To") views[TO] = value;
+                break;
+            case 3:
+                if (name == "Via") views[VIA] = value;
+                break;
+            case 4:
+                if (name == "From") views[FROM] = value;
+                else if (name == "CSeq") views[CSEQ] = value;
+                break;
+            case 7:
+                if (name == "Call-ID") views[CALL_ID] = value;
+                break;
+        }
+    });
+}
+
+} // namespace
+
+ResponseTemplate::ResponseTemplate(SipResponseCode code, const std::string& reason_phrase)
+    : code_(code) {
+    std::string reason = reason_phrase.empty() ? responseCodeToString(code) : reason_phrase;
+    addLiteral("SIP/2.0 " + std::to_string(static_cast<int>(code)) + " " + reason + "\r\nVia: ");
+    addSource(Source::VIA);
+    addLiteral("\r\nFrom: ");
+    addSource(Source::FROM);
+    addLiteral("\r\nTo: ");
+    addSource(Source::TO);
+    addLiteral("\r\nCall-ID: ");
+    addSource(Source::CALL_ID);
+    addLiteral("\r\nCSeq: ");
+    addSource(Source::CSEQ);
+    addLiteral("\r\n");
+}
+
+ResponseTemplate& ResponseTemplate::addToTag(bool enable) {
+    to_tag_ = enable;
+    return *this;
+}
+
+ResponseTemplate& ResponseTemplate::addHeader(std::string_view name, std::string_view value) {
+    addLiteral(std::string(name) + ": " + std::string(value) + "\r\n");
+    return *this;
+}
+
+ResponseTemplate& ResponseTemplate::addHeader(std::string_view name, std::string_view prefix, Slot slot,
+                                              std::string_view suffix) {
+    addLiteral(std::string(name) + ": " + std::string(prefix));
+    addSource(slot == Slot::NONCE ? Source::NONCE : Source::VALUE);
+    addLiteral(std::string(suffix) + "\r\n");
+    return *this;
+}
+
+void ResponseTemplate::addLiteral(std::string_view text) {
+    if (text.empty()) {
+        return;
+    }
+
+    // Literals are appended in order, so consecutive ones merge
+    if (!segments_.empty() && segments_.back().source == Source::LITERAL) {
+        segments_.back().length += static_cast<uint32_t>(text.size());
+    } else {
+        segments_.push_back({Source::LITERAL, static_cast<uint32_t>(text_.size()), static_cast<uint32_t>(text.size())});
+    }
+    text_.append(text);
+    literal_size_ += text.size();
+}
+
+void ResponseTemplate::addSource(Source source) {
+    segments_.push_back({source, 0, 0});
+}
+
+size_t ResponseTemplate::render(const SipMessage& request, const Values& values, char* out, size_t capacity) const {
+    std::string_view headers[HEADER_COUNT];
+    findHeaders(request, headers);
+
+    std::string generated_tag;
+    std::string_view tag;
+    if (to_tag_ && headers[TO].find(TAG_PARAMETER) == std::string_view::npos) {
+        tag = values.to_tag;
+        if (tag.empty()) {
+            generated_tag = core::SecureRandom::base32Token(TAG_LENGTH);
+            tag = generated_tag;
+        }
+    }
+
+    auto sourceText = [&](const Segment& segment) -> std::string_view {
+        switch (segment.source) {
+            case Source::LITERAL: return std::string_view(text_.data() + segment.offset, segment.length);
+            case Source::VIA: return headers[VIA];
+            case Source::FROM: return headers[FROM];
+            case Source::TO: return headers[TO];
+            case Source::CALL_ID: return headers[CALL_ID];
+            case Source::CSEQ: return headers[CSEQ];
+            case Source::NONCE: return values.nonce;
+            case Source::VALUE: return values.value;
+        }
+        return {};
+    };
+
+    size_t size = literal_size_ + CONTENT_LENGTH.size();
+    for (const Segment& segment : segments_) {
+        if (segment.source != Source::LITERAL) {
+            size += sourceText(segment).size();
+        }
+    }
+    if (!tag.empty()) {
+        size += TAG_PARAMETER.size() + tag.size();
+    }
+    if (size > capacity) {
+        return 0;
+    }
+
+    char* position = out;
+    auto write = [&position](std::string_view text) {
+        std::memcpy(position, text.data(), text.size());
+        position += text.size();
+    };
+
+    for (const Segment& segment : segments_) {
+        write(sourceText(segment));
+        if (segment.source == Source::TO && !tag.empty()) {
+            write(TAG_PARAMETER);
+            write(tag);
+        }
+    }
+    write(CONTENT_LENGTH);
+    return size;
+}
+
+std::string_view ResponseTemplate::render(const SipMessage& request, const Values& values) const {
+    thread_local std::vector<char> buffer(1024);
+
+    size_t size = render(request, values, buffer.data(), buffer.size());
+    while (size == 0) {
+        // Rare: a request with very long headers
+        buffer.resize(buffer.size() * 2);
+        size = render(request, values, buffer.data(), buffer.size());
+    }
+    return std::string_view(buffer.data(), size);
+}
+
+ResponseTemplate ResponseTemplate::trying() {
+    return ResponseTemplate(SipResponseCode::Trying);
+}
+
+ResponseTemplate ResponseTemplate::optionsOk(std::string_view allow) {
+    ResponseTemplate response(SipResponseCode::OK);
+    response.addToTag();
+    if (!allow.empty()) {
+        response.addHeader("Allow", allow);
+    }
+    return response;
+}
+
+ResponseTemplate ResponseTemplate::challenge(std::string_view realm, bool proxy) {
+    ResponseTemplate response(proxy ? SipResponseCode::ProxyAuthenticationRequired : SipResponseCode::Unauthorized);
+    response.addToTag();
+    response.addHeader(proxy ? "Proxy-Authenticate" : "WWW-Authenticate",
+                       "Digest realm=\"" + std::string(realm) + "\", nonce=\"", Slot::NONCE,
+                       "\", algorithm=MD5, qop=\"auth\"");
+    return response;
+}
+
+ResponseTemplate ResponseTemplate::serviceUnavailable() {
+    ResponseTemplate response(SipResponseCode::ServiceUnavailable);
+    response.addToTag();
+    response.addHeader("Retry-After", "", Slot::VALUE);
+    return response;
+}
+
+} // namespace fmus::sip
@@ -1,10 +1,13 @@
 #include "fmus/sip/sdp.hpp"
 #include "fmus/core/logger.hpp"
+#include "fmus/core/sha1.hpp"
+#include "fmus/core/base64.hpp"
+#include "fmus/core/random.hpp"
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
 #include <chrono>
-#include <random>
+#include <cctype>
 
 namespace fmus::sip {
 
@@ -51,6 +54,144 @@ Attribute Attribute::fromString(const std::string& line) {
     return Attribute(line.substr(0, colon_pos), line.substr(colon_pos + 1));
 }
 
+// Fingerprint implementation
+static int hexDigitValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string Fingerprint::toString() const {
+    static const char hex[] = "0123456789ABCDEF";
+    
+    std::string result = hash_function + " ";
+    for (size_t i = 0; i < digest.size(); ++i) {
+        if (i > 0) {
+            result += ':';
+        }
+        result += hex[digest[i] >> 4];
+        result += hex[digest[i] & 0x0F];
+    }
+    return result;
+}
+
+std::optional<Fingerprint> Fingerprint::fromString(const std::string& value) {
+    size_t space_pos = value.find(' ');
+    if (space_pos == std::string::npos || space_pos == 0) {
+        return std::nullopt;
+    }
+    
+    Fingerprint fingerprint;
+    fingerprint.hash_function = value.substr(0, space_pos);
+    std::transform(fingerprint.hash_function.begin(), fingerprint.hash_function.end(),
+                   fingerprint.hash_function.begin(), ::tolower);
+    
+    // Pairs of hex digits separated by colons
+    std::string hex = value.substr(space_pos + 1);
+    if (hex.size() < 2 || (hex.size() + 1) % 3 != 0) {
+        return std::nullopt;
+    }
+    
+    for (size_t i = 0; i < hex.size(); i += 3) {
+        if (i + 2 < hex.size() && hex[i + 2] != ':') {
+            return std::nullopt;
+        }
+        int high = hexDigitValue(hex[i]);
+        int low = hexDigitValue(hex[i + 1]);
+        if (high < 0 || low < 0) {
+            return std::nullopt;
+        }
+        fingerprint.digest.push_back(static_cast<uint8_t>((high << 4) | low));
+    }
+    
+    return fingerprint;
+}
+
+Fingerprint Fingerprint::fromCertificate(const std::vector<uint8_t>& der) {
+    auto digest = core::Sha1::digest(der.data(), der.size());
+    
+    Fingerprint fingerprint;
+    fingerprint.hash_function = "sha-1";
+    fingerprint.digest.assign(digest.begin(), digest.end());
+    return fingerprint;
+}
+
+std::optional<Fingerprint> Fingerprint::fromPem(const std::string& pem) {
+    static const std::string begin_marker = "-----BEGIN CERTIFICATE-----";
+    static const std::string end_marker = "-----END CERTIFICATE-----";
+    
+    size_t begin = pem.find(begin_marker);
+    size_t end = pem.find(end_marker);
+    if (begin == std::string::npos || end == std::string::npos || end < begin) {
+        return std::nullopt;
+    }
+    
+    // Strip the line breaks from the base64 body
+    std::string body;
+    for (size_t i = begin + begin_marker.size(); i < end; ++i) {
+        if (!std::isspace(static_cast<unsigned char>(pem[i]))) {
+            body += pem[i];
+        }
+    }
+    
+    std::vector<uint8_t> der;
+    if (!core::base64Decode(body, der) || der.empty()) {
+        return std::nullopt;
+    }
+    return fromCertificate(der);
+}
+
+bool Fingerprint::matches(const std::vector<uint8_t>& der) const {
+    if (hash_function != "sha-1") {
+        core::Logger::warn("Unsupported fingerprint hash function: {}", hash_function);
+        return false;
+    }
+    return fromCertificate(der).digest == digest;
+}
+
+// ExtensionMap implementation
+std::string ExtensionMap::toString() const {
+    std::string result = std::to_string(id);
+    if (!direction.empty()) {
+        result += "/" + direction;
+    }
+    result += " " + uri;
+    if (!attributes.empty()) {
+        result += " " + attributes;
+    }
+    return result;
+}
+
+std::optional<ExtensionMap> ExtensionMap::fromString(const std::string& value) {
+    std::istringstream iss(value);
+    std::string id_part;
+    ExtensionMap map;
+    if (!(iss >> id_part >> map.uri)) {
+        return std::nullopt;
+    }
+    
+    size_t slash_pos = id_part.find('/');
+    if (slash_pos != std::string::npos) {
+        map.direction = id_part.substr(slash_pos + 1);
+        id_part.resize(slash_pos);
+    }
+    
+    // 1-14 for one-byte headers, up to 255 with two-byte ones; 15 is reserved
+    if (id_part.empty() || id_part.size() > 3 ||
+        !std::all_of(id_part.begin(), id_part.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return std::nullopt;
+    }
+    int id = std::stoi(id_part);
+    if (id < 1 || id > 255 || id == 15) {
+        return std::nullopt;
+    }
+    map.id = static_cast<uint8_t>(id);
+    
+    std::getline(iss >> std::ws, map.attributes);
+    return map;
+}
+
 // MediaDescription implementation
 MediaDescription::MediaDescription(MediaType type, uint16_t port, Protocol protocol)
     : type_(type), port_(port), protocol_(protocol) {
@@ -173,15 +314,25 @@ MediaDescription MediaDescription::fromString(const std::string& media_section)
     return media;
 }
 
+std::vector<ExtensionMap> MediaDescription::getExtensionMaps() const {
+    std::vector<ExtensionMap> maps;
+    for (const auto& attr : attributes_) {
+        if (attr.name != "extmap") {
+            continue;
+        }
+        if (auto map = ExtensionMap::fromString(attr.value)) {
+            maps.push_back(std::move(*map));
+        }
+    }
+    return maps;
+}
+
 // SessionDescription implementation
 SessionDescription::SessionDescription() {
     // Set default origin with random session ID
-    std::random_device rd;
-    std::mt19937_64 gen(rd());
-    
     origin_.username = "fmus";
-    origin_.session_id = gen();
-    origin_.session_version = gen();
+    origin_.session_id = core::SecureRandom::next64();
+    origin_.session_version = core::SecureRandom::next64();
     origin_.unicast_address = "127.0.0.1";
     
     // Default timing (permanent session)
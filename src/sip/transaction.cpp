@@ -1,16 +1,17 @@
 #include "fmus/sip/transaction.hpp"
 #include "fmus/sip/dialog.hpp"
 #include "fmus/core/logger.hpp"
+#include "fmus/core/random.hpp"
 #include <sstream>
-#include <random>
 #include <iomanip>
 #include <algorithm>
 
 namespace fmus::sip {
 
 // Transaction base class implementation
-Transaction::Transaction(TransactionType type, const std::string& transaction_id)
-    : type_(type), transaction_id_(transaction_id), state_(TransactionState::TRYING) {
+Transaction::Transaction(TransactionType type, const TransactionId& transaction_id)
+    : type_(type), transaction_id_(transaction_id), state_(TransactionState::TRYING),
+      final_response_(std::make_shared<core::Oneshot<SipMessage>>()) {
 }
 
 Transaction::~Transaction() {
@@ -97,8 +98,13 @@ void Transaction::notifyMessage(const SipMessage& message) {
     }
 }
 
+void Transaction::completeFinalResponse(const SipMessage& response) {
+    // Retransmitted final responses find the value already set
+    final_response_->set(response);
+}
+
 // ClientInviteTransaction implementation
-ClientInviteTransaction::ClientInviteTransaction(const std::string& transaction_id, const SipMessage& invite)
+ClientInviteTransaction::ClientInviteTransaction(const TransactionId& transaction_id, const SipMessage& invite)
     : Transaction(TransactionType::CLIENT_INVITE, transaction_id), invite_(invite) {
     setState(TransactionState::CALLING);
 }
@@ -142,8 +148,8 @@ bool ClientInviteTransaction::canAcceptMessage(const SipMessage& message) const
     }
     
     // Check if response matches our INVITE
-    return message.getHeaders().getCallId() == invite_.getHeaders().getCallId() &&
-           message.getHeaders().getCSeq().find("INVITE") != std::string::npos;
+    return message.getHeaders().view("Call-ID") == invite_.getHeaders().view("Call-ID") &&
+           message.getHeaders().view("CSeq").find("INVITE") != std::string_view::npos;
 }
 
 bool ClientInviteTransaction::sendInvite() {
@@ -222,6 +228,7 @@ void ClientInviteTransaction::handleFinalResponse(const SipMessage& response) {
     }
     
     notifyMessage(response);
+    completeFinalResponse(response);
 }
 
 void ClientInviteTransaction::startTimerA() {
@@ -237,7 +244,7 @@ void ClientInviteTransaction::startTimerD() {
 }
 
 // ClientNonInviteTransaction implementation
-ClientNonInviteTransaction::ClientNonInviteTransaction(const std::string& transaction_id, const SipMessage& request)
+ClientNonInviteTransaction::ClientNonInviteTransaction(const TransactionId& transaction_id, const SipMessage& request)
     : Transaction(TransactionType::CLIENT_NON_INVITE, transaction_id), request_(request) {
     setState(TransactionState::TRYING_NON_INVITE);
 }
@@ -279,8 +286,8 @@ bool ClientNonInviteTransaction::canAcceptMessage(const SipMessage& message) con
     }
     
     // Check if response matches our request
-    return message.getHeaders().getCallId() == request_.getHeaders().getCallId() &&
-           message.getHeaders().getCSeq() == request_.getHeaders().getCSeq();
+    return message.getHeaders().view("Call-ID") == request_.getHeaders().view("Call-ID") &&
+           message.getHeaders().view("CSeq") == request_.getHeaders().view("CSeq");
 }
 
 void ClientNonInviteTransaction::handleProvisionalResponse(const SipMessage& response) {
@@ -300,6 +307,7 @@ void ClientNonInviteTransaction::handleFinalResponse(const SipMessage& response)
     startTimerK(); // Wait for retransmissions
     
     notifyMessage(response);
+    completeFinalResponse(response);
 }
 
 void ClientNonInviteTransaction::startTimerE() {
@@ -315,7 +323,7 @@ void ClientNonInviteTransaction::startTimerK() {
 }
 
 // ServerInviteTransaction implementation
-ServerInviteTransaction::ServerInviteTransaction(const std::string& transaction_id, const SipMessage& invite)
+ServerInviteTransaction::ServerInviteTransaction(const TransactionId& transaction_id, const SipMessage& invite)
     : Transaction(TransactionType::SERVER_INVITE, transaction_id), invite_(invite) {
     setState(TransactionState::TRYING);
 }
@@ -366,23 +374,13 @@ bool ServerInviteTransaction::sendProvisionalResponse(SipResponseCode code, cons
         return false;
     }
 
-    SipMessage response(code, reason.empty() ? "" : reason);
-    response.getHeaders().setCallId(invite_.getHeaders().getCallId());
-    response.getHeaders().setFrom(invite_.getHeaders().getFrom());
-    response.getHeaders().setTo(invite_.getHeaders().getTo());
-    response.getHeaders().setCSeq(invite_.getHeaders().getCSeq());
-    response.getHeaders().setVia(invite_.getHeaders().getVia());
+    SipMessage response = SipMessage::createResponse(invite_, code, reason);
 
     return sendResponse(response);
 }
 
 bool ServerInviteTransaction::sendFinalResponse(SipResponseCode code, const std::string& reason) {
-    SipMessage response(code, reason.empty() ? "" : reason);
-    response.getHeaders().setCallId(invite_.getHeaders().getCallId());
-    response.getHeaders().setFrom(invite_.getHeaders().getFrom());
-    response.getHeaders().setTo(invite_.getHeaders().getTo());
-    response.getHeaders().setCSeq(invite_.getHeaders().getCSeq());
-    response.getHeaders().setVia(invite_.getHeaders().getVia());
+    SipMessage response = SipMessage::createResponse(invite_, code, reason);
 
     final_response_sent_ = true;
     return sendResponse(response);
@@ -443,7 +441,7 @@ void ServerInviteTransaction::startTimerI() {
 }
 
 // ServerNonInviteTransaction implementation
-ServerNonInviteTransaction::ServerNonInviteTransaction(const std::string& transaction_id, const SipMessage& request)
+ServerNonInviteTransaction::ServerNonInviteTransaction(const TransactionId& transaction_id, const SipMessage& request)
     : Transaction(TransactionType::SERVER_NON_INVITE, transaction_id), request_(request) {
     setState(TransactionState::TRYING_NON_INVITE);
 }
@@ -477,8 +475,8 @@ bool ServerNonInviteTransaction::canAcceptMessage(const SipMessage& message) con
     }
 
     // Check if request matches our transaction
-    return message.getHeaders().getCallId() == request_.getHeaders().getCallId() &&
-           message.getHeaders().getCSeq() == request_.getHeaders().getCSeq();
+    return message.getHeaders().view("Call-ID") == request_.getHeaders().view("Call-ID") &&
+           message.getHeaders().view("CSeq") == request_.getHeaders().view("CSeq");
 }
 
 bool ServerNonInviteTransaction::sendProvisionalResponse(SipResponseCode code, const std::string& reason) {
@@ -486,23 +484,13 @@ bool ServerNonInviteTransaction::sendProvisionalResponse(SipResponseCode code, c
         return false;
     }
 
-    SipMessage response(code, reason.empty() ? "" : reason);
-    response.getHeaders().setCallId(request_.getHeaders().getCallId());
-    response.getHeaders().setFrom(request_.getHeaders().getFrom());
-    response.getHeaders().setTo(request_.getHeaders().getTo());
-    response.getHeaders().setCSeq(request_.getHeaders().getCSeq());
-    response.getHeaders().setVia(request_.getHeaders().getVia());
+    SipMessage response = SipMessage::createResponse(request_, code, reason);
 
     return sendResponse(response);
 }
 
 bool ServerNonInviteTransaction::sendFinalResponse(SipResponseCode code, const std::string& reason) {
-    SipMessage response(code, reason.empty() ? "" : reason);
-    response.getHeaders().setCallId(request_.getHeaders().getCallId());
-    response.getHeaders().setFrom(request_.getHeaders().getFrom());
-    response.getHeaders().setTo(request_.getHeaders().getTo());
-    response.getHeaders().setCSeq(request_.getHeaders().getCSeq());
-    response.getHeaders().setVia(request_.getHeaders().getVia());
+    SipMessage response = SipMessage::createResponse(request_, code, reason);
 
     final_response_sent_ = true;
     return sendResponse(response);
@@ -532,55 +520,44 @@ void ServerNonInviteTransaction::startTimerJ() {
 }
 
 // TransactionIdGenerator implementation
-std::string TransactionIdGenerator::generateClientId(const SipMessage& request) {
+TransactionId TransactionIdGenerator::generateClientId(const SipMessage& request) {
     // Client transaction ID = hash(Request-URI + Via + CSeq + Call-ID + From + To)
-    return hashMessage(request);
+    return hashMessage(request, true);
 }
 
-std::string TransactionIdGenerator::generateServerId(const SipMessage& request) {
+TransactionId TransactionIdGenerator::generateServerId(const SipMessage& request) {
     // Server transaction ID = hash(Via + CSeq + Call-ID + From + To)
     // Note: Request-URI is not included for server transactions
-    std::ostringstream oss;
-    oss << request.getHeaders().getVia()
-        << request.getHeaders().getCSeq()
-        << request.getHeaders().getCallId()
-        << request.getHeaders().getFrom()
-        << request.getHeaders().getTo();
-
-    return std::to_string(std::hash<std::string>{}(oss.str()));
+    return hashMessage(request, false);
 }
 
 std::string TransactionIdGenerator::generateBranch() {
-    // Generate RFC 3261 compliant branch parameter
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 15);
-
-    std::ostringstream oss;
-    oss << "z9hG4bK"; // Magic cookie for RFC 3261 compliance
-
-    // Add 8 random hex characters
-    for (int i = 0; i < 8; ++i) {
-        oss << std::hex << dis(gen);
-    }
-
-    return oss.str();
+    // Magic cookie for RFC 3261 compliance, then 80 random bits so the
+    // branch is unique across space and time
+    std::string branch = "z9hG4bK";
+    core::SecureRandom::appendBase32(branch, 16);
+    return branch;
 }
 
-std::string TransactionIdGenerator::hashMessage(const SipMessage& message) {
-    std::ostringstream oss;
-
-    if (message.isRequest()) {
-        oss << message.getRequestUri().toString();
+TransactionId TransactionIdGenerator::hashMessage(const SipMessage& message, bool include_request_uri) {
+    // Hash the header values in place rather than concatenating copies
+    uint64_t hash = core::FNV_OFFSET_BASIS;
+    if (include_request_uri && message.isRequest()) {
+        hash = core::fnv1a(message.getRequestUri().toString(), hash);
     }
 
-    oss << message.getHeaders().getVia()
-        << message.getHeaders().getCSeq()
-        << message.getHeaders().getCallId()
-        << message.getHeaders().getFrom()
-        << message.getHeaders().getTo();
+    const SipHeaders& headers = message.getHeaders();
+    for (std::string_view name : {"Via", "CSeq", "Call-ID", "From", "To"}) {
+        hash = core::fnv1a(headers.view(name), hash);
+    }
 
-    return std::to_string(std::hash<std::string>{}(oss.str()));
+    // Fixed-width hex, so the copy into the ID has a size known at compile time
+    static constexpr char hex_digits[] = "0123456789abcdef";
+    char digits[16];
+    for (size_t i = 0; i < sizeof(digits); ++i) {
+        digits[i] = hex_digits[(hash >> (60 - 4 * i)) & 0x0F];
+    }
+    return TransactionId(std::string_view(digits, sizeof(digits)));
 }
 
 } // namespace fmus::sip
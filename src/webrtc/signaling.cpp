@@ -1,9 +1,8 @@
 #include "fmus/webrtc/signaling.hpp"
 #include "fmus/core/logger.hpp"
+#include "fmus/core/random.hpp"
 #include <sstream>
-#include <random>
 #include <algorithm>
-#include <regex>
 #include <cstring>
 
 namespace fmus::webrtc {
@@ -111,382 +110,6 @@ SignalingMessage SignalingMessage::fromJson(const std::string& json) {
     return message;
 }
 
-// WebSocketFrame implementation
-std::vector<uint8_t> WebSocketFrame::serialize() const {
-    std::vector<uint8_t> frame;
-    
-    // First byte: FIN + RSV + Opcode
-    uint8_t first_byte = (fin ? 0x80 : 0x00) | static_cast<uint8_t>(opcode);
-    frame.push_back(first_byte);
-    
-    // Second byte: MASK + Payload length
-    uint8_t second_byte = masked ? 0x80 : 0x00;
-    
-    if (payload.size() < 126) {
-        second_byte |= static_cast<uint8_t>(payload.size());
-        frame.push_back(second_byte);
-    } else if (payload.size() < 65536) {
-        second_byte |= 126;
-        frame.push_back(second_byte);
-        frame.push_back((payload.size() >> 8) & 0xFF);
-        frame.push_back(payload.size() & 0xFF);
-    } else {
-        second_byte |= 127;
-        frame.push_back(second_byte);
-        // 64-bit length (simplified - only use lower 32 bits)
-        frame.push_back(0); frame.push_back(0); frame.push_back(0); frame.push_back(0);
-        frame.push_back((payload.size() >> 24) & 0xFF);
-        frame.push_back((payload.size() >> 16) & 0xFF);
-        frame.push_back((payload.size() >> 8) & 0xFF);
-        frame.push_back(payload.size() & 0xFF);
-    }
-    
-    // Masking key (if masked)
-    if (masked) {
-        frame.push_back((mask >> 24) & 0xFF);
-        frame.push_back((mask >> 16) & 0xFF);
-        frame.push_back((mask >> 8) & 0xFF);
-        frame.push_back(mask & 0xFF);
-    }
-    
-    // Payload (apply mask if needed)
-    if (masked) {
-        for (size_t i = 0; i < payload.size(); ++i) {
-            uint8_t mask_byte = (mask >> (8 * (3 - (i % 4)))) & 0xFF;
-            frame.push_back(payload[i] ^ mask_byte);
-        }
-    } else {
-        frame.insert(frame.end(), payload.begin(), payload.end());
-    }
-    
-    return frame;
-}
-
-WebSocketFrame WebSocketFrame::deserialize(const uint8_t* data, size_t size) {
-    WebSocketFrame frame;
-    
-    if (size < 2) {
-        return frame; // Invalid frame
-    }
-    
-    // Parse first byte
-    frame.fin = (data[0] & 0x80) != 0;
-    frame.opcode = static_cast<WebSocketOpcode>(data[0] & 0x0F);
-    
-    // Parse second byte
-    frame.masked = (data[1] & 0x80) != 0;
-    uint8_t payload_len = data[1] & 0x7F;
-    
-    size_t header_size = 2;
-    size_t payload_size = payload_len;
-    
-    // Extended payload length
-    if (payload_len == 126) {
-        if (size < 4) return frame;
-        payload_size = (data[2] << 8) | data[3];
-        header_size = 4;
-    } else if (payload_len == 127) {
-        if (size < 10) return frame;
-        // Simplified - only use lower 32 bits
-        payload_size = (data[6] << 24) | (data[7] << 16) | (data[8] << 8) | data[9];
-        header_size = 10;
-    }
-    
-    // Masking key
-    if (frame.masked) {
-        if (size < header_size + 4) return frame;
-        frame.mask = (data[header_size] << 24) | (data[header_size + 1] << 16) |
-                    (data[header_size + 2] << 8) | data[header_size + 3];
-        header_size += 4;
-    }
-    
-    // Payload
-    if (size < header_size + payload_size) return frame;
-    
-    frame.payload.resize(payload_size);
-    if (frame.masked) {
-        for (size_t i = 0; i < payload_size; ++i) {
-            uint8_t mask_byte = (frame.mask >> (8 * (3 - (i % 4)))) & 0xFF;
-            frame.payload[i] = data[header_size + i] ^ mask_byte;
-        }
-    } else {
-        std::memcpy(frame.payload.data(), data + header_size, payload_size);
-    }
-    
-    return frame;
-}
-
-bool WebSocketFrame::isWebSocketFrame(const uint8_t* data, size_t size) {
-    if (size < 2) return false;
-    
-    // Check if it looks like a WebSocket frame
-    uint8_t opcode = data[0] & 0x0F;
-    return opcode <= 0x0A; // Valid opcodes are 0x0-0x2 and 0x8-0xA
-}
-
-// WebSocketConnection implementation
-WebSocketConnection::WebSocketConnection(std::shared_ptr<network::TcpSocket> socket)
-    : socket_(socket), connected_(false), handshake_complete_(false) {
-    
-    connection_id_ = generateClientId();
-    
-    socket_->setDataCallback([this](const std::vector<uint8_t>& data, const network::SocketAddress& from) {
-        onSocketData(data, from);
-    });
-    
-    socket_->setErrorCallback([this](const std::string& error) {
-        onSocketError(error);
-    });
-    
-    socket_->startReceiving();
-}
-
-WebSocketConnection::~WebSocketConnection() {
-    close();
-}
-
-bool WebSocketConnection::performHandshake(const std::string& request) {
-    // Parse WebSocket handshake request
-    std::regex key_regex(R"(Sec-WebSocket-Key:\s*([^\r\n]+))");
-    std::smatch match;
-    
-    if (!std::regex_search(request, match, key_regex)) {
-        return false;
-    }
-    
-    std::string websocket_key = match[1].str();
-    std::string websocket_accept = generateWebSocketAccept(websocket_key);
-    
-    // Create handshake response
-    std::ostringstream response;
-    response << "HTTP/1.1 101 Switching Protocols\r\n"
-             << "Upgrade: websocket\r\n"
-             << "Connection: Upgrade\r\n"
-             << "Sec-WebSocket-Accept: " << websocket_accept << "\r\n"
-             << "\r\n";
-    
-    std::string response_str = response.str();
-    std::vector<uint8_t> response_data(response_str.begin(), response_str.end());
-    
-    if (socket_->send(response_data)) {
-        handshake_complete_ = true;
-        connected_ = true;
-        core::Logger::info("WebSocket handshake completed for connection {}", connection_id_);
-        return true;
-    }
-    
-    return false;
-}
-
-void WebSocketConnection::close() {
-    if (connected_) {
-        // Send close frame
-        WebSocketFrame close_frame;
-        close_frame.opcode = WebSocketOpcode::CLOSE;
-        close_frame.fin = true;
-        
-        auto frame_data = close_frame.serialize();
-        socket_->send(frame_data);
-        
-        connected_ = false;
-        
-        if (close_callback_) {
-            close_callback_();
-        }
-    }
-    
-    if (socket_) {
-        socket_->close();
-    }
-}
-
-bool WebSocketConnection::sendMessage(const std::string& message) {
-    if (!connected_) {
-        return false;
-    }
-    
-    WebSocketFrame frame;
-    frame.opcode = WebSocketOpcode::TEXT;
-    frame.fin = true;
-    frame.payload.assign(message.begin(), message.end());
-    
-    auto frame_data = frame.serialize();
-    return socket_->send(frame_data);
-}
-
-bool WebSocketConnection::sendPing() {
-    if (!connected_) {
-        return false;
-    }
-    
-    WebSocketFrame frame;
-    frame.opcode = WebSocketOpcode::PING;
-    frame.fin = true;
-    
-    auto frame_data = frame.serialize();
-    return socket_->send(frame_data);
-}
-
-bool WebSocketConnection::sendPong() {
-    if (!connected_) {
-        return false;
-    }
-    
-    WebSocketFrame frame;
-    frame.opcode = WebSocketOpcode::PONG;
-    frame.fin = true;
-    
-    auto frame_data = frame.serialize();
-    return socket_->send(frame_data);
-}
-
-const network::SocketAddress& WebSocketConnection::getRemoteAddress() const {
-    static network::SocketAddress default_addr;
-    if (socket_) {
-        return socket_->getRemoteAddress();
-    }
-    return default_addr;
-}
-
-void WebSocketConnection::onSocketData(const std::vector<uint8_t>& data, const network::SocketAddress& /* from */) {
-    if (!handshake_complete_) {
-        // Handle HTTP handshake
-        std::string request(data.begin(), data.end());
-        if (request.find("GET") == 0 && request.find("Upgrade: websocket") != std::string::npos) {
-            performHandshake(request);
-        }
-        return;
-    }
-    
-    // Append to frame buffer
-    frame_buffer_.insert(frame_buffer_.end(), data.begin(), data.end());
-    
-    // Try to parse WebSocket frames
-    while (frame_buffer_.size() >= 2) {
-        if (!WebSocketFrame::isWebSocketFrame(frame_buffer_.data(), frame_buffer_.size())) {
-            frame_buffer_.clear();
-            break;
-        }
-        
-        WebSocketFrame frame = WebSocketFrame::deserialize(frame_buffer_.data(), frame_buffer_.size());
-        
-        // Check if we have a complete frame
-        size_t frame_size = 2; // Minimum header size
-        uint8_t payload_len = frame_buffer_[1] & 0x7F;
-        
-        if (payload_len == 126) frame_size += 2;
-        else if (payload_len == 127) frame_size += 8;
-        
-        if (frame_buffer_[1] & 0x80) frame_size += 4; // Mask
-        
-        size_t actual_payload_size = payload_len;
-        if (payload_len == 126 && frame_buffer_.size() >= 4) {
-            actual_payload_size = (frame_buffer_[2] << 8) | frame_buffer_[3];
-        } else if (payload_len == 127 && frame_buffer_.size() >= 10) {
-            actual_payload_size = (frame_buffer_[6] << 24) | (frame_buffer_[7] << 16) |
-                                 (frame_buffer_[8] << 8) | frame_buffer_[9];
-        }
-        
-        frame_size += actual_payload_size;
-        
-        if (frame_buffer_.size() < frame_size) {
-            break; // Wait for more data
-        }
-        
-        processWebSocketFrame(frame);
-        
-        // Remove processed frame from buffer
-        frame_buffer_.erase(frame_buffer_.begin(), frame_buffer_.begin() + frame_size);
-    }
-}
-
-void WebSocketConnection::onSocketError(const std::string& error) {
-    core::Logger::error("WebSocket connection {} error: {}", connection_id_, error);
-    connected_ = false;
-    
-    if (error_callback_) {
-        error_callback_(error);
-    }
-}
-
-void WebSocketConnection::processWebSocketFrame(const WebSocketFrame& frame) {
-    switch (frame.opcode) {
-        case WebSocketOpcode::TEXT: {
-            std::string message(frame.payload.begin(), frame.payload.end());
-            if (message_callback_) {
-                message_callback_(message);
-            }
-            break;
-        }
-        
-        case WebSocketOpcode::PING:
-            sendPong();
-            break;
-            
-        case WebSocketOpcode::PONG:
-            // Handle pong if needed
-            break;
-            
-        case WebSocketOpcode::CLOSE:
-            close();
-            break;
-            
-        default:
-            core::Logger::debug("Unhandled WebSocket opcode: {}", static_cast<int>(frame.opcode));
-            break;
-    }
-}
-
-std::string WebSocketConnection::generateWebSocketAccept(const std::string& key) const {
-    std::string magic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
-    std::string combined = key + magic;
-    
-    // Calculate SHA-1 hash (simplified implementation)
-    std::string hash = calculateSHA1(combined);
-    
-    // Base64 encode
-    std::vector<uint8_t> hash_bytes(hash.begin(), hash.end());
-    return base64Encode(hash_bytes);
-}
-
-std::string WebSocketConnection::calculateSHA1(const std::string& data) const {
-    // Placeholder implementation - would use proper SHA-1 library in production
-    std::hash<std::string> hasher;
-    size_t hash_value = hasher(data);
-    
-    std::ostringstream oss;
-    oss << std::hex << hash_value;
-    return oss.str();
-}
-
-std::string WebSocketConnection::base64Encode(const std::vector<uint8_t>& data) const {
-    // Simplified base64 encoding
-    const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string result;
-    
-    for (size_t i = 0; i < data.size(); i += 3) {
-        uint32_t value = 0;
-        int count = 0;
-        
-        for (int j = 0; j < 3 && i + j < data.size(); ++j) {
-            value = (value << 8) | data[i + j];
-            count++;
-        }
-        
-        value <<= (3 - count) * 8;
-        
-        for (int j = 0; j < 4; ++j) {
-            if (j <= count) {
-                result += chars[(value >> (18 - j * 6)) & 0x3F];
-            } else {
-                result += '=';
-            }
-        }
-    }
-    
-    return result;
-}
-
 // SignalingServer implementation
 SignalingServer::SignalingServer() : running_(false) {
 }
@@ -524,6 +147,12 @@ bool SignalingServer::start(const network::SocketAddress& bind_address) {
         return false;
     }
 
+    if (!writer_.start()) {
+        server_socket_->close();
+        server_socket_.reset();
+        return false;
+    }
+
     server_socket_->acceptConnections();
     running_ = true;
 
@@ -539,77 +168,100 @@ void SignalingServer::stop() {
     running_ = false;
 
     // Close all connections
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& [id, connection] : connections_) {
+    std::unordered_map<std::string, std::shared_ptr<WebSocketConnection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections.swap(connections_);
+        sessions_.clear();
+        client_to_session_.clear();
+    }
+
+    for (auto& [id, connection] : connections) {
         connection->close();
     }
-    connections_.clear();
-    sessions_.clear();
-    client_to_session_.clear();
+    connections.clear();
 
     if (server_socket_) {
         server_socket_->close();
         server_socket_.reset();
     }
 
+    writer_.stop();
+
     core::Logger::info("WebRTC signaling server stopped");
 }
 
 bool SignalingServer::sendMessage(const SignalingMessage& message, const std::string& connection_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    auto it = connections_.find(connection_id);
-    if (it != connections_.end()) {
-        bool success = it->second->sendMessage(message.toJson());
-        if (success) {
-            stats_.messages_sent++;
-        } else {
-            stats_.errors++;
+    std::shared_ptr<WebSocketConnection> connection;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = connections_.find(connection_id);
+        if (it == connections_.end()) {
+            return false;
         }
-        return success;
+        connection = it->second;
     }
 
-    return false;
+    return fanOut(WebSocketConnection::encodeMessage(message.toJson()), {connection});
 }
 
 bool SignalingServer::broadcastMessage(const SignalingMessage& message) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    bool success = true;
-    for (auto& [id, connection] : connections_) {
-        if (!connection->sendMessage(message.toJson())) {
-            success = false;
-            stats_.errors++;
-        } else {
-            stats_.messages_sent++;
+    // Encode once, outside the lock; every recipient shares the same buffer
+    auto frame = WebSocketConnection::encodeMessage(message.toJson());
+
+    std::vector<std::shared_ptr<WebSocketConnection>> recipients;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        recipients.reserve(connections_.size());
+        for (const auto& [id, connection] : connections_) {
+            recipients.push_back(connection);
         }
     }
 
-    return success;
+    return fanOut(frame, recipients);
 }
 
 bool SignalingServer::sendToSession(const SignalingMessage& message, const std::string& session_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    auto frame = WebSocketConnection::encodeMessage(message.toJson());
 
-    auto session_it = sessions_.find(session_id);
-    if (session_it == sessions_.end()) {
-        return false;
-    }
+    std::vector<std::shared_ptr<WebSocketConnection>> recipients;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
 
-    bool success = true;
-    for (const std::string& participant_id : session_it->second.participants) {
-        auto conn_it = connections_.find(participant_id);
-        if (conn_it != connections_.end()) {
-            if (!conn_it->second->sendMessage(message.toJson())) {
-                success = false;
-                stats_.errors++;
-            } else {
-                stats_.messages_sent++;
+        auto session_it = sessions_.find(session_id);
+        if (session_it == sessions_.end()) {
+            return false;
+        }
+
+        recipients.reserve(session_it->second.participants.size());
+        for (const std::string& participant_id : session_it->second.participants) {
+            auto conn_it = connections_.find(participant_id);
+            if (conn_it != connections_.end()) {
+                recipients.push_back(conn_it->second);
             }
         }
     }
 
-    return success;
+    return fanOut(frame, recipients);
+}
+
+bool SignalingServer::fanOut(const network::SharedBuffer& frame,
+                             const std::vector<std::shared_ptr<WebSocketConnection>>& recipients) {
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+
+    for (const auto& connection : recipients) {
+        if (connection->sendFrame(frame)) {
+            sent++;
+        } else {
+            failed++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.messages_sent += sent;
+    stats_.errors += failed;
+    return failed == 0;
 }
 
 void SignalingServer::disconnectClient(const std::string& connection_id) {
@@ -743,6 +395,12 @@ void SignalingServer::onNewConnection(std::shared_ptr<network::Socket> connectio
         return;
     }
 
+    // Attach before the connection starts receiving so every send is queued
+    if (!writer_.attach(*tcp_connection)) {
+        core::Logger::warn("Signaling connection from {} uses synchronous sends",
+                          tcp_connection->getRemoteAddress().toString());
+    }
+
     auto ws_connection = std::make_shared<WebSocketConnection>(tcp_connection);
 
     ws_connection->setMessageCallback([this, ws_connection](const std::string& message) {
@@ -760,6 +418,7 @@ void SignalingServer::onNewConnection(std::shared_ptr<network::Socket> connectio
     std::lock_guard<std::mutex> lock(mutex_);
     connections_[ws_connection->getId()] = ws_connection;
     stats_.connections_accepted++;
+    ws_connection->start();
 
     if (client_connected_callback_) {
         client_connected_callback_(ws_connection->getId());
@@ -892,33 +551,15 @@ void SignalingServer::handleBye(const SignalingMessage& message, const std::stri
 
 // Utility functions
 std::string generateSessionId() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 15);
-
-    std::ostringstream oss;
-    oss << "session-";
-
-    for (int i = 0; i < 16; ++i) {
-        oss << std::hex << dis(gen);
-    }
-
-    return oss.str();
+    std::string id = "session-";
+    core::SecureRandom::appendHex(id, 16);
+    return id;
 }
 
 std::string generateClientId() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 15);
-
-    std::ostringstream oss;
-    oss << "client-";
-
-    for (int i = 0; i < 12; ++i) {
-        oss << std::hex << dis(gen);
-    }
-
-    return oss.str();
+    std::string id = "client-";
+    core::SecureRandom::appendHex(id, 12);
+    return id;
 }
 
 std::string signalingMessageTypeToString(SignalingMessageType type) {